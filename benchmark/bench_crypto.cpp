@@ -373,6 +373,57 @@ class AesIgeShortBench final : public td::Benchmark {
   }
 };
 
+// computes message key and encrypts MTProto-like packets with different keys as Transport does
+template <bool reuse_contexts>
+class MtprotoPacketBench final : public td::Benchmark {
+ public:
+  explicit MtprotoPacketBench(std::size_t packet_size) : packet_size_(packet_size) {
+  }
+
+  std::string get_description() const final {
+    return PSTRING() << "MTProto packet " << (reuse_contexts ? "with reused contexts " : "with new contexts ") << "["
+                     << packet_size_ << "B]";
+  }
+
+  void start_up() final {
+    auth_key_ = std::string(256, '\0');
+    td::Random::secure_bytes(auth_key_);
+    packet_ = std::string(packet_size_, '\x7b');
+    td::Random::secure_bytes(as_mutable_slice(key_));
+    td::Random::secure_bytes(as_mutable_slice(iv_));
+  }
+
+  void run(int n) final {
+    td::Slice auth_key_part = td::Slice(auth_key_).substr(88, 32);
+    td::UInt256 msg_key;
+    for (int i = 0; i < n; i++) {
+      if (reuse_contexts) {
+        td::sha256(auth_key_part, packet_, as_mutable_slice(msg_key));
+        td::aes_ige_encrypt(as_slice(key_), as_mutable_slice(iv_), packet_, td::MutableSlice(packet_));
+      } else {
+        td::Sha256State state;
+        state.init();
+        state.feed(auth_key_part);
+        state.feed(packet_);
+        state.extract(as_mutable_slice(msg_key));
+
+        td::AesIgeState ige;
+        ige.init(as_slice(key_), as_slice(iv_), true);
+        ige.encrypt(packet_, td::MutableSlice(packet_));
+      }
+      key_.raw[0] = msg_key.raw[0];
+    }
+    td::do_not_optimize_away(msg_key.raw[0]);
+  }
+
+ private:
+  std::size_t packet_size_;
+  std::string auth_key_;
+  std::string packet_;
+  td::UInt256 key_;
+  td::UInt256 iv_;
+};
+
 BENCH(Rand, "std_rand") {
   int res = 0;
   for (int i = 0; i < n; i++) {
@@ -502,6 +553,10 @@ int main() {
   td::bench(AesIgeEncryptBench());
   td::bench(AesIgeDecryptBench());
   td::bench(AesEcbBench());
+  for (std::size_t packet_size : {64, 256, 1024, 4096, 16384}) {
+    td::bench(MtprotoPacketBench<false>(packet_size));
+    td::bench(MtprotoPacketBench<true>(packet_size));
+  }
 
   td::bench(Pbkdf2Bench());
   td::bench(RandBench());
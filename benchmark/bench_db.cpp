@@ -11,7 +11,9 @@
 #include "td/db/SeqKeyValue.h"
 #include "td/db/SqliteConnectionSafe.h"
 #include "td/db/SqliteDb.h"
+#include "td/db/SqliteKeyValue.h"
 #include "td/db/SqliteKeyValueAsync.h"
+#include "td/db/SqliteKeyValueCache.h"
 #include "td/db/SqliteKeyValueSafe.h"
 
 #include "td/actor/actor.h"
@@ -199,6 +201,67 @@ class SqliteKeyValueAsyncBench final : public td::Benchmark {
   }
 };
 
+// reads keys from the SQLite PMC with a few frequently used keys, as it is done on hot paths;
+// one operation is one get and each tenth operation is a set of the same value
+class SqliteKeyValueGetBench final : public td::Benchmark {
+ public:
+  explicit SqliteKeyValueGetBench(size_t cache_size) : cache_size_(cache_size) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "SqliteKeyValue get " << td::tag("cache_size", cache_size_);
+  }
+
+  void start_up() final {
+    td::string sql_db_name = "testdb.sqlite";
+    td::SqliteDb::destroy(sql_db_name).ignore();
+    auto db = td::SqliteDb::open_with_key(sql_db_name, true, td::DbKey::empty()).move_as_ok();
+    init_db(db).ensure();
+    kv_.init_with_connection(std::move(db), "common").ensure();
+    if (cache_size_ > 0) {
+      cache_ = std::make_shared<td::SqliteKeyValueCache>(cache_size_);
+      kv_.set_cache(cache_);
+    }
+    for (int i = 0; i < KEY_COUNT; i++) {
+      kv_.set(get_key(i), td::string(100, 'a'));
+    }
+  }
+
+  void run(int n) final {
+    for (int i = 0; i < n; i++) {
+      // 90% of requests are for 10% of keys
+      auto key_id = i % 10 == 0 ? (i * 7) % KEY_COUNT : (i * 7) % (KEY_COUNT / 10);
+      auto value = kv_.get(get_key(key_id));
+      CHECK(value.size() == 100);
+      if (i % 10 == 5) {
+        kv_.set(get_key(key_id), value);
+      }
+    }
+  }
+
+  void tear_down() final {
+    if (cache_ != nullptr) {
+      auto stats = cache_->get_stats();
+      LOG(ERROR) << "Cache hit rate is " << stats.get_hit_rate() << ", skipped " << stats.skipped_write_count
+                 << " writes";
+    }
+    kv_.close();
+    cache_ = nullptr;
+    td::SqliteDb::destroy("testdb.sqlite").ignore();
+  }
+
+ private:
+  static constexpr int KEY_COUNT = 10000;
+
+  size_t cache_size_;
+  td::SqliteKeyValue kv_;
+  std::shared_ptr<td::SqliteKeyValueCache> cache_;
+
+  static td::string get_key(int key_id) {
+    return PSTRING() << "key" << key_id;
+  }
+};
+
 class SeqKvBench final : public td::Benchmark {
   td::string get_description() const final {
     return "SeqKvBench";
@@ -240,5 +303,8 @@ int main() {
   bench(SqliteKVBench<false>());
   bench(SqliteKVBench<true>());
   bench(SqliteKeyValueAsyncBench());
+  for (size_t cache_size : {0, 1 << 16, 1 << 20}) {
+    bench(SqliteKeyValueGetBench(cache_size));
+  }
   bench(SeqKvBench());
 }
@@ -12,31 +12,55 @@
 #include "td/utils/common.h"
 #include "td/utils/find_boundary.h"
 #include "td/utils/logging.h"
+#include "td/utils/SliceBuilder.h"
+
+#include <utility>
 
 static std::string http_query = "GET / HTTP/1.1\r\nConnection:keep-alive\r\nhost:127.0.0.1:8080\r\n\r\n";
+static std::string long_http_query =
+    "POST /bot123456:ABCDEF/getUpdates HTTP/1.1\r\nHost: api.example.org:8080\r\nConnection: keep-alive\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.9\r\nAccept-Encoding: identity\r\nCache-Control: no-cache\r\n"
+    "X-Forwarded-For: 192.168.0.1, 10.0.0.1\r\nContent-Length: 0\r\n\r\n";
 static const size_t block_size = 2500;
 
 class HttpReaderBench final : public td::Benchmark {
+ public:
+  // if reuse_query is false, then a new HttpQuery is allocated for each request like it is done by HttpConnectionBase
+  // if the handler doesn't return queries with reuse_query
+  HttpReaderBench(std::string query, bool reuse_query) : query_(std::move(query)), reuse_query_(reuse_query) {
+  }
+
+ private:
+  std::string query_;
+  bool reuse_query_;
+
   std::string get_description() const final {
-    return "HttpReaderBench";
+    return PSTRING() << "HttpReaderBench " << query_.size() << (reuse_query_ ? " reused" : " new");
   }
 
   void run(int n) final {
-    auto cnt = static_cast<int>(block_size / http_query.size());
-    td::HttpQuery q;
+    auto cnt = static_cast<int>(block_size / query_.size());
+    auto q = td::make_unique<td::HttpQuery>();
     int parsed = 0;
     int sent = 0;
     for (int i = 0; i < n; i += cnt) {
       for (int j = 0; j < cnt; j++) {
-        writer_.append(http_query);
+        writer_.append(query_);
         sent++;
       }
       reader_.sync_with_writer();
       while (true) {
-        auto wait = http_reader_.read_next(&q).ok();
+        auto wait = http_reader_.read_next(q.get()).ok();
         if (wait != 0) {
           break;
         }
+        if (reuse_query_) {
+          q->clear();
+        } else {
+          q = td::make_unique<td::HttpQuery>();
+        }
         parsed++;
       }
     }
@@ -81,21 +105,28 @@ class BufferBench final : public td::Benchmark {
 };
 
 class FindBoundaryBench final : public td::Benchmark {
+ public:
+  explicit FindBoundaryBench(std::string query) : query_(std::move(query)) {
+  }
+
+ private:
+  std::string query_;
+
   std::string get_description() const final {
-    return "FindBoundaryBench";
+    return PSTRING() << "FindBoundaryBench " << query_.size();
   }
 
   void run(int n) final {
-    auto cnt = static_cast<int>(block_size / http_query.size());
+    auto cnt = static_cast<int>(block_size / query_.size());
     for (int i = 0; i < n; i += cnt) {
       for (int j = 0; j < cnt; j++) {
-        writer_.append(http_query);
+        writer_.append(query_);
       }
       reader_.sync_with_writer();
       for (int j = 0; j < cnt; j++) {
         size_t len = 0;
         find_boundary(reader_.clone(), "\r\n\r\n", len);
-        CHECK(size_t(len) + 4 == http_query.size());
+        CHECK(size_t(len) + 4 == query_.size());
         auto result = reader_.cut_head(len + 2);
         reader_.advance(2);
       }
@@ -114,6 +145,9 @@ class FindBoundaryBench final : public td::Benchmark {
 int main() {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(WARNING));
   td::bench(BufferBench());
-  td::bench(FindBoundaryBench());
-  td::bench(HttpReaderBench());
+  for (auto &query : {http_query, long_http_query}) {
+    td::bench(FindBoundaryBench(query));
+    td::bench(HttpReaderBench(query, false));
+    td::bench(HttpReaderBench(query, true));
+  }
 }
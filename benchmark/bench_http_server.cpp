@@ -7,6 +7,7 @@
 #include "td/net/HttpHeaderCreator.h"
 #include "td/net/HttpInboundConnection.h"
 #include "td/net/HttpQuery.h"
+#include "td/net/MultiTcpListener.h"
 #include "td/net/TcpListener.h"
 
 #include "td/actor/actor.h"
@@ -14,16 +15,23 @@
 
 #include "td/utils/buffer.h"
 #include "td/utils/BufferedFd.h"
+#include "td/utils/common.h"
 #include "td/utils/logging.h"
 #include "td/utils/port/SocketFd.h"
 #include "td/utils/Slice.h"
+#include "td/utils/Time.h"
 
-static int cnt = 0;
+#include <atomic>
+#include <cstdlib>
+#include <utility>
+
+static std::atomic<td::uint64> query_count{0};
 
 class HelloWorld final : public td::HttpInboundConnection::Callback {
  public:
   void handle(td::unique_ptr<td::HttpQuery> query, td::ActorOwn<td::HttpInboundConnection> connection) final {
     // LOG(ERROR) << *query;
+    query_count.fetch_add(1, std::memory_order_relaxed);
     td::HttpHeaderCreator hc;
     td::Slice content = "hello world";
     //auto content = td::BufferSlice("hello world");
@@ -36,49 +44,54 @@ class HelloWorld final : public td::HttpInboundConnection::Callback {
 
     auto res = hc.finish(content);
     LOG_IF(FATAL, res.is_error()) << res.error();
+    send_closure(connection, &td::HttpInboundConnection::reuse_query, std::move(query));
     send_closure(connection, &td::HttpInboundConnection::write_next, td::BufferSlice(res.ok()));
     send_closure(connection.release(), &td::HttpInboundConnection::write_ok);
   }
   void hangup() final {
-    LOG(ERROR) << "CLOSE " << cnt--;
     stop();
   }
 };
 
-const int N = 0;
+// accepts connections on the scheduler, on which it was created, and handles them on the same scheduler
 class Server final : public td::TcpListener::Callback {
  public:
-  void start_up() final {
-    listener_ =
-        td::create_actor<td::TcpListener>("Listener", 8082, td::ActorOwn<td::TcpListener::Callback>(actor_id(this)));
-  }
   void accept(td::SocketFd fd) final {
-    LOG(ERROR) << "ACCEPT " << cnt++;
-    pos_++;
-    auto scheduler_id = pos_ % (N != 0 ? N : 1) + (N != 0);
-    td::create_actor_on_scheduler<td::HttpInboundConnection>(
-        "HttpInboundConnection", scheduler_id, td::BufferedFd<td::SocketFd>(std::move(fd)), 1024 * 1024, 0, 0,
-        td::create_actor_on_scheduler<HelloWorld>("HelloWorld", scheduler_id))
+    td::create_actor<td::HttpInboundConnection>("HttpInboundConnection", td::BufferedFd<td::SocketFd>(std::move(fd)),
+                                                1024 * 1024, 0, 0, td::create_actor<HelloWorld>("HelloWorld"))
         .release();
   }
-  void hangup() final {
-    // may be it should be default?..
-    LOG(ERROR) << "Hanging up..";
-    stop();
-  }
-
- private:
-  td::ActorOwn<td::TcpListener> listener_;
-  int pos_{0};
 };
 
-int main() {
+int main(int argc, char **argv) {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
-  auto scheduler = td::make_unique<td::ConcurrentScheduler>(N, 0);
-  scheduler->create_actor_unsafe<Server>(0, "Server").release();
+  // the number of threads handling connections; run the benchmark with different values to see the scaling
+  int thread_count = argc > 1 ? std::atoi(argv[1]) : 1;
+  if (thread_count <= 0) {
+    thread_count = 1;
+  }
+  auto scheduler = td::make_unique<td::ConcurrentScheduler>(thread_count - 1, 0);
+  td::vector<td::int32> scheduler_ids;
+  for (td::int32 i = 0; i < thread_count; i++) {
+    scheduler_ids.push_back(i);
+  }
+  scheduler
+      ->create_actor_unsafe<td::MultiTcpListener>(
+          0, "MultiTcpListener", 8082, std::move(scheduler_ids),
+          [] { return td::ActorOwn<td::TcpListener::Callback>(td::create_actor<Server>("Server")); })
+      .release();
   scheduler->start();
+  auto last_query_count = query_count.load();
+  auto last_time = td::Time::now();
   while (scheduler->run_main(10)) {
-    // empty
+    auto now = td::Time::now();
+    auto new_query_count = query_count.load();
+    if (now >= last_time + 5) {
+      LOG(ERROR) << thread_count << " threads: "
+                 << static_cast<double>(new_query_count - last_query_count) / (now - last_time) << " requests/second";
+      last_query_count = new_query_count;
+      last_time = now;
+    }
   }
   scheduler->finish();
 }
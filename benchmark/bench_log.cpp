@@ -4,16 +4,30 @@
 // Distributed under the Boost Software License, Version 1.0. (See accompanying
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
+#include "td/utils/AsyncFileLog.h"
 #include "td/utils/benchmark.h"
 #include "td/utils/common.h"
+#include "td/utils/FileLog.h"
 #include "td/utils/logging.h"
+#include "td/utils/MpscPollableQueue.h"
+#include "td/utils/port/Clocks.h"
+#include "td/utils/port/FileFd.h"
+#include "td/utils/port/path.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/TsFileLog.h"
+#include "td/utils/TsLog.h"
 
+#include <algorithm>
 #include <cstdio>
+#include <functional>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <ostream>
 #include <streambuf>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <unistd.h>
 
@@ -150,7 +164,223 @@ class LogWriteBench final : public td::Benchmark {
   }
 };
 
+// measures lines per second and latency percentiles of LOG calls with the given LogInterface
+class LogInterfaceBench final : public td::Benchmark {
+ public:
+  LogInterfaceBench(std::string name, int threads_n, std::function<td::unique_ptr<td::LogInterface>()> creator)
+      : name_(std::move(name)), threads_n_(threads_n), creator_(std::move(creator)) {
+  }
+
+  std::string get_description() const final {
+    return PSTRING() << name_ << " " << td::tag("threads_n", threads_n_);
+  }
+
+  void start_up() final {
+    log_ = creator_();
+    latencies_.clear();
+    latencies_.resize(threads_n_);
+  }
+
+  void run(int n) final {
+    auto old_log_interface = td::log_interface;
+    td::log_interface = log_.get();
+
+    std::vector<td::thread> threads(threads_n_);
+    for (int i = 0; i < threads_n_; i++) {
+      threads[i] = td::thread([this, i, n] {
+        auto &latencies = latencies_[i];
+        for (int j = 0; j < n; j++) {
+          if (j % 16 == 0) {
+            auto begin_time = td::Clocks::monotonic();
+            LOG(ERROR) << "This is just for test" << 987654321 << ' ' << j;
+            latencies.push_back(td::Clocks::monotonic() - begin_time);
+          } else {
+            LOG(ERROR) << "This is just for test" << 987654321 << ' ' << j;
+          }
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    td::log_interface = old_log_interface;
+  }
+
+  void tear_down() final {
+    for (const auto &path : log_->get_file_paths()) {
+      td::unlink(path).ignore();
+    }
+    log_.reset();
+
+    std::vector<double> latencies;
+    for (auto &thread_latencies : latencies_) {
+      latencies.insert(latencies.end(), thread_latencies.begin(), thread_latencies.end());
+    }
+    if (latencies.empty()) {
+      return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto get_percentile = [&latencies](double percentile) {
+      return latencies[static_cast<std::size_t>(static_cast<double>(latencies.size() - 1) * percentile)] * 1e6;
+    };
+    std::fprintf(stderr, "%s: p50 = %.2fus, p99 = %.2fus, p99.9 = %.2fus, max = %.2fus\n",
+                 get_description().c_str(), get_percentile(0.5), get_percentile(0.99), get_percentile(0.999),
+                 latencies.back() * 1e6);
+  }
+
+ private:
+  std::string name_;
+  int threads_n_ = 0;
+  std::function<td::unique_ptr<td::LogInterface>()> creator_;
+  td::unique_ptr<td::LogInterface> log_;
+  std::vector<std::vector<double>> latencies_;
+};
+
+template <class LogT>
+class LogInterfaceWrapper final : public td::LogInterface {
+ public:
+  template <class F>
+  explicit LogInterfaceWrapper(F &&init) {
+    init(log_);
+  }
+
+  void do_append(int log_level, td::CSlice slice) final {
+    static_cast<td::LogInterface &>(log_).do_append(log_level, slice);
+  }
+
+  std::vector<std::string> get_file_paths() final {
+    return static_cast<td::LogInterface &>(log_).get_file_paths();
+  }
+
+ private:
+  LogT log_;
+};
+
+// the previous implementation of AsyncFileLog, which passes each log line to the logging thread
+// as a separate heap-allocated string; kept as a baseline for the ring buffer
+class StringQueueFileLog final : public td::LogInterface {
+ public:
+  StringQueueFileLog() = default;
+  StringQueueFileLog(const StringQueueFileLog &) = delete;
+  StringQueueFileLog &operator=(const StringQueueFileLog &) = delete;
+  StringQueueFileLog(StringQueueFileLog &&) = delete;
+  StringQueueFileLog &operator=(StringQueueFileLog &&) = delete;
+  ~StringQueueFileLog() final {
+    if (queue_ == nullptr) {
+      return;
+    }
+    Query query;
+    query.type_ = Query::Type::Close;
+    queue_->writer_put(std::move(query));
+    logging_thread_.join();
+  }
+
+  void init(std::string path) {
+    auto fd = td::FileFd::open(path, td::FileFd::Create | td::FileFd::Write | td::FileFd::Append).move_as_ok();
+    path_ = std::move(path);
+
+    queue_ = td::make_unique<td::MpscPollableQueue<Query>>();
+    queue_->init();
+
+    logging_thread_ = td::thread([queue = queue_.get(), fd = std::move(fd)]() mutable {
+      while (true) {
+        int ready_count = queue->reader_wait_nonblock();
+        if (ready_count == 0) {
+          queue->reader_get_event_fd().wait(1000);
+          continue;
+        }
+        bool need_close = false;
+        while (ready_count-- > 0) {
+          Query query = queue->reader_get_unsafe();
+          if (query.type_ == Query::Type::Close) {
+            need_close = true;
+            continue;
+          }
+          td::Slice slice = query.data_;
+          while (!slice.empty()) {
+            slice.remove_prefix(fd.write(slice).move_as_ok());
+          }
+        }
+        queue->reader_flush();
+
+        if (need_close) {
+          fd.close();
+          break;
+        }
+      }
+    });
+  }
+
+  void do_append(int log_level, td::CSlice slice) final {
+    Query query;
+    query.data_ = slice.str();
+    queue_->writer_put(std::move(query));
+  }
+
+  std::vector<std::string> get_file_paths() final {
+    return {path_};
+  }
+
+ private:
+  struct Query {
+    enum class Type : td::int32 { Log, Close };
+    Type type_ = Type::Log;
+    std::string data_;
+  };
+
+  std::string path_;
+  td::unique_ptr<td::MpscPollableQueue<Query>> queue_;
+  td::thread logging_thread_;
+};
+
+static void bench_log_interfaces() {
+  static const td::int64 MAX_SIZE = std::numeric_limits<td::int64>::max();
+  for (auto threads_n : {1, 4, 8}) {
+    td::bench(LogInterfaceBench("FileLog + TsLog", threads_n, [] {
+      class FileTsLog final : public td::LogInterface {
+       public:
+        FileTsLog() {
+          file_log_.init(create_tmp_file(), MAX_SIZE, false).ensure();
+          ts_log_.init(&file_log_);
+        }
+        void do_append(int log_level, td::CSlice slice) final {
+          static_cast<td::LogInterface &>(ts_log_).do_append(log_level, slice);
+        }
+        std::vector<std::string> get_file_paths() final {
+          return file_log_.get_file_paths();
+        }
+
+       private:
+        td::FileLog file_log_;
+        td::TsLog ts_log_{nullptr};
+      };
+      return td::make_unique<FileTsLog>();
+    }));
+    td::bench(LogInterfaceBench("TsFileLog", threads_n, [] {
+      return td::TsFileLog::create(create_tmp_file(), MAX_SIZE, false).move_as_ok();
+    }));
+    td::bench(LogInterfaceBench("AsyncFileLog string queue", threads_n, [] {
+      return td::make_unique<LogInterfaceWrapper<StringQueueFileLog>>(
+          [](StringQueueFileLog &log) { log.init(create_tmp_file()); });
+    }));
+    td::bench(LogInterfaceBench("AsyncFileLog block", threads_n, [] {
+      return td::make_unique<LogInterfaceWrapper<td::AsyncFileLog>>([](td::AsyncFileLog &log) {
+        log.init(create_tmp_file(), MAX_SIZE, false).ensure();
+      });
+    }));
+    td::bench(LogInterfaceBench("AsyncFileLog drop", threads_n, [] {
+      return td::make_unique<LogInterfaceWrapper<td::AsyncFileLog>>([](td::AsyncFileLog &log) {
+        log.init(create_tmp_file(), MAX_SIZE, false, td::AsyncFileLog::DEFAULT_BUFFER_SIZE,
+                 td::AsyncFileLog::OverflowPolicy::Drop)
+            .ensure();
+      });
+    }));
+  }
+}
+
 int main() {
+  bench_log_interfaces();
   td::bench(LogWriteBench());
 #if TD_ANDROID
   td::bench(ALogWriteBench());
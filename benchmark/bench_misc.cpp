@@ -4,14 +4,34 @@
 // Distributed under the Boost Software License, Version 1.0. (See accompanying
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
+#include "td/telegram/EmojiKeywordIndex.h"
+#include "td/telegram/files/FileDownloadWorker.h"
+#include "td/telegram/MessageEntity.h"
+#include "td/telegram/StickerSearchIndex.h"
+#include "td/telegram/StickerSetId.h"
 #include "td/telegram/td_api.h"
 #include "td/telegram/telegram_api.h"
 #include "td/telegram/telegram_api.hpp"
 
+#include "td/actor/actor.h"
+#include "td/actor/ConcurrentScheduler.h"
+
+#include "td/db/SqliteDb.h"
+#include "td/db/SqliteKeyValue.h"
+
 #include "td/utils/algorithm.h"
+#include "td/utils/as.h"
 #include "td/utils/benchmark.h"
+#include "td/utils/buffer.h"
+#include "td/utils/ByteFlow.h"
 #include "td/utils/common.h"
+#include "td/utils/crypto.h"
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/FlatHashSet.h"
+#include "td/utils/Gzip.h"
+#include "td/utils/GzipByteFlow.h"
 #include "td/utils/logging.h"
+#include "td/utils/misc.h"
 #include "td/utils/port/Clocks.h"
 #include "td/utils/port/EventFd.h"
 #include "td/utils/port/FileFd.h"
@@ -19,11 +39,13 @@
 #include "td/utils/port/RwMutex.h"
 #include "td/utils/port/Stat.h"
 #include "td/utils/port/thread.h"
+#include "td/utils/Promise.h"
 #include "td/utils/Random.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/StackAllocator.h"
 #include "td/utils/Status.h"
+#include "td/utils/Storer.h"
 #include "td/utils/StringBuilder.h"
 #include "td/utils/ThreadSafeCounter.h"
 
@@ -40,7 +62,9 @@
 #include <array>
 #include <atomic>
 #include <cstdint>
+#include <map>
 #include <set>
+#include <utility>
 
 class F {
   td::uint32 &sum;
@@ -752,9 +776,637 @@ BENCH(AnyOfTd, "any_of td") {
   td::do_not_optimize_away(res);
 }
 
+class FindEntitiesBench final : public td::Benchmark {
+  td::string name_;
+  td::string text_;
+
+ public:
+  FindEntitiesBench(td::string name, td::Slice paragraph, int repeat_count) : name_(std::move(name)) {
+    for (int i = 0; i < repeat_count; i++) {
+      text_.append(paragraph.begin(), paragraph.size());
+    }
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "find_entities with trigger prefilter on " << name_ << " of size " << text_.size();
+  }
+
+  void run(int n) final {
+    std::size_t res = 0;
+    for (int i = 0; i < n; i++) {
+      res += td::find_entities(text_, false, false).size();
+    }
+    td::do_not_optimize_away(res);
+  }
+};
+
+#if TD_HAVE_ZLIB
+static td::BufferSlice serialize_function(const td::telegram_api::Function &function) {
+  auto storer = td::DefaultStorer<td::telegram_api::Function>(function);
+  td::BufferSlice result(storer.size());
+  auto real_size = storer.store(result.as_mutable_slice().ubegin());
+  CHECK(real_size == result.size());
+  return result;
+}
+
+static td::telegram_api::object_ptr<td::telegram_api::replyInlineMarkup> get_bench_reply_markup() {
+  td::vector<td::telegram_api::object_ptr<td::telegram_api::keyboardButtonRow>> rows;
+  for (int i = 0; i < 5; i++) {
+    td::vector<td::telegram_api::object_ptr<td::telegram_api::KeyboardButton>> buttons;
+    for (int j = 0; j < 4; j++) {
+      buttons.push_back(td::telegram_api::make_object<td::telegram_api::keyboardButtonCallback>(
+          0, false, PSTRING() << "Option " << i << '.' << j, td::BufferSlice(PSLICE() << "action=select&item=" << j)));
+    }
+    rows.push_back(td::telegram_api::make_object<td::telegram_api::keyboardButtonRow>(std::move(buttons)));
+  }
+  return td::telegram_api::make_object<td::telegram_api::replyInlineMarkup>(std::move(rows));
+}
+
+static td::vector<td::telegram_api::object_ptr<td::telegram_api::MessageEntity>> get_bench_entities() {
+  td::vector<td::telegram_api::object_ptr<td::telegram_api::MessageEntity>> entities;
+  for (int i = 0; i < 10; i++) {
+    entities.push_back(td::telegram_api::make_object<td::telegram_api::messageEntityBold>(i * 20, 10));
+  }
+  return entities;
+}
+
+// compresses a serialized query and reports the number of saved bytes in the description
+class GzipQueryBench final : public td::Benchmark {
+  td::string name_;
+  td::BufferSlice query_;
+  int compression_level_;
+  std::size_t compressed_size_;
+
+ public:
+  GzipQueryBench(td::string name, const td::telegram_api::Function &function, int compression_level)
+      : name_(std::move(name)), query_(serialize_function(function)), compression_level_(compression_level) {
+    auto compressed = td::gzencode(query_.as_slice(), 0.9, compression_level_);
+    compressed_size_ = compressed.empty() ? query_.size() : compressed.size();
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "gzencode " << name_ << " of size " << query_.size() << " with level " << compression_level_
+                     << ", saved " << query_.size() - compressed_size_ << " bytes";
+  }
+
+  void run(int n) final {
+    std::size_t res = 0;
+    for (int i = 0; i < n; i++) {
+      res += td::gzencode(query_.as_slice(), 0.9, compression_level_).size();
+    }
+    td::do_not_optimize_away(res);
+  }
+};
+
+static void bench_gzip_queries() {
+  auto message = td::string(
+      "Your order #12345 has been confirmed. Please choose the delivery option below. Delivery is available from "
+      "9:00 to 21:00 every day, and you can change the option later in the order settings.");
+  td::telegram_api::messages_sendMessage send_message(
+      12, false, false, false, false, false, false, false,
+      td::telegram_api::make_object<td::telegram_api::inputPeerUser>(123456789, 987654321), nullptr, message, 42,
+      get_bench_reply_markup(), get_bench_entities(), 0, nullptr, nullptr, 0);
+  td::telegram_api::messages_editMessage edit_message(
+      12, false, false, td::telegram_api::make_object<td::telegram_api::inputPeerUser>(123456789, 987654321), 100,
+      message, nullptr, get_bench_reply_markup(), get_bench_entities(), 0, 0);
+  td::BufferSlice file_part(128 << 10);
+  td::Random::secure_bytes(file_part.as_mutable_slice());
+  td::telegram_api::upload_saveFilePart save_file_part(1, 0, std::move(file_part));
+  for (int compression_level : {1, 4, 6, 9}) {
+    td::bench(GzipQueryBench("messages.sendMessage", send_message, compression_level));
+    td::bench(GzipQueryBench("messages.editMessage", edit_message, compression_level));
+    td::bench(GzipQueryBench("upload.saveFilePart", save_file_part, compression_level));
+  }
+}
+#endif
+
+#if TD_HAVE_ZLIB
+#if TD_LINUX
+// returns value of the field from /proc/self/status in kilobytes
+static td::int64 get_proc_self_status_value(td::Slice field) {
+  auto r_fd = td::FileFd::open("/proc/self/status", td::FileFd::Read);
+  if (r_fd.is_error()) {
+    return 0;
+  }
+  auto fd = r_fd.move_as_ok();
+  td::string status(1 << 14, '\0');
+  auto r_size = fd.read(status);
+  fd.close();
+  if (r_size.is_error()) {
+    return 0;
+  }
+  status.resize(r_size.ok());
+  for (auto line : td::full_split(status, '\n')) {
+    if (td::begins_with(line, field)) {
+      return td::to_integer<td::int64>(td::trim(line.substr(field.size())));
+    }
+  }
+  return 0;
+}
+
+static void reset_peak_rss() {
+  auto r_fd = td::FileFd::open("/proc/self/clear_refs", td::FileFd::Write);
+  if (r_fd.is_ok()) {
+    r_fd.ok_ref().write("5").ignore();
+    r_fd.ok_ref().close();
+  }
+}
+#endif
+
+// decompresses a big gzip_packed response in gzip format, which has the uncompressed size in the trailer,
+// in zlib format, which doesn't have it, or in gzip format through the streaming GzipByteFlow,
+// which produces a chain of buffers that must be concatenated for TL parsing
+class GzipDecodeBench final : public td::Benchmark {
+ public:
+  enum class Mode { GzipFormat, ZlibFormat, ByteFlow };
+
+ private:
+  std::size_t size_;
+  Mode mode_;
+  td::string packed_data_;
+  td::int64 peak_memory_ = 0;
+
+  static td::Slice get_mode_name(Mode mode) {
+    switch (mode) {
+      case Mode::GzipFormat:
+        return td::Slice("gzip format");
+      case Mode::ZlibFormat:
+        return td::Slice("zlib format");
+      case Mode::ByteFlow:
+        return td::Slice("gzip format through GzipByteFlow");
+      default:
+        UNREACHABLE();
+        return td::Slice();
+    }
+  }
+
+  std::size_t decode() const {
+    if (mode_ != Mode::ByteFlow) {
+      return td::gzdecode(packed_data_).size();
+    }
+
+    td::ChainBufferWriter input_writer;
+    auto input = input_writer.extract_reader();
+    td::ByteFlowSource source(&input);
+    td::GzipByteFlow gzip_flow(td::Gzip::Mode::Decode);
+    td::ByteFlowSink sink;
+    source >> gzip_flow >> sink;
+    input_writer.append(packed_data_);
+    source.wakeup();
+    source.close_input(td::Status::OK());
+    CHECK(sink.is_ready() && sink.status().is_ok());
+    return sink.result()->move_as_buffer_slice().size();
+  }
+
+ public:
+  GzipDecodeBench(std::size_t size, Mode mode) : size_(size), mode_(mode) {
+    td::string data;
+    data.reserve(size_);
+    while (data.size() < size_) {
+      data += PSTRING() << "{\"update\":" << td::Random::fast(0, 1000000) << ",\"text\":\"message text\"}";
+    }
+    data.resize(size_);
+    packed_data_ =
+        (mode_ == Mode::ZlibFormat ? td::gzencode(data, 2) : td::gzencode_gzip_format(data)).as_slice().str();
+    CHECK(!packed_data_.empty());
+
+#if TD_LINUX
+    reset_peak_rss();
+    auto rss_before = get_proc_self_status_value("VmRSS:");
+    CHECK(decode() == size_);
+    peak_memory_ = get_proc_self_status_value("VmHWM:") - rss_before;
+#endif
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "gzdecode " << (size_ >> 20) << " MB in " << get_mode_name(mode_) << ", peak RSS increase "
+                     << (peak_memory_ >> 10) << " MB";
+  }
+
+  void run(int n) final {
+    std::size_t res = 0;
+    for (int i = 0; i < n; i++) {
+      res += decode();
+    }
+    td::do_not_optimize_away(res);
+  }
+};
+#endif
+
+static constexpr int EMOJI_LANGUAGE_COUNT = 6;
+static constexpr int EMOJI_KEYWORD_COUNT = 20000;
+
+// searches emoji by a short prefix in full keyword sets of several languages, which is done on every keystroke
+class EmojiKeywordSearchBench final : public td::Benchmark {
+  bool use_index_;
+  td::string path_ = "bench_emoji_keywords.sqlite";
+  td::vector<td::EmojiKeywordIndex> indexes_;
+  td::SqliteKeyValue kv_;
+  td::vector<td::string> prefixes_;
+
+  static td::string get_key_prefix(int language) {
+    return PSTRING() << "emoji$lang" << language << '$';
+  }
+
+ public:
+  explicit EmojiKeywordSearchBench(bool use_index) : use_index_(use_index) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "Emoji keyword search in " << EMOJI_LANGUAGE_COUNT << " languages using "
+                     << (use_index_ ? "in-memory index" : "SQLite prefix scan");
+  }
+
+  void start_up() final {
+    td::vector<td::vector<std::pair<td::string, td::string>>> keyword_emojis(EMOJI_LANGUAGE_COUNT);
+    for (auto &language_keyword_emojis : keyword_emojis) {
+      for (int i = 0; i < EMOJI_KEYWORD_COUNT; i++) {
+        td::string keyword;
+        auto length = td::Random::fast(3, 12);
+        for (int j = 0; j < length; j++) {
+          keyword += static_cast<char>(td::Random::fast('a', 'z'));
+        }
+        td::vector<td::string> emojis;
+        auto emoji_count = td::Random::fast(1, 4);
+        for (int j = 0; j < emoji_count; j++) {
+          emojis.push_back(PSTRING() << "\xF0\x9F\x98" << static_cast<char>(td::Random::fast(0x80, 0xBF)));
+        }
+        language_keyword_emojis.emplace_back(std::move(keyword), td::implode(emojis, '$'));
+      }
+    }
+    for (int i = 0; i < 1000; i++) {
+      td::string prefix;
+      prefix += static_cast<char>(td::Random::fast('a', 'z'));
+      prefix += static_cast<char>(td::Random::fast('a', 'z'));
+      prefixes_.push_back(std::move(prefix));
+    }
+
+    if (use_index_) {
+      for (auto &language_keyword_emojis : keyword_emojis) {
+        indexes_.emplace_back(std::move(language_keyword_emojis));
+      }
+      return;
+    }
+
+    td::SqliteDb::destroy(path_).ignore();
+    auto db = td::SqliteDb::open_with_key(path_, true, td::DbKey::empty()).move_as_ok();
+    td::SqliteKeyValue::init(db, "common").ensure();
+    kv_.init_with_connection(std::move(db), "common").ensure();
+    kv_.begin_write_transaction().ensure();
+    for (int language = 0; language < EMOJI_LANGUAGE_COUNT; language++) {
+      auto key_prefix = get_key_prefix(language);
+      for (auto &keyword_emoji : keyword_emojis[language]) {
+        kv_.set(key_prefix + keyword_emoji.first, keyword_emoji.second);
+      }
+    }
+    kv_.commit_transaction().ensure();
+  }
+
+  void run(int n) final {
+    std::size_t res = 0;
+    for (int i = 0; i < n; i++) {
+      const auto &prefix = prefixes_[i % prefixes_.size()];
+      for (int language = 0; language < EMOJI_LANGUAGE_COUNT; language++) {
+        if (use_index_) {
+          res += indexes_[language].search(prefix).size();
+        } else {
+          td::vector<std::pair<td::string, td::string>> result;
+          kv_.get_by_prefix(get_key_prefix(language) + prefix, [&result](td::Slice key, td::Slice value) {
+            for (auto &emoji : td::full_split(value, '$')) {
+              result.emplace_back(emoji.str(), key.str());
+            }
+            return true;
+          });
+          res += result.size();
+        }
+      }
+    }
+    td::do_not_optimize_away(res);
+  }
+
+  void tear_down() final {
+    indexes_.clear();
+    prefixes_.clear();
+    if (!kv_.empty()) {
+      kv_.close();
+      td::SqliteDb::destroy(path_).ignore();
+    }
+  }
+};
+
+static constexpr int STICKER_SET_COUNT = 500;
+static constexpr int STICKER_SET_SIZE = 120;
+
+// searches stickers by an emoji and a keyword prefix in all installed sticker sets
+class StickerSearchBench final : public td::Benchmark {
+  struct StickerSet {
+    td::StickerSetId id_;
+    td::vector<td::FileId> sticker_ids_;
+    td::FlatHashMap<td::string, td::vector<td::FileId>> emoji_stickers_map_;
+    std::map<td::string, td::vector<td::FileId>> keyword_stickers_map_;
+  };
+
+  bool use_index_;
+  td::vector<StickerSet> sticker_sets_;
+  td::StickerSearchIndex index_;
+  td::vector<std::pair<td::vector<td::string>, td::string>> queries_;
+
+  static td::string get_emoji(int i) {
+    return PSTRING() << "\xF0\x9F\x98" << static_cast<char>(0x80 + i % 64);
+  }
+
+  static td::string get_keyword(int i) {
+    return PSTRING() << static_cast<char>('a' + i % 26) << static_cast<char>('a' + i / 26 % 26)
+                     << static_cast<char>('a' + i / 676 % 26) << "word";
+  }
+
+ public:
+  explicit StickerSearchBench(bool use_index) : use_index_(use_index) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "Sticker search in " << STICKER_SET_COUNT << " sticker sets using "
+                     << (use_index_ ? "inverted index" : "per-set maps");
+  }
+
+  void start_up() final {
+    td::int32 file_id = 0;
+    for (int i = 0; i < STICKER_SET_COUNT; i++) {
+      StickerSet sticker_set;
+      sticker_set.id_ = td::StickerSetId(static_cast<td::int64>(i + 1));
+      for (int j = 0; j < STICKER_SET_SIZE; j++) {
+        td::FileId sticker_id(++file_id, 0);
+        sticker_set.sticker_ids_.push_back(sticker_id);
+        auto emoji_count = td::Random::fast(1, 3);
+        for (int k = 0; k < emoji_count; k++) {
+          sticker_set.emoji_stickers_map_[get_emoji(td::Random::fast(0, 63))].push_back(sticker_id);
+        }
+        auto keyword_count = td::Random::fast(2, 4);
+        for (int k = 0; k < keyword_count; k++) {
+          sticker_set.keyword_stickers_map_[get_keyword(td::Random::fast(0, 4999))].push_back(sticker_id);
+        }
+      }
+      index_.update_sticker_set(sticker_set.id_, sticker_set.sticker_ids_, sticker_set.emoji_stickers_map_,
+                                sticker_set.keyword_stickers_map_);
+      sticker_sets_.push_back(std::move(sticker_set));
+    }
+    for (int i = 0; i < 1000; i++) {
+      queries_.emplace_back(td::vector<td::string>{get_emoji(td::Random::fast(0, 63))},
+                            get_keyword(td::Random::fast(0, 4999)).substr(0, 3));
+    }
+  }
+
+  void run(int n) final {
+    std::size_t res = 0;
+    for (int i = 0; i < n; i++) {
+      const auto &query = queries_[i % queries_.size()];
+      if (use_index_) {
+        auto found_sticker_ids = index_.find_stickers(query.first, query.second);
+        for (auto &sticker_set : sticker_sets_) {
+          auto it = found_sticker_ids.find(sticker_set.id_);
+          if (it != found_sticker_ids.end()) {
+            res += it->second.size();
+          }
+        }
+        continue;
+      }
+      for (auto &sticker_set : sticker_sets_) {
+        td::FlatHashSet<td::FileId, td::FileIdHash> found_sticker_ids;
+        for (auto &emoji : query.first) {
+          auto it = sticker_set.emoji_stickers_map_.find(emoji);
+          if (it != sticker_set.emoji_stickers_map_.end()) {
+            found_sticker_ids.insert(it->second.begin(), it->second.end());
+          }
+        }
+        const auto &keywords_map = sticker_set.keyword_stickers_map_;
+        for (auto it = keywords_map.lower_bound(query.second);
+             it != keywords_map.end() && td::begins_with(it->first, query.second); ++it) {
+          found_sticker_ids.insert(it->second.begin(), it->second.end());
+        }
+        if (!found_sticker_ids.empty()) {
+          for (auto sticker_id : sticker_set.sticker_ids_) {
+            if (found_sticker_ids.count(sticker_id) != 0) {
+              res++;
+            }
+          }
+        }
+      }
+    }
+    td::do_not_optimize_away(res);
+  }
+
+  void tear_down() final {
+    for (auto &sticker_set : sticker_sets_) {
+      index_.remove_sticker_set(sticker_set.id_);
+    }
+    sticker_sets_.clear();
+    queries_.clear();
+  }
+};
+
+#if !TD_THREAD_UNSUPPORTED
+static constexpr std::size_t PART_SIZE = 1 << 20;
+static constexpr int PART_SLOT_COUNT = 16;
+static constexpr int MAX_PARTS_IN_FLIGHT = 8;
+
+// downloads CDN-encrypted parts received from a fake network, decrypting, writing and checking them
+// either inline or using FileDownloadWorker actors; one operation is one downloaded megabyte
+class FileDownloadBench final : public td::Benchmark {
+  int worker_count_;
+  td::string path_ = "bench_download.tmp";
+  std::shared_ptr<td::FileFd> fd_;
+  td::string cdn_encryption_key_;
+  td::string cdn_encryption_iv_;
+  td::vector<td::BufferSlice> encrypted_parts_;
+  td::vector<td::string> part_hashes_;
+
+  td::int64 get_part_offset(int part_id) const {
+    return static_cast<td::int64>(part_id % PART_SLOT_COUNT) * static_cast<td::int64>(PART_SIZE);
+  }
+
+  // returns a part as it would be received from a network connection
+  td::BufferSlice receive_part(int part_id) const {
+    return encrypted_parts_[part_id % PART_SLOT_COUNT].copy();
+  }
+
+  class FakeDownloader final : public td::Actor {
+   public:
+    FakeDownloader(const FileDownloadBench *bench, int part_count,
+                   td::vector<td::ActorId<td::FileDownloadWorker>> workers)
+        : bench_(bench), part_count_(part_count), workers_(std::move(workers)) {
+    }
+
+   private:
+    const FileDownloadBench *bench_;
+    int part_count_;
+    td::vector<td::ActorId<td::FileDownloadWorker>> workers_;
+    int sent_part_count_ = 0;
+    int checked_part_count_ = 0;
+
+    void start_up() final {
+      if (workers_.empty()) {
+        for (int part_id = 0; part_id < part_count_; part_id++) {
+          auto offset = bench_->get_part_offset(part_id);
+          td::FileDownloadWorker::do_write_part(*bench_->fd_, offset, bench_->receive_part(part_id), PART_SIZE,
+                                                bench_->cdn_encryption_key_, bench_->cdn_encryption_iv_)
+              .ensure();
+          auto is_ok = td::FileDownloadWorker::do_check_hash(*bench_->fd_, offset, PART_SIZE,
+                                                             bench_->part_hashes_[part_id % PART_SLOT_COUNT]);
+          CHECK(is_ok.is_ok() && is_ok.ok());
+        }
+        return finish();
+      }
+      while (sent_part_count_ < td::min(part_count_, MAX_PARTS_IN_FLIGHT)) {
+        send_part();
+      }
+    }
+
+    td::ActorId<td::FileDownloadWorker> get_worker(int part_id) const {
+      return workers_[part_id % workers_.size()];
+    }
+
+    void send_part() {
+      auto part_id = sent_part_count_++;
+      auto promise = td::PromiseCreator::lambda([actor_id = actor_id(this), part_id](td::Result<size_t> r_size) {
+        r_size.ensure();
+        send_closure(actor_id, &FakeDownloader::on_part_written, part_id);
+      });
+      send_closure(get_worker(part_id), &td::FileDownloadWorker::write_part, bench_->fd_,
+                   bench_->get_part_offset(part_id), bench_->receive_part(part_id), PART_SIZE,
+                   bench_->cdn_encryption_key_, bench_->cdn_encryption_iv_, std::move(promise));
+    }
+
+    void on_part_written(int part_id) {
+      auto promise = td::PromiseCreator::lambda([actor_id = actor_id(this)](td::Result<bool> r_is_ok) {
+        CHECK(r_is_ok.is_ok() && r_is_ok.ok());
+        send_closure(actor_id, &FakeDownloader::on_part_checked);
+      });
+      send_closure(get_worker(part_id), &td::FileDownloadWorker::check_hash, bench_->fd_,
+                   bench_->get_part_offset(part_id), PART_SIZE, bench_->part_hashes_[part_id % PART_SLOT_COUNT],
+                   std::move(promise));
+    }
+
+    void on_part_checked() {
+      checked_part_count_++;
+      if (sent_part_count_ < part_count_) {
+        send_part();
+      }
+      if (checked_part_count_ == part_count_) {
+        finish();
+      }
+    }
+
+    void finish() {
+      stop();
+      td::Scheduler::instance()->finish();
+    }
+  };
+
+ public:
+  explicit FileDownloadBench(int worker_count) : worker_count_(worker_count) {
+  }
+
+  td::string get_description() const final {
+    if (worker_count_ == 0) {
+      return "Download MB inline";
+    }
+    return PSTRING() << "Download MB with " << worker_count_ << " workers";
+  }
+
+  void start_up() final {
+    cdn_encryption_key_ = td::string(32, '\0');
+    td::Random::secure_bytes(cdn_encryption_key_);
+    cdn_encryption_iv_ = td::string(16, '\0');
+    td::Random::secure_bytes(cdn_encryption_iv_);
+    for (int part_id = 0; part_id < PART_SLOT_COUNT; part_id++) {
+      td::BufferSlice part(PART_SIZE);
+      td::Random::secure_bytes(part.as_mutable_slice());
+      encrypted_parts_.push_back(part.copy());
+
+      // CTR decryption is the same as encryption
+      auto offset = td::narrow_cast<td::uint32>(get_part_offset(part_id) / 16);
+      td::string iv = cdn_encryption_iv_;
+      td::as<td::uint32>(&iv[12]) = ((offset & 0xff) << 24) | ((offset & 0xff00) << 8) | ((offset & 0xff0000) >> 8) |
+                                    ((offset & 0xff000000) >> 24);
+      td::AesCtrState ctr_state;
+      ctr_state.init(cdn_encryption_key_, iv);
+      ctr_state.decrypt(part.as_slice(), part.as_mutable_slice());
+      td::string hash(32, '\0');
+      td::sha256(part.as_slice(), hash);
+      part_hashes_.push_back(std::move(hash));
+    }
+  }
+
+  void run(int n) final {
+    fd_ = std::make_shared<td::FileFd>(
+        td::FileFd::open(path_, td::FileFd::Create | td::FileFd::Write | td::FileFd::Read).move_as_ok());
+
+    td::ConcurrentScheduler scheduler(worker_count_, 0);
+    td::vector<td::ActorOwn<td::FileDownloadWorker>> workers;
+    td::vector<td::ActorId<td::FileDownloadWorker>> worker_ids;
+    for (int i = 1; i <= worker_count_; i++) {
+      workers.push_back(scheduler.create_actor_unsafe<td::FileDownloadWorker>(i, "FileDownloadWorker"));
+      worker_ids.push_back(workers.back().get());
+    }
+    scheduler.create_actor_unsafe<FakeDownloader>(0, "FakeDownloader", this, n, std::move(worker_ids)).release();
+    scheduler.start();
+    while (scheduler.run_main(10)) {
+      // empty
+    }
+    {
+      auto guard = scheduler.get_main_guard();
+      workers.clear();
+    }
+    scheduler.finish();
+    fd_ = nullptr;
+  }
+
+  void tear_down() final {
+    td::unlink(path_).ignore();
+  }
+};
+#endif
+
 int main() {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(DEBUG));
 
+  td::bench(FindEntitiesBench("plain text",
+                              "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt "
+                              "ut labore et dolore magna aliqua\n",
+                              100));
+  td::bench(FindEntitiesBench("cyrillic text",
+                              "\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82, \xd0\xbc\xd0\xb8\xd1\x80! "
+                              "\xd0\x9a\xd0\xb0\xd0\xba \xd0\xb4\xd0\xb5\xd0\xbb\xd0\xb0?\n",
+                              200));
+  td::bench(FindEntitiesBench("channel post",
+                              "Read more at https://telegram.org/blog, follow @telegram and #news, price $BTC, "
+                              "timestamp 1:23:45, contact support@telegram.org. /start@bot\n",
+                              50));
+  // '.', ':' and digits are present, so only the matchers of mentions, bot commands, hashtags and cashtags are skipped
+  td::bench(FindEntitiesBench("chat message",
+                              "Ok, see you tomorrow at 10:30. Don't forget the tickets, they cost 25.50 each!\n", 100));
+
+#if TD_HAVE_ZLIB
+  bench_gzip_queries();
+  for (std::size_t size_mb : {1, 10, 50}) {
+    td::bench(GzipDecodeBench(size_mb << 20, GzipDecodeBench::Mode::GzipFormat));
+    td::bench(GzipDecodeBench(size_mb << 20, GzipDecodeBench::Mode::ZlibFormat));
+    td::bench(GzipDecodeBench(size_mb << 20, GzipDecodeBench::Mode::ByteFlow));
+  }
+#endif
+
+  td::bench(EmojiKeywordSearchBench(false));
+  td::bench(EmojiKeywordSearchBench(true));
+
+  td::bench(StickerSearchBench(false));
+  td::bench(StickerSearchBench(true));
+
+#if !TD_THREAD_UNSUPPORTED
+  for (int worker_count : {0, 1, 2, 4}) {
+    td::bench(FileDownloadBench(worker_count));
+  }
+#endif
+
   td::bench(AnyOfStdBench());
   td::bench(AnyOfTdBench());
 
@@ -23,8 +23,12 @@
 #include "td/utils/logging.h"
 #include "td/utils/Promise.h"
 #include "td/utils/Random.h"
+#include "td/utils/Slice.h"
+#include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
+#include "td/utils/Time.h"
 
+#include <cstdlib>
 #include <memory>
 
 static td::Status init_db(td::SqliteDb &db) {
@@ -107,7 +111,152 @@ class MessageDbBench final : public td::Benchmark {
   }
 };
 
-int main() {
+// synthetic database for full-text search benchmarks
+// words have Zipf-like distribution, text of every message contains dialog token like the texts of real messages
+class MessageDbFtsData {
+ public:
+  static constexpr int WORD_COUNT = 100000;
+  static constexpr int DIALOG_COUNT = 1000;
+
+  td::Status init(int message_count) {
+    scheduler_ = td::make_unique<td::ConcurrentScheduler>(0, 0);
+    auto guard = scheduler_->get_main_guard();
+
+    for (int i = 0; i < WORD_COUNT; i++) {
+      td::string word(static_cast<size_t>(td::Random::fast(3, 10)), ' ');
+      for (auto &c : word) {
+        c = static_cast<char>(td::Random::fast('a', 'z'));
+      }
+      words_.push_back(std::move(word));
+    }
+
+    td::string sql_db_name = "testdb_fts.sqlite";
+    td::SqliteDb::destroy(sql_db_name).ignore();
+    sql_connection_ = std::make_shared<td::SqliteConnectionSafe>(sql_db_name, td::DbKey::empty());
+    auto &db = sql_connection_->get();
+    TRY_STATUS(init_db(db));
+
+    db.exec("BEGIN TRANSACTION").ensure();
+    TRY_STATUS(init_message_db(db, 0));
+    db.exec("COMMIT TRANSACTION").ensure();
+
+    message_db_sync_safe_ = td::create_message_db_sync(sql_connection_);
+    auto &message_db = message_db_sync_safe_->get();
+
+    auto start_time = td::Time::now();
+    const int BATCH_SIZE = 10000;
+    for (int i = 0; i < message_count; i += BATCH_SIZE) {
+      TRY_STATUS(message_db.begin_write_transaction());
+      for (int j = i; j < i + BATCH_SIZE && j < message_count; j++) {
+        auto dialog_id = get_dialog_id(td::Random::fast(1, DIALOG_COUNT));
+        auto message_id = td::MessageId(td::ServerMessageId(j + 1));
+        td::string text;
+        auto text_word_count = td::Random::fast(1, 20);
+        for (int k = 0; k < text_word_count; k++) {
+          text += get_random_word();
+          text += ' ';
+        }
+        text += PSTRING() << '\a' << dialog_id.get();
+        message_db.add_message({dialog_id, message_id}, td::ServerMessageId(j + 1), td::DialogId(), 0, 0, 0, j + 1,
+                               std::move(text), td::NotificationId(), td::MessageId(), td::BufferSlice(100));
+      }
+      TRY_STATUS(message_db.commit_transaction());
+    }
+    LOG(WARNING) << "Added " << message_count << " messages in " << td::Time::now() - start_time << " seconds";
+    return td::Status::OK();
+  }
+
+  void merge_fts_index() {
+    auto guard = scheduler_->get_main_guard();
+    auto start_time = td::Time::now();
+    int step_count = 0;
+    while (message_db_sync_safe_->get().merge_fts_index()) {
+      step_count++;
+    }
+    LOG(WARNING) << "Merged full-text search index in " << step_count << " steps and " << td::Time::now() - start_time
+                 << " seconds";
+  }
+
+  td::MessageDbFtsResult search(td::MessageDbFtsQuery query) {
+    auto guard = scheduler_->get_main_guard();
+    return message_db_sync_safe_->get().get_messages_fts(std::move(query));
+  }
+
+  const td::string &get_random_word() const {
+    // approximately Zipf distribution
+    auto x = td::Random::fast(0, WORD_COUNT - 1);
+    return words_[static_cast<size_t>(static_cast<td::int64>(x) * x / WORD_COUNT)];
+  }
+
+  static td::DialogId get_dialog_id(int dialog_index) {
+    return td::DialogId(td::UserId(static_cast<td::int64>(dialog_index)));
+  }
+
+ private:
+  td::unique_ptr<td::ConcurrentScheduler> scheduler_;
+  std::shared_ptr<td::SqliteConnectionSafe> sql_connection_;
+  std::shared_ptr<td::MessageDbSyncSafeInterface> message_db_sync_safe_;
+  td::vector<td::string> words_;
+};
+
+class MessageDbFtsBench final : public td::Benchmark {
+ public:
+  enum class Mode : td::int32 { Word, Prefix, Dialog };
+
+  MessageDbFtsBench(MessageDbFtsData &data, Mode mode, td::Slice description)
+      : data_(data), mode_(mode), description_(description.str()) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "MessageDb FTS " << description_ << ' '
+                     << (mode_ == Mode::Word ? "word" : (mode_ == Mode::Prefix ? "prefix" : "dialog"));
+  }
+
+  void run(int n) final {
+    size_t found_message_count = 0;
+    for (int i = 0; i < n; i++) {
+      td::MessageDbFtsQuery query;
+      query.query = data_.get_random_word();
+      query.limit = 50;
+      switch (mode_) {
+        case Mode::Word:
+          break;
+        case Mode::Prefix:
+          query.query.resize(2);
+          query.search_last_word_prefix = true;
+          break;
+        case Mode::Dialog:
+          query.dialog_id = MessageDbFtsData::get_dialog_id(td::Random::fast(1, MessageDbFtsData::DIALOG_COUNT));
+          break;
+      }
+      found_message_count += data_.search(std::move(query)).messages.size();
+    }
+    td::do_not_optimize_away(found_message_count);
+  }
+
+ private:
+  MessageDbFtsData &data_;
+  Mode mode_;
+  td::string description_;
+};
+
+static void bench_message_db_fts(int message_count) {
+  MessageDbFtsData data;
+  data.init(message_count).ensure();
+  for (auto mode : {MessageDbFtsBench::Mode::Word, MessageDbFtsBench::Mode::Prefix, MessageDbFtsBench::Mode::Dialog}) {
+    td::bench(MessageDbFtsBench(data, mode, "unmerged"));
+  }
+  data.merge_fts_index();
+  for (auto mode : {MessageDbFtsBench::Mode::Word, MessageDbFtsBench::Mode::Prefix, MessageDbFtsBench::Mode::Dialog}) {
+    td::bench(MessageDbFtsBench(data, mode, "merged"));
+  }
+}
+
+int main(int argc, char **argv) {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(WARNING));
   td::bench(MessageDbBench());
+
+  // pass 10000000 to benchmark search in a database of realistic size
+  int fts_message_count = argc > 1 ? std::atoi(argv[1]) : 100000;
+  bench_message_db_fts(fts_message_count);
 }
@@ -11,11 +11,13 @@
 #if (TD_DARWIN || TD_LINUX) && defined(USE_MEMPROF)
 #include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
+#include <limits>
 #include <new>
 #include <utility>
 #include <vector>
@@ -126,9 +128,80 @@ static constexpr std::int32_t MALLOC_INFO_MAGIC = 0x27138373;
 struct malloc_info {
   std::int32_t magic;
   std::int32_t size;
-  std::int32_t ht_pos;
+  std::int32_t ht_pos;  // -1 if the allocation wasn't sampled
+  std::int32_t weight;  // estimated number of bytes represented by the allocation
 };
 
+static std::size_t get_initial_sampling_interval() {
+  auto *value = std::getenv("TD_MEMPROF_SAMPLING_INTERVAL");
+  if (value == nullptr) {
+    return DEFAULT_MEMPROF_SAMPLING_INTERVAL;
+  }
+  return static_cast<std::size_t>(std::strtoull(value, nullptr, 10));
+}
+
+static std::atomic<std::size_t> sampling_interval{get_initial_sampling_interval()};
+
+void set_memprof_sampling_interval(std::size_t new_sampling_interval) {
+  sampling_interval.store(new_sampling_interval, std::memory_order_relaxed);
+}
+
+std::size_t get_memprof_sampling_interval() {
+  return sampling_interval.load(std::memory_order_relaxed);
+}
+
+static double get_initial_dump_period() {
+  auto *value = std::getenv("TD_MEMPROF_DUMP_PERIOD");
+  if (value == nullptr) {
+    return 0.0;
+  }
+  return std::max(std::strtod(value, nullptr), 0.0);
+}
+
+static std::atomic<double> dump_period{get_initial_dump_period()};
+
+void set_memprof_dump_period(double new_dump_period) {
+  dump_period.store(std::max(new_dump_period, 0.0), std::memory_order_relaxed);
+}
+
+double get_memprof_dump_period() {
+  return dump_period.load(std::memory_order_relaxed);
+}
+
+// returns the number of allocated bytes to skip before the next sampled allocation
+static std::int64_t get_next_sample_distance(std::size_t interval) {
+  static __thread std::uint64_t random_state;  // static zero-initialized
+  if (random_state == 0) {
+    random_state = reinterpret_cast<std::uintptr_t>(&random_state) | 1;
+  }
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 7;
+  random_state ^= random_state << 17;
+  // uniform value in (0, 1]
+  auto uniform = static_cast<double>((random_state >> 11) + 1) * (1.0 / static_cast<double>(1ull << 53));
+  return static_cast<std::int64_t>(-std::log(uniform) * static_cast<double>(interval)) + 1;
+}
+
+// returns estimated number of bytes represented by the allocation, or 0 if the allocation must not be sampled
+static std::int32_t sample_allocation(std::size_t size) {
+  auto interval = sampling_interval.load(std::memory_order_relaxed);
+  if (interval == 0) {
+    return static_cast<std::int32_t>(size);
+  }
+
+  static __thread std::int64_t bytes_until_sample;  // static zero-initialized
+  bytes_until_sample -= static_cast<std::int64_t>(size);
+  if (bytes_until_sample > 0) {
+    return 0;
+  }
+  bytes_until_sample = get_next_sample_distance(interval);
+
+  // an allocation of the size S is sampled with probability 1 - exp(-S / interval)
+  auto probability = -std::expm1(-static_cast<double>(size) / static_cast<double>(interval));
+  auto weight = static_cast<double>(size) / std::max(probability, 1e-9);
+  return static_cast<std::int32_t>(std::min(weight, static_cast<double>(std::numeric_limits<std::int32_t>::max())));
+}
+
 static std::uint64_t get_hash(const Backtrace &bt) {
   std::uint64_t h = 7;
   for (std::size_t i = 0; i < bt.size() && i < BACKTRACE_HASHED_LENGTH; i++) {
@@ -141,6 +214,8 @@ struct HashtableNode {
   std::atomic<std::uint64_t> hash;
   Backtrace backtrace;
   std::atomic<std::size_t> size;
+  std::atomic<std::size_t> allocated_size;
+  std::atomic<std::size_t> allocation_count;
 };
 
 static constexpr std::size_t HT_MAX_SIZE = 10000000;
@@ -196,23 +271,32 @@ void dump_alloc(const std::function<void(const AllocInfo &)> &func) {
     if (size == 0) {
       continue;
     }
-    func(AllocInfo{node.backtrace, size});
+    func(AllocInfo{node.backtrace, size, node.allocated_size.load(std::memory_order_relaxed),
+                   node.allocation_count.load(std::memory_order_relaxed)});
   }
 }
 
 void register_xalloc(malloc_info *info, std::int32_t diff) {
   my_assert(info->size >= 0);
+  if (info->ht_pos < 0) {
+    return;
+  }
+  auto &node = ht[info->ht_pos];
+  auto weight = static_cast<std::size_t>(info->weight);
   if (diff > 0) {
-    ht[info->ht_pos].size.fetch_add(info->size, std::memory_order_relaxed);
+    node.size.fetch_add(weight, std::memory_order_relaxed);
+    node.allocated_size.fetch_add(weight, std::memory_order_relaxed);
+    node.allocation_count.fetch_add(info->size == 0 ? 1 : std::max(std::size_t(1), weight / info->size),
+                                    std::memory_order_relaxed);
   } else {
-    auto old_value = ht[info->ht_pos].size.fetch_sub(info->size, std::memory_order_relaxed);
-    my_assert(old_value >= static_cast<std::size_t>(info->size));
+    auto old_value = node.size.fetch_sub(weight, std::memory_order_relaxed);
+    my_assert(old_value >= weight);
   }
 }
 
 extern "C" {
 
-static void *malloc_with_frame(std::size_t size, const Backtrace &frame) {
+static void *malloc_with_frame(std::size_t size, std::int32_t weight, const Backtrace &frame) {
   static_assert(RESERVED_SIZE % alignof(std::max_align_t) == 0, "fail");
   static_assert(RESERVED_SIZE >= sizeof(malloc_info), "fail");
 #if TD_DARWIN
@@ -227,7 +311,8 @@ static void *malloc_with_frame(std::size_t size, const Backtrace &frame) {
 
   info->magic = MALLOC_INFO_MAGIC;
   info->size = static_cast<std::int32_t>(size);
-  info->ht_pos = get_ht_pos(frame);
+  info->ht_pos = weight == 0 ? -1 : get_ht_pos(frame);
+  info->weight = weight;
 
   register_xalloc(info, +1);
 
@@ -236,6 +321,16 @@ static void *malloc_with_frame(std::size_t size, const Backtrace &frame) {
   return data;
 }
 
+// backtraces are expensive, so they are collected only for sampled allocations
+// the function must be inlined to keep the number of frames to skip in get_backtrace unchanged
+static inline __attribute__((always_inline)) void *malloc_sampled(std::size_t size) {
+  auto weight = sample_allocation(size);
+  if (weight == 0) {
+    return malloc_with_frame(size, 0, Backtrace{{nullptr}});
+  }
+  return malloc_with_frame(size, weight, get_backtrace());
+}
+
 static malloc_info *get_info(void *data_void) {
   auto *data = static_cast<char *>(data_void);
   auto *buf = data - RESERVED_SIZE;
@@ -246,7 +341,7 @@ static malloc_info *get_info(void *data_void) {
 }
 
 void *malloc(std::size_t size) {
-  return malloc_with_frame(size, get_backtrace());
+  return malloc_sampled(size);
 }
 
 void free(void *data_void) {
@@ -268,17 +363,17 @@ void free(void *data_void) {
 
 void *calloc(std::size_t size_a, std::size_t size_b) {
   auto size = size_a * size_b;
-  void *res = malloc_with_frame(size, get_backtrace());
+  void *res = malloc_sampled(size);
   std::memset(res, 0, size);
   return res;
 }
 
 void *realloc(void *ptr, std::size_t size) {
   if (ptr == nullptr) {
-    return malloc_with_frame(size, get_backtrace());
+    return malloc_sampled(size);
   }
   auto *info = get_info(ptr);
-  auto *new_ptr = malloc_with_frame(size, get_backtrace());
+  auto *new_ptr = malloc_sampled(size);
   auto to_copy = std::min(static_cast<std::int32_t>(size), info->size);
   std::memcpy(new_ptr, ptr, to_copy);
   free(ptr);
@@ -293,7 +388,7 @@ void *memalign(std::size_t aligment, std::size_t size) {
 
 // c++14 guarantees that it is enough to override these two operators.
 void *operator new(std::size_t count) {
-  return malloc_with_frame(count, get_backtrace());
+  return malloc_sampled(count);
 }
 void operator delete(void *ptr) noexcept(true) {
   free(ptr);
@@ -319,6 +414,16 @@ double get_fast_backtrace_success_rate() {
 std::size_t get_ht_size() {
   return 0;
 }
+void set_memprof_sampling_interval(std::size_t sampling_interval) {
+}
+std::size_t get_memprof_sampling_interval() {
+  return 0;
+}
+void set_memprof_dump_period(double dump_period) {
+}
+double get_memprof_dump_period() {
+  return 0.0;
+}
 #endif
 
 std::size_t get_used_memory_size() {
@@ -17,7 +17,9 @@ constexpr std::size_t BACKTRACE_LENGTH = 10;
 using Backtrace = std::array<void *, BACKTRACE_LENGTH>;
 struct AllocInfo {
   Backtrace backtrace;
-  std::size_t size;
+  std::size_t size;              // live bytes, estimated in sampling mode
+  std::size_t allocated_size;    // total allocated bytes, estimated in sampling mode
+  std::size_t allocation_count;  // total number of allocations, estimated in sampling mode
 };
 
 bool is_memprof_on();
@@ -25,3 +27,17 @@ std::size_t get_ht_size();
 double get_fast_backtrace_success_rate();
 void dump_alloc(const std::function<void(const AllocInfo &)> &func);
 std::size_t get_used_memory_size();
+
+constexpr std::size_t DEFAULT_MEMPROF_SAMPLING_INTERVAL = 512 << 10;
+
+// 0 - record a backtrace for every allocation
+// N - record backtraces only for allocations sampled with Poisson process with mean distance of N bytes
+// initial value is DEFAULT_MEMPROF_SAMPLING_INTERVAL and can be overridden
+// in TD_MEMPROF_SAMPLING_INTERVAL environment variable
+void set_memprof_sampling_interval(std::size_t sampling_interval);
+std::size_t get_memprof_sampling_interval();
+
+// period in seconds between periodic memory usage dumps done by the application; 0 if periodic dumps are disabled
+// initial value can be specified in TD_MEMPROF_DUMP_PERIOD environment variable
+void set_memprof_dump_period(double dump_period);
+double get_memprof_dump_period();
@@ -351,6 +351,7 @@ Status SessionConnection::on_packet(const MsgInfo &info,
       LOG(WARNING) << bad_info << ": MessageId is too high. Session will be closed";
       // All this queries will be re-sent by parent
       to_send_.clear();
+      to_send_size_ = 0;
       reset_server_time_difference(info.message_id);
       callback_->on_session_failed(Status::Error("MessageId is too high"));
       return Status::Error("MessageId is too high");
@@ -804,9 +805,25 @@ void SessionConnection::do_close(Status status) {
 
 void SessionConnection::send_crypto(const Storer &storer, uint64 quick_ack_token) {
   CHECK(state_ != Closed);
-  last_write_size_ += raw_connection_->send_crypto(storer, auth_data_->get_session_id(),
-                                                   auth_data_->get_server_salt(Time::now_cached()),
-                                                   auth_data_->get_auth_key(), quick_ack_token);
+  auto size = raw_connection_->send_crypto(storer, auth_data_->get_session_id(),
+                                           auth_data_->get_server_salt(Time::now_cached()), auth_data_->get_auth_key(),
+                                           quick_ack_token);
+  last_write_size_ += size;
+  packing_stats_.packet_count++;
+  packing_stats_.byte_count += size;
+}
+
+void SessionConnection::set_query_delay(double query_delay) {
+  CHECK(query_delay >= 0.0);
+  query_delay_ = query_delay;
+  if (!to_send_.empty()) {
+    send_before(Time::now_cached() + query_delay_);
+  }
+}
+
+size_t SessionConnection::get_packed_query_size(const MtprotoQuery &query) {
+  // message identifier, sequence number and length of the message in the container
+  return query.packet.size() + 16;
 }
 
 Result<MessageId> SessionConnection::send_query(BufferSlice buffer, bool gzip_flag, MessageId message_id,
@@ -817,10 +834,15 @@ Result<MessageId> SessionConnection::send_query(BufferSlice buffer, bool gzip_fl
   }
   auto seq_no = auth_data_->next_seq_no(true);
   if (to_send_.empty()) {
-    send_before(Time::now_cached() + QUERY_DELAY);
+    send_before(Time::now_cached() + query_delay_);
   }
   to_send_.push_back(MtprotoQuery{message_id, seq_no, std::move(buffer), gzip_flag, std::move(invoke_after_message_ids),
                                   use_quick_ack});
+  to_send_size_ += get_packed_query_size(to_send_.back());
+  if (to_send_size_ >= MAX_PACKET_QUERY_SIZE || to_send_.size() >= MAX_PACKET_QUERY_COUNT) {
+    // there is no reason to wait for more queries
+    send_before(Time::now_cached());
+  }
   VLOG(mtproto) << "Invoke query with " << message_id << " and seq_no " << seq_no << " of size "
                 << to_send_.back().packet.size() << " after " << invoke_after_message_ids
                 << (use_quick_ack ? " with quick ack" : "");
@@ -945,20 +967,27 @@ void SessionConnection::flush_packet() {
     }
   }
 
-  static constexpr size_t MAX_QUERY_COUNT = 1000;
   size_t send_till = 0;
   size_t send_size = 0;
   if (has_salt) {
-    // send at most MAX_QUERY_COUNT queries, of total size up to 2^15
-    while (send_till < to_send_.size() && send_till < MAX_QUERY_COUNT && send_size < (1 << 15)) {
-      send_size += to_send_[send_till].packet.size();
+    // send at most MAX_PACKET_QUERY_COUNT queries of total size up to MAX_PACKET_QUERY_SIZE,
+    // but at least one query even if it is bigger
+    while (send_till < to_send_.size() && send_till < MAX_PACKET_QUERY_COUNT) {
+      auto query_size = get_packed_query_size(to_send_[send_till]);
+      if (send_till != 0 && send_size + query_size > MAX_PACKET_QUERY_SIZE) {
+        break;
+      }
+      send_size += query_size;
       send_till++;
     }
   }
   vector<MtprotoQuery> queries;
   if (send_till == to_send_.size()) {
     queries = std::move(to_send_);
+    to_send_size_ = 0;
   } else if (send_till != 0) {
+    CHECK(to_send_size_ >= send_size);
+    to_send_size_ -= send_size;
     queries.reserve(send_till);
     std::move(to_send_.begin(), to_send_.begin() + send_till, std::back_inserter(queries));
     to_send_.erase(to_send_.begin(), to_send_.begin() + send_till);
@@ -1005,8 +1034,9 @@ void SessionConnection::flush_packet() {
   // no more than 8192 message identifiers per container..
   auto to_resend_answer = cut_tail(to_resend_answer_message_ids_, 8192, "resend_answer");
   MessageId resend_answer_message_id;
-  CHECK(queries.size() <= MAX_QUERY_COUNT);
-  auto to_cancel_answer = cut_tail(to_cancel_answer_message_ids_, MAX_QUERY_COUNT - queries.size(), "cancel_answer");
+  CHECK(queries.size() <= MAX_PACKET_QUERY_COUNT);
+  auto to_cancel_answer =
+      cut_tail(to_cancel_answer_message_ids_, MAX_PACKET_QUERY_COUNT - queries.size(), "cancel_answer");
   auto to_get_state_info = cut_tail(to_get_state_info_message_ids_, 8192, "get_state_info");
   MessageId get_state_info_message_id;
   auto to_ack = cut_tail(to_ack_message_ids_, 8192, "ack");
@@ -1025,6 +1055,7 @@ void SessionConnection::flush_packet() {
 
     auto quick_ack_token = use_quick_ack ? parent_message_id.get() : 0;
     send_crypto(storer, quick_ack_token);
+    packing_stats_.query_count += queries.size();
   }
 
   if (resend_answer_message_id != MessageId()) {
@@ -1058,9 +1089,14 @@ void SessionConnection::flush_packet() {
     }
   }
 
-  if (to_send_.empty() && to_ack_message_ids_.empty() && to_get_state_info_message_ids_.empty() &&
-      to_resend_answer_message_ids_.empty() && to_cancel_answer_message_ids_.empty()) {
-    force_send_at_ = 0;
+  if (to_ack_message_ids_.empty() && to_get_state_info_message_ids_.empty() && to_resend_answer_message_ids_.empty() &&
+      to_cancel_answer_message_ids_.empty()) {
+    if (to_send_.empty()) {
+      force_send_at_ = 0;
+    } else if (to_send_size_ < MAX_PACKET_QUERY_SIZE && to_send_.size() < MAX_PACKET_QUERY_COUNT) {
+      // the remaining queries don't fill a packet, so wait for more queries
+      force_send_at_ = Time::now_cached() + query_delay_;
+    }
   }
 }
 
@@ -81,6 +81,31 @@ class SessionConnection final
   void set_online(bool online_flag, bool is_main);
   void force_ack();
 
+  // returns network round trip time measured by pings during connection establishment
+  double get_ping_rtt() const {
+    return raw_connection_ == nullptr ? 0.0 : raw_connection_->extra().rtt;
+  }
+
+  // sets maximum time for which queries are delayed to be sent in the same packet with subsequent queries;
+  // the packet is sent immediately as soon as there is enough queries to fill it
+  void set_query_delay(double query_delay);
+
+  struct PackingStats {
+    uint64 packet_count = 0;
+    uint64 query_count = 0;
+    uint64 byte_count = 0;
+
+    double get_packets_per_query() const {
+      return query_count == 0 ? 0.0 : static_cast<double>(packet_count) / static_cast<double>(query_count);
+    }
+    double get_bytes_per_packet() const {
+      return packet_count == 0 ? 0.0 : static_cast<double>(byte_count) / static_cast<double>(packet_count);
+    }
+  };
+  const PackingStats &get_packing_stats() const {
+    return packing_stats_;
+  }
+
   class Callback {
    public:
     Callback() = default;
@@ -122,6 +147,10 @@ class SessionConnection final
   static constexpr double QUERY_DELAY = 0.001;          // 0.001s
   static constexpr double RESEND_ANSWER_DELAY = 0.001;  // 0.001s
 
+  // maximum total size and number of queries in a packet
+  static constexpr size_t MAX_PACKET_QUERY_SIZE = 1 << 15;
+  static constexpr size_t MAX_PACKET_QUERY_COUNT = 1000;
+
   struct MsgInfo {
     MessageId message_id;
     int32 seq_no;
@@ -161,8 +190,11 @@ class SessionConnection final
   static constexpr int HTTP_MAX_DELAY = 30;  // 0.03s
 
   vector<MtprotoQuery> to_send_;
+  size_t to_send_size_ = 0;
+  double query_delay_ = QUERY_DELAY;
   vector<MessageId> to_ack_message_ids_;
   double force_send_at_ = 0;
+  PackingStats packing_stats_;
 
   struct ServiceQuery {
     enum Type { GetStateInfo, ResendAnswer } type_;
@@ -259,6 +291,8 @@ class SessionConnection final
 
   void do_close(Status status);
 
+  static size_t get_packed_query_size(const MtprotoQuery &query);
+
   void send_ack(MessageId message_id);
   void send_crypto(const Storer &storer, uint64 quick_ack_token);
   void send_before(double tm);
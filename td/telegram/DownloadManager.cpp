@@ -165,7 +165,7 @@ class DownloadManagerImpl final : public DownloadManager {
   }
 
   void change_search_text(FileId file_id, FileSourceId file_source_id, string search_text) final {
-    if (!is_search_inited_) {
+    if (!are_hints_inited_) {
       return;
     }
 
@@ -187,6 +187,7 @@ class DownloadManagerImpl final : public DownloadManager {
 
     LOG(INFO) << "DownloadManager: hints are synchronized";
     is_search_inited_ = true;
+    are_hints_inited_ = true;
   }
 
   void search(string query, bool only_active, bool only_completed, string offset, int32 limit,
@@ -200,7 +201,7 @@ class DownloadManagerImpl final : public DownloadManager {
     TRY_STATUS_PROMISE(promise, G()->close_status());
     TRY_STATUS_PROMISE(promise, check_is_active("do_search"));
 
-    if (!is_search_inited_) {
+    if (!query.empty() && !are_hints_inited_) {
       Promise<Unit> lock;
       if (load_search_text_multipromise_.promise_count() == 0) {
         load_search_text_multipromise_.add_promise(
@@ -227,34 +228,39 @@ class DownloadManagerImpl final : public DownloadManager {
       }
       offset_int64 = r_offset.move_as_ok();
     }
-    auto download_ids = hints_.search(query, 10000, true).second;
+    auto limit_size_t = static_cast<size_t>(limit);
+    vector<int64> download_ids;
     FileCounters counters;
-    td::remove_if(download_ids, [&](int64 download_id) {
-      auto r_file_info_ptr = get_file_info_ptr(download_id);
-      CHECK(r_file_info_ptr.is_ok());
-      auto &file_info = *r_file_info_ptr.ok();
-      if (is_completed(file_info)) {
-        counters.completed_count++;
-        if (only_active) {
-          return true;
-        }
-      } else {
-        counters.active_count++;
-        if (file_info.is_paused) {
-          counters.paused_count++;
-        }
-        if (only_completed) {
-          return true;
+    if (query.empty()) {
+      // all files match the query, so return the page directly without loading search texts
+      is_search_inited_ = true;
+      counters = file_counters_;
+      const auto &ordered_download_ids = only_completed ? completed_download_ids_ : download_ids_;
+      download_ids = get_download_ids_page(
+          ordered_download_ids.begin(), ordered_download_ids.lower_bound(offset_int64), limit_size_t,
+          [&](int64 download_id) { return only_active && completed_download_ids_.count(download_id) != 0; });
+    } else {
+      // all matching files must be counted, but only the requested page is selected
+      auto found_download_ids = hints_.search_keys(query);
+      for (auto download_id : found_download_ids) {
+        auto r_file_info_ptr = get_file_info_ptr(download_id);
+        CHECK(r_file_info_ptr.is_ok());
+        auto &file_info = *r_file_info_ptr.ok();
+        if (is_completed(file_info)) {
+          counters.completed_count++;
+        } else {
+          counters.active_count++;
+          if (file_info.is_paused) {
+            counters.paused_count++;
+          }
         }
       }
-      if (download_id >= offset_int64) {
-        return true;
-      }
-      return false;
-    });
-    std::sort(download_ids.begin(), download_ids.end(), std::greater<>());
-    if (static_cast<int32>(download_ids.size()) > limit) {
-      download_ids.resize(limit);
+      download_ids = get_download_ids_page(
+          found_download_ids.begin(),
+          std::lower_bound(found_download_ids.begin(), found_download_ids.end(), offset_int64), limit_size_t,
+          [&](int64 download_id) {
+            return is_completed(*get_file_info_ptr(download_id).ok()) ? only_active : only_completed;
+          });
     }
     auto file_downloads = transform(download_ids, [&](int64 download_id) {
       on_file_viewed(download_id);
@@ -344,6 +350,7 @@ class DownloadManagerImpl final : public DownloadManager {
   FlatHashMap<FileId, int64, FileIdHash> by_file_id_;
   FlatHashMap<FileId, int64, FileIdHash> by_internal_file_id_;
   FlatHashMap<int64, unique_ptr<FileInfo>> files_;
+  std::set<int64> download_ids_;
   std::set<int64> completed_download_ids_;
   FlatHashSet<int64> unviewed_completed_download_ids_;
   Hints hints_;
@@ -355,6 +362,7 @@ class DownloadManagerImpl final : public DownloadManager {
   bool is_inited_{false};
   bool is_database_loaded_{false};
   bool is_search_inited_{false};
+  bool are_hints_inited_{false};
   int64 max_download_id_{0};
   uint64 last_link_token_{0};
   MultiPromiseActor load_search_text_multipromise_{"LoadFileSearchTextMultiPromiseActor"};
@@ -548,6 +556,7 @@ class DownloadManagerImpl final : public DownloadManager {
               << " with downloaded_size = " << file_info->downloaded_size
               << " and is_paused = " << file_info->is_paused;
     auto it = files_.emplace(download_id, std::move(file_info)).first;
+    download_ids_.insert(download_id);
     bool was_completed = is_completed(*it->second);
     register_file_info(*it->second);  // must be called before start_file, which can call update_file_download_state
     if (is_completed(*it->second)) {
@@ -579,6 +588,7 @@ class DownloadManagerImpl final : public DownloadManager {
     by_internal_file_id_.erase(file_info.internal_file_id);
     by_file_id_.erase(file_id);
     hints_.remove(download_id);
+    download_ids_.erase(download_id);
     completed_download_ids_.erase(download_id);
 
     remove_from_database(file_info);
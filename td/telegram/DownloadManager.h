@@ -84,6 +84,21 @@ class DownloadManager : public Actor {
 
   static unique_ptr<DownloadManager> create(unique_ptr<Callback> callback);
 
+  // returns at most limit download identifiers preceding the position in the range [begin, position)
+  // sorted in increasing order, starting from the last one, and skipping the ones for which is_skipped returns true
+  template <class IteratorT, class FunctionT>
+  static vector<int64> get_download_ids_page(IteratorT begin, IteratorT position, size_t limit,
+                                             FunctionT &&is_skipped) {
+    vector<int64> result;
+    while (position != begin && result.size() < limit) {
+      --position;
+      if (!is_skipped(*position)) {
+        result.push_back(*position);
+      }
+    }
+    return result;
+  }
+
   //
   // public interface for user
   //
@@ -0,0 +1,120 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/EmojiKeywordIndex.h"
+
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace td {
+
+EmojiKeywordIndex::EmojiKeywordIndex(vector<std::pair<string, string>> keyword_emojis) {
+  normalize(keyword_emojis);
+
+  size_t total_size = 0;
+  for (auto &keyword_emoji : keyword_emojis) {
+    total_size += keyword_emoji.first.size() + keyword_emoji.second.size();
+  }
+  data_.reserve(total_size);
+  entries_.reserve(keyword_emojis.size());
+  for (auto &keyword_emoji : keyword_emojis) {
+    if (!keyword_emoji.second.empty()) {
+      add_entry(data_, entries_, keyword_emoji.first, keyword_emoji.second);
+    }
+  }
+}
+
+void EmojiKeywordIndex::normalize(vector<std::pair<string, string>> &keyword_emojis) {
+  // sort by keyword, keeping the last value for duplicate keywords
+  std::stable_sort(keyword_emojis.begin(), keyword_emojis.end(),
+                   [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+  size_t result_size = 0;
+  for (size_t i = 0; i < keyword_emojis.size(); i++) {
+    if (result_size > 0 && keyword_emojis[result_size - 1].first == keyword_emojis[i].first) {
+      keyword_emojis[result_size - 1].second = std::move(keyword_emojis[i].second);
+      continue;
+    }
+    if (result_size != i) {
+      keyword_emojis[result_size] = std::move(keyword_emojis[i]);
+    }
+    result_size++;
+  }
+  keyword_emojis.resize(result_size);
+}
+
+void EmojiKeywordIndex::add_entry(string &data, vector<Entry> &entries, Slice keyword, Slice emojis) {
+  CHECK(data.size() + keyword.size() + emojis.size() <= static_cast<size_t>(std::numeric_limits<uint32>::max()));
+  Entry entry;
+  entry.offset_ = static_cast<uint32>(data.size());
+  entry.keyword_size_ = static_cast<uint32>(keyword.size());
+  entry.emojis_size_ = static_cast<uint32>(emojis.size());
+  data.append(keyword.data(), keyword.size());
+  data.append(emojis.data(), emojis.size());
+  entries.push_back(entry);
+}
+
+vector<EmojiKeywordIndex::Entry>::const_iterator EmojiKeywordIndex::lower_bound(Slice keyword) const {
+  return std::lower_bound(entries_.begin(), entries_.end(), keyword,
+                          [this](const Entry &entry, Slice keyword) { return get_keyword(entry) < keyword; });
+}
+
+vector<string> EmojiKeywordIndex::get_keyword_emojis(Slice keyword) const {
+  auto it = lower_bound(keyword);
+  if (it == entries_.end() || get_keyword(*it) != keyword) {
+    return {};
+  }
+  return full_split(get_emojis(*it).str(), '$');
+}
+
+vector<std::pair<string, string>> EmojiKeywordIndex::search(Slice prefix) const {
+  vector<std::pair<string, string>> result;
+  for (auto it = lower_bound(prefix); it != entries_.end(); ++it) {
+    auto keyword = get_keyword(*it);
+    if (!begins_with(keyword, prefix)) {
+      break;
+    }
+    for (auto emoji : full_split(get_emojis(*it), '$')) {
+      result.emplace_back(emoji.str(), keyword.str());
+    }
+  }
+  return result;
+}
+
+void EmojiKeywordIndex::update(vector<std::pair<string, string>> keyword_emojis) {
+  if (keyword_emojis.empty()) {
+    return;
+  }
+  normalize(keyword_emojis);
+
+  // merge sorted entries with sorted changes into a new buffer
+  string new_data;
+  vector<Entry> new_entries;
+  new_data.reserve(data_.size());
+  new_entries.reserve(entries_.size() + keyword_emojis.size());
+  auto it = entries_.begin();
+  for (auto &keyword_emoji : keyword_emojis) {
+    while (it != entries_.end() && get_keyword(*it) < keyword_emoji.first) {
+      add_entry(new_data, new_entries, get_keyword(*it), get_emojis(*it));
+      ++it;
+    }
+    if (it != entries_.end() && get_keyword(*it) == keyword_emoji.first) {
+      ++it;
+    }
+    if (!keyword_emoji.second.empty()) {
+      add_entry(new_data, new_entries, keyword_emoji.first, keyword_emoji.second);
+    }
+  }
+  for (; it != entries_.end(); ++it) {
+    add_entry(new_data, new_entries, get_keyword(*it), get_emojis(*it));
+  }
+  data_ = std::move(new_data);
+  entries_ = std::move(new_entries);
+}
+
+}  // namespace td
@@ -0,0 +1,67 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+
+#include <utility>
+
+namespace td {
+
+// immutable-layout in-memory index of emoji keywords of one language
+// keywords are stored sorted in a single buffer together with '$'-separated lists of their emojis
+class EmojiKeywordIndex {
+ public:
+  EmojiKeywordIndex() = default;
+
+  // pairs (keyword, '$'-separated emojis) in any order; keywords with empty emojis are ignored
+  explicit EmojiKeywordIndex(vector<std::pair<string, string>> keyword_emojis);
+
+  size_t size() const {
+    return entries_.size();
+  }
+
+  size_t get_memory_usage() const {
+    return data_.capacity() + entries_.capacity() * sizeof(Entry);
+  }
+
+  // returns emojis for the keyword
+  vector<string> get_keyword_emojis(Slice keyword) const;
+
+  // returns pairs (emoji, keyword) for all keywords beginning with the prefix in lexicographical order of keywords
+  vector<std::pair<string, string>> search(Slice prefix) const;
+
+  // replaces emojis of the keywords; keywords with empty emojis are removed
+  void update(vector<std::pair<string, string>> keyword_emojis);
+
+ private:
+  struct Entry {
+    uint32 offset_;
+    uint32 keyword_size_;
+    uint32 emojis_size_;
+  };
+
+  string data_;
+  vector<Entry> entries_;
+
+  Slice get_keyword(const Entry &entry) const {
+    return Slice(data_).substr(entry.offset_, entry.keyword_size_);
+  }
+
+  Slice get_emojis(const Entry &entry) const {
+    return Slice(data_).substr(entry.offset_ + entry.keyword_size_, entry.emojis_size_);
+  }
+
+  vector<Entry>::const_iterator lower_bound(Slice keyword) const;
+
+  static void normalize(vector<std::pair<string, string>> &keyword_emojis);
+
+  static void add_entry(string &data, vector<Entry> &entries, Slice keyword, Slice emojis);
+};
+
+}  // namespace td
@@ -258,6 +258,7 @@ DcId Global::get_webfile_dc_id() const {
 }
 
 void Global::set_net_query_stats(std::shared_ptr<NetQueryStats> net_query_stats) {
+  net_query_stats_ = net_query_stats;
   net_query_creator_.set_create_func(
       [net_query_stats = std::move(net_query_stats)] { return td::make_unique<NetQueryCreator>(net_query_stats); });
 }
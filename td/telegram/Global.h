@@ -134,6 +134,10 @@ class Global final : public ActorContext {
 
   void set_net_query_stats(std::shared_ptr<NetQueryStats> net_query_stats);
 
+  NetQueryStats *get_net_query_stats() const {
+    return net_query_stats_.get();
+  }
+
   void set_net_query_dispatcher(unique_ptr<NetQueryDispatcher> net_query_dispatcher);
 
   NetQueryDispatcher &net_query_dispatcher() {
@@ -756,6 +760,7 @@ class Global final : public ActorContext {
   ActorId<StateManager> state_manager_;
 
   LazySchedulerLocalStorage<unique_ptr<NetQueryCreator>> net_query_creator_;
+  std::shared_ptr<NetQueryStats> net_query_stats_;
   unique_ptr<NetQueryDispatcher> net_query_dispatcher_;
 
   static int64 get_location_key(double latitude, double longitude);
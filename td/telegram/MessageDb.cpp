@@ -41,6 +41,27 @@ namespace td {
 static constexpr int32 MESSAGE_DB_INDEX_COUNT = 30;
 static constexpr int32 MESSAGE_DB_INDEX_COUNT_OLD = 9;
 
+static constexpr size_t MIN_FTS_PREFIX_LENGTH = 2;
+static constexpr int32 FTS_MERGE_PAGE_COUNT = 256;
+static constexpr int32 FTS_BUILD_BATCH_SIZE = 1000;
+
+static Status create_fts_table(SqliteDb &db, Slice table_name) {
+  // prefix indexes make search by the last incomplete word of the query fast
+  return db.exec(PSLICE() << "CREATE VIRTUAL TABLE IF NOT EXISTS " << table_name
+                          << " USING fts5(text, content='messages', content_rowid='search_id', tokenize = "
+                             "\"unicode61 remove_diacritics 0 tokenchars '\a'\", prefix = '2 3')");
+}
+
+static Status create_fts_triggers(SqliteDb &db) {
+  TRY_STATUS(db.exec(
+      "CREATE TRIGGER IF NOT EXISTS trigger_fts_delete BEFORE DELETE ON messages WHEN OLD.search_id IS NOT NULL"
+      " BEGIN INSERT INTO messages_fts(messages_fts, rowid, text) VALUES(\'delete\', OLD.search_id, OLD.text); END"));
+  TRY_STATUS(db.exec(
+      "CREATE TRIGGER IF NOT EXISTS trigger_fts_insert AFTER INSERT ON messages WHEN NEW.search_id IS NOT NULL"
+      " BEGIN INSERT INTO messages_fts(rowid, text) VALUES(NEW.search_id, NEW.text); END"));
+  return Status::OK();
+}
+
 // NB: must happen inside a transaction
 Status init_message_db(SqliteDb &db, int32 version) {
   LOG(INFO) << "Init message database " << tag("version", version);
@@ -68,15 +89,8 @@ Status init_message_db(SqliteDb &db, int32 version) {
         db.exec("CREATE INDEX IF NOT EXISTS message_by_search_id ON messages "
                 "(search_id) WHERE search_id IS NOT NULL"));
 
-    TRY_STATUS(
-        db.exec("CREATE VIRTUAL TABLE IF NOT EXISTS messages_fts USING fts5(text, content='messages', "
-                "content_rowid='search_id', tokenize = \"unicode61 remove_diacritics 0 tokenchars '\a'\")"));
-    TRY_STATUS(db.exec(
-        "CREATE TRIGGER IF NOT EXISTS trigger_fts_delete BEFORE DELETE ON messages WHEN OLD.search_id IS NOT NULL"
-        " BEGIN INSERT INTO messages_fts(messages_fts, rowid, text) VALUES(\'delete\', OLD.search_id, OLD.text); END"));
-    TRY_STATUS(db.exec(
-        "CREATE TRIGGER IF NOT EXISTS trigger_fts_insert AFTER INSERT ON messages WHEN NEW.search_id IS NOT NULL"
-        " BEGIN INSERT INTO messages_fts(rowid, text) VALUES(NEW.search_id, NEW.text); END"));
+    TRY_STATUS(create_fts_table(db, "messages_fts"));
+    TRY_STATUS(create_fts_triggers(db));
     //TRY_STATUS(db.exec(
     //"CREATE TRIGGER IF NOT EXISTS trigger_fts_update AFTER UPDATE ON messages WHEN NEW.search_id IS NOT NULL OR "
     //"OLD.search_id IS NOT NULL"
@@ -167,6 +181,23 @@ Status init_message_db(SqliteDb &db, int32 version) {
   if (version < static_cast<int32>(DbVersion::AddMessageThreadSupport)) {
     TRY_STATUS(db.exec("ALTER TABLE messages ADD COLUMN top_thread_message_id INT8"));
   }
+  if (version >= static_cast<int32>(DbVersion::AddMessageDbFts) &&
+      version < static_cast<int32>(DbVersion::AddMessageDbFtsPrefixIndex)) {
+    // building of the index can take minutes for big databases, so the index with prefixes is built
+    // in background in batches by MessageDbImpl::build_fts_prefix_index and replaces messages_fts when it is ready;
+    // messages with search_id not less than messages_fts_new_state.min_search_id are already added to the new index
+    TRY_STATUS(create_fts_table(db, "messages_fts_new"));
+    TRY_STATUS(db.exec("CREATE TABLE IF NOT EXISTS messages_fts_new_state (min_search_id INT8)"));
+    TRY_STATUS(db.exec("INSERT INTO messages_fts_new_state SELECT IFNULL(MAX(search_id), 0) + 1 FROM messages"));
+    TRY_STATUS(
+        db.exec("CREATE TRIGGER IF NOT EXISTS trigger_fts_new_delete BEFORE DELETE ON messages WHEN OLD.search_id >= "
+                "(SELECT min_search_id FROM messages_fts_new_state) BEGIN INSERT INTO "
+                "messages_fts_new(messages_fts_new, rowid, text) VALUES(\'delete\', OLD.search_id, OLD.text); END"));
+    TRY_STATUS(
+        db.exec("CREATE TRIGGER IF NOT EXISTS trigger_fts_new_insert AFTER INSERT ON messages WHEN NEW.search_id >= "
+                "(SELECT min_search_id FROM messages_fts_new_state) BEGIN INSERT INTO messages_fts_new(rowid, text) "
+                "VALUES(NEW.search_id, NEW.text); END"));
+  }
   return Status::OK();
 }
 
@@ -224,6 +255,10 @@ class MessageDbImpl final : public MessageDbSyncInterface {
                       db_.get_statement("SELECT dialog_id, message_id, data, search_id FROM messages WHERE search_id "
                                         "IN (SELECT rowid FROM messages_fts WHERE messages_fts MATCH ?1 AND rowid < ?2 "
                                         "ORDER BY rowid DESC LIMIT ?3) ORDER BY search_id DESC"));
+    TRY_RESULT_ASSIGN(merge_fts_stmt_,
+                      db_.get_statement("INSERT INTO messages_fts(messages_fts, rank) VALUES('merge', ?1)"));
+    TRY_RESULT_ASSIGN(get_total_changes_stmt_, db_.get_statement("SELECT total_changes()"));
+    TRY_RESULT_ASSIGN(need_fts_prefix_index_build_, db_.has_table("messages_fts_new_state"));
 
     for (int32 i = 0; i < MESSAGE_DB_INDEX_COUNT; i++) {
       TRY_RESULT_ASSIGN(
@@ -688,7 +723,7 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     return result;
   }
 
-  static string prepare_query(Slice query) {
+  static string prepare_query(Slice query, bool search_last_word_prefix) {
     auto is_word_character = [](uint32 a) {
       switch (get_unicode_simple_category(a)) {
         case UnicodeSimpleCategory::Letter:
@@ -705,6 +740,7 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     auto buf = StackAllocator::alloc(query.size() * 4 + 100);
     StringBuilder sb(buf.as_slice());
     bool in_word{false};
+    size_t word_length = 0;
 
     for (auto ptr = query.ubegin(), end = query.uend(); ptr < end;) {
       uint32 code;
@@ -713,9 +749,11 @@ class MessageDbImpl final : public MessageDbSyncInterface {
       if (is_word_character(code)) {
         if (!in_word) {
           in_word = true;
+          word_length = 0;
           sb << "\"";
         }
         sb << Slice(code_ptr, ptr);
+        word_length++;
       } else {
         if (in_word) {
           in_word = false;
@@ -724,7 +762,8 @@ class MessageDbImpl final : public MessageDbSyncInterface {
       }
     }
     if (in_word) {
-      sb << "\" ";
+      // the last word can be incomplete, so search for it as a prefix if the prefix is long enough to be indexed
+      sb << (search_last_word_prefix && word_length >= MIN_FTS_PREFIX_LENGTH ? "\"* " : "\" ");
     }
 
     if (sb.is_error()) {
@@ -741,8 +780,10 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     };
 
     LOG(INFO) << tag("query", query.query) << query.dialog_id << tag("filter", query.filter)
-              << tag("from_search_id", query.from_search_id) << tag("limit", query.limit);
-    string words = prepare_query(query.query);
+              << tag("from_search_id", query.from_search_id) << tag("limit", query.limit)
+              << tag("search_last_word_prefix", query.search_last_word_prefix);
+    // prefix queries without the prefix index would scan the whole index, so they are used only after it is built
+    string words = prepare_query(query.query, query.search_last_word_prefix && !need_fts_prefix_index_build_);
     LOG(INFO) << tag("from", query.query) << tag("to", words);
 
     // dialog_id kludge
@@ -780,6 +821,101 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     return result;
   }
 
+  bool merge_fts_index() final {
+    auto total_changes = get_total_changes();
+    SCOPE_EXIT {
+      merge_fts_stmt_.reset();
+    };
+    // negative page count is used to start the merge, because it moves all segments to the same level first,
+    // so they are merged even if there are few segments on each level
+    merge_fts_stmt_.bind_int32(1, is_fts_merge_started_ ? FTS_MERGE_PAGE_COUNT : -FTS_MERGE_PAGE_COUNT).ensure();
+    auto status = merge_fts_stmt_.step();
+    if (status.is_error()) {
+      LOG(ERROR) << "Failed to merge full-text search index: " << status;
+      is_fts_merge_started_ = false;
+      return false;
+    }
+    // the merge did no work if it has written less than 2 pages
+    is_fts_merge_started_ = get_total_changes() - total_changes >= 2;
+    return is_fts_merge_started_;
+  }
+
+  bool build_fts_prefix_index() final {
+    if (!need_fts_prefix_index_build_) {
+      return false;
+    }
+    auto r_need_continue = [&]() -> Result<bool> {
+      TRY_STATUS(db_.begin_write_transaction());
+      // the savepoint allows to discard a partially applied step in case of an error
+      auto r_result = db_.exec("SAVEPOINT build_fts_prefix_index");
+      Result<bool> result;
+      if (r_result.is_ok()) {
+        result = do_build_fts_prefix_index();
+        if (result.is_error()) {
+          db_.exec("ROLLBACK TO build_fts_prefix_index").ignore();
+        }
+        db_.exec("RELEASE build_fts_prefix_index").ignore();
+      } else {
+        result = std::move(r_result);
+      }
+      TRY_STATUS(db_.commit_transaction());
+      return result;
+    }();
+    if (r_need_continue.is_error()) {
+      LOG(ERROR) << "Failed to build full-text search index: " << r_need_continue.error();
+      // the build will be continued after restart
+      need_fts_prefix_index_build_ = false;
+      return false;
+    }
+    need_fts_prefix_index_build_ = r_need_continue.ok();
+    return true;
+  }
+
+  Result<bool> do_build_fts_prefix_index() {
+    TRY_RESULT(get_state_stmt, db_.get_statement("SELECT min_search_id FROM messages_fts_new_state"));
+    TRY_STATUS(get_state_stmt.step());
+    if (!get_state_stmt.has_row()) {
+      return Status::Error("Have no state of the full-text search index build");
+    }
+    auto min_search_id = get_state_stmt.view_int64(0);
+    get_state_stmt.reset();
+
+    TRY_RESULT(get_batch_stmt, db_.get_statement("SELECT MIN(search_id) FROM (SELECT search_id FROM messages WHERE "
+                                                 "search_id < ?1 ORDER BY search_id DESC LIMIT ?2)"));
+    get_batch_stmt.bind_int64(1, min_search_id).ensure();
+    get_batch_stmt.bind_int32(2, FTS_BUILD_BATCH_SIZE).ensure();
+    TRY_STATUS(get_batch_stmt.step());
+    CHECK(get_batch_stmt.has_row());
+    if (get_batch_stmt.view_datatype(0) == SqliteStatement::Datatype::Null) {
+      // all messages have been added to the new index; replace the old index with it
+      get_batch_stmt.reset();
+      TRY_STATUS(db_.exec("DROP TRIGGER IF EXISTS trigger_fts_new_delete"));
+      TRY_STATUS(db_.exec("DROP TRIGGER IF EXISTS trigger_fts_new_insert"));
+      TRY_STATUS(db_.exec("DROP TRIGGER IF EXISTS trigger_fts_delete"));
+      TRY_STATUS(db_.exec("DROP TRIGGER IF EXISTS trigger_fts_insert"));
+      TRY_STATUS(db_.exec("DROP TABLE messages_fts"));
+      TRY_STATUS(db_.exec("ALTER TABLE messages_fts_new RENAME TO messages_fts"));
+      TRY_STATUS(db_.exec("DROP TABLE messages_fts_new_state"));
+      TRY_STATUS(create_fts_triggers(db_));
+      LOG(INFO) << "Full-text search index with prefixes is built";
+      return false;
+    }
+    auto batch_min_search_id = get_batch_stmt.view_int64(0);
+    get_batch_stmt.reset();
+
+    TRY_RESULT(add_batch_stmt,
+               db_.get_statement("INSERT INTO messages_fts_new(rowid, text) SELECT search_id, text FROM messages "
+                                 "WHERE search_id >= ?1 AND search_id < ?2"));
+    add_batch_stmt.bind_int64(1, batch_min_search_id).ensure();
+    add_batch_stmt.bind_int64(2, min_search_id).ensure();
+    TRY_STATUS(add_batch_stmt.step());
+
+    TRY_RESULT(set_state_stmt, db_.get_statement("UPDATE messages_fts_new_state SET min_search_id = ?1"));
+    set_state_stmt.bind_int64(1, batch_min_search_id).ensure();
+    TRY_STATUS(set_state_stmt.step());
+    return true;
+  }
+
   vector<MessageDbDialogMessage> get_messages_from_index(DialogId dialog_id, MessageId from_message_id,
                                                          MessageSearchFilter filter, int32 offset, int32 limit) {
     auto &stmt = get_messages_from_index_stmts_[message_search_filter_index(filter)];
@@ -850,6 +986,10 @@ class MessageDbImpl final : public MessageDbSyncInterface {
   std::array<SqliteStatement, 2> get_calls_stmts_;
 
   SqliteStatement get_messages_fts_stmt_;
+  SqliteStatement merge_fts_stmt_;
+  SqliteStatement get_total_changes_stmt_;
+  bool is_fts_merge_started_ = false;
+  bool need_fts_prefix_index_build_ = false;
 
   SqliteStatement add_scheduled_message_stmt_;
   SqliteStatement get_scheduled_message_stmt_;
@@ -857,6 +997,15 @@ class MessageDbImpl final : public MessageDbSyncInterface {
   SqliteStatement delete_scheduled_message_stmt_;
   SqliteStatement delete_scheduled_server_message_stmt_;
 
+  int64 get_total_changes() {
+    SCOPE_EXIT {
+      get_total_changes_stmt_.reset();
+    };
+    get_total_changes_stmt_.step().ensure();
+    CHECK(get_total_changes_stmt_.has_row());
+    return get_total_changes_stmt_.view_int64(0);
+  }
+
   static vector<MessageDbDialogMessage> get_messages_impl(GetMessagesStmt &stmt, DialogId dialog_id,
                                                           MessageId from_message_id, int32 offset, int32 limit) {
     LOG_CHECK(dialog_id.is_valid()) << dialog_id;
@@ -1103,12 +1252,16 @@ class MessageDbAsync final : public MessageDbAsyncInterface {
     void delete_all_dialog_messages(DialogId dialog_id, MessageId from_message_id, Promise<> promise) {
       add_read_query();
       sync_db_->delete_all_dialog_messages(dialog_id, from_message_id);
+      need_fts_merge_ = true;
+      schedule_fts_merge();
       promise.set_value(Unit());
     }
 
     void delete_dialog_messages_by_sender(DialogId dialog_id, DialogId sender_dialog_id, Promise<> promise) {
       add_read_query();
       sync_db_->delete_dialog_messages_by_sender(dialog_id, sender_dialog_id);
+      need_fts_merge_ = true;
+      schedule_fts_merge();
       promise.set_value(Unit());
     }
 
@@ -1186,15 +1339,23 @@ class MessageDbAsync final : public MessageDbAsyncInterface {
 
     static constexpr size_t MAX_PENDING_QUERIES_COUNT{50};
     static constexpr double MAX_PENDING_QUERIES_DELAY{0.01};
+    static constexpr double FTS_MERGE_IDLE_DELAY{5.0};
+    static constexpr double FTS_MERGE_STEP_DELAY{0.05};
 
     //NB: order is important, destructor of pending_writes_ will change finished_writes_
     vector<Promise<Unit>> finished_writes_;
     vector<Promise<Unit>> pending_writes_;  // TODO use Action
     double wakeup_at_ = 0;
 
+    // the full-text search index is merged in background only after there were no queries for FTS_MERGE_IDLE_DELAY
+    bool need_fts_merge_ = false;
+    double last_query_time_ = 0;
+
     template <class F>
     void add_write_query(F &&f) {
       pending_writes_.push_back(PromiseCreator::lambda(std::forward<F>(f)));
+      need_fts_merge_ = true;
+      last_query_time_ = Time::now_cached();
       if (pending_writes_.size() > MAX_PENDING_QUERIES_COUNT) {
         do_flush();
         wakeup_at_ = 0;
@@ -1206,6 +1367,7 @@ class MessageDbAsync final : public MessageDbAsyncInterface {
       }
     }
     void add_read_query() {
+      last_query_time_ = Time::now_cached();
       do_flush();
     }
     void do_flush() {
@@ -1217,13 +1379,37 @@ class MessageDbAsync final : public MessageDbAsyncInterface {
       sync_db_->commit_transaction().ensure();
       set_promises(finished_writes_);
       cancel_timeout();
+      schedule_fts_merge();
+    }
+    void schedule_fts_merge() {
+      if (need_fts_merge_ && !has_timeout()) {
+        set_timeout_at(last_query_time_ + FTS_MERGE_IDLE_DELAY);
+      }
     }
     void timeout_expired() final {
       do_flush();
+      if (!need_fts_merge_ || sync_db_ == nullptr) {
+        return;
+      }
+      if (Time::now() < last_query_time_ + FTS_MERGE_IDLE_DELAY) {
+        set_timeout_at(last_query_time_ + FTS_MERGE_IDLE_DELAY);
+        return;
+      }
+      if (sync_db_->build_fts_prefix_index() || sync_db_->merge_fts_index()) {
+        set_timeout_in(FTS_MERGE_STEP_DELAY);
+      } else {
+        LOG(INFO) << "Full-text search index is merged";
+        need_fts_merge_ = false;
+      }
     }
 
     void start_up() final {
       sync_db_ = &sync_db_safe_->get();
+
+      // continue building of the full-text search index if it was interrupted
+      need_fts_merge_ = true;
+      last_query_time_ = Time::now();
+      schedule_fts_merge();
     }
   };
   ActorOwn<Impl> impl_;
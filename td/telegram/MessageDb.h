@@ -81,6 +81,7 @@ struct MessageDbFtsQuery {
   MessageSearchFilter filter{MessageSearchFilter::Empty};
   int64 from_search_id{0};
   int32 limit{100};
+  bool search_last_word_prefix{false};  // search for the last word of the query as a prefix if the index allows it
 };
 struct MessageDbFtsResult {
   vector<MessageDbMessage> messages;
@@ -134,6 +135,13 @@ class MessageDbSyncInterface {
   virtual MessageDbCallsResult get_calls(MessageDbCallsQuery query) = 0;
   virtual MessageDbFtsResult get_messages_fts(MessageDbFtsQuery query) = 0;
 
+  // merges some segments of the full-text search index; returns false if there is nothing to merge
+  virtual bool merge_fts_index() = 0;
+
+  // adds a batch of messages to the full-text search index with prefixes, which is built in background after
+  // a database upgrade; returns false if there is nothing to build
+  virtual bool build_fts_prefix_index() = 0;
+
   virtual Status begin_write_transaction() = 0;
   virtual Status commit_transaction() = 0;
 };
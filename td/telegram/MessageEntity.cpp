@@ -19,6 +19,7 @@
 #include "td/actor/MultiPromise.h"
 
 #include "td/utils/algorithm.h"
+#include "td/utils/bits.h"
 #include "td/utils/format.h"
 #include "td/utils/HashTableUtils.h"
 #include "td/utils/logging.h"
@@ -34,6 +35,11 @@
 #include <limits>
 #include <tuple>
 
+#if defined(__SSE2__) || (TD_MSVC && (defined(_M_X64) || (defined(_M_IX86) && _M_IX86_FP >= 2)))
+#define TD_ENTITY_SCANNER_SSE2 1
+#include <emmintrin.h>
+#endif
+
 namespace td {
 
 int MessageEntity::get_type_priority(Type type) {
@@ -257,11 +263,11 @@ static bool is_alpha_digit_or_underscore_or_minus(uint32 code) {
 
 // This functions just implements corresponding regexps
 // All other fixes will be in other functions
-static vector<Slice> match_mentions(Slice str) {
+static vector<Slice> match_mentions(Slice str, size_t start) {
   vector<Slice> result;
   const unsigned char *begin = str.ubegin();
   const unsigned char *end = str.uend();
-  const unsigned char *ptr = begin;
+  const unsigned char *ptr = begin + start;
 
   // '/(?<=\B)@([a-zA-Z0-9_]{2,32})(?=\b)/u'
 
@@ -301,11 +307,11 @@ static vector<Slice> match_mentions(Slice str) {
   return result;
 }
 
-static vector<Slice> match_bot_commands(Slice str) {
+static vector<Slice> match_bot_commands(Slice str, size_t start) {
   vector<Slice> result;
   const unsigned char *begin = str.ubegin();
   const unsigned char *end = str.uend();
-  const unsigned char *ptr = begin;
+  const unsigned char *ptr = begin + start;
 
   // '/(?<!\b|[\/<>])\/([a-zA-Z0-9_]{1,64})(?:@([a-zA-Z0-9_]{3,32}))?(?!\B|[\/<>])/u'
 
@@ -374,11 +380,11 @@ static bool is_hashtag_letter(uint32 c, UnicodeSimpleCategory &category) {
   }
 }
 
-static vector<Slice> match_hashtags(Slice str) {
+static vector<Slice> match_hashtags(Slice str, size_t start) {
   vector<Slice> result;
   const unsigned char *begin = str.ubegin();
   const unsigned char *end = str.uend();
-  const unsigned char *ptr = begin;
+  const unsigned char *ptr = begin + start;
 
   // '/(?<=^|[^\d_\pL\x{200c}\x{0d80}-\x{0dff}])#([\d_\pL\x{200c}\x{0d80}-\x{0dff}]{1,256})(?![\d_\pL\x{200c}\x{0d80}-\x{0dff}]*#)/u'
   // and at least one letter
@@ -437,11 +443,11 @@ static vector<Slice> match_hashtags(Slice str) {
   return result;
 }
 
-static vector<Slice> match_cashtags(Slice str) {
+static vector<Slice> match_cashtags(Slice str, size_t start) {
   vector<Slice> result;
   const unsigned char *begin = str.ubegin();
   const unsigned char *end = str.uend();
-  const unsigned char *ptr = begin;
+  const unsigned char *ptr = begin + start;
 
   // '/(?<=^|[^$\d_\pL\x{200c}\x{0d80}-\x{0dff}])\$(1INCH|[A-Z]{1,8})(?![$\d_\pL\x{200c}\x{0d80}-\x{0dff}])/u'
 
@@ -489,11 +495,11 @@ static vector<Slice> match_cashtags(Slice str) {
   return result;
 }
 
-static vector<Slice> match_media_timestamps(Slice str) {
+static vector<Slice> match_media_timestamps(Slice str, size_t start) {
   vector<Slice> result;
   const unsigned char *begin = str.ubegin();
   const unsigned char *end = str.uend();
-  const unsigned char *ptr = begin;
+  const unsigned char *ptr = begin + start;
 
   while (true) {
     ptr = static_cast<const unsigned char *>(std::memchr(ptr, ':', narrow_cast<int32>(end - ptr)));
@@ -540,11 +546,11 @@ static vector<Slice> match_media_timestamps(Slice str) {
   return result;
 }
 
-static vector<Slice> match_bank_card_numbers(Slice str) {
+static vector<Slice> match_bank_card_numbers(Slice str, size_t start) {
   vector<Slice> result;
   const unsigned char *begin = str.ubegin();
   const unsigned char *end = str.uend();
-  const unsigned char *ptr = begin;
+  const unsigned char *ptr = begin + start;
 
   // '/(?<=^|[^+_\pL\d-.,])[\d -]{13,}([^_\pL\d-]|$)/'
 
@@ -626,11 +632,12 @@ static bool is_url_path_symbol(uint32 c) {
   }
 }
 
-static vector<Slice> match_tg_urls(Slice str) {
+static vector<Slice> match_tg_urls(Slice str, size_t start) {
   vector<Slice> result;
   const unsigned char *begin = str.ubegin();
   const unsigned char *end = str.uend();
-  const unsigned char *ptr = begin;
+  // the first ':' can be close to the end of the text, but only the whole text must be long enough for a URL
+  const unsigned char *ptr = end - begin > 5 ? std::min(begin + start, end - 6) : begin;
 
   // '(tg|ton|tonsite)://[a-z0-9_-]{1,253}([/?#][^\s\x{2000}-\x{200b}\x{200e}-\x{200f}\x{2016}-\x{206f}<>«»"]*)?'
 
@@ -691,7 +698,7 @@ static vector<Slice> match_tg_urls(Slice str) {
   return result;
 }
 
-static vector<Slice> match_urls(Slice str) {
+static vector<Slice> match_urls(Slice str, size_t start) {
   vector<Slice> result;
   const unsigned char *begin = str.ubegin();
   const unsigned char *end = str.uend();
@@ -739,7 +746,11 @@ static vector<Slice> match_urls(Slice str) {
   Slice bad_path_end_chars(".:;,('?!`");
 
   while (true) {
-    auto dot_pos = str.find('.');
+    auto dot_pos = str.substr(start).find('.');
+    if (dot_pos != Slice::npos) {
+      dot_pos += start;
+    }
+    start = 0;
     if (dot_pos > str.size() || dot_pos + 1 == str.size()) {
       break;
     }
@@ -1320,8 +1331,8 @@ const FlatHashSet<Slice, SliceHash> &get_valid_short_usernames() {
   return valid_usernames;
 }
 
-vector<Slice> find_mentions(Slice str) {
-  auto mentions = match_mentions(str);
+static vector<Slice> find_mentions(Slice str, size_t start) {
+  auto mentions = match_mentions(str, start);
   td::remove_if(mentions, [](Slice mention) {
     mention.remove_prefix(1);
     if (mention.size() >= 4) {
@@ -1333,21 +1344,37 @@ vector<Slice> find_mentions(Slice str) {
   return mentions;
 }
 
+vector<Slice> find_mentions(Slice str) {
+  return find_mentions(str, 0);
+}
+
+static vector<Slice> find_bot_commands(Slice str, size_t start) {
+  return match_bot_commands(str, start);
+}
+
 vector<Slice> find_bot_commands(Slice str) {
-  return match_bot_commands(str);
+  return find_bot_commands(str, 0);
+}
+
+static vector<Slice> find_hashtags(Slice str, size_t start) {
+  return match_hashtags(str, start);
 }
 
 vector<Slice> find_hashtags(Slice str) {
-  return match_hashtags(str);
+  return find_hashtags(str, 0);
+}
+
+static vector<Slice> find_cashtags(Slice str, size_t start) {
+  return match_cashtags(str, start);
 }
 
 vector<Slice> find_cashtags(Slice str) {
-  return match_cashtags(str);
+  return find_cashtags(str, 0);
 }
 
-vector<Slice> find_bank_card_numbers(Slice str) {
+static vector<Slice> find_bank_card_numbers(Slice str, size_t start) {
   vector<Slice> result;
-  for (auto bank_card : match_bank_card_numbers(str)) {
+  for (auto bank_card : match_bank_card_numbers(str, start)) {
     if (is_valid_bank_card(bank_card)) {
       result.emplace_back(bank_card);
     }
@@ -1355,13 +1382,21 @@ vector<Slice> find_bank_card_numbers(Slice str) {
   return result;
 }
 
+vector<Slice> find_bank_card_numbers(Slice str) {
+  return find_bank_card_numbers(str, 0);
+}
+
+static vector<Slice> find_tg_urls(Slice str, size_t start) {
+  return match_tg_urls(str, start);
+}
+
 vector<Slice> find_tg_urls(Slice str) {
-  return match_tg_urls(str);
+  return find_tg_urls(str, 0);
 }
 
-vector<std::pair<Slice, bool>> find_urls(Slice str) {
+static vector<std::pair<Slice, bool>> find_urls(Slice str, size_t start) {
   vector<std::pair<Slice, bool>> result;
-  for (auto url : match_urls(str)) {
+  for (auto url : match_urls(str, start)) {
     if (is_email_address(url)) {
       result.emplace_back(url, true);
     } else if (begins_with(url, "mailto:") && is_email_address(url.substr(7))) {
@@ -1376,9 +1411,13 @@ vector<std::pair<Slice, bool>> find_urls(Slice str) {
   return result;
 }
 
-vector<std::pair<Slice, int32>> find_media_timestamps(Slice str) {
+vector<std::pair<Slice, bool>> find_urls(Slice str) {
+  return find_urls(str, 0);
+}
+
+static vector<std::pair<Slice, int32>> find_media_timestamps(Slice str, size_t start) {
   vector<std::pair<Slice, int32>> result;
-  for (auto media_timestamp : match_media_timestamps(str)) {
+  for (auto media_timestamp : match_media_timestamps(str, start)) {
     vector<Slice> parts = full_split(media_timestamp, ':');
     CHECK(parts.size() >= 2);
     if (parts.size() > 3 || parts.back().size() != 2) {
@@ -1412,6 +1451,10 @@ vector<std::pair<Slice, int32>> find_media_timestamps(Slice str) {
   return result;
 }
 
+vector<std::pair<Slice, int32>> find_media_timestamps(Slice str) {
+  return find_media_timestamps(str, 0);
+}
+
 void remove_empty_entities(vector<MessageEntity> &entities) {
   td::remove_if(entities, [](const auto &entity) {
     if (entity.length <= 0) {
@@ -1689,35 +1732,148 @@ static void fix_entity_offsets(Slice text, vector<MessageEntity> &entities) {
   }
 }
 
+namespace {
+// positions of the first occurrences of characters, which must be present in a text for an entity
+// of the corresponding type to be found; matchers start scanning the text from them
+struct EntityTriggers {
+  enum Type : int32 { At, Slash, Hash, Dollar, Dot, Colon, Digit, Size };
+
+  size_t first_positions[Size];
+  size_t digit_count = 0;
+
+  EntityTriggers() {
+    for (auto &position : first_positions) {
+      position = Slice::npos;
+    }
+  }
+
+  void add(Type type, size_t position) {
+    if (first_positions[type] == Slice::npos) {
+      first_positions[type] = position;
+    }
+  }
+
+  bool has(Type type) const {
+    return first_positions[type] != Slice::npos;
+  }
+
+  size_t get_first_position(Type type) const {
+    return first_positions[type];
+  }
+};
+}  // namespace
+
+static EntityTriggers::Type get_entity_trigger_type(unsigned char c) {
+  switch (c) {
+    case '@':
+      return EntityTriggers::At;
+    case '/':
+      return EntityTriggers::Slash;
+    case '#':
+      return EntityTriggers::Hash;
+    case '$':
+      return EntityTriggers::Dollar;
+    case '.':
+      return EntityTriggers::Dot;
+    case ':':
+      return EntityTriggers::Colon;
+    default:
+      return EntityTriggers::Size;
+  }
+}
+
+// scans the text once and returns the first positions of trigger characters in it, so that the matchers
+// for absent entity types are skipped entirely and the other matchers start from their first candidate
+static EntityTriggers scan_entity_triggers(Slice text) {
+  EntityTriggers result;
+  const unsigned char *begin = text.ubegin();
+  const unsigned char *end = text.uend();
+  const unsigned char *ptr = begin;
+#if TD_ENTITY_SCANNER_SSE2
+  const auto at = _mm_set1_epi8('@');
+  const auto slash = _mm_set1_epi8('/');
+  const auto hash = _mm_set1_epi8('#');
+  const auto dollar = _mm_set1_epi8('$');
+  const auto dot = _mm_set1_epi8('.');
+  const auto colon = _mm_set1_epi8(':');
+  const auto before_zero = _mm_set1_epi8('0' - 1);
+  const auto after_nine = _mm_set1_epi8('9' + 1);
+  while (end - ptr >= 16) {
+    auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+    auto is_digit_mask = _mm_and_si128(_mm_cmpgt_epi8(block, before_zero), _mm_cmplt_epi8(block, after_nine));
+    auto digit_bits = static_cast<uint32>(_mm_movemask_epi8(is_digit_mask));
+    if (digit_bits != 0) {
+      result.digit_count += static_cast<size_t>(count_bits32(digit_bits));
+      result.add(EntityTriggers::Digit, static_cast<size_t>(ptr - begin) + count_trailing_zeroes32(digit_bits));
+    }
+
+    auto is_trigger_mask =
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, at), _mm_cmpeq_epi8(block, slash)),
+                     _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, hash), _mm_cmpeq_epi8(block, dollar)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(block, dot), _mm_cmpeq_epi8(block, colon))));
+    auto trigger_bits = static_cast<uint32>(_mm_movemask_epi8(is_trigger_mask));
+    while (trigger_bits != 0) {
+      auto position = static_cast<size_t>(ptr - begin) + count_trailing_zeroes32(trigger_bits);
+      result.add(get_entity_trigger_type(begin[position]), position);
+      trigger_bits &= trigger_bits - 1;
+    }
+    ptr += 16;
+  }
+#endif
+  for (; ptr != end; ptr++) {
+    auto position = static_cast<size_t>(ptr - begin);
+    if (is_digit(*ptr)) {
+      result.digit_count++;
+      result.add(EntityTriggers::Digit, position);
+    } else {
+      auto type = get_entity_trigger_type(*ptr);
+      if (type != EntityTriggers::Size) {
+        result.add(type, position);
+      }
+    }
+  }
+  return result;
+}
+
 vector<MessageEntity> find_entities(Slice text, bool skip_bot_commands, bool skip_media_timestamps) {
   vector<MessageEntity> entities;
 
-  auto add_entities = [&entities, &text](MessageEntity::Type type, vector<Slice> (*find_entities_f)(Slice)) mutable {
-    auto new_entities = find_entities_f(text);
+  auto triggers = scan_entity_triggers(text);
+
+  auto add_entities = [&entities, &text, &triggers](MessageEntity::Type type, EntityTriggers::Type trigger_type,
+                                                    vector<Slice> (*find_entities_f)(Slice, size_t)) mutable {
+    if (!triggers.has(trigger_type)) {
+      return;
+    }
+    auto new_entities = find_entities_f(text, triggers.get_first_position(trigger_type));
     for (auto &entity : new_entities) {
       auto offset = narrow_cast<int32>(entity.begin() - text.begin());
       auto length = narrow_cast<int32>(entity.size());
       entities.emplace_back(type, offset, length);
     }
   };
-  add_entities(MessageEntity::Type::Mention, find_mentions);
+  add_entities(MessageEntity::Type::Mention, EntityTriggers::At, find_mentions);
   if (!skip_bot_commands) {
-    add_entities(MessageEntity::Type::BotCommand, find_bot_commands);
+    add_entities(MessageEntity::Type::BotCommand, EntityTriggers::Slash, find_bot_commands);
   }
-  add_entities(MessageEntity::Type::Hashtag, find_hashtags);
-  add_entities(MessageEntity::Type::Cashtag, find_cashtags);
+  add_entities(MessageEntity::Type::Hashtag, EntityTriggers::Hash, find_hashtags);
+  add_entities(MessageEntity::Type::Cashtag, EntityTriggers::Dollar, find_cashtags);
   // TODO find_phone_numbers
-  add_entities(MessageEntity::Type::BankCardNumber, find_bank_card_numbers);
-  add_entities(MessageEntity::Type::Url, find_tg_urls);
-  auto urls = find_urls(text);
-  for (auto &url : urls) {
-    auto type = url.second ? MessageEntity::Type::EmailAddress : MessageEntity::Type::Url;
-    auto offset = narrow_cast<int32>(url.first.begin() - text.begin());
-    auto length = narrow_cast<int32>(url.first.size());
-    entities.emplace_back(type, offset, length);
-  }
-  if (!skip_media_timestamps) {
-    auto media_timestamps = find_media_timestamps(text);
+  if (triggers.digit_count >= 13) {
+    add_entities(MessageEntity::Type::BankCardNumber, EntityTriggers::Digit, find_bank_card_numbers);
+  }
+  add_entities(MessageEntity::Type::Url, EntityTriggers::Colon, find_tg_urls);
+  if (triggers.has(EntityTriggers::Dot)) {
+    auto urls = find_urls(text, triggers.get_first_position(EntityTriggers::Dot));
+    for (auto &url : urls) {
+      auto type = url.second ? MessageEntity::Type::EmailAddress : MessageEntity::Type::Url;
+      auto offset = narrow_cast<int32>(url.first.begin() - text.begin());
+      auto length = narrow_cast<int32>(url.first.size());
+      entities.emplace_back(type, offset, length);
+    }
+  }
+  if (!skip_media_timestamps && triggers.has(EntityTriggers::Colon) && triggers.digit_count >= 3) {
+    auto media_timestamps = find_media_timestamps(text, triggers.get_first_position(EntityTriggers::Colon));
     for (auto &entity : media_timestamps) {
       auto offset = narrow_cast<int32>(entity.first.begin() - text.begin());
       auto length = narrow_cast<int32>(entity.first.size());
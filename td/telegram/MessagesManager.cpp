@@ -21357,6 +21357,8 @@ void MessagesManager::offline_search_messages(DialogId dialog_id, const string &
     fts_query.from_search_id = r_from_search_id.ok();
   }
   fts_query.limit = limit;
+  // the user is likely to be still typing the last word
+  fts_query.search_last_word_prefix = true;
 
   G()->td_db()->get_message_db_async()->get_messages_fts(
       std::move(fts_query), PromiseCreator::lambda([offset = std::move(offset), limit, promise = std::move(promise)](
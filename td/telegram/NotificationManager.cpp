@@ -162,8 +162,8 @@ void NotificationManager::on_flush_pending_updates_timeout_callback(void *notifi
   }
 
   auto notification_manager = static_cast<NotificationManager *>(notification_manager_ptr);
-  send_closure_later(notification_manager->actor_id(notification_manager), &NotificationManager::flush_pending_updates,
-                     narrow_cast<int32>(group_id_int), "timeout");
+  send_closure_later(notification_manager->actor_id(notification_manager),
+                     &NotificationManager::on_flush_pending_updates_timeout, narrow_cast<int32>(group_id_int));
 }
 
 bool NotificationManager::is_disabled() const {
@@ -801,7 +801,7 @@ void NotificationManager::try_reuse_notification_group_id(NotificationGroupId gr
   if (group_it != groups_.end()) {
     LOG_CHECK(group_it->first.last_notification_date == 0 && group_it->second.total_count == 0)
         << running_get_difference_ << " " << delayed_notification_update_count_ << " "
-        << unreceived_notification_update_count_ << " " << pending_updates_[group_id.get()].size() << " "
+        << unreceived_notification_update_count_ << " " << pending_updates_.get_update_count(group_id.get()) << " "
         << group_it->first << " " << group_it->second;
     CHECK(group_it->second.notifications.empty());
     CHECK(group_it->second.pending_notifications.empty());
@@ -814,7 +814,7 @@ void NotificationManager::try_reuse_notification_group_id(NotificationGroupId gr
       flush_pending_notifications_timeout_.cancel_timeout(group_id.get(), "try_reuse_notification_group_id");
       flush_pending_updates_timeout_.cancel_timeout(group_id.get());
     }
-    if (pending_updates_.erase(group_id.get()) == 1) {
+    if (pending_updates_.drop_updates(group_id.get())) {
       on_delayed_notification_update_count_changed(-1, group_id.get(), "try_reuse_notification_group_id");
     }
   }
@@ -989,13 +989,14 @@ void NotificationManager::add_update(int32 group_id, td_api::object_ptr<td_api::
     return;
   }
   VLOG(notifications) << "Add " << as_notification_update(update.get());
-  auto &updates = pending_updates_[group_id];
-  if (updates.empty()) {
+  if (pending_updates_.add_update(group_id, std::move(update))) {
     on_delayed_notification_update_count_changed(1, group_id, "add_update");
   }
-  updates.push_back(std::move(update));
   if (!G()->close_flag()) {
-    if (!running_get_difference_ && running_get_chat_difference_.count(group_id) == 0) {
+    if (running_get_difference_) {
+      // updates from all groups are flushed at once after getDifference
+      set_flush_all_pending_updates_timeout();
+    } else if (running_get_chat_difference_.count(group_id) == 0) {
       flush_pending_updates_timeout_.add_timeout_in(group_id, MIN_UPDATE_DELAY_MS * 1e-3);
     } else {
       flush_pending_updates_timeout_.set_timeout_in(group_id, MAX_UPDATE_DELAY_MS * 1e-3);
@@ -1003,6 +1004,28 @@ void NotificationManager::add_update(int32 group_id, td_api::object_ptr<td_api::
   }
 }
 
+void NotificationManager::on_flush_pending_updates_timeout(int32 group_id) {
+  if (group_id == 0) {
+    VLOG(notifications) << "Flush notification updates accumulated during too long getDifference";
+    return flush_ready_pending_updates(false, "batch timeout");
+  }
+  if (running_get_difference_) {
+    // the updates will be flushed together with updates from other groups after getDifference
+    if (!G()->close_flag()) {
+      set_flush_all_pending_updates_timeout();
+    }
+    return;
+  }
+  flush_pending_updates(group_id, "timeout");
+}
+
+void NotificationManager::set_flush_all_pending_updates_timeout() {
+  // the timeout bounds the delay of pending updates if getDifference takes too long
+  if (!flush_pending_updates_timeout_.has_timeout(0)) {
+    flush_pending_updates_timeout_.set_timeout_in(0, MAX_UPDATE_DELAY_MS * 1e-3);
+  }
+}
+
 void NotificationManager::add_update_notification_group(td_api::object_ptr<td_api::updateNotificationGroup> update) {
   auto group_id = update->notification_group_id_;
   if (update->notification_settings_chat_id_ == 0) {
@@ -1038,336 +1061,22 @@ void NotificationManager::add_update_notification(NotificationGroupId notificati
 
 void NotificationManager::flush_pending_updates(int32 group_id, const char *source) {
   // no check for G()->close_flag() to flush pending notifications even while closing
-  auto it = pending_updates_.find(group_id);
-  if (it == pending_updates_.end()) {
+  if (!pending_updates_.has_updates(group_id)) {
     return;
   }
 
-  auto updates = std::move(it->second);
-  pending_updates_.erase(it);
-
   if (is_destroyed_) {
+    pending_updates_.drop_updates(group_id);
     return;
   }
 
-  VLOG(notifications) << "Send " << updates.size() << " pending updates in " << NotificationGroupId(group_id)
-                      << " from " << source;
-  for (auto &update : updates) {
-    VLOG(notifications) << "Have " << as_notification_update(update.get());
-  }
-
-  td::remove_if(updates, [](auto &update) { return update == nullptr; });
-
-  // if a notification was added, then deleted and then re-added we need to keep
-  // first addition, because it can be with sound,
-  // deletion, because number of notification should never exceed max_notification_group_size_,
-  // and second addition, because we has kept the deletion
-
-  // calculate last state of all notifications
-  FlatHashSet<int32> added_notification_ids;
-  FlatHashSet<int32> edited_notification_ids;
-  FlatHashSet<int32> removed_notification_ids;
-  for (auto &update : updates) {
-    CHECK(update != nullptr);
-    if (update->get_id() == td_api::updateNotificationGroup::ID) {
-      auto update_ptr = static_cast<td_api::updateNotificationGroup *>(update.get());
-      for (auto &notification : update_ptr->added_notifications_) {
-        auto notification_id = notification->id_;
-        CHECK(notification_id != 0);
-        bool is_inserted = added_notification_ids.insert(notification_id).second;
-        CHECK(is_inserted);                                          // there must be no additions after addition
-        CHECK(edited_notification_ids.count(notification_id) == 0);  // there must be no additions after edit
-        removed_notification_ids.erase(notification_id);
-      }
-      for (auto &notification_id : update_ptr->removed_notification_ids_) {
-        CHECK(notification_id != 0);
-        added_notification_ids.erase(notification_id);
-        edited_notification_ids.erase(notification_id);
-        if (!removed_notification_ids.insert(notification_id).second) {
-          // sometimes there can be deletion of notification without previous addition, because the notification
-          // has already been deleted at the time of addition and get_notification_object_type was nullptr
-          VLOG(notifications) << "Remove duplicate deletion of " << notification_id;
-          notification_id = 0;
-        }
-      }
-      td::remove_if(update_ptr->removed_notification_ids_, [](auto &notification_id) { return notification_id == 0; });
-    } else {
-      CHECK(update->get_id() == td_api::updateNotification::ID);
-      auto update_ptr = static_cast<td_api::updateNotification *>(update.get());
-      auto notification_id = update_ptr->notification_->id_;
-      CHECK(notification_id != 0);
-      CHECK(removed_notification_ids.count(notification_id) == 0);  // there must be no edits of deleted notifications
-      added_notification_ids.erase(notification_id);
-      edited_notification_ids.insert(notification_id);
-    }
-  }
-
-  // we need to keep only additions of notifications from added_notification_ids/edited_notification_ids and
-  // all edits of notifications from edited_notification_ids
-  // deletions of a notification can be removed, only if the addition of the notification has already been deleted
-  // deletions of all unkept notifications can be moved to the first updateNotificationGroup
-  // after that at every moment there are no more active notifications than in the last moment,
-  // so left deletions after add/edit can be safely removed and following additions can be treated as edits
-  // we still need to keep deletions coming first, because we can't have 2 consequent additions
-  // from all additions of the same notification, we need to preserve the first, because it can be with sound,
-  // all other additions and edits can be merged to the first addition/edit
-  // i.e. in edit+delete+add chain we want to remove deletion and merge addition to the edit
+  VLOG(notifications) << "Send " << pending_updates_.get_update_count(group_id) << " pending updates in "
+                      << NotificationGroupId(group_id) << " from " << source;
 
   auto group_key = group_keys_[NotificationGroupId(group_id)];
   bool is_hidden = group_key.last_notification_date == 0 || get_last_updated_group_key() < group_key;
-  bool is_changed = true;
-  while (is_changed) {
-    is_changed = false;
-
-    size_t cur_pos = 0;
-    FlatHashMap<int32, size_t> first_add_notification_pos;
-    FlatHashMap<int32, size_t> first_edit_notification_pos;
-    FlatHashSet<int32> can_be_deleted_notification_ids;
-    vector<int32> moved_deleted_notification_ids;
-    size_t first_notification_group_pos = 0;
-
-    for (auto &update : updates) {
-      cur_pos++;
-
-      CHECK(update != nullptr);
-      if (update->get_id() == td_api::updateNotificationGroup::ID) {
-        auto update_ptr = static_cast<td_api::updateNotificationGroup *>(update.get());
-
-        for (auto &notification : update_ptr->added_notifications_) {
-          auto notification_id = notification->id_;
-          CHECK(notification_id != 0);
-          bool is_needed =
-              added_notification_ids.count(notification_id) != 0 || edited_notification_ids.count(notification_id) != 0;
-          if (!is_needed) {
-            VLOG(notifications) << "Remove unneeded addition of " << notification_id << " in update " << cur_pos;
-            can_be_deleted_notification_ids.insert(notification_id);
-            notification = nullptr;
-            is_changed = true;
-            continue;
-          }
-
-          auto edit_it = first_edit_notification_pos.find(notification_id);
-          if (edit_it != first_edit_notification_pos.end()) {
-            VLOG(notifications) << "Move addition of " << notification_id << " in update " << cur_pos
-                                << " to edit in update " << edit_it->second;
-            CHECK(edit_it->second < cur_pos);
-            auto previous_update_ptr = static_cast<td_api::updateNotification *>(updates[edit_it->second - 1].get());
-            CHECK(previous_update_ptr->notification_->id_ == notification_id);
-            previous_update_ptr->notification_->type_ = std::move(notification->type_);
-            is_changed = true;
-            notification = nullptr;
-            continue;
-          }
-          auto add_it = first_add_notification_pos.find(notification_id);
-          if (add_it != first_add_notification_pos.end()) {
-            VLOG(notifications) << "Move addition of " << notification_id << " in update " << cur_pos << " to update "
-                                << add_it->second;
-            CHECK(add_it->second < cur_pos);
-            auto previous_update_ptr =
-                static_cast<td_api::updateNotificationGroup *>(updates[add_it->second - 1].get());
-            bool is_found = false;
-            for (auto &prev_notification : previous_update_ptr->added_notifications_) {
-              if (prev_notification->id_ == notification_id) {
-                prev_notification->type_ = std::move(notification->type_);
-                is_found = true;
-                break;
-              }
-            }
-            CHECK(is_found);
-            is_changed = true;
-            notification = nullptr;
-            continue;
-          }
-
-          // it is a first addition/edit of needed notification
-          first_add_notification_pos[notification_id] = cur_pos;
-        }
-        td::remove_if(update_ptr->added_notifications_, [](auto &notification) { return notification == nullptr; });
-        if (update_ptr->added_notifications_.empty() && update_ptr->notification_sound_id_ != 0) {
-          update_ptr->notification_sound_id_ = 0;
-          is_changed = true;
-        }
-
-        for (auto &notification_id : update_ptr->removed_notification_ids_) {
-          bool is_needed =
-              added_notification_ids.count(notification_id) != 0 || edited_notification_ids.count(notification_id) != 0;
-          if (can_be_deleted_notification_ids.count(notification_id) == 1) {
-            CHECK(!is_needed);
-            VLOG(notifications) << "Remove unneeded deletion of " << notification_id << " in update " << cur_pos;
-            notification_id = 0;
-            is_changed = true;
-            continue;
-          }
-          if (!is_needed) {
-            if (first_notification_group_pos != 0) {
-              VLOG(notifications) << "Need to keep deletion of " << notification_id << " in update " << cur_pos
-                                  << ", but can move it to the first updateNotificationGroup at pos "
-                                  << first_notification_group_pos;
-              moved_deleted_notification_ids.push_back(notification_id);
-              notification_id = 0;
-              is_changed = true;
-            }
-            continue;
-          }
-
-          if (first_add_notification_pos.count(notification_id) != 0 ||
-              first_edit_notification_pos.count(notification_id) != 0) {
-            // the notification will be re-added, and we will be able to merge the addition with previous update, so we can just remove the deletion
-            VLOG(notifications) << "Remove unneeded deletion in update " << cur_pos;
-            notification_id = 0;
-            is_changed = true;
-            continue;
-          }
-
-          // we need to keep the deletion, because otherwise we will have 2 consequent additions
-        }
-        td::remove_if(update_ptr->removed_notification_ids_,
-                      [](auto &notification_id) { return notification_id == 0; });
-
-        if (update_ptr->removed_notification_ids_.empty() && update_ptr->added_notifications_.empty()) {
-          for (size_t i = cur_pos - 1; i > 0; i--) {
-            if (updates[i - 1] != nullptr && updates[i - 1]->get_id() == td_api::updateNotificationGroup::ID) {
-              VLOG(notifications) << "Move total_count from empty update " << cur_pos << " to update " << i;
-              auto previous_update_ptr = static_cast<td_api::updateNotificationGroup *>(updates[i - 1].get());
-              previous_update_ptr->type_ = std::move(update_ptr->type_);
-              previous_update_ptr->total_count_ = update_ptr->total_count_;
-              is_changed = true;
-              update = nullptr;
-              break;
-            }
-          }
-          if (update != nullptr && cur_pos == 1) {
-            bool is_empty_group =
-                added_notification_ids.empty() && edited_notification_ids.empty() && update_ptr->total_count_ == 0;
-            if (updates.size() > 1 || (is_hidden && !is_empty_group)) {
-              VLOG(notifications) << "Remove empty update " << cur_pos;
-              CHECK(moved_deleted_notification_ids.empty());
-              is_changed = true;
-              update = nullptr;
-            }
-          }
-        }
-
-        if (first_notification_group_pos == 0 && update != nullptr) {
-          first_notification_group_pos = cur_pos;
-        }
-      } else {
-        CHECK(update->get_id() == td_api::updateNotification::ID);
-        auto update_ptr = static_cast<td_api::updateNotification *>(update.get());
-        auto notification_id = update_ptr->notification_->id_;
-        bool is_needed =
-            added_notification_ids.count(notification_id) != 0 || edited_notification_ids.count(notification_id) != 0;
-        if (!is_needed) {
-          VLOG(notifications) << "Remove unneeded update " << cur_pos;
-          is_changed = true;
-          update = nullptr;
-          continue;
-        }
-        auto edit_it = first_edit_notification_pos.find(notification_id);
-        if (edit_it != first_edit_notification_pos.end()) {
-          VLOG(notifications) << "Move edit of " << notification_id << " in update " << cur_pos << " to update "
-                              << edit_it->second;
-          CHECK(edit_it->second < cur_pos);
-          auto previous_update_ptr = static_cast<td_api::updateNotification *>(updates[edit_it->second - 1].get());
-          CHECK(previous_update_ptr->notification_->id_ == notification_id);
-          previous_update_ptr->notification_->type_ = std::move(update_ptr->notification_->type_);
-          is_changed = true;
-          update = nullptr;
-          continue;
-        }
-        auto add_it = first_add_notification_pos.find(notification_id);
-        if (add_it != first_add_notification_pos.end()) {
-          VLOG(notifications) << "Move edit of " << notification_id << " in update " << cur_pos << " to update "
-                              << add_it->second;
-          CHECK(add_it->second < cur_pos);
-          auto previous_update_ptr = static_cast<td_api::updateNotificationGroup *>(updates[add_it->second - 1].get());
-          bool is_found = false;
-          for (auto &notification : previous_update_ptr->added_notifications_) {
-            if (notification->id_ == notification_id) {
-              notification->type_ = std::move(update_ptr->notification_->type_);
-              is_found = true;
-              break;
-            }
-          }
-          CHECK(is_found);
-          is_changed = true;
-          update = nullptr;
-          continue;
-        }
-
-        // it is a first addition/edit of needed notification
-        first_edit_notification_pos[notification_id] = cur_pos;
-      }
-    }
-    if (!moved_deleted_notification_ids.empty()) {
-      CHECK(first_notification_group_pos != 0);
-      auto &update = updates[first_notification_group_pos - 1];
-      CHECK(update->get_id() == td_api::updateNotificationGroup::ID);
-      auto update_ptr = static_cast<td_api::updateNotificationGroup *>(update.get());
-      append(update_ptr->removed_notification_ids_, std::move(moved_deleted_notification_ids));
-      auto old_size = update_ptr->removed_notification_ids_.size();
-      td::unique(update_ptr->removed_notification_ids_);
-      CHECK(old_size == update_ptr->removed_notification_ids_.size());
-    }
-
-    td::remove_if(updates, [](auto &update) { return update == nullptr; });
-    if (updates.empty()) {
-      VLOG(notifications) << "There are no updates to send in " << NotificationGroupId(group_id);
-      break;
-    }
-
-    auto has_common_notifications = [](const vector<td_api::object_ptr<td_api::notification>> &notifications,
-                                       const vector<int32> &notification_ids) {
-      for (auto &notification : notifications) {
-        if (td::contains(notification_ids, notification->id_)) {
-          return true;
-        }
-      }
-      return false;
-    };
-
-    size_t last_update_pos = 0;
-    for (size_t i = 1; i < updates.size(); i++) {
-      if (updates[last_update_pos]->get_id() == td_api::updateNotificationGroup::ID &&
-          updates[i]->get_id() == td_api::updateNotificationGroup::ID) {
-        auto last_update_ptr = static_cast<td_api::updateNotificationGroup *>(updates[last_update_pos].get());
-        auto update_ptr = static_cast<td_api::updateNotificationGroup *>(updates[i].get());
-        if ((last_update_ptr->notification_settings_chat_id_ == update_ptr->notification_settings_chat_id_ ||
-             last_update_ptr->added_notifications_.empty()) &&
-            !has_common_notifications(last_update_ptr->added_notifications_, update_ptr->removed_notification_ids_) &&
-            !has_common_notifications(update_ptr->added_notifications_, last_update_ptr->removed_notification_ids_) &&
-            last_update_ptr->notification_sound_id_ == update_ptr->notification_sound_id_) {
-          // combine updates
-          VLOG(notifications) << "Combine " << as_notification_update(last_update_ptr) << " and "
-                              << as_notification_update(update_ptr);
-          CHECK(last_update_ptr->notification_group_id_ == update_ptr->notification_group_id_);
-          CHECK(last_update_ptr->chat_id_ == update_ptr->chat_id_);
-          last_update_ptr->notification_settings_chat_id_ = update_ptr->notification_settings_chat_id_;
-          last_update_ptr->type_ = std::move(update_ptr->type_);
-          last_update_ptr->total_count_ = update_ptr->total_count_;
-          append(last_update_ptr->added_notifications_, std::move(update_ptr->added_notifications_));
-          append(last_update_ptr->removed_notification_ids_, std::move(update_ptr->removed_notification_ids_));
-          updates[i] = nullptr;
-          is_changed = true;
-          continue;
-        }
-      }
-      last_update_pos++;
-      if (last_update_pos != i) {
-        updates[last_update_pos] = std::move(updates[i]);
-      }
-    }
-    updates.resize(last_update_pos + 1);
-  }
-
+  auto updates = pending_updates_.flush_updates(group_id, is_hidden);
   for (auto &update : updates) {
-    CHECK(update != nullptr);
-    if (update->get_id() == td_api::updateNotificationGroup::ID) {
-      auto update_ptr = static_cast<td_api::updateNotificationGroup *>(update.get());
-      std::sort(update_ptr->added_notifications_.begin(), update_ptr->added_notifications_.end(),
-                [](const auto &lhs, const auto &rhs) { return lhs->id_ < rhs->id_; });
-      std::sort(update_ptr->removed_notification_ids_.begin(), update_ptr->removed_notification_ids_.end());
-    }
     VLOG(notifications) << "Send " << as_notification_update(update.get());
     send_closure(G()->td(), &Td::send_update, std::move(update));
   }
@@ -1395,10 +1104,14 @@ void NotificationManager::flush_all_pending_updates(bool include_delayed_chats,
     return;
   }
 
+  flush_ready_pending_updates(include_delayed_chats, source);
+}
+
+void NotificationManager::flush_ready_pending_updates(bool include_delayed_chats, const char *source) {
   vector<NotificationGroupKey> ready_group_keys;
-  for (const auto &it : pending_updates_) {
-    if (include_delayed_chats || running_get_chat_difference_.count(it.first) == 0) {
-      auto group_it = get_group(NotificationGroupId(it.first));
+  for (auto group_id : pending_updates_.get_group_ids()) {
+    if (include_delayed_chats || running_get_chat_difference_.count(group_id) == 0) {
+      auto group_it = get_group(NotificationGroupId(group_id));
       CHECK(group_it != groups_.end());
       ready_group_keys.push_back(group_it->first);
     }
@@ -1822,13 +1535,13 @@ void NotificationManager::on_notifications_removed(
 void NotificationManager::remove_added_notifications_from_pending_updates(
     NotificationGroupId group_id,
     const std::function<bool(const td_api::object_ptr<td_api::notification> &notification)> &is_removed) {
-  auto it = pending_updates_.find(group_id.get());
-  if (it == pending_updates_.end()) {
+  auto updates = pending_updates_.get_updates(group_id.get());
+  if (updates == nullptr) {
     return;
   }
 
   FlatHashSet<int32> removed_notification_ids;
-  for (auto &update : it->second) {
+  for (auto &update : *updates) {
     if (update == nullptr) {
       continue;
     }
@@ -2458,7 +2171,7 @@ void NotificationManager::remove_call_notification(DialogId dialog_id, CallId ca
         CHECK(group_it->second.pending_notifications.empty());
         CHECK(group_it->second.type == NotificationGroupType::Calls);
         CHECK(!group_it->second.is_being_loaded_from_database);
-        CHECK(pending_updates_.count(group_id.get()) == 0);
+        CHECK(!pending_updates_.has_updates(group_id.get()));
         delete_group(std::move(group_it));
       }
       return;
@@ -2501,7 +2214,7 @@ void NotificationManager::on_notification_group_count_max_changed(bool send_upda
       auto &group_key = it->first;
       auto &group = it->second;
       CHECK(group.pending_notifications.empty());
-      CHECK(pending_updates_.count(group_key.group_id.get()) == 0);
+      CHECK(!pending_updates_.has_updates(group_key.group_id.get()));
 
       if (group_key.last_notification_date == 0) {
         break;
@@ -2562,7 +2275,7 @@ void NotificationManager::on_notification_group_size_max_changed() {
       auto &group_key = it->first;
       auto &group = it->second;
       CHECK(group.pending_notifications.empty());
-      CHECK(pending_updates_.count(group_key.group_id.get()) == 0);
+      CHECK(!pending_updates_.has_updates(group_key.group_id.get()));
 
       if (group_key.last_notification_date == 0) {
         break;
@@ -4136,6 +3849,7 @@ void NotificationManager::before_get_difference() {
   }
 
   running_get_difference_ = true;
+  pending_updates_.on_get_difference_started();
   on_unreceived_notification_update_count_changed(1, 0, "before_get_difference");
 }
 
@@ -4172,7 +3886,18 @@ void NotificationManager::after_get_difference_impl() {
     remove_temporary_notifications(group_id, "after_get_difference");
   }
 
+  flush_pending_updates_timeout_.cancel_timeout(0);
+  auto pending_group_count = pending_updates_.get_group_count();
   flush_all_pending_updates(false, "after_get_difference");
+
+  auto stats = pending_updates_.get_difference_stats();
+  if (stats.added_update_count > 0) {
+    auto total_stats = pending_updates_.get_stats();
+    LOG(INFO) << "Sent " << stats.sent_update_count << " notification updates instead of " << stats.added_update_count
+              << " in " << pending_group_count << " notification groups after getDifference; totally sent "
+              << total_stats.sent_update_count << " out of " << total_stats.added_update_count
+              << " notification updates";
+  }
 }
 
 void NotificationManager::before_get_chat_difference(NotificationGroupId group_id) {
@@ -4210,7 +3935,7 @@ void NotificationManager::after_get_chat_difference_impl(NotificationGroupId gro
 
   VLOG(notifications) << "Flush updates after get chat difference in " << group_id;
   CHECK(group_id.is_valid());
-  if (!running_get_difference_ && pending_updates_.count(group_id.get()) == 1) {
+  if (!running_get_difference_ && pending_updates_.has_updates(group_id.get())) {
     remove_temporary_notifications(group_id, "after_get_chat_difference");
     force_flush_pending_updates(group_id, "after_get_chat_difference");
   }
@@ -18,6 +18,7 @@
 #include "td/telegram/NotificationObjectFullId.h"
 #include "td/telegram/NotificationObjectId.h"
 #include "td/telegram/NotificationType.h"
+#include "td/telegram/PendingNotificationUpdates.h"
 #include "td/telegram/Photo.h"
 #include "td/telegram/td_api.h"
 #include "td/telegram/telegram_api.h"
@@ -306,6 +307,12 @@ class NotificationManager final : public Actor {
 
   void flush_all_pending_updates(bool include_delayed_chats, const char *source);
 
+  void flush_ready_pending_updates(bool include_delayed_chats, const char *source);
+
+  void on_flush_pending_updates_timeout(int32 group_id);
+
+  void set_flush_all_pending_updates_timeout();
+
   NotificationGroupId get_call_notification_group_id(DialogId dialog_id);
 
   static Result<string> decrypt_push_payload(int64 encryption_key_id, string encryption_key, string payload);
@@ -358,6 +365,8 @@ class NotificationManager final : public Actor {
 
   friend StringBuilder &operator<<(StringBuilder &string_builder, const NotificationUpdate &update);
 
+  friend class PendingNotificationUpdates;
+
   NotificationId current_notification_id_;
   NotificationGroupId current_notification_group_id_;
 
@@ -389,7 +398,7 @@ class NotificationManager final : public Actor {
   NotificationGroups groups_;
   FlatHashMap<NotificationGroupId, NotificationGroupKey, NotificationGroupIdHash> group_keys_;
 
-  FlatHashMap<int32, vector<td_api::object_ptr<td_api::Update>>> pending_updates_;
+  PendingNotificationUpdates pending_updates_;
 
   MultiTimeout flush_pending_notifications_timeout_{"FlushPendingNotificationsTimeout"};
   MultiTimeout flush_pending_updates_timeout_{"FlushPendingUpdatesTimeout"};
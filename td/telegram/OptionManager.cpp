@@ -818,6 +818,9 @@ void OptionManager::set_option(const string &name, td_api::object_ptr<td_api::Op
           })) {
         return;
       }
+      if (set_integer_option("connection_race_count", 1, 3)) {
+        return;
+      }
       break;
     case 'd':
       if (!is_bot && set_boolean_option("disable_animated_emoji")) {
@@ -941,6 +944,12 @@ void OptionManager::set_option(const string &name, td_api::object_ptr<td_api::Op
         return;
       }
       break;
+    case 'q':
+      // delay in milliseconds
+      if (set_integer_option("query_packing_delay", 0, 100)) {
+        return;
+      }
+      break;
     case 'r':
       // temporary option
       if (set_boolean_option("reuse_uploaded_photos_by_hash")) {
@@ -948,6 +957,9 @@ void OptionManager::set_option(const string &name, td_api::object_ptr<td_api::Op
       }
       break;
     case 's':
+      if (set_integer_option("spare_connection_count", 0, 2)) {
+        return;
+      }
       if (set_integer_option("storage_max_files_size")) {
         return;
       }
@@ -0,0 +1,63 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/telegram/td_api.h"
+
+#include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
+
+namespace td {
+
+// notification updates of notification groups, which are waiting to be sent
+// pending updates of a group are merged into the minimal equivalent list of updates before sending
+class PendingNotificationUpdates {
+ public:
+  struct Stats {
+    int64 added_update_count = 0;
+    int64 sent_update_count = 0;
+  };
+
+  // returns true if the group had no pending updates
+  bool add_update(int32 group_id, td_api::object_ptr<td_api::Update> update);
+
+  bool has_updates(int32 group_id) const;
+
+  size_t get_update_count(int32 group_id) const;
+
+  // returns nullptr if the group has no pending updates
+  vector<td_api::object_ptr<td_api::Update>> *get_updates(int32 group_id);
+
+  vector<int32> get_group_ids() const;
+
+  size_t get_group_count() const;
+
+  bool empty() const;
+
+  // removes pending updates of the group without sending; returns true if the group had pending updates
+  bool drop_updates(int32 group_id);
+
+  // removes pending updates of the group and returns the updates, which must be sent instead of them
+  // is_hidden must be true if the group isn't shown to the user, i.e. isn't among the last updated groups
+  vector<td_api::object_ptr<td_api::Update>> flush_updates(int32 group_id, bool is_hidden);
+
+  // get_difference_stats returns the numbers of updates added and sent since the last call
+  void on_get_difference_started();
+
+  Stats get_difference_stats() const;
+
+  Stats get_stats() const;
+
+ private:
+  FlatHashMap<int32, vector<td_api::object_ptr<td_api::Update>>> updates_;
+  Stats stats_;
+  Stats get_difference_start_stats_;
+
+  static void merge_updates(int32 group_id, vector<td_api::object_ptr<td_api::Update>> &updates, bool is_hidden);
+};
+
+}  // namespace td
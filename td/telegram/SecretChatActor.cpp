@@ -24,7 +24,6 @@
 
 #include "td/actor/MultiPromise.h"
 
-#include "td/utils/as.h"
 #include "td/utils/crypto.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
@@ -36,8 +35,6 @@
 #include "td/utils/Time.h"
 #include "td/utils/tl_parsers.h"
 
-#include <array>
-#include <tuple>
 #include <type_traits>
 
 //#define G GLOBAL_SHOULD_NOT_BE_USED_HERE
@@ -161,8 +158,70 @@ void SecretChatActor::add_inbound_message(unique_ptr<log_event::InboundSecretMes
     LOG(ERROR) << "Ignore unexpected update: " << tag("message", *message);
     return;
   }
-  check_status(do_inbound_message_encrypted(std::move(message)));
-  loop();
+  if (decryption_workers_.empty()) {
+    auto r_decrypted_message = decrypt(message->encrypted_message);
+    check_status(do_inbound_message_encrypted(std::move(message), std::move(r_decrypted_message)));
+    loop();
+    return;
+  }
+
+  auto decrypting_message_id = ++last_decrypting_inbound_message_id_;
+  auto &worker = decryption_workers_[next_decryption_worker_++ % decryption_workers_.size()];
+  auto promise = PromiseCreator::lambda(
+      [actor_id = actor_id(this),
+       decrypting_message_id](Result<SecretChatDecryptionWorker::DecryptedMessage> r_decrypted_message) {
+        send_closure(actor_id, &SecretChatActor::on_inbound_message_decrypted, decrypting_message_id,
+                     std::move(r_decrypted_message));
+      });
+  auto &decrypting_message = decrypting_inbound_messages_[decrypting_message_id];
+  decrypting_message.keys = get_decryption_keys();
+  send_closure(worker, &SecretChatDecryptionWorker::decrypt_message, decrypting_message.keys,
+               message->encrypted_message.clone(), std::move(promise));
+  decrypting_message.message = std::move(message);
+}
+
+void SecretChatActor::on_inbound_message_decrypted(
+    uint64 decrypting_message_id, Result<SecretChatDecryptionWorker::DecryptedMessage> r_decrypted_message) {
+  auto it = decrypting_inbound_messages_.find(decrypting_message_id);
+  CHECK(it != decrypting_inbound_messages_.end());
+  CHECK(!it->second.is_decrypted);
+  it->second.is_decrypted = true;
+  it->second.r_decrypted_message = std::move(r_decrypted_message);
+  process_decrypted_inbound_messages();
+}
+
+void SecretChatActor::process_decrypted_inbound_messages() {
+  bool was_processed = false;
+  while (!decrypting_inbound_messages_.empty() && decrypting_inbound_messages_.begin()->second.is_decrypted) {
+    auto message = std::move(decrypting_inbound_messages_.begin()->second.message);
+    auto r_decrypted_message = std::move(decrypting_inbound_messages_.begin()->second.r_decrypted_message);
+    auto keys = std::move(decrypting_inbound_messages_.begin()->second.keys);
+    decrypting_inbound_messages_.erase(decrypting_inbound_messages_.begin());
+    SCOPE_EXIT {
+      if (message) {
+        message->promise.set_value(Unit());
+      }
+    };
+    if (close_flag_) {
+      continue;
+    }
+    if (auth_state_.state != State::Ready) {
+      LOG(ERROR) << "Ignore unexpected update: " << tag("message", *message);
+      continue;
+    }
+
+    // keys could have been changed by previous messages; otherwise the result of the worker is final
+    if (keys->auth_key.id() != pfs_state_.auth_key.id() ||
+        keys->other_auth_key.id() != pfs_state_.other_auth_key.id()) {
+      LOG(INFO) << "Decrypt " << tag("message", *message) << " again after change of keys";
+      r_decrypted_message = decrypt(message->encrypted_message);
+    }
+    check_status(do_inbound_message_encrypted(std::move(message), std::move(r_decrypted_message)));
+    was_processed = true;
+  }
+  if (was_processed) {
+    loop();
+  }
 }
 
 void SecretChatActor::replay_inbound_message(unique_ptr<log_event::InboundSecretMessage> message) {
@@ -765,111 +824,61 @@ void SecretChatActor::tear_down() {
   // TODO notify send update that we are dead
 }
 
-Result<std::tuple<uint64, BufferSlice, int32>> SecretChatActor::decrypt(BufferSlice &encrypted_message) {
-  MutableSlice data = encrypted_message.as_mutable_slice();
-  CHECK(is_aligned_pointer<4>(data.data()));
-  TRY_RESULT(auth_key_id, mtproto::Transport::read_auth_key_id(data));
-  mtproto::AuthKey *auth_key = nullptr;
-  if (auth_key_id == pfs_state_.auth_key.id()) {
-    auth_key = &pfs_state_.auth_key;
-  } else if (auth_key_id == pfs_state_.other_auth_key.id()) {
-    auth_key = &pfs_state_.other_auth_key;
-  } else {
-    return Status::Error(1, PSLICE() << "Unknown " << tag("auth_key_id", format::as_hex(auth_key_id))
-                                     << tag("crc", crc64(encrypted_message.as_slice())));
-  }
-
-  std::array<int, 2> versions{{2, 1}};
-  BufferSlice encrypted_message_copy;
-  int32 mtproto_version = -1;
-  Result<mtproto::Transport::ReadResult> r_read_result;
-  for (size_t i = 0; i < versions.size(); i++) {
-    encrypted_message_copy = encrypted_message.copy();
-    data = encrypted_message_copy.as_mutable_slice();
-    CHECK(is_aligned_pointer<4>(data.data()));
-
-    mtproto::PacketInfo packet_info;
-    packet_info.type = mtproto::PacketInfo::EndToEnd;
-    mtproto_version = versions[i];
-    packet_info.version = mtproto_version;
-    packet_info.is_creator = auth_state_.x == 0;
-    r_read_result = mtproto::Transport::read(data, *auth_key, &packet_info);
-    if (i + 1 != versions.size() && r_read_result.is_error()) {
-      if (config_state_.his_layer >= static_cast<int32>(SecretChatLayer::Mtproto2)) {
-        LOG(WARNING) << tag("mtproto", mtproto_version) << " decryption failed " << r_read_result.error();
-      }
-      continue;
-    }
-    break;
-  }
-  TRY_RESULT(read_result, std::move(r_read_result));
-  switch (read_result.type()) {
-    case mtproto::Transport::ReadResult::Quickack:
-      return Status::Error("Receive quickack instead of a message");
-    case mtproto::Transport::ReadResult::Error:
-      return Status::Error(PSLICE() << "Receive MTProto error code instead of a message: " << read_result.error());
-    case mtproto::Transport::ReadResult::Nop:
-      return Status::Error("Receive nop instead of a message");
-    case mtproto::Transport::ReadResult::Packet:
-      data = read_result.packet();
-      break;
-    default:
-      UNREACHABLE();
+std::shared_ptr<const SecretChatDecryptionWorker::Keys> SecretChatActor::get_decryption_keys() {
+  bool is_mtproto2_expected = config_state_.his_layer >= static_cast<int32>(SecretChatLayer::Mtproto2);
+  if (decryption_keys_ == nullptr || decryption_keys_->auth_key.id() != pfs_state_.auth_key.id() ||
+      decryption_keys_->other_auth_key.id() != pfs_state_.other_auth_key.id() ||
+      decryption_keys_->is_mtproto2_expected != is_mtproto2_expected) {
+    auto keys = std::make_shared<SecretChatDecryptionWorker::Keys>();
+    keys->auth_key = pfs_state_.auth_key;
+    keys->other_auth_key = pfs_state_.other_auth_key;
+    keys->is_creator = auth_state_.x == 0;
+    keys->is_mtproto2_expected = is_mtproto2_expected;
+    decryption_keys_ = std::move(keys);
   }
+  return decryption_keys_;
+}
 
-  int32 len = as<int32>(data.begin());
-  data = data.substr(4, len);
-  if (!is_aligned_pointer<4>(data.data())) {
-    return std::make_tuple(auth_key_id, BufferSlice(data), mtproto_version);
-  } else {
-    return std::make_tuple(auth_key_id, encrypted_message_copy.from_slice(data), mtproto_version);
-  }
+Result<SecretChatDecryptionWorker::DecryptedMessage> SecretChatActor::decrypt(const BufferSlice &encrypted_message) {
+  return SecretChatDecryptionWorker::do_decrypt_message(*get_decryption_keys(), encrypted_message);
 }
 
-Status SecretChatActor::do_inbound_message_encrypted(unique_ptr<log_event::InboundSecretMessage> message) {
+Status SecretChatActor::do_inbound_message_encrypted(
+    unique_ptr<log_event::InboundSecretMessage> message,
+    Result<SecretChatDecryptionWorker::DecryptedMessage> r_decrypted_message) {
   SCOPE_EXIT {
     if (message) {
       message->promise.set_value(Unit());
     }
   };
-  TRY_RESULT(decrypted, decrypt(message->encrypted_message));
-  auto auth_key_id = std::get<0>(decrypted);
-  auto data_buffer = std::move(std::get<1>(decrypted));
-  auto mtproto_version = std::get<2>(decrypted);
-  message->auth_key_id = auth_key_id;
-
-  TlBufferParser parser(&data_buffer);
-  auto id = parser.fetch_int();
-  Status status;
-  if (id == secret_api::decryptedMessageLayer::ID) {
-    auto message_with_layer = secret_api::decryptedMessageLayer::fetch(parser);
-    parser.fetch_end();
-    if (!parser.get_error()) {
-      auto layer = message_with_layer->layer_;
-      if (layer < static_cast<int32>(SecretChatLayer::Default) &&
-          false /* old Android app could send such messages */) {
-        LOG(ERROR) << "Layer " << layer << " is not supported, drop message " << to_string(message_with_layer);
-        return Status::OK();
-      }
-      if (config_state_.his_layer < layer) {
-        config_state_.his_layer = layer;
-        context_->secret_chat_db()->set_value(config_state_);
-        send_update_secret_chat();
-      }
-      if (layer >= static_cast<int32>(SecretChatLayer::Mtproto2) && mtproto_version < 2) {
-        return Status::Error("MTProto 1.0 encryption is forbidden for this layer");
-      }
-      if (message_with_layer->in_seq_no_ < 0) {
-        return Status::Error(PSLICE() << "Invalid seq_no: " << to_string(message_with_layer));
-      }
-      message->decrypted_message_layer = std::move(message_with_layer);
-      return do_inbound_message_decrypted_unchecked(std::move(message), mtproto_version);
-    } else {
-      status = Status::Error(PSLICE() << parser.get_error() << format::as_hex_dump<4>(data_buffer.as_slice()));
+  TRY_RESULT(decrypted_message, std::move(r_decrypted_message));
+  auto &data_buffer = decrypted_message.data;
+  auto mtproto_version = decrypted_message.mtproto_version;
+  message->auth_key_id = decrypted_message.auth_key_id;
+
+  if (decrypted_message.r_message_with_layer.is_ok()) {
+    auto message_with_layer = decrypted_message.r_message_with_layer.move_as_ok();
+    auto layer = message_with_layer->layer_;
+    if (layer < static_cast<int32>(SecretChatLayer::Default) &&
+        false /* old Android app could send such messages */) {
+      LOG(ERROR) << "Layer " << layer << " is not supported, drop message " << to_string(message_with_layer);
+      return Status::OK();
     }
-  } else {
-    status = Status::Error(PSLICE() << "Unknown constructor " << format::as_hex(id));
+    if (config_state_.his_layer < layer) {
+      config_state_.his_layer = layer;
+      context_->secret_chat_db()->set_value(config_state_);
+      send_update_secret_chat();
+    }
+    if (layer >= static_cast<int32>(SecretChatLayer::Mtproto2) && mtproto_version < 2) {
+      return Status::Error("MTProto 1.0 encryption is forbidden for this layer");
+    }
+    if (message_with_layer->in_seq_no_ < 0) {
+      return Status::Error(PSLICE() << "Invalid seq_no: " << to_string(message_with_layer));
+    }
+    message->decrypted_message_layer = std::move(message_with_layer);
+    return do_inbound_message_decrypted_unchecked(std::move(message), mtproto_version);
   }
+  auto status = decrypted_message.r_message_with_layer.move_as_error();
 
   // support for older layer
   LOG(WARNING) << "Failed to fetch update: " << status;
@@ -880,7 +889,6 @@ Status SecretChatActor::do_inbound_message_encrypted(unique_ptr<log_event::Inbou
   if (config_state_.his_layer == 8) {
     TlBufferParser new_parser(&data_buffer);
     auto message_without_layer = secret_api::DecryptedMessage::fetch(new_parser);
-    parser.fetch_end();
     if (!new_parser.get_error()) {
       message->decrypted_message_layer = secret_api::make_object<secret_api::decryptedMessageLayer>(
           BufferSlice(), config_state_.his_layer, -1, -1, std::move(message_without_layer));
@@ -1880,6 +1888,7 @@ void SecretChatActor::start_up() {
   }
   saved_pfs_state_message_id_ = pfs_state_.message_id;
   pfs_state_.last_timestamp = Time::now();
+  decryption_workers_ = context_->get_decryption_workers();
 
   send_update_secret_chat();
   get_dh_config();
@@ -14,6 +14,7 @@
 #include "td/telegram/net/NetQuery.h"
 #include "td/telegram/secret_api.h"
 #include "td/telegram/SecretChatDb.h"
+#include "td/telegram/SecretChatDecryptionWorker.h"
 #include "td/telegram/SecretChatId.h"
 #include "td/telegram/SecretChatLayer.h"
 #include "td/telegram/telegram_api.h"
@@ -41,7 +42,6 @@
 #include <functional>
 #include <map>
 #include <memory>
-#include <tuple>
 #include <utility>
 
 namespace td {
@@ -71,6 +71,9 @@ class SecretChatActor final : public NetQueryCallback {
 
     virtual bool close_flag() = 0;
 
+    // inbound messages are decrypted synchronously if there are no decryption workers
+    virtual vector<ActorId<SecretChatDecryptionWorker>> get_decryption_workers() = 0;
+
     // We don't want to expose the whole NetQueryDispatcher, MessagesManager and UserManager.
     // So it is more clear which parts of MessagesManager are really used. And it is much easier to create tests.
     virtual void send_net_query(NetQueryPtr query, ActorShared<NetQueryCallback> callback, bool ordered) = 0;
@@ -566,9 +569,28 @@ class SecretChatActor final : public NetQueryCallback {
 
   std::map<int32, unique_ptr<log_event::InboundSecretMessage>> pending_inbound_messages_;
 
-  Result<std::tuple<uint64, BufferSlice, int32>> decrypt(BufferSlice &encrypted_message);
+  // inbound messages, which are decrypted by decryption workers; they are processed in the order of receiving
+  struct DecryptingInboundMessage {
+    unique_ptr<log_event::InboundSecretMessage> message;
+    std::shared_ptr<const SecretChatDecryptionWorker::Keys> keys;  // keys used by the worker
+    bool is_decrypted = false;
+    Result<SecretChatDecryptionWorker::DecryptedMessage> r_decrypted_message;
+  };
+  std::map<uint64, DecryptingInboundMessage> decrypting_inbound_messages_;
+  uint64 last_decrypting_inbound_message_id_ = 0;
+  size_t next_decryption_worker_ = 0;
+  vector<ActorId<SecretChatDecryptionWorker>> decryption_workers_;
+  std::shared_ptr<const SecretChatDecryptionWorker::Keys> decryption_keys_;
+
+  std::shared_ptr<const SecretChatDecryptionWorker::Keys> get_decryption_keys();
+  Result<SecretChatDecryptionWorker::DecryptedMessage> decrypt(const BufferSlice &encrypted_message);
+
+  void on_inbound_message_decrypted(uint64 decrypting_message_id,
+                                    Result<SecretChatDecryptionWorker::DecryptedMessage> r_decrypted_message);
+  void process_decrypted_inbound_messages();
 
-  Status do_inbound_message_encrypted(unique_ptr<log_event::InboundSecretMessage> message);
+  Status do_inbound_message_encrypted(unique_ptr<log_event::InboundSecretMessage> message,
+                                      Result<SecretChatDecryptionWorker::DecryptedMessage> r_decrypted_message);
   Status do_inbound_message_decrypted_unchecked(unique_ptr<log_event::InboundSecretMessage> message,
                                                 int32 mtproto_version);
   Status do_inbound_message_decrypted(unique_ptr<log_event::InboundSecretMessage> message);
@@ -0,0 +1,115 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/SecretChatDecryptionWorker.h"
+
+#include "td/telegram/secret_api.hpp"
+
+#include "td/mtproto/PacketInfo.h"
+#include "td/mtproto/Transport.h"
+
+#include "td/utils/as.h"
+#include "td/utils/crypto.h"
+#include "td/utils/format.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/SliceBuilder.h"
+#include "td/utils/tl_parsers.h"
+
+#include <array>
+
+namespace td {
+
+void SecretChatDecryptionWorker::decrypt_message(std::shared_ptr<const Keys> keys, BufferSlice encrypted_message,
+                                                 Promise<DecryptedMessage> promise) {
+  CHECK(keys != nullptr);
+  promise.set_result(do_decrypt_message(*keys, encrypted_message));
+}
+
+Result<SecretChatDecryptionWorker::DecryptedMessage> SecretChatDecryptionWorker::do_decrypt_message(
+    const Keys &keys, const BufferSlice &encrypted_message) {
+  Slice encrypted_data = encrypted_message.as_slice();
+  CHECK(is_aligned_pointer<4>(encrypted_data.data()));
+  TRY_RESULT(auth_key_id, mtproto::Transport::read_auth_key_id(encrypted_data));
+  const mtproto::AuthKey *auth_key = nullptr;
+  if (auth_key_id == keys.auth_key.id()) {
+    auth_key = &keys.auth_key;
+  } else if (auth_key_id == keys.other_auth_key.id()) {
+    auth_key = &keys.other_auth_key;
+  } else {
+    return Status::Error(1, PSLICE() << "Unknown " << tag("auth_key_id", format::as_hex(auth_key_id))
+                                     << tag("crc", crc64(encrypted_data)));
+  }
+
+  std::array<int, 2> versions{{2, 1}};
+  BufferSlice encrypted_message_copy;
+  int32 mtproto_version = -1;
+  MutableSlice data;
+  Result<mtproto::Transport::ReadResult> r_read_result;
+  for (size_t i = 0; i < versions.size(); i++) {
+    encrypted_message_copy = encrypted_message.copy();
+    data = encrypted_message_copy.as_mutable_slice();
+    CHECK(is_aligned_pointer<4>(data.data()));
+
+    mtproto::PacketInfo packet_info;
+    packet_info.type = mtproto::PacketInfo::EndToEnd;
+    mtproto_version = versions[i];
+    packet_info.version = mtproto_version;
+    packet_info.is_creator = keys.is_creator;
+    r_read_result = mtproto::Transport::read(data, *auth_key, &packet_info);
+    if (i + 1 != versions.size() && r_read_result.is_error()) {
+      if (keys.is_mtproto2_expected) {
+        LOG(WARNING) << tag("mtproto", mtproto_version) << " decryption failed " << r_read_result.error();
+      }
+      continue;
+    }
+    break;
+  }
+  TRY_RESULT(read_result, std::move(r_read_result));
+  switch (read_result.type()) {
+    case mtproto::Transport::ReadResult::Quickack:
+      return Status::Error("Receive quickack instead of a message");
+    case mtproto::Transport::ReadResult::Error:
+      return Status::Error(PSLICE() << "Receive MTProto error code instead of a message: " << read_result.error());
+    case mtproto::Transport::ReadResult::Nop:
+      return Status::Error("Receive nop instead of a message");
+    case mtproto::Transport::ReadResult::Packet:
+      data = read_result.packet();
+      break;
+    default:
+      UNREACHABLE();
+  }
+
+  int32 len = as<int32>(data.begin());
+  data = data.substr(4, len);
+
+  DecryptedMessage result;
+  result.auth_key_id = auth_key_id;
+  if (!is_aligned_pointer<4>(data.data())) {
+    result.data = BufferSlice(data);
+  } else {
+    result.data = encrypted_message_copy.from_slice(data);
+  }
+  result.mtproto_version = mtproto_version;
+
+  TlBufferParser parser(&result.data);
+  auto id = parser.fetch_int();
+  if (id == secret_api::decryptedMessageLayer::ID) {
+    auto message_with_layer = secret_api::decryptedMessageLayer::fetch(parser);
+    parser.fetch_end();
+    if (!parser.get_error()) {
+      result.r_message_with_layer = std::move(message_with_layer);
+    } else {
+      result.r_message_with_layer =
+          Status::Error(PSLICE() << parser.get_error() << format::as_hex_dump<4>(result.data.as_slice()));
+    }
+  } else {
+    result.r_message_with_layer = Status::Error(PSLICE() << "Unknown constructor " << format::as_hex(id));
+  }
+  return std::move(result);
+}
+
+}  // namespace td
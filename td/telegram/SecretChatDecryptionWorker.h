@@ -0,0 +1,50 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/telegram/secret_api.h"
+
+#include "td/mtproto/AuthKey.h"
+
+#include "td/actor/actor.h"
+
+#include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/Promise.h"
+#include "td/utils/Status.h"
+
+#include <memory>
+
+namespace td {
+
+// decrypts and parses inbound secret chat messages outside of the SecretChatActor's scheduler
+class SecretChatDecryptionWorker final : public Actor {
+ public:
+  struct Keys {
+    mtproto::AuthKey auth_key;
+    mtproto::AuthKey other_auth_key;
+    bool is_creator = false;
+    // failures of MTProto 2.0 decryption are logged only if MTProto 1.0 isn't expected
+    bool is_mtproto2_expected = false;
+  };
+
+  struct DecryptedMessage {
+    uint64 auth_key_id = 0;
+    BufferSlice data;
+    int32 mtproto_version = -1;
+    // data parsed as decryptedMessageLayer
+    Result<tl_object_ptr<secret_api::decryptedMessageLayer>> r_message_with_layer;
+  };
+
+  void decrypt_message(std::shared_ptr<const Keys> keys, BufferSlice encrypted_message,
+                       Promise<DecryptedMessage> promise);
+
+  // returns an error with code 1 if the message is encrypted with an unknown key
+  static Result<DecryptedMessage> do_decrypt_message(const Keys &keys, const BufferSlice &encrypted_message);
+};
+
+}  // namespace td
@@ -92,6 +92,19 @@ void SecretChatsManager::start_up() {
     ActorId<SecretChatsManager> parent_;
   };
   send_closure(G()->state_manager(), &StateManager::add_callback, make_unique<StateCallback>(actor_id(this)));
+
+  // inbound messages are decrypted on schedulers without time-critical work; if there are no such schedulers,
+  // then they are decrypted synchronously by SecretChatActor
+  auto current_scheduler_id = Scheduler::instance()->sched_id();
+  auto scheduler_count = Scheduler::instance()->sched_count();
+  for (int32 scheduler_id = 0; scheduler_id < scheduler_count; scheduler_id++) {
+    if (scheduler_id != current_scheduler_id && scheduler_id != G()->get_database_scheduler_id() &&
+        (scheduler_id == G()->get_gc_scheduler_id() || scheduler_id > G()->get_slow_net_scheduler_id())) {
+      decryption_workers_.push_back(
+          create_actor_on_scheduler<SecretChatDecryptionWorker>("SecretChatDecryptionWorker", scheduler_id));
+      decryption_worker_ids_.push_back(decryption_workers_.back().get());
+    }
+  }
 }
 
 void SecretChatsManager::create_chat(UserId user_id, int64 user_access_hash, Promise<SecretChatId> promise) {
@@ -313,8 +326,12 @@ ActorId<SecretChatActor> SecretChatsManager::create_chat_actor(int32 id) {
 unique_ptr<SecretChatActor::Context> SecretChatsManager::make_secret_chat_context(int32 id) {
   class Context final : public SecretChatActor::Context {
    public:
-    Context(int32 id, ActorShared<SecretChatsManager> parent, unique_ptr<SecretChatDb> secret_chat_db)
-        : secret_chat_id_(SecretChatId(id)), parent_(std::move(parent)), secret_chat_db_(std::move(secret_chat_db)) {
+    Context(int32 id, ActorShared<SecretChatsManager> parent, unique_ptr<SecretChatDb> secret_chat_db,
+            vector<ActorId<SecretChatDecryptionWorker>> decryption_workers)
+        : secret_chat_id_(SecretChatId(id))
+        , parent_(std::move(parent))
+        , secret_chat_db_(std::move(secret_chat_db))
+        , decryption_workers_(std::move(decryption_workers)) {
       sequence_dispatcher_ = create_actor<SequenceDispatcher>("SecretChat SequenceDispatcher");
     }
     Context(const Context &) = delete;
@@ -364,6 +381,10 @@ unique_ptr<SecretChatActor::Context> SecretChatsManager::make_secret_chat_contex
       return G()->close_flag();
     }
 
+    vector<ActorId<SecretChatDecryptionWorker>> get_decryption_workers() final {
+      return decryption_workers_;
+    }
+
     void on_update_secret_chat(int64 access_hash, UserId user_id, SecretChatState state, bool is_outbound, int32 ttl,
                                int32 date, string key_hash, int32 layer, FolderId initial_folder_id) final {
       send_closure(G()->user_manager(), &UserManager::on_update_secret_chat, secret_chat_id_, access_hash, user_id,
@@ -417,9 +438,11 @@ unique_ptr<SecretChatActor::Context> SecretChatsManager::make_secret_chat_contex
     ActorOwn<SequenceDispatcher> sequence_dispatcher_;
     ActorShared<SecretChatsManager> parent_;
     unique_ptr<SecretChatDb> secret_chat_db_;
+    vector<ActorId<SecretChatDecryptionWorker>> decryption_workers_;
   };
-  return make_unique<Context>(id, actor_shared(this, id),
-                              td::make_unique<SecretChatDb>(G()->td_db()->get_binlog_pmc_shared(), id));
+  return td::make_unique<Context>(id, actor_shared(this, id),
+                                  td::make_unique<SecretChatDb>(G()->td_db()->get_binlog_pmc_shared(), id),
+                                  decryption_worker_ids_);
 }
 
 ActorId<SecretChatActor> SecretChatsManager::create_chat_actor_impl(int32 id, bool can_be_empty) {
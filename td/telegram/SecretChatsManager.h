@@ -9,6 +9,7 @@
 #include "td/telegram/logevent/SecretChatEvent.h"
 #include "td/telegram/secret_api.h"
 #include "td/telegram/SecretChatActor.h"
+#include "td/telegram/SecretChatDecryptionWorker.h"
 #include "td/telegram/SecretChatId.h"
 #include "td/telegram/telegram_api.h"
 #include "td/telegram/UserId.h"
@@ -55,6 +56,8 @@ class SecretChatsManager final : public Actor {
   bool close_flag_ = false;
   ActorShared<> parent_;
   std::map<int32, ActorOwn<SecretChatActor>> id_to_actor_;
+  vector<ActorOwn<SecretChatDecryptionWorker>> decryption_workers_;
+  vector<ActorId<SecretChatDecryptionWorker>> decryption_worker_ids_;
 
   bool is_online_{false};
 
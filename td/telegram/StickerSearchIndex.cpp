@@ -0,0 +1,169 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/StickerSearchIndex.h"
+
+#include "td/utils/algorithm.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace td {
+
+void StickerSearchIndex::add_postings(vector<Posting> &postings, uint32 set_index, const vector<uint32> &positions) {
+  auto it = std::lower_bound(postings.begin(), postings.end(), get_posting(set_index, 0));
+  auto pos = postings.insert(it, positions.size(), Posting());
+  for (auto position : positions) {
+    *pos++ = get_posting(set_index, position);
+  }
+}
+
+void StickerSearchIndex::remove_postings(vector<Posting> &postings, uint32 set_index) {
+  auto begin = std::lower_bound(postings.begin(), postings.end(), get_posting(set_index, 0));
+  auto end = std::lower_bound(begin, postings.end(), get_posting(set_index + 1, 0));
+  postings.erase(begin, end);
+}
+
+void StickerSearchIndex::update_sticker_set(StickerSetId sticker_set_id, const vector<FileId> &sticker_ids,
+                                            const FlatHashMap<string, vector<FileId>> &emoji_stickers,
+                                            const std::map<string, vector<FileId>> &keyword_stickers) {
+  CHECK(sticker_set_id.is_valid());
+  remove_sticker_set(sticker_set_id);
+
+  uint32 set_index;
+  if (!free_set_indexes_.empty()) {
+    set_index = free_set_indexes_.back();
+    free_set_indexes_.pop_back();
+  } else {
+    CHECK(sets_.size() < static_cast<size_t>(std::numeric_limits<uint32>::max()));
+    set_index = static_cast<uint32>(sets_.size());
+    sets_.emplace_back();
+  }
+  sticker_set_indexes_.emplace(sticker_set_id, set_index);
+
+  auto &set_info = sets_[set_index];
+  set_info.sticker_set_id_ = sticker_set_id;
+  set_info.sticker_ids_ = sticker_ids;
+
+  FlatHashMap<FileId, uint32, FileIdHash> sticker_positions;
+  for (size_t i = 0; i < sticker_ids.size(); i++) {
+    if (sticker_ids[i].is_valid()) {
+      sticker_positions.emplace(sticker_ids[i], static_cast<uint32>(i));
+    }
+  }
+  auto get_positions = [&sticker_positions](const vector<FileId> &file_ids) {
+    vector<uint32> positions;
+    for (auto file_id : file_ids) {
+      auto it = sticker_positions.find(file_id);
+      if (it != sticker_positions.end()) {
+        positions.push_back(it->second);
+      }
+    }
+    td::unique(positions);
+    return positions;
+  };
+
+  for (auto &emoji_sticker_ids : emoji_stickers) {
+    auto positions = get_positions(emoji_sticker_ids.second);
+    if (!positions.empty()) {
+      add_postings(emoji_postings_[emoji_sticker_ids.first], set_index, positions);
+      set_info.emojis_.push_back(emoji_sticker_ids.first);
+    }
+  }
+  for (auto &keyword_sticker_ids : keyword_stickers) {
+    auto positions = get_positions(keyword_sticker_ids.second);
+    if (!positions.empty()) {
+      add_postings(keyword_postings_[keyword_sticker_ids.first], set_index, positions);
+      set_info.keywords_.push_back(keyword_sticker_ids.first);
+    }
+  }
+}
+
+void StickerSearchIndex::remove_sticker_set(StickerSetId sticker_set_id) {
+  auto index_it = sticker_set_indexes_.find(sticker_set_id);
+  if (index_it == sticker_set_indexes_.end()) {
+    return;
+  }
+  auto set_index = index_it->second;
+  sticker_set_indexes_.erase(index_it);
+
+  auto &set_info = sets_[set_index];
+  for (auto &emoji : set_info.emojis_) {
+    auto it = emoji_postings_.find(emoji);
+    CHECK(it != emoji_postings_.end());
+    remove_postings(it->second, set_index);
+    if (it->second.empty()) {
+      emoji_postings_.erase(it);
+    }
+  }
+  for (auto &keyword : set_info.keywords_) {
+    auto it = keyword_postings_.find(keyword);
+    CHECK(it != keyword_postings_.end());
+    remove_postings(it->second, set_index);
+    if (it->second.empty()) {
+      keyword_postings_.erase(it);
+    }
+  }
+  set_info = SetInfo();
+  free_set_indexes_.push_back(set_index);
+}
+
+bool StickerSearchIndex::has_sticker_set(StickerSetId sticker_set_id) const {
+  return sticker_set_indexes_.count(sticker_set_id) != 0;
+}
+
+FlatHashMap<StickerSetId, vector<FileId>, StickerSetIdHash> StickerSearchIndex::find_stickers(
+    const vector<string> &emojis, Slice query) const {
+  vector<Posting> postings;
+  for (auto &emoji : emojis) {
+    auto it = emoji_postings_.find(emoji);
+    if (it != emoji_postings_.end()) {
+      append(postings, it->second);
+    }
+  }
+  if (!query.empty()) {
+    for (auto it = keyword_postings_.lower_bound(query.str());
+         it != keyword_postings_.end() && begins_with(it->first, query); ++it) {
+      append(postings, it->second);
+    }
+  }
+  td::unique(postings);
+
+  FlatHashMap<StickerSetId, vector<FileId>, StickerSetIdHash> result;
+  vector<FileId> *set_sticker_ids = nullptr;
+  auto last_set_index = std::numeric_limits<uint32>::max();
+  for (auto posting : postings) {
+    auto set_index = static_cast<uint32>(posting >> 32);
+    auto position = static_cast<uint32>(posting);
+    const auto &set_info = sets_[set_index];
+    if (set_index != last_set_index) {
+      // the pointer is used only until the next insertion into the result
+      set_sticker_ids = &result[set_info.sticker_set_id_];
+      last_set_index = set_index;
+    }
+    set_sticker_ids->push_back(set_info.sticker_ids_[position]);
+  }
+  return result;
+}
+
+size_t StickerSearchIndex::get_memory_usage() const {
+  size_t result = sets_.capacity() * sizeof(SetInfo);
+  for (auto &set_info : sets_) {
+    result += set_info.sticker_ids_.capacity() * sizeof(FileId) +
+              (set_info.emojis_.capacity() + set_info.keywords_.capacity()) * sizeof(string);
+  }
+  for (auto &it : emoji_postings_) {
+    result += it.first.capacity() + it.second.capacity() * sizeof(Posting);
+  }
+  for (auto &it : keyword_postings_) {
+    result += it.first.capacity() + it.second.capacity() * sizeof(Posting);
+  }
+  return result;
+}
+
+}  // namespace td
@@ -0,0 +1,68 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/telegram/files/FileId.h"
+#include "td/telegram/StickerSetId.h"
+
+#include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/Slice.h"
+
+#include <map>
+#include <utility>
+
+namespace td {
+
+// inverted index of emojis and keywords of stickers from all loaded sticker sets
+// a posting is a packed pair (sticker set index, sticker position in the set), so merged postings are ordered
+// by sticker set and by sticker position in the set
+class StickerSearchIndex {
+ public:
+  // replaces all postings of the sticker set
+  void update_sticker_set(StickerSetId sticker_set_id, const vector<FileId> &sticker_ids,
+                          const FlatHashMap<string, vector<FileId>> &emoji_stickers,
+                          const std::map<string, vector<FileId>> &keyword_stickers);
+
+  void remove_sticker_set(StickerSetId sticker_set_id);
+
+  bool has_sticker_set(StickerSetId sticker_set_id) const;
+
+  // returns stickers found by any of the emojis or by a keyword beginning with the query,
+  // grouped by sticker set in the order of stickers in the set
+  FlatHashMap<StickerSetId, vector<FileId>, StickerSetIdHash> find_stickers(const vector<string> &emojis,
+                                                                            Slice query) const;
+
+  size_t get_memory_usage() const;
+
+ private:
+  using Posting = uint64;
+
+  struct SetInfo {
+    StickerSetId sticker_set_id_;
+    vector<FileId> sticker_ids_;
+    vector<string> emojis_;
+    vector<string> keywords_;
+  };
+
+  vector<SetInfo> sets_;
+  vector<uint32> free_set_indexes_;
+  FlatHashMap<StickerSetId, uint32, StickerSetIdHash> sticker_set_indexes_;
+
+  FlatHashMap<string, vector<Posting>> emoji_postings_;
+  std::map<string, vector<Posting>> keyword_postings_;
+
+  static Posting get_posting(uint32 set_index, uint32 position) {
+    return (static_cast<uint64>(set_index) << 32) | position;
+  }
+
+  static void add_postings(vector<Posting> &postings, uint32 set_index, const vector<uint32> &positions);
+
+  static void remove_postings(vector<Posting> &postings, uint32 set_index);
+};
+
+}  // namespace td
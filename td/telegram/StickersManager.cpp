@@ -1702,7 +1702,8 @@ StickersManager::~StickersManager() {
       G()->get_gc_scheduler_id(), stickers_, sticker_sets_, short_name_to_sticker_set_id_, attached_sticker_sets_,
       found_stickers_[0], found_stickers_[1], found_stickers_[2], found_sticker_sets_[0], found_sticker_sets_[1],
       found_sticker_sets_[2], emoji_language_codes_, emoji_language_code_versions_,
-      emoji_language_code_last_difference_times_, reloaded_emoji_keywords_, premium_gift_messages_, dice_messages_,
+      emoji_language_code_last_difference_times_, reloaded_emoji_keywords_, emoji_keyword_indexes_,
+      premium_gift_messages_, dice_messages_,
       dice_quick_reply_messages_, emoji_messages_, custom_emoji_messages_, custom_emoji_to_sticker_id_);
 }
 
@@ -4007,6 +4008,7 @@ StickerSetId StickersManager::on_get_messages_sticker_set(StickerSetId sticker_s
         LOG(ERROR) << "Receive twice document with ID " << document_id << " in " << get_full_source();
       }
     }
+    update_sticker_set_search_index(s);
   }
 
   update_sticker_set(s, "on_get_messages_sticker_set 2");
@@ -4204,32 +4206,11 @@ const std::map<string, vector<FileId>> &StickersManager::get_sticker_set_keyword
   return sticker_set->keyword_stickers_map_;
 }
 
-void StickersManager::find_sticker_set_stickers(const StickerSet *sticker_set, const vector<string> &emojis,
-                                                const string &query, vector<std::pair<bool, FileId>> &result) const {
+void StickersManager::update_sticker_set_search_index(const StickerSet *sticker_set) {
   CHECK(sticker_set != nullptr);
-  FlatHashSet<FileId, FileIdHash> found_sticker_ids;
-  for (auto &emoji : emojis) {
-    auto it = sticker_set->emoji_stickers_map_.find(emoji);
-    if (it != sticker_set->emoji_stickers_map_.end()) {
-      found_sticker_ids.insert(it->second.begin(), it->second.end());
-    }
-  }
-  if (!query.empty()) {
-    const auto &keywords_map = get_sticker_set_keywords(sticker_set);
-    for (auto it = keywords_map.lower_bound(query); it != keywords_map.end() && begins_with(it->first, query); ++it) {
-      found_sticker_ids.insert(it->second.begin(), it->second.end());
-    }
-  }
-
-  if (!found_sticker_ids.empty()) {
-    for (auto sticker_id : sticker_set->sticker_ids_) {
-      if (found_sticker_ids.count(sticker_id) != 0) {
-        const Sticker *s = get_sticker(sticker_id);
-        LOG(INFO) << "Add " << sticker_id << " sticker from " << sticker_set->id_;
-        result.emplace_back(is_sticker_format_animated(s->format_), sticker_id);
-      }
-    }
-  }
+  CHECK(sticker_set->was_loaded_);
+  sticker_search_index_.update_sticker_set(sticker_set->id_, sticker_set->sticker_ids_,
+                                           sticker_set->emoji_stickers_map_, get_sticker_set_keywords(sticker_set));
 }
 
 bool StickersManager::can_find_sticker_by_query(FileId sticker_id, const vector<string> &emojis,
@@ -4487,10 +4468,19 @@ vector<FileId> StickersManager::get_stickers(StickerType sticker_type, string qu
         examined_sticker_sets.push_back(sticker_set);
       }
     }
+    auto found_sticker_ids = sticker_search_index_.find_stickers(emojis, prepared_query);
     vector<std::pair<bool, FileId>> partial_results[2][2];
     for (auto sticker_set : examined_sticker_sets) {
-      find_sticker_set_stickers(sticker_set, emojis, prepared_query,
-                                partial_results[sticker_set->is_installed_][sticker_set->is_archived_]);
+      auto it = found_sticker_ids.find(sticker_set->id_);
+      if (it == found_sticker_ids.end()) {
+        continue;
+      }
+      auto &partial_result = partial_results[sticker_set->is_installed_][sticker_set->is_archived_];
+      for (auto sticker_id : it->second) {
+        const Sticker *s = get_sticker(sticker_id);
+        LOG(INFO) << "Add " << sticker_id << " sticker from " << sticker_set->id_;
+        partial_result.emplace_back(is_sticker_format_animated(s->format_), sticker_id);
+      }
     }
     for (int is_installed = 1; is_installed >= 0; is_installed--) {
       for (int is_archived = 1; is_archived >= 0; is_archived--) {
@@ -5486,6 +5476,9 @@ void StickersManager::on_load_sticker_set_from_database(StickerSetId sticker_set
                  << format::as_hex_dump<4>(Slice(value));
     }
   }
+  if (with_stickers && sticker_set->was_loaded_) {
+    update_sticker_set_search_index(sticker_set);
+  }
   if (!sticker_set->is_created_loaded_ || !sticker_set->is_sticker_channel_emoji_status_loaded_ ||
       !sticker_set->is_sticker_has_text_color_loaded_ || !sticker_set->are_keywords_loaded_ ||
       !sticker_set->is_thumbnail_reloaded_ || !sticker_set->are_legacy_sticker_thumbnails_reloaded_) {
@@ -9670,8 +9663,13 @@ string StickersManager::get_language_emojis_database_key(const string &language_
 }
 
 vector<std::pair<string, string>> StickersManager::search_language_emojis(const string &language_code,
-                                                                          const string &text) {
+                                                                          const string &text) const {
   LOG(INFO) << "Search emoji for \"" << text << "\" in language " << language_code;
+  auto it = emoji_keyword_indexes_.find(language_code);
+  if (it != emoji_keyword_indexes_.end()) {
+    return it->second.search(text);
+  }
+
   auto key = get_language_emojis_database_key(language_code, text);
   vector<std::pair<string, string>> result;
   G()->td_db()->get_sqlite_sync_pmc()->get_by_prefix(key, [&text, &result](Slice key, Slice value) {
@@ -9683,13 +9681,60 @@ vector<std::pair<string, string>> StickersManager::search_language_emojis(const
   return result;
 }
 
-vector<string> StickersManager::get_keyword_language_emojis(const string &language_code, const string &text) {
+vector<string> StickersManager::get_keyword_language_emojis(const string &language_code, const string &text) const {
   LOG(INFO) << "Get emoji for \"" << text << "\" in language " << language_code;
+  auto it = emoji_keyword_indexes_.find(language_code);
+  if (it != emoji_keyword_indexes_.end()) {
+    return it->second.get_keyword_emojis(text);
+  }
+
   auto key = get_language_emojis_database_key(language_code, text);
   string emojis = G()->td_db()->get_sqlite_sync_pmc()->get(key);
   return full_split(emojis, '$');
 }
 
+void StickersManager::load_emoji_keyword_index(const string &language_code, Promise<Unit> &&promise) {
+  auto &promises = load_emoji_keyword_index_queries_[language_code];
+  promises.push_back(std::move(promise));
+  if (promises.size() != 1) {
+    // the index is already being loaded
+    return;
+  }
+
+  LOG(INFO) << "Load emoji keyword index for language " << language_code;
+  CHECK(G()->use_sqlite_pmc());
+  G()->td_db()->get_sqlite_pmc()->get_by_prefix(
+      get_language_emojis_database_key(language_code, string()),
+      PromiseCreator::lambda([actor_id = actor_id(this),
+                              language_code](Result<vector<std::pair<string, string>>> r_keyword_emojis) {
+        send_closure(actor_id, &StickersManager::on_load_emoji_keyword_index, language_code,
+                     std::move(r_keyword_emojis));
+      }));
+}
+
+void StickersManager::on_load_emoji_keyword_index(const string &language_code,
+                                                  Result<vector<std::pair<string, string>>> &&r_keyword_emojis) {
+  G()->ignore_result_if_closing(r_keyword_emojis);
+  auto it = load_emoji_keyword_index_queries_.find(language_code);
+  CHECK(it != load_emoji_keyword_index_queries_.end());
+  auto promises = std::move(it->second);
+  CHECK(!promises.empty());
+  load_emoji_keyword_index_queries_.erase(it);
+
+  if (r_keyword_emojis.is_error()) {
+    return fail_promises(promises, r_keyword_emojis.move_as_error());
+  }
+
+  // the index could have been created from a server response
+  if (emoji_keyword_indexes_.count(language_code) == 0) {
+    EmojiKeywordIndex index(r_keyword_emojis.move_as_ok());
+    LOG(INFO) << "Loaded " << index.size() << " emoji keywords for language " << language_code << " using "
+              << index.get_memory_usage() << " bytes";
+    emoji_keyword_indexes_.emplace(language_code, std::move(index));
+  }
+  set_promises(promises);
+}
+
 string StickersManager::get_emoji_language_codes_database_key(const vector<string> &language_codes) {
   return PSTRING() << "emojilc$" << implode(language_codes, '$');
 }
@@ -9882,6 +9927,7 @@ void StickersManager::on_get_emoji_keywords(
     LOG(ERROR) << "Receive keywords of version " << version;
     version = 1;
   }
+  vector<std::pair<string, string>> keyword_emojis;
   for (auto &keyword_ptr : keywords->keywords_) {
     switch (keyword_ptr->get_id()) {
       case telegram_api::emojiKeyword::ID: {
@@ -9896,8 +9942,10 @@ void StickersManager::on_get_emoji_keywords(
         }
         if (is_good && !G()->close_flag()) {
           CHECK(G()->use_sqlite_pmc());
-          G()->td_db()->get_sqlite_pmc()->set(get_language_emojis_database_key(language_code, text),
-                                              implode(keyword->emoticons_, '$'), mpas.get_promise());
+          auto emojis = implode(keyword->emoticons_, '$');
+          G()->td_db()->get_sqlite_pmc()->set(get_language_emojis_database_key(language_code, text), emojis,
+                                              mpas.get_promise());
+          keyword_emojis.emplace_back(std::move(text), std::move(emojis));
         }
         break;
       }
@@ -9917,6 +9965,7 @@ void StickersManager::on_get_emoji_keywords(
   }
   emoji_language_code_versions_[language_code] = version;
   emoji_language_code_last_difference_times_[language_code] = static_cast<int32>(Time::now_cached());
+  emoji_keyword_indexes_[language_code] = EmojiKeywordIndex(std::move(keyword_emojis));
 
   lock.set_value(Unit());
 }
@@ -9926,6 +9975,22 @@ void StickersManager::load_emoji_keywords_difference(const string &language_code
   CHECK(!language_code.empty());
   emoji_language_code_last_difference_times_[language_code] =
       Time::now_cached() + 1e9;  // prevent simultaneous requests
+
+  // the difference is applied to the in-memory index, so it must be loaded first
+  load_emoji_keyword_index(language_code,
+                           PromiseCreator::lambda([actor_id = actor_id(this), language_code](Result<Unit> result) {
+                             send_closure(actor_id, &StickersManager::send_get_emoji_keywords_difference_query,
+                                          language_code, std::move(result));
+                           }));
+}
+
+void StickersManager::send_get_emoji_keywords_difference_query(const string &language_code, Result<Unit> &&result) {
+  G()->ignore_result_if_closing(result);
+  if (result.is_error()) {
+    emoji_language_code_last_difference_times_[language_code] = Time::now_cached() - EMOJI_KEYWORDS_UPDATE_DELAY - 2;
+    return;
+  }
+
   int32 from_version = get_emoji_language_code_version(language_code);
   auto query_promise = PromiseCreator::lambda(
       [actor_id = actor_id(this), language_code,
@@ -9966,6 +10031,20 @@ void StickersManager::on_get_emoji_keywords_difference(
   key_values.emplace(get_emoji_language_code_version_database_key(language_code), to_string(version));
   key_values.emplace(get_emoji_language_code_last_difference_time_database_key(language_code),
                      to_string(G()->unix_time()));
+  struct KeywordEmojis {
+    vector<string> emojis_;
+    bool is_changed_ = false;
+  };
+  FlatHashMap<string, KeywordEmojis> keyword_emojis;
+  auto get_keyword_emojis = [&](const string &text) -> KeywordEmojis & {
+    auto it = keyword_emojis.find(text);
+    if (it == keyword_emojis.end()) {
+      KeywordEmojis emojis;
+      emojis.emojis_ = get_keyword_language_emojis(language_code, text);
+      it = keyword_emojis.emplace(text, std::move(emojis)).first;
+    }
+    return it->second;
+  };
   for (auto &keyword_ptr : keywords->keywords_) {
     switch (keyword_ptr->get_id()) {
       case telegram_api::emojiKeyword::ID: {
@@ -9979,16 +10058,16 @@ void StickersManager::on_get_emoji_keywords_difference(
           }
         }
         if (is_good) {
-          vector<string> emojis = get_keyword_language_emojis(language_code, text);
+          auto &emojis = get_keyword_emojis(text);
           bool is_changed = false;
           for (auto &emoji : keyword->emoticons_) {
-            if (!td::contains(emojis, emoji)) {
-              emojis.push_back(emoji);
+            if (!td::contains(emojis.emojis_, emoji)) {
+              emojis.emojis_.push_back(emoji);
               is_changed = true;
             }
           }
           if (is_changed) {
-            key_values.emplace(get_language_emojis_database_key(language_code, text), implode(emojis, '$'));
+            emojis.is_changed_ = true;
           } else {
             LOG(INFO) << "Emoji keywords not changed for \"" << text << "\" from version " << from_version
                       << " to version " << version;
@@ -9999,15 +10078,15 @@ void StickersManager::on_get_emoji_keywords_difference(
       case telegram_api::emojiKeywordDeleted::ID: {
         auto keyword = telegram_api::move_object_as<telegram_api::emojiKeywordDeleted>(keyword_ptr);
         auto text = utf8_to_lower(keyword->keyword_);
-        vector<string> emojis = get_keyword_language_emojis(language_code, text);
+        auto &emojis = get_keyword_emojis(text);
         bool is_changed = false;
         for (auto &emoji : keyword->emoticons_) {
-          if (td::remove(emojis, emoji)) {
+          if (td::remove(emojis.emojis_, emoji)) {
             is_changed = true;
           }
         }
         if (is_changed) {
-          key_values.emplace(get_language_emojis_database_key(language_code, text), implode(emojis, '$'));
+          emojis.is_changed_ = true;
         } else {
           LOG(INFO) << "Emoji keywords not changed for \"" << text << "\" from version " << from_version
                     << " to version " << version;
@@ -10018,6 +10097,18 @@ void StickersManager::on_get_emoji_keywords_difference(
         UNREACHABLE();
     }
   }
+  vector<std::pair<string, string>> changed_keyword_emojis;
+  for (auto &it : keyword_emojis) {
+    if (it.second.is_changed_) {
+      auto emojis = implode(it.second.emojis_, '$');
+      key_values.emplace(get_language_emojis_database_key(language_code, it.first), emojis);
+      changed_keyword_emojis.emplace_back(it.first, std::move(emojis));
+    }
+  }
+  auto index_it = emoji_keyword_indexes_.find(language_code);
+  if (index_it != emoji_keyword_indexes_.end()) {
+    index_it->second.update(std::move(changed_keyword_emojis));
+  }
   CHECK(G()->use_sqlite_pmc());
   G()->td_db()->get_sqlite_pmc()->set_all(
       std::move(key_values), PromiseCreator::lambda([actor_id = actor_id(this), language_code, version](Unit) mutable {
@@ -10050,6 +10141,7 @@ bool StickersManager::prepare_search_emoji_query(const string &text, const vecto
   }
 
   vector<string> languages_to_load;
+  vector<string> indexes_to_load;
   for (auto &language_code : language_codes) {
     CHECK(!language_code.empty());
     auto version = get_emoji_language_code_version(language_code);
@@ -10057,10 +10149,13 @@ bool StickersManager::prepare_search_emoji_query(const string &text, const vecto
       languages_to_load.push_back(language_code);
     } else {
       LOG(DEBUG) << "Found language " << language_code << " with version " << version;
+      if (emoji_keyword_indexes_.count(language_code) == 0) {
+        indexes_to_load.push_back(language_code);
+      }
     }
   }
 
-  if (!languages_to_load.empty()) {
+  if (!languages_to_load.empty() || !indexes_to_load.empty()) {
     if (!force) {
       MultiPromiseActorSafe mpas{"LoadEmojiLanguagesMultiPromiseActor"};
       mpas.add_promise(std::move(promise));
@@ -10069,10 +10164,14 @@ bool StickersManager::prepare_search_emoji_query(const string &text, const vecto
       for (auto &language_code : languages_to_load) {
         load_emoji_keywords(language_code, mpas.get_promise());
       }
+      for (auto &language_code : indexes_to_load) {
+        load_emoji_keyword_index(language_code, mpas.get_promise());
+      }
       lock.set_value(Unit());
       return false;
     } else {
-      LOG(ERROR) << "Have no " << languages_to_load << " emoji keywords";
+      LOG_IF(ERROR, !languages_to_load.empty()) << "Have no " << languages_to_load << " emoji keywords";
+      LOG_IF(ERROR, !indexes_to_load.empty()) << "Have no " << indexes_to_load << " emoji keyword indexes";
     }
   }
 
@@ -11,6 +11,7 @@
 #include "td/telegram/Dimensions.h"
 #include "td/telegram/EmojiGroup.h"
 #include "td/telegram/EmojiGroupType.h"
+#include "td/telegram/EmojiKeywordIndex.h"
 #include "td/telegram/files/FileId.h"
 #include "td/telegram/files/FileSourceId.h"
 #include "td/telegram/MessageFullId.h"
@@ -22,6 +23,7 @@
 #include "td/telegram/StickerFormat.h"
 #include "td/telegram/StickerListType.h"
 #include "td/telegram/StickerMaskPosition.h"
+#include "td/telegram/StickerSearchIndex.h"
 #include "td/telegram/StickerSetId.h"
 #include "td/telegram/StickerType.h"
 #include "td/telegram/td_api.h"
@@ -925,8 +927,7 @@ class StickersManager final : public Actor {
 
   static const std::map<string, vector<FileId>> &get_sticker_set_keywords(const StickerSet *sticker_set);
 
-  void find_sticker_set_stickers(const StickerSet *sticker_set, const vector<string> &emojis, const string &query,
-                                 vector<std::pair<bool, FileId>> &result) const;
+  void update_sticker_set_search_index(const StickerSet *sticker_set);
 
   bool can_find_sticker_by_query(FileId sticker_id, const vector<string> &emojis, const string &query) const;
 
@@ -962,9 +963,14 @@ class StickersManager final : public Actor {
 
   void on_get_language_codes(const string &key, Result<vector<string>> &&result);
 
-  static vector<std::pair<string, string>> search_language_emojis(const string &language_code, const string &text);
+  vector<std::pair<string, string>> search_language_emojis(const string &language_code, const string &text) const;
 
-  static vector<string> get_keyword_language_emojis(const string &language_code, const string &text);
+  vector<string> get_keyword_language_emojis(const string &language_code, const string &text) const;
+
+  void load_emoji_keyword_index(const string &language_code, Promise<Unit> &&promise);
+
+  void on_load_emoji_keyword_index(const string &language_code,
+                                   Result<vector<std::pair<string, string>>> &&r_keyword_emojis);
 
   void load_emoji_keywords(const string &language_code, Promise<Unit> &&promise);
 
@@ -973,6 +979,8 @@ class StickersManager final : public Actor {
 
   void load_emoji_keywords_difference(const string &language_code);
 
+  void send_get_emoji_keywords_difference_query(const string &language_code, Result<Unit> &&result);
+
   void on_get_emoji_keywords_difference(
       const string &language_code, int32 from_version,
       Result<telegram_api::object_ptr<telegram_api::emojiKeywordsDifference>> &&result);
@@ -1000,6 +1008,7 @@ class StickersManager final : public Actor {
   WaitFreeHashMap<StickerSetId, unique_ptr<StickerSet>, StickerSetIdHash>
       sticker_sets_;  // sticker_set_id -> StickerSet
   WaitFreeHashMap<string, StickerSetId> short_name_to_sticker_set_id_;
+  StickerSearchIndex sticker_search_index_;  // emojis and keywords of stickers from all loaded sticker sets
 
   vector<StickerSetId> installed_sticker_set_ids_[MAX_STICKER_TYPE];
   vector<StickerSetId> featured_sticker_set_ids_[MAX_STICKER_TYPE];
@@ -1124,6 +1133,8 @@ class StickersManager final : public Actor {
   FlatHashMap<string, double> emoji_language_code_last_difference_times_;
   FlatHashSet<string> reloaded_emoji_keywords_;
   FlatHashMap<string, vector<Promise<Unit>>> load_emoji_keywords_queries_;
+  FlatHashMap<string, EmojiKeywordIndex> emoji_keyword_indexes_;
+  FlatHashMap<string, vector<Promise<Unit>>> load_emoji_keyword_index_queries_;
   FlatHashMap<string, vector<Promise<Unit>>> load_language_codes_queries_;
   FlatHashMap<int64, string> emoji_suggestions_urls_;
 
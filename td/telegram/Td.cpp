@@ -2275,6 +2275,7 @@ bool Td::is_preauthentication_request(int32 id) {
     case td_api::getNetworkStatistics::ID:
     case td_api::addNetworkStatistics::ID:
     case td_api::resetNetworkStatistics::ID:
+    case td_api::getNetworkRequestsStatistics::ID:
     case td_api::setApplicationVerificationToken::ID:
     case td_api::getCountries::ID:
     case td_api::getCountryCode::ID:
@@ -2504,6 +2505,9 @@ void Td::start_up() {
   alarm_timeout_.set_callback(on_alarm_timeout_callback);
   alarm_timeout_.set_callback_data(static_cast<void *>(this));
 
+  // network request statistics are dumped from here to avoid logging on the query answer path
+  timeout_expired();
+
   CHECK(state_ == State::WaitParameters);
   for (auto &update : get_fake_current_state()) {
     send_update(std::move(update));
@@ -2528,6 +2532,16 @@ void Td::hangup_shared() {
   }
 }
 
+void Td::timeout_expired() {
+  if (close_flag_ > 0) {
+    return;
+  }
+  if (td_options_.net_query_stats != nullptr) {
+    td_options_.net_query_stats->dump_network_requests_statistics_if_needed();
+  }
+  set_timeout_in(60.0);
+}
+
 void Td::hangup() {
   LOG(INFO) << "Receive Td::hangup";
   close();
@@ -4349,6 +4363,13 @@ void Td::on_request(uint64 id, td_api::resetNetworkStatistics &request) {
   promise.set_value(Unit());
 }
 
+void Td::on_request(uint64 id, const td_api::getNetworkRequestsStatistics &request) {
+  if (td_options_.net_query_stats == nullptr) {
+    return send_error_raw(id, 400, "Network request statistics are unavailable");
+  }
+  send_result(id, td_options_.net_query_stats->get_network_requests_statistics_object());
+}
+
 void Td::on_request(uint64 id, td_api::addNetworkStatistics &request) {
   if (request.entry_ == nullptr) {
     return send_error_raw(id, 400, "Network statistics entry must be non-empty");
@@ -654,6 +654,8 @@ class Td final : public Actor {
 
   void on_request(uint64 id, td_api::resetNetworkStatistics &request);
 
+  void on_request(uint64 id, const td_api::getNetworkRequestsStatistics &request);
+
   void on_request(uint64 id, td_api::addNetworkStatistics &request);
 
   void on_request(uint64 id, const td_api::setNetworkType &request);
@@ -2027,6 +2029,7 @@ class Td final : public Actor {
   void tear_down() final;
   void hangup_shared() final;
   void hangup() final;
+  void timeout_expired() final;
 };
 
 }  // namespace td
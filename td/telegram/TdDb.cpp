@@ -25,6 +25,7 @@
 #include "td/db/SqliteKeyValue.h"
 #include "td/db/SqliteKeyValueAsync.h"
 #include "td/db/SqliteKeyValueSafe.h"
+#include "td/db/SqliteWalCheckpointer.h"
 
 #include "td/actor/actor.h"
 #include "td/actor/MultiPromise.h"
@@ -287,6 +288,12 @@ void TdDb::do_close(bool destroy_flag, Promise<Unit> on_finished) {
   } else {
     LOG(INFO) << "Close all databases";
   }
+  if (sql_connection_ != nullptr) {
+    auto commit_stats = sql_connection_->get_commit_stats();
+    LOG(INFO) << "Did " << commit_stats.commit_count << " SQLite commits in " << commit_stats.total_commit_time
+              << " seconds with maximum duration of " << commit_stats.max_commit_time << " seconds; "
+              << commit_stats.slow_commit_count << " commits were slow";
+  }
   MultiPromiseActorSafe mpas{"TdDbCloseMultiPromiseActor"};
   mpas.add_promise(PromiseCreator::lambda(
       [promise = std::move(on_finished), sql_connection = std::move(sql_connection_), destroy_flag](Unit) mutable {
@@ -303,11 +310,20 @@ void TdDb::do_close(bool destroy_flag, Promise<Unit> on_finished) {
       }));
   auto lock = mpas.get_promise();
 
+  if (wal_checkpointer_) {
+    wal_checkpointer_->close(mpas.get_promise());
+  }
+
   if (file_db_) {
     file_db_->close(mpas.get_promise());
     file_db_.reset();
   }
 
+  if (common_kv_safe_ && common_kv_safe_->get_cache() != nullptr) {
+    auto stats = common_kv_safe_->get_cache()->get_stats();
+    LOG(INFO) << "SQLite PMC cache hit rate is " << stats.get_hit_rate() << " with " << stats.hit_count << " hits and "
+              << stats.miss_count << " misses; skipped " << stats.skipped_write_count << " writes";
+  }
   common_kv_safe_.reset();
   if (common_kv_async_) {
     common_kv_async_->close(mpas.get_promise());
@@ -373,7 +389,9 @@ Status TdDb::init_sqlite(const Parameters &parameters, const DbKey &key, const D
   }
 
   TRY_RESULT(db_instance, SqliteDb::change_key(sql_database_path, true, key, old_key));
-  sql_connection_ = std::make_shared<SqliteConnectionSafe>(sql_database_path, key, db_instance.get_cipher_version());
+  TRY_STATUS(db_instance.apply_tuning(parameters.sqlite_tuning_));
+  sql_connection_ = std::make_shared<SqliteConnectionSafe>(sql_database_path, key, db_instance.get_cipher_version(),
+                                                           parameters.sqlite_tuning_);
   sql_connection_->set(std::move(db_instance));
   auto &db = sql_connection_->get();
   TRY_STATUS(db.exec("PRAGMA journal_mode=WAL"));
@@ -459,7 +477,8 @@ Status TdDb::init_sqlite(const Parameters &parameters, const DbKey &key, const D
 
   file_db_ = create_file_db(sql_connection_);
 
-  common_kv_safe_ = std::make_shared<SqliteKeyValueSafe>("common", sql_connection_);
+  common_kv_safe_ =
+      std::make_shared<SqliteKeyValueSafe>("common", sql_connection_, parameters.sqlite_pmc_cache_size_);
   common_kv_async_ = create_sqlite_key_value_async(common_kv_safe_);
 
   if (was_dialog_db_created_) {
@@ -489,6 +508,13 @@ Status TdDb::init_sqlite(const Parameters &parameters, const DbKey &key, const D
     story_db_async_ = create_story_db_async(story_db_sync_safe_);
   }
 
+  // the checkpointer must not run on the database scheduler, otherwise it would delay database requests
+  auto checkpoint_period = parameters.sqlite_wal_checkpoint_period_;
+  auto checkpointer_scheduler_id = G()->get_gc_scheduler_id();
+  if (checkpoint_period > 0 && checkpointer_scheduler_id != Scheduler::instance()->sched_id()) {
+    wal_checkpointer_ = create_sqlite_wal_checkpointer(sql_connection_, checkpoint_period, checkpointer_scheduler_id);
+  }
+
   return Status::OK();
 }
 
@@ -673,6 +699,18 @@ void TdDb::change_key(DbKey key, Promise<> promise) {
   get_binlog()->change_key(std::move(key), std::move(promise));
 }
 
+SqliteTuning TdDb::get_default_sqlite_tuning() {
+  SqliteTuning tuning;
+  // memory mapping can exhaust address space of 32-bit processes
+  tuning.mmap_size = sizeof(void *) >= 8 ? static_cast<int64>(64) << 20 : 0;
+  tuning.cache_size = -4096;
+  tuning.page_size = 4096;
+  tuning.use_memory_temp_store = true;
+  // WAL is checkpointed in background, so committing connections checkpoint it only if the checkpointer falls behind
+  tuning.wal_autocheckpoint = 4000;
+  return tuning;
+}
+
 Status TdDb::destroy(const Parameters &parameters) {
   SqliteDb::destroy(get_sqlite_path(parameters)).ignore();
   Binlog::destroy(get_binlog_path(parameters)).ignore();
@@ -758,7 +796,20 @@ Result<string> TdDb::get_stats() {
   }
   sb << "Max file database depth out of " << prev.size() << '/' << count
      << " elements: " << *std::max_element(prev.begin(), prev.end()) << "\n";
-  sb << "Have " << bad_count << " forward references with maximum reference to " << max_bad_to;
+  sb << "Have " << bad_count << " forward references with maximum reference to " << max_bad_to << "\n";
+
+  if (common_kv_safe_ != nullptr && common_kv_safe_->get_cache() != nullptr) {
+    auto cache_stats = common_kv_safe_->get_cache()->get_stats();
+    sb << "SQLite PMC cache has " << cache_stats.key_count << " keys of total size "
+       << format::as_size(cache_stats.size) << "; hit rate is " << cache_stats.get_hit_rate() << " with "
+       << cache_stats.hit_count << " hits and " << cache_stats.miss_count << " misses; skipped "
+       << cache_stats.skipped_write_count << " writes\n";
+  }
+
+  auto commit_stats = sql_connection_->get_commit_stats();
+  sb << "Have " << commit_stats.commit_count << " commits with total duration " << commit_stats.total_commit_time
+     << " and maximum duration " << commit_stats.max_commit_time << "; " << commit_stats.slow_commit_count
+     << " commits were slower than " << SqliteDb::SLOW_COMMIT_TIME;
 
   return sb.as_cslice().str();
 }
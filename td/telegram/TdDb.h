@@ -10,6 +10,7 @@
 #include "td/db/binlog/BinlogInterface.h"
 #include "td/db/DbKey.h"
 #include "td/db/KeyValueSyncInterface.h"
+#include "td/db/SqliteTuning.h"
 
 #include "td/utils/common.h"
 #include "td/utils/Promise.h"
@@ -39,6 +40,7 @@ class SqliteConnectionSafe;
 class SqliteKeyValueSafe;
 class SqliteKeyValueAsyncInterface;
 class SqliteKeyValue;
+class SqliteWalCheckpointerInterface;
 class StoryDbSyncInterface;
 class StoryDbSyncSafeInterface;
 class StoryDbAsyncInterface;
@@ -52,6 +54,8 @@ class TdDb {
   TdDb &operator=(TdDb &&) = delete;
   ~TdDb();
 
+  static SqliteTuning get_default_sqlite_tuning();
+
   struct Parameters {
     DbKey encryption_key_;
     string database_directory_;
@@ -60,6 +64,12 @@ class TdDb {
     bool use_file_database_ = false;
     bool use_chat_info_database_ = false;
     bool use_message_database_ = false;
+    // the maximum size of values of the SQLite PMC cached in memory; 0 disables the cache
+    size_t sqlite_pmc_cache_size_ = 1 << 20;
+    // SQLite settings, which are applied to every connection to the database
+    SqliteTuning sqlite_tuning_ = get_default_sqlite_tuning();
+    // the period of passive WAL checkpoints, which are done in background; 0 disables background checkpoints
+    double sqlite_wal_checkpoint_period_ = 1.0;
   };
 
   struct OpenedDatabase {
@@ -162,6 +172,7 @@ class TdDb {
   bool was_dialog_db_created_ = false;
 
   std::shared_ptr<SqliteConnectionSafe> sql_connection_;
+  unique_ptr<SqliteWalCheckpointerInterface> wal_checkpointer_;
 
   std::shared_ptr<FileDbInterface> file_db_;
 
@@ -62,6 +62,7 @@
 #include <iostream>
 #include <limits>
 #include <locale>
+#include <map>
 #include <memory>
 #include <queue>
 #include <tuple>
@@ -83,20 +84,41 @@ static void dump_memory_usage() {
     dump_alloc([&](const AllocInfo &info) { alloc_info.push_back(info); });
     std::sort(alloc_info.begin(), alloc_info.end(),
               [](const AllocInfo &lhs, const AllocInfo &rhs) { return lhs.size > rhs.size; });
+
+    // allocation rate is calculated relatively to the previous dump
+    static std::map<Backtrace, size_t> last_allocated_sizes;
+    static double last_dump_time = 0.0;
+    auto now = Time::now();
+    auto elapsed_time = last_dump_time == 0.0 ? 0.0 : now - last_dump_time;
+    std::map<Backtrace, size_t> allocated_sizes;
+
     size_t total_size = 0;
     size_t other_size = 0;
     int cnt = 0;
     for (auto &info : alloc_info) {
       if (cnt++ < 50) {
-        LOG(WARNING) << format::as_size(info.size) << format::as_array(info.backtrace);
+        auto allocation_rate = 0.0;
+        auto it = last_allocated_sizes.find(info.backtrace);
+        if (elapsed_time > 0 && it != last_allocated_sizes.end() && info.allocated_size >= it->second) {
+          allocation_rate = static_cast<double>(info.allocated_size - it->second) / elapsed_time;
+        }
+        LOG(WARNING) << format::as_size(info.size) << tag("allocated", format::as_size(info.allocated_size))
+                     << tag("count", info.allocation_count)
+                     << tag("rate", PSLICE() << format::as_size(static_cast<size_t>(allocation_rate)) << "/s")
+                     << format::as_array(info.backtrace);
       } else {
         other_size += info.size;
       }
       total_size += info.size;
+      allocated_sizes[info.backtrace] = info.allocated_size;
     }
+    last_allocated_sizes = std::move(allocated_sizes);
+    last_dump_time = now;
+
     LOG(WARNING) << tag("other", format::as_size(other_size));
     LOG(WARNING) << tag("total", format::as_size(total_size));
     LOG(WARNING) << tag("total traces", get_ht_size());
+    LOG(WARNING) << tag("sampling_interval", get_memprof_sampling_interval());
     LOG(WARNING) << tag("fast_backtrace_success_rate", get_fast_backtrace_success_rate());
   }
 }
@@ -226,6 +248,9 @@ class CliClient final : public Actor {
  private:
   void start_up() final {
     yield();
+
+    // periodic memory usage dumps can be enabled through TD_MEMPROF_DUMP_PERIOD environment variable
+    schedule_memprof_dump();
   }
 
   FlatHashMap<uint64, SendMessageInfo> query_id_to_send_message_info_;
@@ -384,6 +409,16 @@ class CliClient final : public Actor {
 
   vector<FileGeneration> pending_file_generations_;
 
+  double next_memprof_dump_time_ = 0.0;
+
+  void schedule_memprof_dump() {
+    auto dump_period = get_memprof_dump_period();
+    if (dump_period > 0) {
+      next_memprof_dump_time_ = Time::now() + dump_period;
+      set_timeout_in(dump_period);
+    }
+  }
+
   void on_file_generation_start(const td_api::updateFileGenerationStart &update) {
     FileGeneration file_generation;
     file_generation.id = update.generation_id_;
@@ -3609,6 +3644,8 @@ class CliClient final : public Actor {
       send_request(td_api::make_object<td_api::getNetworkStatistics>(true));
     } else if (op == "reset_network") {
       send_request(td_api::make_object<td_api::resetNetworkStatistics>());
+    } else if (op == "network_requests") {
+      send_request(td_api::make_object<td_api::getNetworkRequestsStatistics>());
     } else if (op == "snt") {
       send_request(td_api::make_object<td_api::setNetworkType>(as_network_type(args)));
     } else if (op == "gadsp") {
@@ -7077,6 +7114,12 @@ class CliClient final : public Actor {
         LOG(ERROR) << "RSS = " << stats.resident_size_ << ", peak RSS = " << stats.resident_size_peak_ << ", VSZ "
                    << stats.virtual_size_ << ", peak VSZ = " << stats.virtual_size_peak_;
       }
+    } else if (op == "mps") {
+      set_memprof_sampling_interval(to_integer<size_t>(args));
+    } else if (op == "mpd") {
+      set_memprof_dump_period(to_double(args));
+      dump_memory_usage();
+      schedule_memprof_dump();
     } else if (op == "cpu") {
       auto inc_count = to_integer<uint32>(args);
       while (inc_count-- > 0) {
@@ -7229,8 +7272,16 @@ class CliClient final : public Actor {
       }
     }
 
+    auto memprof_dump_period = get_memprof_dump_period();
+    if (memprof_dump_period > 0 && Time::now() >= next_memprof_dump_time_) {
+      dump_memory_usage();
+      next_memprof_dump_time_ = Time::now() + memprof_dump_period;
+    }
+
     if (!pending_file_generations_.empty()) {
       set_timeout_in(0.01);
+    } else if (memprof_dump_period > 0) {
+      set_timeout_in(next_memprof_dump_time_ - Time::now());
     }
   }
 
@@ -17,6 +17,15 @@ namespace td {
 
 FileDownloadManager::Callback::~Callback() = default;
 
+NetQueryCreator &FileDownloadManager::FileDownloaderCallback::net_query_creator() {
+  return G()->net_query_creator();
+}
+
+void FileDownloadManager::FileDownloaderCallback::send_net_query(NetQueryPtr net_query,
+                                                                 ActorShared<NetQueryCallback> callback) {
+  G()->net_query_dispatcher().dispatch_with_callback(std::move(net_query), std::move(callback));
+}
+
 FileDownloadManager::FileDownloadManager(unique_ptr<Callback> callback, ActorShared<> parent)
     : callback_(std::move(callback)), parent_(std::move(parent)) {
 }
@@ -25,6 +34,26 @@ void FileDownloadManager::start_up() {
   if (G()->get_option_boolean("is_premium")) {
     max_download_resource_limit_ *= 8;
   }
+
+  // downloaded parts are decrypted, written and checked on schedulers without time-critical work;
+  // a client with the default 3 additional threads has only the GC scheduler suitable,
+  // so it gets a single worker sharing the thread with the garbage collector
+  auto current_scheduler_id = Scheduler::instance()->sched_id();
+  auto scheduler_count = Scheduler::instance()->sched_count();
+  vector<int32> worker_scheduler_ids;
+  for (int32 scheduler_id = 0; scheduler_id < scheduler_count; scheduler_id++) {
+    if (scheduler_id != current_scheduler_id && scheduler_id != G()->get_database_scheduler_id() &&
+        (scheduler_id == G()->get_gc_scheduler_id() || scheduler_id > G()->get_slow_net_scheduler_id())) {
+      worker_scheduler_ids.push_back(scheduler_id);
+    }
+  }
+  if (worker_scheduler_ids.empty()) {
+    worker_scheduler_ids.push_back(current_scheduler_id);
+  }
+  for (auto scheduler_id : worker_scheduler_ids) {
+    workers_.push_back(create_actor_on_scheduler<FileDownloadWorker>("FileDownloadWorker", scheduler_id));
+    worker_ids_.push_back(workers_.back().get());
+  }
 }
 
 ActorOwn<ResourceManager> &FileDownloadManager::get_download_resource_manager(bool is_small, DcId dc_id) {
@@ -52,7 +81,7 @@ void FileDownloadManager::download(QueryId query_id, const FullRemoteFileLocatio
   bool is_small = size < 20 * 1024;
   node->downloader_ =
       create_actor<FileDownloader>("Downloader", remote_location, local, size, std::move(name), encryption_key,
-                                   is_small, need_search_file, offset, limit, std::move(callback));
+                                   is_small, need_search_file, offset, limit, worker_ids_, std::move(callback));
   DcId dc_id = remote_location.is_web() ? G()->get_webfile_dc_id() : remote_location.get_dc_id();
   auto &resource_manager = get_download_resource_manager(is_small, dc_id);
   send_closure(resource_manager, &ResourceManager::register_worker,
@@ -184,6 +213,7 @@ void FileDownloadManager::hangup_shared() {
 
 void FileDownloadManager::try_stop() {
   if (stop_flag_ && nodes_container_.empty()) {
+    workers_.clear();
     stop();
   }
 }
@@ -7,6 +7,7 @@
 #pragma once
 
 #include "td/telegram/files/FileDownloader.h"
+#include "td/telegram/files/FileDownloadWorker.h"
 #include "td/telegram/files/FileEncryptionKey.h"
 #include "td/telegram/files/FileFromBytes.h"
 #include "td/telegram/files/FileLocation.h"
@@ -64,6 +65,9 @@ class FileDownloadManager final : public Actor {
   std::map<DcId, ActorOwn<ResourceManager>> download_resource_manager_map_;
   std::map<DcId, ActorOwn<ResourceManager>> download_small_resource_manager_map_;
 
+  vector<ActorOwn<FileDownloadWorker>> workers_;
+  vector<ActorId<FileDownloadWorker>> worker_ids_;
+
   Container<Node> nodes_container_;
   unique_ptr<Callback> callback_;
   ActorShared<> parent_;
@@ -107,6 +111,8 @@ class FileDownloadManager final : public Actor {
     void on_error(Status status) final {
       send_closure(std::move(actor_id_), &FileDownloadManager::on_error, std::move(status));
     }
+    NetQueryCreator &net_query_creator() final;
+    void send_net_query(NetQueryPtr net_query, ActorShared<NetQueryCallback> callback) final;
   };
 
   class FileFromBytesCallback final : public FileFromBytes::Callback {
@@ -0,0 +1,66 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/files/FileDownloadWorker.h"
+
+#include "td/utils/as.h"
+#include "td/utils/crypto.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+
+namespace td {
+
+void FileDownloadWorker::write_part(std::shared_ptr<FileFd> fd, int64 offset, BufferSlice bytes, size_t size,
+                                    string cdn_encryption_key, string cdn_encryption_iv, Promise<size_t> promise) {
+  CHECK(fd != nullptr);
+  promise.set_result(do_write_part(*fd, offset, std::move(bytes), size, cdn_encryption_key, cdn_encryption_iv));
+}
+
+void FileDownloadWorker::check_hash(std::shared_ptr<FileFd> fd, int64 offset, size_t size, string hash,
+                                    Promise<bool> promise) {
+  CHECK(fd != nullptr);
+  promise.set_result(do_check_hash(*fd, offset, size, hash));
+}
+
+Result<size_t> FileDownloadWorker::do_write_part(FileFd &fd, int64 offset, BufferSlice bytes, size_t size,
+                                                 Slice cdn_encryption_key, Slice cdn_encryption_iv) {
+  if (!cdn_encryption_key.empty()) {
+    CHECK(offset % 16 == 0);
+    CHECK(cdn_encryption_iv.size() == 16);
+    auto block_offset = narrow_cast<uint32>(offset / 16);
+    block_offset = ((block_offset & 0xff) << 24) | ((block_offset & 0xff00) << 8) |
+                   ((block_offset & 0xff0000) >> 8) | ((block_offset & 0xff000000) >> 24);
+
+    AesCtrState ctr_state;
+    string iv = cdn_encryption_iv.str();
+    as<uint32>(&iv[12]) = block_offset;
+    ctr_state.init(cdn_encryption_key, iv);
+    ctr_state.decrypt(bytes.as_slice(), bytes.as_mutable_slice());
+  }
+
+  auto slice = bytes.as_slice().substr(0, size);
+  LOG(INFO) << "Receive " << slice.size() << " bytes at offset " << offset;
+  TRY_RESULT(written, fd.pwrite(slice, offset));
+  LOG(INFO) << "Written " << written << " bytes";
+  // may write less than size, when size of downloadable file is unknown
+  if (written != slice.size()) {
+    return Status::Error("Failed to save file part to the file");
+  }
+  return written;
+}
+
+Result<bool> FileDownloadWorker::do_check_hash(FileFd &fd, int64 offset, size_t size, Slice hash) {
+  auto slice = BufferSlice(size);
+  TRY_RESULT(read_size, fd.pread(slice.as_mutable_slice(), offset));
+  if (size != read_size) {
+    return Status::Error("Failed to read file to check hash");
+  }
+  string real_hash(32, ' ');
+  sha256(slice.as_slice(), real_hash);
+  return real_hash == hash;
+}
+
+}  // namespace td
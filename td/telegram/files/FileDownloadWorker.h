@@ -0,0 +1,39 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/actor/actor.h"
+
+#include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/port/FileFd.h"
+#include "td/utils/Promise.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+
+#include <memory>
+
+namespace td {
+
+// decrypts, writes and checks downloaded file parts outside of the FileDownloader's scheduler
+// using the file descriptor shared with the FileDownloader
+class FileDownloadWorker final : public Actor {
+ public:
+  // decrypts CDN part if cdn_encryption_key isn't empty and writes first size bytes of it to the file at the offset
+  void write_part(std::shared_ptr<FileFd> fd, int64 offset, BufferSlice bytes, size_t size, string cdn_encryption_key,
+                  string cdn_encryption_iv, Promise<size_t> promise);
+
+  // returns whether SHA-256 of the file part is equal to the hash
+  void check_hash(std::shared_ptr<FileFd> fd, int64 offset, size_t size, string hash, Promise<bool> promise);
+
+  static Result<size_t> do_write_part(FileFd &fd, int64 offset, BufferSlice bytes, size_t size,
+                                      Slice cdn_encryption_key, Slice cdn_encryption_iv);
+
+  static Result<bool> do_check_hash(FileFd &fd, int64 offset, size_t size, Slice hash);
+};
+
+}  // namespace td
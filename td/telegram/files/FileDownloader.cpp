@@ -10,7 +10,7 @@
 #include "td/telegram/files/FileLoaderUtils.h"
 #include "td/telegram/files/FileType.h"
 #include "td/telegram/Global.h"
-#include "td/telegram/net/NetQueryDispatcher.h"
+#include "td/telegram/net/NetQueryCreator.h"
 #include "td/telegram/SecureStorage.h"
 #include "td/telegram/telegram_api.h"
 #include "td/telegram/UniqueId.h"
@@ -24,6 +24,7 @@
 #include "td/utils/misc.h"
 #include "td/utils/port/path.h"
 #include "td/utils/port/Stat.h"
+#include "td/utils/Promise.h"
 #include "td/utils/ScopeGuard.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/UInt.h"
@@ -34,13 +35,15 @@ namespace td {
 
 FileDownloader::FileDownloader(const FullRemoteFileLocation &remote, const LocalFileLocation &local, int64 size,
                                string name, const FileEncryptionKey &encryption_key, bool is_small,
-                               bool need_search_file, int64 offset, int64 limit, unique_ptr<Callback> callback)
+                               bool need_search_file, int64 offset, int64 limit,
+                               vector<ActorId<FileDownloadWorker>> workers, unique_ptr<Callback> callback)
     : remote_(remote)
     , local_(local)
     , size_(size)
     , name_(std::move(name))
     , encryption_key_(encryption_key)
     , callback_(std::move(callback))
+    , workers_(std::move(workers))
     , is_small_(is_small)
     , need_search_file_(need_search_file)
     , ordered_flag_(encryption_key_.is_secret())
@@ -49,10 +52,11 @@ FileDownloader::FileDownloader(const FullRemoteFileLocation &remote, const Local
   if (!encryption_key.empty()) {
     CHECK(offset_ == 0);
   }
+  CHECK(!workers_.empty());
 }
 
 void FileDownloader::on_error(Status status) {
-  fd_.close();
+  fd_ = nullptr;
   stop_flag_ = true;
   callback_->on_error(std::move(status));
 }
@@ -159,12 +163,12 @@ Result<NetQueryPtr> FileDownloader::start_part(Part part, int32 part_count, int6
     auto unique_id = UniqueId::next(UniqueId::Type::Default, static_cast<uint8>(QueryType::Default));
     net_query =
         remote_.is_web()
-            ? G()->net_query_creator().create(
+            ? callback_->net_query_creator().create(
                   unique_id, nullptr,
                   telegram_api::upload_getWebFile(remote_.as_input_web_file_location(), narrow_cast<int32>(part.offset),
                                                   narrow_cast<int32>(size)),
                   {}, dc_id, net_query_type, NetQuery::AuthFlag::On)
-            : G()->net_query_creator().create(
+            : callback_->net_query_creator().create(
                   unique_id, nullptr,
                   telegram_api::upload_getFile(flags, false /*ignored*/, false /*ignored*/,
                                                remote_.as_input_file_location(), part.offset, narrow_cast<int32>(size)),
@@ -177,12 +181,12 @@ Result<NetQueryPtr> FileDownloader::start_part(Part part, int32 part_count, int6
     if (it == cdn_part_reupload_token_.end()) {
       auto query = telegram_api::upload_getCdnFile(BufferSlice(cdn_file_token_), part.offset, narrow_cast<int32>(size));
       cdn_part_file_token_generation_[part.id] = cdn_file_token_generation_;
-      net_query =
-          G()->net_query_creator().create(UniqueId::next(UniqueId::Type::Default, static_cast<uint8>(QueryType::CDN)),
-                                          nullptr, query, {}, cdn_dc_id_, net_query_type, NetQuery::AuthFlag::Off);
+      net_query = callback_->net_query_creator().create(
+          UniqueId::next(UniqueId::Type::Default, static_cast<uint8>(QueryType::CDN)), nullptr, query, {}, cdn_dc_id_,
+          net_query_type, NetQuery::AuthFlag::Off);
     } else {
       auto query = telegram_api::upload_reuploadCdnFile(BufferSlice(cdn_file_token_), BufferSlice(it->second));
-      net_query = G()->net_query_creator().create(
+      net_query = callback_->net_query_creator().create(
           UniqueId::next(UniqueId::Type::Default, static_cast<uint8>(QueryType::ReuploadCDN)), nullptr, query, {},
           remote_.get_dc_id(), net_query_type, NetQuery::AuthFlag::On);
       cdn_part_reupload_token_.erase(it);
@@ -205,7 +209,7 @@ Status FileDownloader::check_net_query(NetQueryPtr &net_query) {
   return Status::OK();
 }
 
-Result<size_t> FileDownloader::process_part(Part part, NetQueryPtr net_query) {
+Status FileDownloader::process_part(Part part, NetQueryPtr net_query) {
   TRY_STATUS(check_net_query(net_query));
 
   BufferSlice bytes;
@@ -245,23 +249,13 @@ Result<size_t> FileDownloader::process_part(Part part, NetQueryPtr net_query) {
   if (bytes.size() > padded_size) {
     return Status::Error("Part size is more than requested");
   }
+  auto seq_no = next_written_part_seq_no_++;
   if (bytes.empty()) {
-    return 0;
+    add_written_part(seq_no, part, 0);
+    return Status::OK();
   }
 
-  // Encryption
-  if (need_cdn_decrypt) {
-    CHECK(part.offset % 16 == 0);
-    auto offset = narrow_cast<uint32>(part.offset / 16);
-    offset =
-        ((offset & 0xff) << 24) | ((offset & 0xff00) << 8) | ((offset & 0xff0000) >> 8) | ((offset & 0xff000000) >> 24);
-
-    AesCtrState ctr_state;
-    string iv = cdn_encryption_iv_;
-    as<uint32>(&iv[12]) = offset;
-    ctr_state.init(cdn_encryption_key_, iv);
-    ctr_state.decrypt(bytes.as_slice(), bytes.as_mutable_slice());
-  }
+  // secret files must be decrypted sequentially, so they are decrypted here in order of parts
   if (encryption_key_.is_secret()) {
     LOG_CHECK(next_part_ == part.id) << tag("expected part.id", next_part_) << "!=" << tag("part.id", part.id);
     CHECK(!next_part_stop_);
@@ -271,18 +265,55 @@ Result<size_t> FileDownloader::process_part(Part part, NetQueryPtr net_query) {
     }
     aes_ige_decrypt(as_slice(encryption_key_.key()), as_mutable_slice(encryption_key_.mutable_iv()), bytes.as_slice(),
                     bytes.as_mutable_slice());
+    secret_part_ivs_[next_part_] = encryption_key_.mutable_iv();
   }
 
-  auto slice = bytes.as_slice().substr(0, part.size);
+  // CDN decryption and writing to the file are done by a worker
   TRY_STATUS(acquire_fd());
-  LOG(INFO) << "Receive " << slice.size() << " bytes at offset " << part.offset << " for \"" << path_ << '"';
-  TRY_RESULT(written, fd_.pwrite(slice, part.offset));
-  LOG(INFO) << "Written " << written << " bytes";
-  // may write less than part.size, when size of downloadable file is unknown
-  if (written != slice.size()) {
-    return Status::Error("Failed to save file part to the file");
+  string cdn_encryption_key;
+  string cdn_encryption_iv;
+  if (need_cdn_decrypt) {
+    CHECK(part.offset % 16 == 0);
+    cdn_encryption_key = cdn_encryption_key_;
+    cdn_encryption_iv = cdn_encryption_iv_;
+  }
+  auto promise = PromiseCreator::lambda([actor_id = actor_id(this), seq_no, part](Result<size_t> r_size) {
+    send_closure(actor_id, &FileDownloader::on_part_written, seq_no, part, std::move(r_size));
+  });
+  worker_query_count_++;
+  send_closure(get_worker(), &FileDownloadWorker::write_part, fd_, part.offset, std::move(bytes), part.size,
+               std::move(cdn_encryption_key), std::move(cdn_encryption_iv), std::move(promise));
+  return Status::OK();
+}
+
+ActorId<FileDownloadWorker> FileDownloader::get_worker() {
+  auto worker = workers_[next_worker_];
+  next_worker_ = (next_worker_ + 1) % workers_.size();
+  return worker;
+}
+
+void FileDownloader::add_written_part(uint64 seq_no, Part part, Result<size_t> r_size) {
+  // parts are reported to parts_manager_ in the order in which they were received
+  written_parts_.add(seq_no, std::make_pair(part, std::move(r_size)),
+                     [this](uint64, std::pair<Part, Result<size_t>> &&p) {
+                       if (stop_flag_) {
+                         return;
+                       }
+                       auto status = try_on_part_written(p.first, std::move(p.second));
+                       if (status.is_error()) {
+                         on_error(std::move(status));
+                       }
+                     });
+}
+
+void FileDownloader::on_part_written(uint64 seq_no, Part part, Result<size_t> r_size) {
+  on_worker_query_finished();
+  if (stop_flag_) {
+    return;
   }
-  return written;
+  add_written_part(seq_no, part, std::move(r_size));
+  update_estimated_limit();
+  loop();
 }
 
 void FileDownloader::on_progress() {
@@ -303,11 +334,15 @@ void FileDownloader::on_progress() {
   } else if (encryption_key_.is_secret()) {
     UInt256 iv;
     auto ready_part_count = parts_manager_.get_ready_prefix_count();
+    auto it = secret_part_ivs_.find(ready_part_count);
     if (ready_part_count == next_part_) {
       iv = encryption_key_.mutable_iv();
+    } else if (it != secret_part_ivs_.end()) {
+      iv = it->second;
     } else {
       LOG(FATAL) << tag("ready_part_count", ready_part_count) << tag("next_part", next_part_);
     }
+    secret_part_ivs_.erase(secret_part_ivs_.begin(), secret_part_ivs_.lower_bound(ready_part_count));
     callback_->on_partial_download(PartialLocalFileLocation{remote_.file_type_, part_size, path_, as_slice(iv).str(),
                                                             parts_manager_.get_bitmask()},
                                    ready_size, size);
@@ -331,7 +366,10 @@ Status FileDownloader::check_loop(int64 checked_prefix_size, int64 ready_prefix_
   SCOPE_EXIT {
     try_release_fd();
   };
-  bool is_changed = false;
+  if (!hash_checks_.empty()) {
+    // the parts are already being checked
+    checked_prefix_size = max(checked_prefix_size, hash_checks_.rbegin()->first);
+  }
   vector<NetQueryPtr> queries;
   while (checked_prefix_size < ready_prefix_size) {
     //LOG(ERROR) << "NEED TO CHECK: " << checked_prefix_size << "->" << ready_prefix_size - checked_prefix_size;
@@ -352,31 +390,23 @@ Status FileDownloader::check_loop(int64 checked_prefix_size, int64 ready_prefix_
         end_offset = ready_prefix_size;
       }
       auto size = narrow_cast<size_t>(end_offset - begin_offset);
-      auto slice = BufferSlice(size);
       TRY_STATUS(acquire_fd());
-      TRY_RESULT(read_size, fd_.pread(slice.as_mutable_slice(), begin_offset));
-      if (size != read_size) {
-        return Status::Error("Failed to read file to check hash");
-      }
-      string hash(32, ' ');
-      sha256(slice.as_slice(), hash);
-
-      if (hash != it->hash) {
-        if (only_check_) {
-          return Status::Error("FILE_DOWNLOAD_RESTART");
-        }
-        return Status::Error("Hash mismatch");
-      }
+      hash_checks_[end_offset] = false;
+      auto promise = PromiseCreator::lambda([actor_id = actor_id(this), end_offset](Result<bool> r_is_ok) {
+        send_closure(actor_id, &FileDownloader::on_hash_checked, end_offset, std::move(r_is_ok));
+      });
+      worker_query_count_++;
+      send_closure(get_worker(), &FileDownloadWorker::check_hash, fd_, begin_offset, size, it->hash,
+                   std::move(promise));
 
       checked_prefix_size = end_offset;
-      is_changed = true;
       continue;
     }
     if (!has_hash_query_) {
       has_hash_query_ = true;
       auto query = telegram_api::upload_getFileHashes(remote_.as_input_file_location(), checked_prefix_size);
       auto net_query_type = is_small_ ? NetQuery::Type::DownloadSmall : NetQuery::Type::Download;
-      auto net_query = G()->net_query_creator().create(query, {}, remote_.get_dc_id(), net_query_type);
+      auto net_query = callback_->net_query_creator().create(query, {}, remote_.get_dc_id(), net_query_type);
       queries.push_back(std::move(net_query));
       break;
     }
@@ -384,18 +414,52 @@ Status FileDownloader::check_loop(int64 checked_prefix_size, int64 ready_prefix_
     break;
   }
 
-  if (is_changed) {
-    on_progress();
-  }
   for (auto &query : queries) {
-    G()->net_query_dispatcher().dispatch_with_callback(
-        std::move(query), actor_shared(this, UniqueId::next(UniqueId::Type::Default, COMMON_QUERY_KEY)));
+    callback_->send_net_query(std::move(query),
+                              actor_shared(this, UniqueId::next(UniqueId::Type::Default, COMMON_QUERY_KEY)));
   }
-  if (need_check_) {
-    parts_manager_.set_need_check();
-    parts_manager_.set_checked_prefix_size(checked_prefix_size);
+  parts_manager_.set_need_check();
+
+  return Status::OK();
+}
+
+void FileDownloader::on_hash_checked(int64 end_offset, Result<bool> r_is_ok) {
+  on_worker_query_finished();
+  if (stop_flag_) {
+    return;
+  }
+  auto status = try_on_hash_checked(end_offset, std::move(r_is_ok));
+  if (status.is_error()) {
+    return on_error(std::move(status));
   }
+  loop();
+}
 
+Status FileDownloader::try_on_hash_checked(int64 end_offset, Result<bool> r_is_ok) {
+  TRY_RESULT(is_ok, std::move(r_is_ok));
+  if (!is_ok) {
+    if (only_check_) {
+      return Status::Error("FILE_DOWNLOAD_RESTART");
+    }
+    return Status::Error("Hash mismatch");
+  }
+
+  auto it = hash_checks_.find(end_offset);
+  CHECK(it != hash_checks_.end());
+  it->second = true;
+
+  // checked prefix can be extended only after all previous parts are checked
+  bool is_changed = false;
+  auto checked_prefix_size = parts_manager_.get_checked_prefix_size();
+  while (!hash_checks_.empty() && hash_checks_.begin()->second) {
+    checked_prefix_size = hash_checks_.begin()->first;
+    hash_checks_.erase(hash_checks_.begin());
+    is_changed = true;
+  }
+  if (is_changed) {
+    parts_manager_.set_checked_prefix_size(checked_prefix_size);
+    on_progress();
+  }
   return Status::OK();
 }
 
@@ -411,18 +475,21 @@ void FileDownloader::add_hash_info(const std::vector<telegram_api::object_ptr<te
 }
 
 void FileDownloader::try_release_fd() {
-  if (!keep_fd_ && !fd_.empty()) {
-    fd_.close();
+  if (!keep_fd_ && fd_ != nullptr) {
+    // the file is closed after all worker queries using it are finished
+    fd_ = nullptr;
   }
 }
 
 Status FileDownloader::acquire_fd() {
-  if (fd_.empty()) {
+  if (fd_ == nullptr) {
+    FileFd fd;
     if (path_.empty()) {
-      TRY_RESULT_ASSIGN(std::tie(fd_, path_), open_temp_file(remote_.file_type_));
+      TRY_RESULT_ASSIGN(std::tie(fd, path_), open_temp_file(remote_.file_type_));
     } else {
-      TRY_RESULT_ASSIGN(fd_, FileFd::open(path_, (only_check_ ? 0 : FileFd::Write) | FileFd::Read));
+      TRY_RESULT_ASSIGN(fd, FileFd::open(path_, (only_check_ ? 0 : FileFd::Write) | FileFd::Read));
     }
+    fd_ = std::make_shared<FileFd>(std::move(fd));
   }
   return Status::OK();
 }
@@ -444,7 +511,7 @@ void FileDownloader::update_resources(const ResourceState &other) {
 
 void FileDownloader::hangup() {
   if (delay_dispatcher_.empty()) {
-    stop();
+    try_stop();
   } else {
     delay_dispatcher_.reset();
   }
@@ -452,6 +519,23 @@ void FileDownloader::hangup() {
 
 void FileDownloader::hangup_shared() {
   if (get_link_token() == 1) {
+    try_stop();
+  }
+}
+
+void FileDownloader::try_stop() {
+  // the file must not be written after the downloader is closed, so wait for parts being written by workers
+  stop_flag_ = true;
+  need_stop_ = true;
+  if (worker_query_count_ == 0) {
+    stop();
+  }
+}
+
+void FileDownloader::on_worker_query_finished() {
+  CHECK(worker_query_count_ > 0);
+  worker_query_count_--;
+  if (need_stop_ && worker_query_count_ == 0) {
     stop();
   }
 }
@@ -502,20 +586,20 @@ void FileDownloader::start_up() {
           encryption_key_.mutable_iv() = as<UInt256>(partial.iv_.data());
           next_part_ = narrow_cast<int32>(bitmask.get_ready_parts(0));
         }
-        fd_ = result_fd.move_as_ok();
+        fd_ = std::make_shared<FileFd>(result_fd.move_as_ok());
         part_size = static_cast<int32>(partial.part_size_);
       } else {
         LOG(ERROR) << "Have invalid " << partial;
       }
     }
   }
-  if (need_search_file_ && fd_.empty() && size_ > 0 && encryption_key_.empty() && !remote_.is_web()) {
+  if (need_search_file_ && fd_ == nullptr && size_ > 0 && encryption_key_.empty() && !remote_.is_web()) {
     auto r_path = search_file(remote_.file_type_, name_, size_);
     if (r_path.is_ok()) {
       auto r_fd = FileFd::open(r_path.ok(), FileFd::Read);
       if (r_fd.is_ok()) {
         path_ = r_path.move_as_ok();
-        fd_ = r_fd.move_as_ok();
+        fd_ = std::make_shared<FileFd>(r_fd.move_as_ok());
         need_check_ = true;
         only_check_ = true;
         part_size = 128 * (1 << 10);
@@ -573,7 +657,7 @@ Status FileDownloader::do_loop() {
 
   if (parts_manager_.may_finish()) {
     TRY_STATUS(parts_manager_.finish());
-    fd_.close();
+    fd_ = nullptr;
     auto size = parts_manager_.get_size();
     if (encryption_key_.is_secure()) {
       TRY_RESULT(file_path, open_temp_file(remote_.file_type_));
@@ -618,7 +702,7 @@ Status FileDownloader::do_loop() {
 
     auto callback = actor_shared(this, unique_id);
     if (delay_dispatcher_.empty()) {
-      G()->net_query_dispatcher().dispatch_with_callback(std::move(query), std::move(callback));
+      callback_->send_net_query(std::move(query), std::move(callback));
     } else {
       query->debug("sent to DelayDispatcher");
       send_closure(delay_dispatcher_, &DelayDispatcher::send_with_callback_and_delay, std::move(query),
@@ -723,7 +807,11 @@ void FileDownloader::on_part_query(Part part, NetQueryPtr query) {
 }
 
 Status FileDownloader::try_on_part_query(Part part, NetQueryPtr query) {
-  TRY_RESULT(size, process_part(part, std::move(query)));
+  return process_part(part, std::move(query));
+}
+
+Status FileDownloader::try_on_part_written(Part part, Result<size_t> r_size) {
+  TRY_RESULT(size, std::move(r_size));
   VLOG(file_loader) << "Ok part " << tag("id", part.id) << tag("size", part.size);
   resource_state_.stop_use(static_cast<int64>(part.size));
   auto old_ready_prefix_count = parts_manager_.get_unchecked_ready_prefix_count();
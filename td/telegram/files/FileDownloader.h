@@ -7,6 +7,7 @@
 #pragma once
 
 #include "td/telegram/DelayDispatcher.h"
+#include "td/telegram/files/FileDownloadWorker.h"
 #include "td/telegram/files/FileEncryptionKey.h"
 #include "td/telegram/files/FileLoaderActor.h"
 #include "td/telegram/files/FileLocation.h"
@@ -23,13 +24,17 @@
 #include "td/utils/OrderedEventsProcessor.h"
 #include "td/utils/port/FileFd.h"
 #include "td/utils/Status.h"
+#include "td/utils/UInt.h"
 
 #include <map>
+#include <memory>
 #include <set>
 #include <utility>
 
 namespace td {
 
+class NetQueryCreator;
+
 class FileDownloader final : public FileLoaderActor {
  public:
   class Callback {
@@ -41,12 +46,14 @@ class FileDownloader final : public FileLoaderActor {
     virtual void on_partial_download(PartialLocalFileLocation partial_local, int64 ready_size, int64 size) = 0;
     virtual void on_ok(FullLocalFileLocation full_local, int64 size, bool is_new) = 0;
     virtual void on_error(Status status) = 0;
+    virtual NetQueryCreator &net_query_creator() = 0;
+    virtual void send_net_query(NetQueryPtr net_query, ActorShared<NetQueryCallback> callback) = 0;
     virtual ~Callback() = default;
   };
 
   FileDownloader(const FullRemoteFileLocation &remote, const LocalFileLocation &local, int64 size, string name,
                  const FileEncryptionKey &encryption_key, bool is_small, bool need_search_file, int64 offset,
-                 int64 limit, unique_ptr<Callback> callback);
+                 int64 limit, vector<ActorId<FileDownloadWorker>> workers, unique_ptr<Callback> callback);
 
   void update_downloaded_part(int64 offset, int64 limit, int64 max_resource_limit);
 
@@ -60,13 +67,16 @@ class FileDownloader final : public FileLoaderActor {
   string name_;
   FileEncryptionKey encryption_key_;
   unique_ptr<Callback> callback_;
+  vector<ActorId<FileDownloadWorker>> workers_;
+  size_t next_worker_ = 0;
   bool only_check_{false};
 
   string path_;
-  FileFd fd_;
+  std::shared_ptr<FileFd> fd_;  // shared with the workers, which write and check file parts
 
   int32 next_part_ = 0;
   bool next_part_stop_ = false;
+  std::map<int32, UInt256> secret_part_ivs_;  // part_id -> IV after decryption of all previous parts
   bool is_small_ = false;
   bool need_search_file_ = false;
   bool ordered_flag_ = false;
@@ -94,6 +104,7 @@ class FileDownloader final : public FileLoaderActor {
   };
   std::set<HashInfo> hash_info_;
   bool has_hash_query_ = false;
+  std::map<int64, bool> hash_checks_;  // end_offset -> is_checked, for checks sent to workers
 
   static constexpr uint8 COMMON_QUERY_KEY = 2;
   bool stop_flag_ = false;
@@ -102,6 +113,10 @@ class FileDownloader final : public FileLoaderActor {
   PartsManager parts_manager_;
   std::map<uint64, std::pair<Part, ActorShared<>>> part_map_;
   OrderedEventsProcessor<std::pair<Part, NetQueryPtr>> ordered_parts_;
+  uint64 next_written_part_seq_no_ = 1;  // sequence numbers of OrderedEventsProcessor start from 1
+  OrderedEventsProcessor<std::pair<Part, Result<size_t>>> written_parts_;
+  int32 worker_query_count_ = 0;
+  bool need_stop_ = false;
   ActorOwn<DelayDispatcher> delay_dispatcher_;
   double next_delay_ = 0;
 
@@ -113,6 +128,10 @@ class FileDownloader final : public FileLoaderActor {
 
   void hangup_shared() final;
 
+  void try_stop();
+
+  void on_worker_query_finished();
+
   void on_error(Status status);
 
   Result<bool> should_restart_part(Part part, const NetQueryPtr &net_query) TD_WARN_UNUSED_RESULT;
@@ -121,9 +140,19 @@ class FileDownloader final : public FileLoaderActor {
 
   Status check_loop(int64 checked_prefix_size, int64 ready_prefix_size, bool is_ready);
 
+  void on_hash_checked(int64 end_offset, Result<bool> r_is_ok);
+
+  Status try_on_hash_checked(int64 end_offset, Result<bool> r_is_ok);
+
   Result<NetQueryPtr> start_part(Part part, int32 part_count, int64 streaming_offset) TD_WARN_UNUSED_RESULT;
 
-  Result<size_t> process_part(Part part, NetQueryPtr net_query) TD_WARN_UNUSED_RESULT;
+  Status process_part(Part part, NetQueryPtr net_query) TD_WARN_UNUSED_RESULT;
+
+  ActorId<FileDownloadWorker> get_worker();
+
+  void add_written_part(uint64 seq_no, Part part, Result<size_t> r_size);
+
+  void on_part_written(uint64 seq_no, Part part, Result<size_t> r_size);
 
   void add_hash_info(const std::vector<telegram_api::object_ptr<telegram_api::fileHash>> &hashes);
 
@@ -151,6 +180,7 @@ class FileDownloader final : public FileLoaderActor {
   void on_part_query(Part part, NetQueryPtr query);
   void on_common_query(NetQueryPtr query);
   Status try_on_part_query(Part part, NetQueryPtr query);
+  Status try_on_part_written(Part part, Result<size_t> r_size);
 };
 
 }  // namespace td
@@ -35,6 +35,7 @@
 
 #include "td/utils/algorithm.h"
 #include "td/utils/base64.h"
+#include "td/utils/bits.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
@@ -97,6 +98,67 @@ class StatsCallback final : public mtproto::RawConnection::StatsCallback {
   DcOptionsSet::Stat *option_stat_;
 };
 
+void ConnectionQueries::add_query(Promise<unique_ptr<mtproto::RawConnection>> promise) {
+  Query query;
+  query.promise = std::move(promise);
+  query.id = ++max_query_id_;
+  queries_.push_back(std::move(query));
+}
+
+void ConnectionQueries::send_ready_connections(
+    vector<std::pair<unique_ptr<mtproto::RawConnection>, double>> &ready_connections) {
+  td::remove_if(queries_, [](auto &query) { return query.promise.is_canceled(); });
+
+  // pending connections of the served queries become spare connections
+  size_t served_query_count = 0;
+  while (served_query_count < queries_.size() && !ready_connections.empty()) {
+    VLOG(connections) << "Send to promise " << tag("connection", ready_connections.back().first.get());
+    queries_[served_query_count++].promise.set_value(std::move(ready_connections.back().first));
+    ready_connections.pop_back();
+  }
+  queries_.erase(queries_.begin(), queries_.begin() + served_query_count);
+}
+
+Result<ConnectionQueries::NewConnection> ConnectionQueries::get_new_connection(size_t pending_connection_count,
+                                                                               size_t race_count,
+                                                                               size_t spare_connection_count) const {
+  size_t query_connection_count = 0;
+  for (auto &query : queries_) {
+    for (size_t race_index = 0; race_index < race_count; race_index++) {
+      if ((query.pending_race_mask & (1u << race_index)) == 0) {
+        NewConnection result;
+        result.query_id = query.id;
+        result.race_index = race_index;
+        return result;
+      }
+    }
+    query_connection_count += count_bits32(query.pending_race_mask);
+  }
+  if (pending_connection_count >= query_connection_count + spare_connection_count) {
+    return Status::Error("There are enough pending connections");
+  }
+  return NewConnection();
+}
+
+void ConnectionQueries::on_connection_started(NewConnection connection) {
+  for (auto &query : queries_) {
+    if (query.id == connection.query_id) {
+      CHECK((query.pending_race_mask & (1u << connection.race_index)) == 0);
+      query.pending_race_mask |= 1u << connection.race_index;
+      return;
+    }
+  }
+}
+
+void ConnectionQueries::on_connection_finished(NewConnection connection) {
+  for (auto &query : queries_) {
+    if (query.id == connection.query_id) {
+      query.pending_race_mask &= ~(1u << connection.race_index);
+      return;
+    }
+  }
+}
+
 }  // namespace detail
 
 ConnectionCreator::ClientInfo::ClientInfo() {
@@ -257,6 +319,8 @@ ActorId<GetHostByNameActor> ConnectionCreator::get_dns_resolver() {
       options.resolver_types = {GetHostByNameActor::ResolverType::Google, GetHostByNameActor::ResolverType::Native};
       options.ok_timeout = 60;
       options.error_timeout = 0;
+      // a proxy or a DC can change its address, so an outdated address is used only while the new one is resolved
+      options.stale_timeout = 60;
       block_get_host_by_name_actor_ = create_actor<GetHostByNameActor>("BlockDnsResolverActor", std::move(options));
     }
     return block_get_host_by_name_actor_.get();
@@ -267,6 +331,7 @@ ActorId<GetHostByNameActor> ConnectionCreator::get_dns_resolver() {
       options.scheduler_id = G()->get_gc_scheduler_id();
       options.ok_timeout = 5 * 60 - 1;
       options.error_timeout = 0;
+      options.stale_timeout = 60;
       get_host_by_name_actor_ = create_actor<GetHostByNameActor>("DnsResolverActor", std::move(options));
     }
     return get_host_by_name_actor_.get();
@@ -344,7 +409,7 @@ void ConnectionCreator::ping_proxy_resolved(int32 proxy_id, IPAddress ip_address
   const Proxy &proxy = it->second;
   auto main_dc_id = G()->net_query_dispatcher().get_main_dc_id();
   FindConnectionExtra extra;
-  auto r_socket_fd = find_connection(proxy, ip_address, main_dc_id, false, extra);
+  auto r_socket_fd = find_connection(proxy, ip_address, main_dc_id, false, 0, extra);
   if (r_socket_fd.is_error()) {
     return promise.set_error(Status::Error(400, r_socket_fd.error().public_message()));
   }
@@ -661,6 +726,9 @@ void ConnectionCreator::on_network(bool network_flag, uint32 network_generation)
   network_flag_ = network_flag;
   auto old_generation = network_generation_;
   network_generation_ = network_generation;
+  if (old_generation != network_generation_) {
+    network_changed_at_ = Time::now();
+  }
   if (network_flag_) {
     VLOG(connections) << "Set proxy query token to 0: " << old_generation << " " << network_generation_;
     resolve_proxy_query_token_ = 0;
@@ -746,7 +814,7 @@ void ConnectionCreator::request_raw_connection(DcId dc_id, bool allow_media_only
   client.auth_data_generation++;
   VLOG(connections) << "Request connection for " << tag("client", format::as_hex(client.hash)) << " to " << dc_id << " "
                     << tag("allow_media_only", allow_media_only);
-  client.queries.push_back(std::move(promise));
+  client.queries.add_query(std::move(promise));
 
   client_loop(client);
 }
@@ -811,15 +879,17 @@ Result<mtproto::TransportType> ConnectionCreator::get_transport_type(const Proxy
 }
 
 Result<SocketFd> ConnectionCreator::find_connection(const Proxy &proxy, const IPAddress &proxy_ip_address, DcId dc_id,
-                                                    bool allow_media_only, FindConnectionExtra &extra) {
+                                                    bool allow_media_only, size_t option_index,
+                                                    FindConnectionExtra &extra) {
   extra.debug_str = PSTRING() << "Failed to find valid IP address for " << dc_id;
   bool prefer_ipv6 = G()->get_option_boolean("prefer_ipv6") || (proxy.use_proxy() && proxy_ip_address.is_ipv6());
   bool only_http = proxy.use_http_caching_proxy();
 #if TD_DARWIN_WATCH_OS
   only_http = true;
 #endif
-  TRY_RESULT(info, dc_options_set_.find_connection(
-                       dc_id, allow_media_only, proxy.use_proxy() && proxy.use_socks5_proxy(), prefer_ipv6, only_http));
+  TRY_RESULT(info,
+             dc_options_set_.find_connection(dc_id, allow_media_only, proxy.use_proxy() && proxy.use_socks5_proxy(),
+                                             prefer_ipv6, only_http, option_index));
   extra.stat = info.stat;
   TRY_RESULT_ASSIGN(extra.transport_type, get_transport_type(proxy, info));
 
@@ -955,50 +1025,63 @@ void ConnectionCreator::client_loop(ClientInfo &client) {
 
   VLOG(connections) << "In client_loop: " << tag("client", format::as_hex(client.hash));
 
-  // Remove expired ready connections
-  td::remove_if(client.ready_connections,
-                [&, expires_at = Time::now_cached() - ClientInfo::READY_CONNECTIONS_TIMEOUT](auto &v) {
-                  bool drop = v.second < expires_at;
-                  VLOG_IF(connections, drop) << "Drop expired " << tag("connection", v.first.get());
-                  return drop;
-                });
-
-  // Send ready connections into promises
-  {
-    auto begin = client.queries.begin();
-    auto it = begin;
-    while (it != client.queries.end() && !client.ready_connections.empty()) {
-      if (!it->is_canceled()) {
-        VLOG(connections) << "Send to promise " << tag("connection", client.ready_connections.back().first.get());
-        it->set_value(std::move(client.ready_connections.back().first));
-        client.ready_connections.pop_back();
+  // If racing is enabled, several connections to different IP addresses are created for each query,
+  // and the first ready connection is used. Spare connections are created in advance while online
+  auto race_count = static_cast<size_t>(clamp(G()->get_option_integer("connection_race_count", 1), int64{1}, int64{3}));
+  auto spare_count = static_cast<size_t>(clamp(G()->get_option_integer("spare_connection_count"), int64{0}, int64{2}));
+  if (proxy.use_proxy()) {
+    // all connections go through the same proxy server
+    race_count = 1;
+  }
+  bool act_as_if_online = online_flag_ || is_logging_out_;
+  if (!act_as_if_online || !client.inited) {
+    spare_count = 0;
+  }
+
+  // Remove expired ready connections and connections created before the last network change;
+  // up to spare_count connections are kept longer
+  size_t kept_spare_count = 0;
+  td::remove_if(client.ready_connections, [&, now = Time::now_cached()](auto &v) {
+    bool drop = v.first->extra().extra != network_generation_;
+    if (!drop && v.second < now - ClientInfo::READY_CONNECTIONS_TIMEOUT) {
+      drop = v.second < now - ClientInfo::SPARE_CONNECTIONS_TIMEOUT || kept_spare_count >= spare_count;
+      if (!drop) {
+        kept_spare_count++;
       }
-      ++it;
     }
-    client.queries.erase(begin, it);
-  }
+    VLOG_IF(connections, drop) << "Drop expired " << tag("connection", v.first.get());
+    return drop;
+  });
+
+  // Send ready connections into promises
+  client.queries.send_ready_connections(client.ready_connections);
 
   // Main loop. Create new connections till needed
   bool check_mode = client.checking_connections != 0 && !proxy.use_proxy();
   while (true) {
     // Check if we need new connections
-    if (client.queries.empty()) {
+    size_t need_spare_connections =
+        spare_count > client.ready_connections.size() ? spare_count - client.ready_connections.size() : 0;
+    if (client.queries.empty() && need_spare_connections == 0) {
       if (!client.ready_connections.empty()) {
         client_set_timeout_at(client, Time::now() + ClientInfo::READY_CONNECTIONS_TIMEOUT);
       }
       return;
     }
+    detail::ConnectionQueries::NewConnection new_connection;
     if (check_mode) {
       if (client.checking_connections >= 3) {
         return;
       }
     } else {
-      if (client.pending_connections >= client.queries.size()) {
+      auto r_new_connection =
+          client.queries.get_new_connection(client.pending_connections, race_count, need_spare_connections);
+      if (r_new_connection.is_error()) {
         return;
       }
+      new_connection = r_new_connection.move_as_ok();
     }
 
-    bool act_as_if_online = online_flag_ || is_logging_out_;
     // Check flood
     auto &flood_control = act_as_if_online ? client.flood_control_online : client.flood_control;
     auto wakeup_at = max(flood_control.get_wakeup_at(), client.mtproto_error_flood_control.get_wakeup_at());
@@ -1010,15 +1093,18 @@ void ConnectionCreator::client_loop(ClientInfo &client) {
     if (wakeup_at > Time::now()) {
       return client_set_timeout_at(client, wakeup_at);
     }
-    client.sanity_flood_control.add_event(Time::now());
-    if (!act_as_if_online) {
-      client.backoff.add_event(static_cast<int32>(Time::now()));
-    }
 
     // Create new RawConnection
     // sync part
     FindConnectionExtra extra;
-    auto r_socket_fd = find_connection(proxy, proxy_ip_address_, client.dc_id, client.allow_media_only, extra);
+    auto r_socket_fd = find_connection(proxy, proxy_ip_address_, client.dc_id, client.allow_media_only,
+                                       new_connection.race_index, extra);
+    if (r_socket_fd.is_error() && new_connection.race_index != 0) {
+      // there are no more different IP addresses to race with; use the best one
+      VLOG(connections) << "Can't race to a different IP address: " << r_socket_fd.error();
+      extra = FindConnectionExtra();
+      r_socket_fd = find_connection(proxy, proxy_ip_address_, client.dc_id, client.allow_media_only, 0, extra);
+    }
     check_mode |= extra.check_mode;
     if (r_socket_fd.is_error()) {
       LOG(WARNING) << extra.debug_str << ": " << r_socket_fd.error();
@@ -1030,6 +1116,10 @@ void ConnectionCreator::client_loop(ClientInfo &client) {
 
     // Events with failed socket creation are ignored
     flood_control.add_event(Time::now());
+    client.sanity_flood_control.add_event(Time::now());
+    if (!act_as_if_online) {
+      client.backoff.add_event(static_cast<int32>(Time::now()));
+    }
 
     auto socket_fd = r_socket_fd.move_as_ok();
 #if !TD_DARWIN_WATCH_OS
@@ -1042,8 +1132,11 @@ void ConnectionCreator::client_loop(ClientInfo &client) {
     }
 #endif
 
+    // spare connections are always pinged before use
+    bool need_check = check_mode || new_connection.query_id == 0;
     client.pending_connections++;
-    if (check_mode) {
+    client.queries.on_connection_started(new_connection);
+    if (need_check) {
       if (extra.stat) {
         extra.stat->on_check();
       }
@@ -1051,11 +1144,12 @@ void ConnectionCreator::client_loop(ClientInfo &client) {
     }
 
     auto promise = PromiseCreator::lambda(
-        [actor_id = actor_id(this), check_mode, transport_type = extra.transport_type, hash = client.hash,
-         debug_str = extra.debug_str,
+        [actor_id = actor_id(this), check_mode = need_check, transport_type = extra.transport_type, hash = client.hash,
+         new_connection, debug_str = extra.debug_str,
          network_generation = network_generation_](Result<ConnectionData> r_connection_data) mutable {
           send_closure(actor_id, &ConnectionCreator::client_create_raw_connection, std::move(r_connection_data),
-                       check_mode, std::move(transport_type), hash, std::move(debug_str), network_generation);
+                       check_mode, std::move(transport_type), hash, new_connection, std::move(debug_str),
+                       network_generation);
         });
 
     auto stats_callback =
@@ -1073,6 +1167,7 @@ void ConnectionCreator::client_loop(ClientInfo &client) {
 
 void ConnectionCreator::client_create_raw_connection(Result<ConnectionData> r_connection_data, bool check_mode,
                                                      mtproto::TransportType transport_type, uint32 hash,
+                                                     detail::ConnectionQueries::NewConnection new_connection,
                                                      string debug_str, uint32 network_generation) {
   unique_ptr<mtproto::AuthData> auth_data;
   uint64 auth_data_generation{0};
@@ -1088,7 +1183,8 @@ void ConnectionCreator::client_create_raw_connection(Result<ConnectionData> r_co
       auth_data->set_session_id(session_id);
     }
   }
-  auto promise = PromiseCreator::lambda([actor_id = actor_id(this), hash, check_mode, auth_data_generation, session_id,
+  auto promise = PromiseCreator::lambda([actor_id = actor_id(this), hash, new_connection, check_mode,
+                                         auth_data_generation, session_id,
                                          debug_str](Result<unique_ptr<mtproto::RawConnection>> result) mutable {
     if (result.is_ok()) {
       VLOG(connections) << "Ready connection (" << (check_mode ? "" : "un") << "checked) " << result.ok().get() << ' '
@@ -1097,8 +1193,8 @@ void ConnectionCreator::client_create_raw_connection(Result<ConnectionData> r_co
       VLOG(connections) << "Failed connection (" << (check_mode ? "" : "un") << "checked) " << result.error() << ' '
                         << debug_str;
     }
-    send_closure(actor_id, &ConnectionCreator::client_add_connection, hash, std::move(result), check_mode,
-                 auth_data_generation, session_id);
+    send_closure(actor_id, &ConnectionCreator::client_add_connection, hash, new_connection, std::move(result),
+                 check_mode, auth_data_generation, session_id);
   });
 
   if (r_connection_data.is_error()) {
@@ -1133,12 +1229,14 @@ void ConnectionCreator::client_set_timeout_at(ClientInfo &client, double wakeup_
                     << wakeup_at - Time::now_cached();
 }
 
-void ConnectionCreator::client_add_connection(uint32 hash, Result<unique_ptr<mtproto::RawConnection>> r_raw_connection,
+void ConnectionCreator::client_add_connection(uint32 hash, detail::ConnectionQueries::NewConnection new_connection,
+                                              Result<unique_ptr<mtproto::RawConnection>> r_raw_connection,
                                               bool check_flag, uint64 auth_data_generation, uint64 session_id) {
   auto &client = clients_[hash];
   client.add_session_id(session_id);
   CHECK(client.pending_connections > 0);
   client.pending_connections--;
+  client.queries.on_connection_finished(new_connection);
   if (check_flag) {
     CHECK(client.checking_connections > 0);
     client.checking_connections--;
@@ -1147,6 +1245,10 @@ void ConnectionCreator::client_add_connection(uint32 hash, Result<unique_ptr<mtp
     VLOG(connections) << "Add ready connection " << r_raw_connection.ok().get() << " for "
                       << tag("client", format::as_hex(hash));
     client.backoff.clear();
+    if (r_raw_connection.ok()->extra().extra == network_generation_ &&
+        client.connected_network_generation != network_generation_) {
+      on_first_connection_after_network_change(client);
+    }
     client.ready_connections.emplace_back(r_raw_connection.move_as_ok(), Time::now_cached());
   } else {
     if (r_raw_connection.error().code() == -404 && client.auth_data &&
@@ -1159,6 +1261,22 @@ void ConnectionCreator::client_add_connection(uint32 hash, Result<unique_ptr<mtp
   client_loop(client);
 }
 
+void ConnectionCreator::on_first_connection_after_network_change(ClientInfo &client) {
+  client.connected_network_generation = network_generation_;
+  if (network_changed_at_ == 0.0) {
+    return;
+  }
+
+  auto delay = Time::now() - network_changed_at_;
+  first_connection_delay_count_++;
+  first_connection_delay_sum_ += delay;
+  first_connection_delay_max_ = max(first_connection_delay_max_, delay);
+  LOG(INFO) << "Receive first connection for " << tag("client", format::as_hex(client.hash)) << " to " << client.dc_id
+            << " in " << format::as_time(delay) << " after network change; average delay is "
+            << format::as_time(first_connection_delay_sum_ / static_cast<double>(first_connection_delay_count_))
+            << ", maximum delay is " << format::as_time(first_connection_delay_max_);
+}
+
 void ConnectionCreator::client_wakeup(uint32 hash) {
   VLOG(connections) << tag("hash", format::as_hex(hash)) << " wakeup";
   G()->save_server_time();
@@ -45,6 +45,41 @@ namespace td {
 
 namespace detail {
 class StatsCallback;
+
+// waiting requests for a connection; several racing connections can be created for each request
+class ConnectionQueries {
+ public:
+  struct NewConnection {
+    uint64 query_id = 0;  // 0 for a spare connection
+    size_t race_index = 0;
+  };
+
+  void add_query(Promise<unique_ptr<mtproto::RawConnection>> promise);
+
+  bool empty() const {
+    return queries_.empty();
+  }
+
+  // drops canceled queries and sends ready connections to the other queries in order
+  void send_ready_connections(vector<std::pair<unique_ptr<mtproto::RawConnection>, double>> &ready_connections);
+
+  // returns the next connection to create or an error if there are enough pending connections
+  Result<NewConnection> get_new_connection(size_t pending_connection_count, size_t race_count,
+                                           size_t spare_connection_count) const;
+
+  void on_connection_started(NewConnection connection);
+
+  void on_connection_finished(NewConnection connection);
+
+ private:
+  struct Query {
+    Promise<unique_ptr<mtproto::RawConnection>> promise;
+    uint64 id = 0;
+    uint32 pending_race_mask = 0;  // race indexes of pending connections created for the query
+  };
+  vector<Query> queries_;
+  uint64 max_query_id_ = 0;
+};
 }  // namespace detail
 
 class GetHostByNameActor;
@@ -87,6 +122,7 @@ class ConnectionCreator final : public NetQueryCallback {
   DcOptionsSet dc_options_set_;
   bool network_flag_ = false;
   uint32 network_generation_ = 0;
+  double network_changed_at_ = 0.0;
   bool online_flag_ = false;
   bool is_logging_out_ = false;
   bool is_inited_ = false;
@@ -140,9 +176,10 @@ class ConnectionCreator final : public NetQueryCallback {
     size_t pending_connections{0};
     size_t checking_connections{0};
     std::vector<std::pair<unique_ptr<mtproto::RawConnection>, double>> ready_connections;
-    std::vector<Promise<unique_ptr<mtproto::RawConnection>>> queries;
+    detail::ConnectionQueries queries;
 
     static constexpr double READY_CONNECTIONS_TIMEOUT = 10;
+    static constexpr double SPARE_CONNECTIONS_TIMEOUT = 50;
 
     bool inited{false};
     uint32 hash{0};
@@ -152,9 +189,15 @@ class ConnectionCreator final : public NetQueryCallback {
     std::set<uint64> session_ids_;
     unique_ptr<mtproto::AuthData> auth_data;
     uint64 auth_data_generation{0};
+    uint32 connected_network_generation{0};
   };
   std::map<uint32, ClientInfo> clients_;
 
+  // time from a network change to the first ready connection of a client
+  size_t first_connection_delay_count_ = 0;
+  double first_connection_delay_sum_ = 0.0;
+  double first_connection_delay_max_ = 0.0;
+
   std::shared_ptr<NetStatsCallback> media_net_stats_callback_;
   std::shared_ptr<NetStatsCallback> common_net_stats_callback_;
 
@@ -227,11 +270,14 @@ class ConnectionCreator final : public NetQueryCallback {
   void client_wakeup(uint32 hash);
   void client_loop(ClientInfo &client);
   void client_create_raw_connection(Result<ConnectionData> r_connection_data, bool check_mode,
-                                    mtproto::TransportType transport_type, uint32 hash, string debug_str,
+                                    mtproto::TransportType transport_type, uint32 hash,
+                                    detail::ConnectionQueries::NewConnection new_connection, string debug_str,
                                     uint32 network_generation);
-  void client_add_connection(uint32 hash, Result<unique_ptr<mtproto::RawConnection>> r_raw_connection, bool check_flag,
+  void client_add_connection(uint32 hash, detail::ConnectionQueries::NewConnection new_connection,
+                             Result<unique_ptr<mtproto::RawConnection>> r_raw_connection, bool check_flag,
                              uint64 auth_data_generation, uint64 session_id);
   void client_set_timeout_at(ClientInfo &client, double wakeup_at);
+  void on_first_connection_after_network_change(ClientInfo &client);
 
   void on_proxy_resolved(Result<IPAddress> ip_address, bool dummy);
 
@@ -244,7 +290,7 @@ class ConnectionCreator final : public NetQueryCallback {
     bool check_mode{false};
   };
   Result<SocketFd> find_connection(const Proxy &proxy, const IPAddress &proxy_ip_address, DcId dc_id,
-                                   bool allow_media_only, FindConnectionExtra &extra);
+                                   bool allow_media_only, size_t option_index, FindConnectionExtra &extra);
 
   static DcOptions get_default_dc_options(bool is_test);
 
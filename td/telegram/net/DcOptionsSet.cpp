@@ -137,7 +137,8 @@ vector<DcOptionsSet::ConnectionInfo> DcOptionsSet::find_all_connections(DcId dc_
 }
 
 Result<DcOptionsSet::ConnectionInfo> DcOptionsSet::find_connection(DcId dc_id, bool allow_media_only, bool use_static,
-                                                                   bool prefer_ipv6, bool only_http) {
+                                                                   bool prefer_ipv6, bool only_http,
+                                                                   size_t option_index) {
   auto options = find_all_connections(dc_id, allow_media_only, use_static, prefer_ipv6, only_http);
 
   if (options.empty()) {
@@ -151,7 +152,7 @@ Result<DcOptionsSet::ConnectionInfo> DcOptionsSet::find_connection(DcId dc_id, b
                          return a_option.stat->error_at > b_option.stat->error_at;
                        })->stat->error_at;
 
-  auto result = *std::min_element(options.begin(), options.end(), [](const auto &a_option, const auto &b_option) {
+  std::stable_sort(options.begin(), options.end(), [](const auto &a_option, const auto &b_option) {
     auto &a = *a_option.stat;
     auto &b = *b_option.stat;
     auto a_state = a.state();
@@ -169,8 +170,21 @@ Result<DcOptionsSet::ConnectionInfo> DcOptionsSet::find_connection(DcId dc_id, b
     }
     return a_option.order < b_option.order;
   });
-  result.should_check = !result.stat->is_ok() || result.use_http || last_error_at > Time::now_cached() - 10;
-  return result;
+
+  // skip options with already used IP addresses
+  vector<IPAddress> ip_addresses;
+  for (auto &result : options) {
+    auto ip_address = result.option->get_ip_address();
+    if (td::contains(ip_addresses, ip_address)) {
+      continue;
+    }
+    if (ip_addresses.size() == option_index) {
+      result.should_check = !result.stat->is_ok() || result.use_http || last_error_at > Time::now_cached() - 10;
+      return result;
+    }
+    ip_addresses.push_back(std::move(ip_address));
+  }
+  return Status::Error(PSLICE() << "There are only " << ip_addresses.size() << " different IP addresses for " << dc_id);
 }
 
 void DcOptionsSet::reset() {
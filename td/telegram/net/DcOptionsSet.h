@@ -64,8 +64,9 @@ class DcOptionsSet {
   vector<ConnectionInfo> find_all_connections(DcId dc_id, bool allow_media_only, bool use_static, bool prefer_ipv6,
                                               bool only_http);
 
+  // returns the best connection if option_index == 0, or the next best connections to other IP addresses otherwise
   Result<ConnectionInfo> find_connection(DcId dc_id, bool allow_media_only, bool use_static, bool prefer_ipv6,
-                                         bool only_http);
+                                         bool only_http, size_t option_index = 0);
   void reset();
 
  private:
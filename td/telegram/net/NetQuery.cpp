@@ -51,11 +51,13 @@ NetQuery::NetQuery(uint64 id, BufferSlice &&query, DcId dc_id, Type type, AuthFl
   td::unique(chain_ids_);
 
   auto &data = get_data_unsafe();
-  data.my_id_ = G()->get_option_integer("my_id");
   data.start_timestamp_ = data.state_timestamp_ = Time::now();
   LOG(INFO) << *this;
   if (stats) {
+    // the identifier is used only in the list of active queries, which is maintained by NetQueryStats
+    data.my_id_ = G()->get_option_integer("my_id");
     nq_counter_ = stats->register_query(this);
+    stats_ = stats;
   }
 }
 
@@ -112,6 +114,31 @@ void NetQuery::on_net_read(size_t size) {
   }
 }
 
+void NetQuery::on_net_answer(int32 dc_id, double sent_at, double ping_rtt) {
+  if (stats_ == nullptr) {
+    return;
+  }
+  double start_timestamp;
+  int32 resend_count;
+  {
+    auto guard = lock();
+    const auto &data = get_data_unsafe();
+    start_timestamp = data.start_timestamp_;
+    resend_count = data.resend_count_;
+  }
+  auto round_trip_time = Time::now() - sent_at;
+  // the server time is estimated as the round trip time without network latency measured by pings
+  auto server_time = ping_rtt > 0 ? max(round_trip_time - ping_rtt, 0.0) : -1.0;
+  stats_->on_query_answered(dc_id, tl_constructor_, sent_at - start_timestamp, round_trip_time, server_time,
+                            resend_count);
+}
+
+void NetQuery::on_coalesced(int32 dc_id) {
+  if (stats_ != nullptr) {
+    stats_->on_query_coalesced(dc_id, tl_constructor_);
+  }
+}
+
 int32 NetQuery::tl_magic(const BufferSlice &buffer_slice) {
   auto slice = buffer_slice.as_slice();
   if (slice.size() < 4) {
@@ -117,6 +117,12 @@ class NetQuery final : public TsListNode<NetQueryDebug> {
   void on_net_write(size_t size);
   void on_net_read(size_t size);
 
+  // must be called by Session when an answer to the query is received
+  void on_net_answer(int32 dc_id, double sent_at, double ping_rtt);
+
+  // must be called when the query will receive the result of an identical query instead of being sent
+  void on_coalesced(int32 dc_id);
+
   void set_error(Status status, string source = string());
 
   void set_error_resend() {
@@ -193,6 +199,7 @@ class NetQuery final : public TsListNode<NetQueryDebug> {
 
   void stop_track() {
     nq_counter_ = NetQueryCounter();
+    stats_ = nullptr;
     remove();
   }
 
@@ -252,6 +259,7 @@ class NetQuery final : public TsListNode<NetQueryDebug> {
   DcId dc_id_;
 
   NetQueryCounter nq_counter_;
+  NetQueryStats *stats_ = nullptr;
   Status status_;
   uint64 id_ = 0;
   BufferSlice query_;
@@ -0,0 +1,145 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/net/NetQueryCoalescer.h"
+
+#include "td/telegram/telegram_api.h"
+
+#include "td/utils/algorithm.h"
+#include "td/utils/logging.h"
+#include "td/utils/SliceBuilder.h"
+
+#include <utility>
+
+namespace td {
+
+bool NetQueryCoalescer::can_be_coalesced(const NetQuery &net_query) {
+  if (net_query.type() != NetQuery::Type::Common || !net_query.get_chain_ids().empty() ||
+      !net_query.invoke_after().empty() || net_query.has_verification_prefix() || net_query.quick_ack_promise_ ||
+      !net_query.cancel_slot_.empty()) {
+    return false;
+  }
+  switch (net_query.tl_constructor()) {
+    case telegram_api::channels_getChannels::ID:
+    case telegram_api::channels_getFullChannel::ID:
+    case telegram_api::channels_getMessages::ID:
+    case telegram_api::messages_getChats::ID:
+    case telegram_api::messages_getFullChat::ID:
+    case telegram_api::messages_getMessages::ID:
+    case telegram_api::messages_getStickerSet::ID:
+    case telegram_api::users_getFullUser::ID:
+    case telegram_api::users_getUsers::ID:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool NetQueryCoalescer::try_coalesce(NetQueryPtr &net_query, DcId dc_id) {
+  if (!can_be_coalesced(*net_query)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (in_flight_query_keys_.count(net_query->id()) != 0) {
+    // the query is resent
+    return false;
+  }
+
+  auto query = net_query->query().as_slice();
+  string key = PSTRING() << dc_id.get_raw_id() << (net_query->auth_flag() == NetQuery::AuthFlag::On ? 'a' : 'n');
+  key.append(query.data(), query.size());
+
+  auto &in_flight_query = in_flight_queries_[key];
+  if (in_flight_query.query_id_ == 0) {
+    in_flight_query.query_id_ = net_query->id();
+    in_flight_query_keys_.emplace(net_query->id(), std::move(key));
+    return false;
+  }
+
+  if (net_query->update_is_ready()) {
+    // the query was canceled; it will be returned by Session
+    return false;
+  }
+
+  net_query->on_coalesced(dc_id.get_raw_id());
+  net_query->debug("wait for an identical query");
+  waiting_query_count_++;
+  in_flight_query.waiting_queries_.push_back(std::move(net_query));
+  return true;
+}
+
+vector<NetQueryPtr> NetQueryCoalescer::on_query_ready(const NetQueryPtr &net_query) {
+  vector<NetQueryPtr> waiting_queries;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (in_flight_query_keys_.empty()) {
+      return {};
+    }
+    auto key_it = in_flight_query_keys_.find(net_query->id());
+    if (key_it == in_flight_query_keys_.end()) {
+      return {};
+    }
+    auto it = in_flight_queries_.find(key_it->second);
+    CHECK(it != in_flight_queries_.end());
+    waiting_queries = std::move(it->second.waiting_queries_);
+    in_flight_queries_.erase(it);
+    in_flight_query_keys_.erase(key_it);
+    waiting_query_count_ -= waiting_queries.size();
+  }
+
+  for (auto &query : waiting_queries) {
+    if (query->update_is_ready()) {
+      // the query was canceled
+      continue;
+    }
+    if (net_query->is_ok()) {
+      query->set_ok(net_query->ok().copy());
+    } else if (net_query->error().code() != NetQuery::Canceled) {
+      query->set_error(net_query->error().clone());
+    }
+    // if the original query was canceled, then waiting queries must be sent again
+  }
+  return waiting_queries;
+}
+
+vector<NetQueryPtr> NetQueryCoalescer::get_canceled_queries() {
+  vector<NetQueryPtr> result;
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (waiting_query_count_ == 0) {
+    return result;
+  }
+  for (auto &it : in_flight_queries_) {
+    auto &waiting_queries = it.second.waiting_queries_;
+    for (auto &query : waiting_queries) {
+      if (query->update_is_ready()) {
+        result.push_back(std::move(query));
+      }
+    }
+    td::remove_if(waiting_queries, [](const NetQueryPtr &query) { return query.empty(); });
+  }
+  waiting_query_count_ -= result.size();
+  return result;
+}
+
+bool NetQueryCoalescer::has_waiting_queries() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return waiting_query_count_ != 0;
+}
+
+vector<NetQueryPtr> NetQueryCoalescer::clear() {
+  vector<NetQueryPtr> result;
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (auto &it : in_flight_queries_) {
+    append(result, std::move(it.second.waiting_queries_));
+  }
+  in_flight_queries_.clear();
+  in_flight_query_keys_.clear();
+  waiting_query_count_ = 0;
+  return result;
+}
+
+}  // namespace td
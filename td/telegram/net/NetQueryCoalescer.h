@@ -0,0 +1,55 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/telegram/net/DcId.h"
+#include "td/telegram/net/NetQuery.h"
+
+#include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
+
+#include <mutex>
+
+namespace td {
+
+// Merges identical concurrent read-only queries, so that only one of them is sent to the server
+// and all others receive a copy of its result. Thread-safe.
+// Waiting queries can be canceled only through their cancellation token, because their cancellation slots
+// are owned by the callers and can't be used from other threads.
+class NetQueryCoalescer {
+ public:
+  // returns true if the query was taken to wait for the result of an identical query sent to the same DC
+  bool try_coalesce(NetQueryPtr &net_query, DcId dc_id);
+
+  // must be called for every ready query before it is returned to the caller
+  // returns queries, which waited for the query; ready queries must be returned to their callers,
+  // others must be dispatched again
+  vector<NetQueryPtr> on_query_ready(const NetQueryPtr &net_query);
+
+  // returns all canceled waiting queries; they must be returned to their callers
+  vector<NetQueryPtr> get_canceled_queries();
+
+  bool has_waiting_queries();
+
+  // returns all waiting queries
+  vector<NetQueryPtr> clear();
+
+ private:
+  struct InFlightQuery {
+    uint64 query_id_ = 0;
+    vector<NetQueryPtr> waiting_queries_;
+  };
+
+  std::mutex mutex_;
+  FlatHashMap<string, InFlightQuery> in_flight_queries_;
+  FlatHashMap<uint64, string> in_flight_query_keys_;
+  size_t waiting_query_count_ = 0;
+
+  static bool can_be_coalesced(const NetQuery &net_query);
+};
+
+}  // namespace td
@@ -19,6 +19,7 @@
 #include "td/utils/logging.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Storer.h"
+#include "td/utils/Time.h"
 
 namespace td {
 
@@ -64,6 +65,7 @@ NetQueryPtr NetQueryCreator::create(uint64 id, const telegram_api::object_ptr<te
   size_t min_gzipped_size = 128;
   int32 tl_constructor = function.get_id();
   int32 total_timeout_limit = 60;
+  bool is_bot = false;
 
   if (Scheduler::instance() != nullptr && current_scheduler_id_ == Scheduler::instance()->sched_id() &&
       !G()->close_flag()) {
@@ -71,6 +73,7 @@ NetQueryPtr NetQueryCreator::create(uint64 id, const telegram_api::object_ptr<te
     if (!td.empty()) {
       auto auth_manager = td.get_actor_unsafe()->auth_manager_.get();
       if (auth_manager != nullptr && auth_manager->is_bot()) {
+        is_bot = true;
         total_timeout_limit = 8;
         min_gzipped_size = 1024;
       }
@@ -82,29 +85,79 @@ NetQueryPtr NetQueryCreator::create(uint64 id, const telegram_api::object_ptr<te
     }
   }
 
-  auto gzip_flag = slice.size() < min_gzipped_size ? NetQuery::GzipFlag::Off : NetQuery::GzipFlag::On;
+  auto gzip_flag = NetQuery::GzipFlag::Off;
+  if (slice.size() >= min_gzipped_size && try_compress(slice, tl_constructor, is_bot)) {
+    gzip_flag = NetQuery::GzipFlag::On;
+  }
+
+  auto query = object_pool_.create(id, std::move(slice), dc_id, type, auth_flag, gzip_flag, tl_constructor,
+                                   total_timeout_limit, net_query_stats_.get(), std::move(chain_ids));
+  query->set_cancellation_token(query.generation());
+  return query;
+}
+
+int NetQueryCreator::get_compression_level(size_t size, bool is_bot, bool is_over_budget) {
+  if (is_over_budget) {
+    return 1;
+  }
+  // big queries and queries of bots, which are sent much more often, are compressed faster
+  if (size >= (1 << 18)) {
+    return 1;
+  }
+  if (size >= (1 << 16) || is_bot) {
+    return 4;
+  }
+  return 6;
+}
+
+bool NetQueryCreator::is_compression_over_budget(double now) {
+  // at most 5% of the scheduler time can be spent on compression at levels above the fastest one
+  constexpr double BUDGET_WINDOW = 1.0;
+  constexpr double MAX_COMPRESSION_TIME = 0.05 * BUDGET_WINDOW;
+  if (now >= compression_window_start_time_ + BUDGET_WINDOW || now < compression_window_start_time_) {
+    compression_window_start_time_ = now;
+    compression_window_time_ = 0.0;
+  }
+  return compression_window_time_ >= MAX_COMPRESSION_TIME;
+}
+
+bool NetQueryCreator::try_compress(BufferSlice &slice, int32 tl_constructor, bool is_bot) {
+  constexpr int32 MAX_SKIPPED_COUNT = 256;
+  auto &stats = compression_stats_[tl_constructor];
+  if (stats.skipped_count_ > 0) {
+    stats.skipped_count_--;
+    return false;
+  }
+
+  auto on_compression_failed = [&stats] {
+    stats.failed_count_++;
+    if (stats.failed_count_ >= 3) {
+      // queries with the constructor are likely to be incompressible, so don't waste time on them for a while
+      stats.skipped_count_ = min(stats.failed_count_ * 8, MAX_SKIPPED_COUNT);
+    }
+    return false;
+  };
+
   if (slice.size() >= 16384) {
     // test compression ratio for the middle part
     // if it is less than 0.9, then try to compress the whole request
-    size_t TESTED_SIZE = 1024;
-    BufferSlice compressed_part = gzencode(slice.as_slice().substr((slice.size() - TESTED_SIZE) / 2, TESTED_SIZE), 0.9);
+    const size_t TESTED_SIZE = 1024;
+    auto compressed_part = gzencode(slice.as_slice().substr((slice.size() - TESTED_SIZE) / 2, TESTED_SIZE), 0.9, 1);
     if (compressed_part.empty()) {
-      gzip_flag = NetQuery::GzipFlag::Off;
-    }
-  }
-  if (gzip_flag == NetQuery::GzipFlag::On) {
-    BufferSlice compressed = gzencode(slice.as_slice(), 0.9);
-    if (compressed.empty()) {
-      gzip_flag = NetQuery::GzipFlag::Off;
-    } else {
-      slice = std::move(compressed);
+      return on_compression_failed();
     }
   }
 
-  auto query = object_pool_.create(id, std::move(slice), dc_id, type, auth_flag, gzip_flag, tl_constructor,
-                                   total_timeout_limit, net_query_stats_.get(), std::move(chain_ids));
-  query->set_cancellation_token(query.generation());
-  return query;
+  auto start_time = Time::now();
+  auto level = get_compression_level(slice.size(), is_bot, is_compression_over_budget(start_time));
+  auto compressed = gzencode(slice.as_slice(), 0.9, level);
+  compression_window_time_ += Time::now() - start_time;
+  if (compressed.empty()) {
+    return on_compression_failed();
+  }
+  stats.failed_count_ = 0;
+  slice = std::move(compressed);
+  return true;
 }
 
 }  // namespace td
@@ -12,7 +12,9 @@
 #include "td/telegram/net/NetQueryStats.h"
 #include "td/telegram/UniqueId.h"
 
+#include "td/utils/buffer.h"
 #include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
 #include "td/utils/ObjectPool.h"
 
 #include <memory>
@@ -47,9 +49,26 @@ class NetQueryCreator {
                      NetQuery::Type type, NetQuery::AuthFlag auth_flag);
 
  private:
+  // compression results for queries with the same constructor
+  struct CompressionStats {
+    int32 failed_count_ = 0;   // number of consecutive failed compression attempts
+    int32 skipped_count_ = 0;  // number of queries to be sent without compression attempt
+  };
+
   std::shared_ptr<NetQueryStats> net_query_stats_;
   ObjectPool<NetQuery> object_pool_;
   int32 current_scheduler_id_ = 0;
+  FlatHashMap<int32, CompressionStats> compression_stats_;
+
+  // time spent on compression during the current budget window
+  double compression_window_start_time_ = 0.0;
+  double compression_window_time_ = 0.0;
+
+  static int get_compression_level(size_t size, bool is_bot, bool is_over_budget);
+
+  bool is_compression_over_budget(double now);
+
+  bool try_compress(BufferSlice &slice, int32 tl_constructor, bool is_bot);
 };
 
 }  // namespace td
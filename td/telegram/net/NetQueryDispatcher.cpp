@@ -34,7 +34,52 @@ namespace td {
 
 #define TD_TEST_VERIFICATION 0
 
+// periodically returns canceled coalesced queries while there are waiting queries
+class CoalescedQueryCancellationWatcher final : public Actor {
+ public:
+  explicit CoalescedQueryCancellationWatcher(ActorShared<> parent) : parent_(std::move(parent)) {
+  }
+
+  void on_query_coalesced() {
+    if (!has_timeout()) {
+      set_timeout_in(CHECK_PERIOD);
+    }
+  }
+
+ private:
+  static constexpr double CHECK_PERIOD = 0.5;
+
+  ActorShared<> parent_;
+
+  void timeout_expired() final {
+    if (G()->net_query_dispatcher().return_canceled_coalesced_queries()) {
+      set_timeout_in(CHECK_PERIOD);
+    }
+  }
+};
+
 void NetQueryDispatcher::complete_net_query(NetQueryPtr net_query) {
+  // complete_net_query is called by check_stop_flag while mutex_ is locked. Re-dispatching a waiting query from
+  // there would lock mutex_ again. It is safe only because such queries are aborted with request_aborted_error,
+  // which isn't Canceled, so all their waiting queries receive the same error and are returned, not re-dispatched.
+  for (auto &waiting_query : query_coalescer_.on_query_ready(net_query)) {
+    if (waiting_query->is_ready()) {
+      return_net_query(std::move(waiting_query));
+    } else {
+      dispatch(std::move(waiting_query));
+    }
+  }
+  return_net_query(std::move(net_query));
+}
+
+bool NetQueryDispatcher::return_canceled_coalesced_queries() {
+  for (auto &net_query : query_coalescer_.get_canceled_queries()) {
+    return_net_query(std::move(net_query));
+  }
+  return query_coalescer_.has_waiting_queries();
+}
+
+void NetQueryDispatcher::return_net_query(NetQueryPtr net_query) {
   auto callback = net_query->move_callback();
   if (callback.empty()) {
     net_query->debug("sent to td (no callback)");
@@ -45,7 +90,7 @@ void NetQueryDispatcher::complete_net_query(NetQueryPtr net_query) {
   }
 }
 
-bool NetQueryDispatcher::check_stop_flag(NetQueryPtr &net_query) const {
+bool NetQueryDispatcher::check_stop_flag(NetQueryPtr &net_query) {
   if (stop_flag_.load(std::memory_order_relaxed)) {
     net_query->set_error(Global::request_aborted_error());
     complete_net_query(std::move(net_query));
@@ -143,6 +188,11 @@ void NetQueryDispatcher::dispatch(NetQueryPtr net_query) {
     net_query->dispatch_ttl_--;
   }
 
+  if (query_coalescer_.try_coalesce(net_query, dest_dc_id)) {
+    send_closure(coalesced_query_cancellation_watcher_id_, &CoalescedQueryCancellationWatcher::on_query_coalesced);
+    return;
+  }
+
   auto dc_pos = static_cast<size_t>(dest_dc_id.get_raw_id() - 1);
   CHECK(dc_pos < dcs_.size());
   std::lock_guard<std::mutex> guard(mutex_);
@@ -266,9 +316,17 @@ void NetQueryDispatcher::stop() {
     dc.download_small_session_.reset();
   }
   public_rsa_key_watchdog_.reset();
+  coalesced_query_cancellation_watcher_.reset();
   dc_auth_manager_.reset();
   sequence_dispatcher_.reset();
   td_guard_.reset();
+
+  for (auto &net_query : query_coalescer_.clear()) {
+    if (!net_query->update_is_ready()) {
+      net_query->set_error(Global::request_aborted_error());
+    }
+    return_net_query(std::move(net_query));
+  }
 }
 
 void NetQueryDispatcher::update_session_count() {
@@ -358,6 +416,9 @@ NetQueryDispatcher::NetQueryDispatcher(const std::function<ActorShared<>()> &cre
       create_actor_on_scheduler<DcAuthManager>("DcAuthManager", get_main_session_scheduler_id(), create_reference());
   public_rsa_key_watchdog_ = create_actor<PublicRsaKeyWatchdog>("PublicRsaKeyWatchdog", create_reference());
   sequence_dispatcher_ = MultiSequenceDispatcher::create("MultiSequenceDispatcher");
+  coalesced_query_cancellation_watcher_ =
+      create_actor<CoalescedQueryCancellationWatcher>("CoalescedQueryCancellationWatcher", create_reference());
+  coalesced_query_cancellation_watcher_id_ = coalesced_query_cancellation_watcher_.get();
 
   td_guard_ = create_shared_lambda_guard([actor = create_reference()] {});
 }
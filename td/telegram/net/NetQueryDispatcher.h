@@ -8,6 +8,7 @@
 
 #include "td/telegram/net/DcId.h"
 #include "td/telegram/net/NetQuery.h"
+#include "td/telegram/net/NetQueryCoalescer.h"
 
 #include "td/actor/actor.h"
 
@@ -24,6 +25,7 @@
 
 namespace td {
 
+class CoalescedQueryCancellationWatcher;
 class DcAuthManager;
 class MultiSequenceDispatcher;
 class NetQueryDelayer;
@@ -59,6 +61,9 @@ class NetQueryDispatcher {
 
   void set_verification_token(int64 verification_id, string &&token, Promise<Unit> &&promise);
 
+  // returns canceled coalesced queries to their callers; returns true if there are other waiting coalesced queries
+  bool return_canceled_coalesced_queries();
+
  private:
   std::atomic<bool> stop_flag_{false};
   bool need_destroy_auth_key_{false};
@@ -85,6 +90,9 @@ class NetQueryDispatcher {
   ActorOwn<PublicRsaKeyWatchdog> public_rsa_key_watchdog_;
   std::mutex mutex_;
   std::shared_ptr<Guard> td_guard_;
+  NetQueryCoalescer query_coalescer_;
+  ActorOwn<CoalescedQueryCancellationWatcher> coalesced_query_cancellation_watcher_;
+  ActorId<CoalescedQueryCancellationWatcher> coalesced_query_cancellation_watcher_id_;
 
   Status wait_dc_init(DcId dc_id, bool force);
   bool is_dc_inited(int32 raw_dc_id);
@@ -93,8 +101,9 @@ class NetQueryDispatcher {
   static int32 get_session_count();
   static bool get_use_pfs();
 
-  static void complete_net_query(NetQueryPtr net_query);
-  bool check_stop_flag(NetQueryPtr &net_query) const;
+  static void return_net_query(NetQueryPtr net_query);
+  void complete_net_query(NetQueryPtr net_query);
+  bool check_stop_flag(NetQueryPtr &net_query);
 
   void try_fix_migrate(NetQueryPtr &net_query);
 };
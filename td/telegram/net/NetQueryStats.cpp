@@ -8,14 +8,19 @@
 
 #include "td/telegram/net/NetQuery.h"
 
+#include "td/utils/algorithm.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Time.h"
 
+#include <algorithm>
+
 namespace td {
 
+static constexpr double LATENCY_STATISTICS_DUMP_PERIOD = 600.0;
+
 uint64 NetQueryStats::get_count() const {
   return count_.load(std::memory_order_relaxed);
 }
@@ -52,5 +57,183 @@ void NetQueryStats::dump_pending_network_queries() {
       was_gap = true;
     }
   }
+
+  for (auto &str : get_network_requests_statistics_strings()) {
+    LOG(WARNING) << str;
+  }
+}
+
+void NetQueryStats::on_query_answered(int32 dc_id, int32 tl_constructor, double queue_time, double round_trip_time,
+                                      double server_time, int32 resend_count) {
+  auto &shard = latency_stats_shards_.get();
+  std::lock_guard<std::mutex> guard(shard.mutex_);
+  auto &stats = get_query_latency_stats(shard, dc_id, tl_constructor);
+  stats.resend_count_ += resend_count;
+  stats.queue_time_.add(queue_time);
+  stats.round_trip_time_.add(round_trip_time);
+  if (server_time >= 0) {
+    stats.server_time_.add(server_time);
+  }
+}
+
+void NetQueryStats::on_query_coalesced(int32 dc_id, int32 tl_constructor) {
+  auto &shard = latency_stats_shards_.get();
+  std::lock_guard<std::mutex> guard(shard.mutex_);
+  get_query_latency_stats(shard, dc_id, tl_constructor).coalesced_count_++;
+}
+
+void NetQueryStats::dump_network_requests_statistics_if_needed() {
+  auto now = Time::now();
+  auto next_dump_time = next_latency_stats_dump_time_.load(std::memory_order_relaxed);
+  if (next_dump_time == 0.0) {
+    next_latency_stats_dump_time_.compare_exchange_strong(next_dump_time, now + LATENCY_STATISTICS_DUMP_PERIOD);
+    return;
+  }
+  // the statistics can be shared between several clients, but only one of them must dump it
+  if (now < next_dump_time ||
+      !next_latency_stats_dump_time_.compare_exchange_strong(next_dump_time, now + LATENCY_STATISTICS_DUMP_PERIOD)) {
+    return;
+  }
+  for (auto &str : get_network_requests_statistics_strings()) {
+    LOG(WARNING) << str;
+  }
+}
+
+void NetQueryStats::on_session_loads_changed(int32 dc_id, const string &session_type, vector<SessionLoad> &&loads) {
+  auto key = std::make_pair(dc_id, session_type);
+  std::lock_guard<std::mutex> guard(session_loads_mutex_);
+  if (loads.empty()) {
+    session_loads_.erase(key);
+  } else {
+    session_loads_[std::move(key)] = std::move(loads);
+  }
+}
+
+uint64 NetQueryStats::get_latency_stats_key(int32 dc_id, int32 tl_constructor) {
+  return (static_cast<uint64>(static_cast<uint32>(dc_id)) << 32) | static_cast<uint32>(tl_constructor);
+}
+
+NetQueryStats::QueryLatencyStats &NetQueryStats::get_query_latency_stats(LatencyStatsShard &shard, int32 dc_id,
+                                                                         int32 tl_constructor) {
+  auto &stats = shard.latency_stats_[get_latency_stats_key(dc_id, tl_constructor)];
+  if (stats == nullptr) {
+    stats = make_unique<QueryLatencyStats>();
+    stats->dc_id_ = dc_id;
+    stats->tl_constructor_ = tl_constructor;
+  }
+  return *stats;
 }
+
+vector<NetQueryStats::QueryLatencyStats> NetQueryStats::get_latency_stats() const {
+  FlatHashMap<uint64, size_t> positions;
+  vector<QueryLatencyStats> result;
+  latency_stats_shards_.for_each([&](const LatencyStatsShard &shard) {
+    std::lock_guard<std::mutex> guard(shard.mutex_);
+    for (auto &it : shard.latency_stats_) {
+      const auto &stats = *it.second;
+      auto &position = positions[it.first];
+      if (position == 0) {
+        result.push_back(stats);
+        position = result.size();
+        continue;
+      }
+      auto &merged_stats = result[position - 1];
+      merged_stats.resend_count_ += stats.resend_count_;
+      merged_stats.coalesced_count_ += stats.coalesced_count_;
+      merged_stats.queue_time_.merge(stats.queue_time_);
+      merged_stats.round_trip_time_.merge(stats.round_trip_time_);
+      merged_stats.server_time_.merge(stats.server_time_);
+    }
+  });
+  std::sort(result.begin(), result.end(), [](const QueryLatencyStats &lhs, const QueryLatencyStats &rhs) {
+    if (lhs.dc_id_ != rhs.dc_id_) {
+      return lhs.dc_id_ < rhs.dc_id_;
+    }
+    return lhs.tl_constructor_ < rhs.tl_constructor_;
+  });
+  return result;
+}
+
+static td_api::object_ptr<td_api::latencyStatistics> get_latency_statistics_object(
+    const LatencyHistogram &histogram) {
+  return td_api::make_object<td_api::latencyStatistics>(histogram.get_average(), histogram.get_percentile(50),
+                                                        histogram.get_percentile(90), histogram.get_percentile(99),
+                                                        histogram.get_max());
+}
+
+td_api::object_ptr<td_api::networkRequestsStatistics> NetQueryStats::get_network_requests_statistics_object() const {
+  auto latency_stats = get_latency_stats();
+  auto entries = transform(latency_stats, [](const QueryLatencyStats &stats) {
+    return td_api::make_object<td_api::networkRequestStatistics>(
+        stats.dc_id_, stats.tl_constructor_, static_cast<int64>(stats.round_trip_time_.get_count()),
+        stats.resend_count_, stats.coalesced_count_, get_latency_statistics_object(stats.queue_time_),
+        get_latency_statistics_object(stats.round_trip_time_), get_latency_statistics_object(stats.server_time_));
+  });
+  vector<td_api::object_ptr<td_api::networkSessionStatistics>> sessions;
+  {
+    std::lock_guard<std::mutex> guard(session_loads_mutex_);
+    for (auto &it : session_loads_) {
+      for (size_t i = 0; i < it.second.size(); i++) {
+        const auto &load = it.second[i];
+        sessions.push_back(td_api::make_object<td_api::networkSessionStatistics>(
+            it.first.first, it.first.second, narrow_cast<int32>(i), load.sent_query_count_, load.query_count_,
+            load.bulk_query_count_, load.query_bytes_, load.query_duration_));
+      }
+    }
+  }
+  return td_api::make_object<td_api::networkRequestsStatistics>(std::move(entries), std::move(sessions));
+}
+
+vector<string> NetQueryStats::get_network_requests_statistics_strings() const {
+  vector<string> result;
+  {
+    std::lock_guard<std::mutex> guard(session_loads_mutex_);
+    for (auto &it : session_loads_) {
+      for (size_t i = 0; i < it.second.size(); i++) {
+        const auto &load = it.second[i];
+        if (load.sent_query_count_ == 0) {
+          continue;
+        }
+        result.push_back(PSTRING() << tag("DC", it.first.first) << tag("session", it.first.second) << tag("index", i)
+                                   << tag("sent queries", load.sent_query_count_)
+                                   << tag("pending queries", load.query_count_)
+                                   << tag("pending bulk queries", load.bulk_query_count_)
+                                   << tag("pending bytes", load.query_bytes_)
+                                   << tag("query duration", format::as_time(load.query_duration_)));
+      }
+    }
+  }
+
+  auto latency_stats = get_latency_stats();
+  if (latency_stats.empty()) {
+    return result;
+  }
+
+  // show request types with the worst tail latency first
+  vector<std::pair<double, size_t>> order;
+  order.reserve(latency_stats.size());
+  for (size_t i = 0; i < latency_stats.size(); i++) {
+    order.emplace_back(latency_stats[i].round_trip_time_.get_percentile(99), i);
+  }
+  std::sort(order.begin(), order.end(), [](const std::pair<double, size_t> &lhs, const std::pair<double, size_t> &rhs) {
+    return lhs.first > rhs.first;
+  });
+  result.push_back(PSTRING() << tag("network request types", latency_stats.size()));
+  for (size_t i = 0; i < order.size() && i < 20; i++) {
+    const auto &stats = latency_stats[order[i].second];
+    result.push_back(PSTRING() << tag("DC", stats.dc_id_) << tag("request", format::as_hex(stats.tl_constructor_))
+                               << tag("count", stats.round_trip_time_.get_count())
+                               << tag("resends", stats.resend_count_)
+                               << tag("coalesced", stats.coalesced_count_)
+                               << tag("queue p50", format::as_time(stats.queue_time_.get_percentile(50)))
+                               << tag("queue p99", format::as_time(stats.queue_time_.get_percentile(99)))
+                               << tag("RTT p50", format::as_time(stats.round_trip_time_.get_percentile(50)))
+                               << tag("RTT p99", format::as_time(stats.round_trip_time_.get_percentile(99)))
+                               << tag("RTT max", format::as_time(stats.round_trip_time_.get_max()))
+                               << tag("server p50", format::as_time(stats.server_time_.get_percentile(50)))
+                               << tag("server p99", format::as_time(stats.server_time_.get_percentile(99))));
+  }
+  return result;
+}
+
 }  // namespace td
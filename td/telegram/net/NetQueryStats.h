@@ -7,11 +7,18 @@
 #pragma once
 
 #include "td/telegram/net/NetQueryCounter.h"
+#include "td/telegram/td_api.h"
 
 #include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/LatencyHistogram.h"
+#include "td/utils/ThreadLocalStorage.h"
 #include "td/utils/TsList.h"
 
 #include <atomic>
+#include <map>
+#include <mutex>
+#include <utility>
 
 namespace td {
 
@@ -40,10 +47,65 @@ class NetQueryStats {
 
   void dump_pending_network_queries();
 
+  // can be called from any thread; all durations are in seconds, negative server_time means that it is unknown
+  // the statistics are collected separately for each thread, so different threads don't contend with each other
+  void on_query_answered(int32 dc_id, int32 tl_constructor, double queue_time, double round_trip_time,
+                         double server_time, int32 resend_count);
+
+  // can be called from any thread
+  void on_query_coalesced(int32 dc_id, int32 tl_constructor);
+
+  // can be called from any thread periodically; logs the statistics at most once in 10 minutes
+  void dump_network_requests_statistics_if_needed();
+
+  struct SessionLoad {
+    int64 sent_query_count_ = 0;
+    int32 query_count_ = 0;
+    int32 bulk_query_count_ = 0;
+    int64 query_bytes_ = 0;
+    double query_duration_ = 0.0;  // exponential moving average of interactive query durations; 0 if unknown
+  };
+
+  // can be called from any thread; session_type is the type of sessions of the SessionMultiProxy
+  // replaces load of all sessions of the SessionMultiProxy; forgets the sessions if the loads are empty
+  void on_session_loads_changed(int32 dc_id, const string &session_type, vector<SessionLoad> &&loads);
+
+  td_api::object_ptr<td_api::networkRequestsStatistics> get_network_requests_statistics_object() const;
+
  private:
   NetQueryCounter::Counter count_{0};
   std::atomic<bool> use_list_{true};
   TsList<NetQueryDebug> list_;
+
+  struct QueryLatencyStats {
+    int32 dc_id_ = 0;
+    int32 tl_constructor_ = 0;
+    int64 resend_count_ = 0;
+    int64 coalesced_count_ = 0;
+    LatencyHistogram queue_time_;
+    LatencyHistogram round_trip_time_;
+    LatencyHistogram server_time_;
+  };
+
+  struct LatencyStatsShard {
+    // the mutex is locked by other threads only to read the statistics
+    mutable std::mutex mutex_;
+    FlatHashMap<uint64, unique_ptr<QueryLatencyStats>> latency_stats_;
+  };
+  ThreadLocalStorage<LatencyStatsShard> latency_stats_shards_;
+
+  mutable std::mutex session_loads_mutex_;
+  std::map<std::pair<int32, string>, vector<SessionLoad>> session_loads_;
+
+  std::atomic<double> next_latency_stats_dump_time_{0.0};
+
+  static uint64 get_latency_stats_key(int32 dc_id, int32 tl_constructor);
+
+  static QueryLatencyStats &get_query_latency_stats(LatencyStatsShard &shard, int32 dc_id, int32 tl_constructor);
+
+  vector<QueryLatencyStats> get_latency_stats() const;
+
+  vector<string> get_network_requests_statistics_strings() const;
 };
 
 }  // namespace td
@@ -624,6 +624,9 @@ void Session::on_closed(Status status) {
   if (!close_flag_ && is_main_) {
     connection_token_.reset();
   }
+  const auto &packing_stats = current_info_->connection_->get_packing_stats();
+  LOG(INFO) << "Close connection after sending " << packing_stats.query_count << " queries in "
+            << packing_stats.packet_count << " packets of " << packing_stats.byte_count << " bytes";
   auto raw_connection = current_info_->connection_->move_as_raw_connection();
   Scheduler::unsubscribe_before_close(raw_connection->get_poll_info().get_pollable_fd_ref());
   raw_connection->close();
@@ -918,6 +921,7 @@ Status Session::on_message_result_ok(mtproto::MessageId message_id, BufferSlice
   cleanup_container(message_id, query_ptr);
   mark_as_known(message_id, query_ptr);
   query_ptr->net_query_->on_net_read(original_size);
+  query_ptr->net_query_->on_net_answer(raw_dc_id_, query_ptr->sent_at_, current_info_->connection_->get_ping_rtt());
   query_ptr->net_query_->set_ok(std::move(packet));
   query_ptr->net_query_->set_message_id(0);
   return_query(std::move(query_ptr->net_query_));
@@ -999,6 +1003,7 @@ void Session::on_message_result_error(mtproto::MessageId message_id, int error_c
 
   cleanup_container(message_id, query_ptr);
   mark_as_known(message_id, query_ptr);
+  query_ptr->net_query_->on_net_answer(raw_dc_id_, query_ptr->sent_at_, current_info_->connection_->get_ping_rtt());
   query_ptr->net_query_->set_error(Status::Error(error_code, message), current_info_->connection_->get_name().str());
   query_ptr->net_query_->set_message_id(0);
   return_query(std::move(query_ptr->net_query_));
@@ -1301,6 +1306,7 @@ void Session::connection_open_finish(ConnectionInfo *info,
     info->connection_->destroy_key();
   }
   info->connection_->set_online(connection_online_flag_, is_primary_);
+  info->connection_->set_query_delay(static_cast<double>(G()->get_option_integer("query_packing_delay", 1)) * 1e-3);
   info->connection_->set_name(name);
   Scheduler::subscribe(info->connection_->get_poll_info().extract_pollable_fd(this));
   info->mode_ = mode_;
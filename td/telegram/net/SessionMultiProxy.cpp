@@ -6,8 +6,13 @@
 //
 #include "td/telegram/net/SessionMultiProxy.h"
 
+#include "td/telegram/Global.h"
+#include "td/telegram/net/NetQueryStats.h"
 #include "td/telegram/net/SessionProxy.h"
+#include "td/telegram/telegram_api.h"
 
+#include "td/utils/algorithm.h"
+#include "td/utils/as.h"
 #include "td/utils/common.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
@@ -15,9 +20,25 @@
 #include "td/utils/Random.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
+#include "td/utils/Time.h"
 
 namespace td {
 
+// queries with bigger request or expected response are considered as bulk transfers
+static constexpr size_t BULK_QUERY_SIZE = 32 << 10;
+
+// every 64 KB of data in flight is considered as load of one more query
+static constexpr double QUERY_BYTES_PER_LOAD_UNIT = 65536.0;
+
+// minimum estimated query duration, which is used if query duration of the session is unknown or is too small
+static constexpr double MIN_QUERY_DURATION = 0.05;
+
+// score multiplier for interactive queries sent to a session with bulk transfers in flight and vice versa
+static constexpr double MIXED_SESSION_PENALTY = 4.0;
+
+// session loads are published to NetQueryStats at most once in the period
+static constexpr double SESSION_LOAD_PUBLISH_PERIOD = 1.0;
+
 SessionMultiProxy::~SessionMultiProxy() = default;
 
 SessionMultiProxy::SessionMultiProxy(int32 session_count, std::shared_ptr<AuthDataShared> shared_auth_data,
@@ -38,30 +59,88 @@ SessionMultiProxy::SessionMultiProxy(int32 session_count, std::shared_ptr<AuthDa
 
 void SessionMultiProxy::send(NetQueryPtr query) {
   size_t pos = 0;
+  auto size = get_query_transfer_size(*query);
+  auto is_bulk = is_bulk_query(size);
   if (query->auth_flag() == NetQuery::AuthFlag::On) {
     size_t session_rand = query->session_rand();
     if (session_rand) {
       pos = session_rand % sessions_.size();
     } else {
-      size_t equal_count = 1;
-      int min_query_count = sessions_[pos].query_count;
-      for (size_t i = 1; i < sessions_.size(); i++) {
-        if (sessions_[i].query_count < min_query_count) {
-          pos = i;
-          min_query_count = sessions_[pos].query_count;
-          equal_count = 1;
-        } else if (sessions_[i].query_count == min_query_count) {
-          equal_count++;
-          if (Random::fast_uint32() % equal_count == 0) {
-            pos = i;
-          }
+      pos = choose_session(is_bulk);
+    }
+  }
+  // query->debug(PSTRING() << get_name() << ": send to proxy #" << pos);
+  auto &session = sessions_[pos];
+  auto &query_info = session.queries[query->id()];
+  if (query_info.count == 0) {
+    query_info.size = size;
+    query_info.sent_at = Time::now();
+  } else {
+    LOG(INFO) << "Receive twice " << query;
+  }
+  query_info.count++;
+  session.query_count++;
+  session.query_bytes += static_cast<int64>(size);
+  if (is_bulk) {
+    session.bulk_query_count++;
+  }
+  session.sent_query_count++;
+  on_session_load_changed();
+  send_closure(session.proxy, &SessionProxy::send, std::move(query));
+}
+
+size_t SessionMultiProxy::get_query_transfer_size(const NetQuery &query) {
+  auto size = query.query().size();
+  switch (query.tl_constructor()) {
+    case telegram_api::upload_getFile::ID:
+    case telegram_api::upload_getCdnFile::ID:
+    case telegram_api::upload_getWebFile::ID:
+      // the last parameter of the requests is the maximum size of the returned file part
+      if (query.gzip_flag() == NetQuery::GzipFlag::Off && size >= 4) {
+        auto limit = as<int32>(query.query().as_slice().uend() - 4);
+        if (limit > 0) {
+          size += static_cast<size_t>(limit);
         }
       }
+      break;
+    default:
+      break;
+  }
+  return size;
+}
+
+bool SessionMultiProxy::is_bulk_query(size_t size) {
+  return size >= BULK_QUERY_SIZE;
+}
+
+double SessionMultiProxy::get_session_score(const SessionInfo &session, bool is_bulk) const {
+  auto load = session.query_count + static_cast<double>(session.query_bytes) / QUERY_BYTES_PER_LOAD_UNIT;
+  auto score = (load + 1.0) * max(session.query_duration, MIN_QUERY_DURATION);
+  if (!is_media_ && (session.bulk_query_count > 0) != is_bulk) {
+    // keep bulk transfers away from sessions used by interactive queries in the main DC session
+    score *= MIXED_SESSION_PENALTY;
+  }
+  return score;
+}
+
+size_t SessionMultiProxy::choose_session(bool is_bulk) const {
+  size_t pos = 0;
+  size_t equal_count = 1;
+  double min_score = get_session_score(sessions_[0], is_bulk);
+  for (size_t i = 1; i < sessions_.size(); i++) {
+    auto score = get_session_score(sessions_[i], is_bulk);
+    if (score < min_score) {
+      pos = i;
+      min_score = score;
+      equal_count = 1;
+    } else if (score == min_score) {
+      equal_count++;
+      if (Random::fast_uint32() % equal_count == 0) {
+        pos = i;
+      }
     }
   }
-  // query->debug(PSTRING() << get_name() << ": send to proxy #" << pos);
-  sessions_[pos].query_count++;
-  send_closure(sessions_[pos].proxy, &SessionProxy::send, std::move(query));
+  return pos;
 }
 
 void SessionMultiProxy::update_main_flag(bool is_main) {
@@ -126,9 +205,45 @@ void SessionMultiProxy::update_mtproto_header() {
 }
 
 void SessionMultiProxy::start_up() {
+  auto name = get_name();
+  session_type_ = name.substr(name.rfind(':') + 1).str();
   init();
 }
 
+void SessionMultiProxy::tear_down() {
+  auto net_query_stats = G()->get_net_query_stats();
+  if (net_query_stats != nullptr) {
+    net_query_stats->on_session_loads_changed(auth_data_->dc_id().get_raw_id(), session_type_, {});
+  }
+}
+
+void SessionMultiProxy::timeout_expired() {
+  publish_session_loads();
+}
+
+void SessionMultiProxy::on_session_load_changed() {
+  if (!has_timeout()) {
+    set_timeout_in(SESSION_LOAD_PUBLISH_PERIOD);
+  }
+}
+
+void SessionMultiProxy::publish_session_loads() const {
+  auto net_query_stats = G()->get_net_query_stats();
+  if (net_query_stats == nullptr) {
+    return;
+  }
+  auto loads = transform(sessions_, [](const SessionInfo &session) {
+    NetQueryStats::SessionLoad load;
+    load.sent_query_count_ = session.sent_query_count;
+    load.query_count_ = session.query_count;
+    load.bulk_query_count_ = session.bulk_query_count;
+    load.query_bytes_ = session.query_bytes;
+    load.query_duration_ = session.query_duration;
+    return load;
+  });
+  net_query_stats->on_session_loads_changed(auth_data_->dc_id().get_raw_id(), session_type_, std::move(loads));
+}
+
 bool SessionMultiProxy::get_pfs_flag() const {
   return use_pfs_ && !is_cdn_;
 }
@@ -149,8 +264,8 @@ void SessionMultiProxy::init() {
       Callback(ActorId<SessionMultiProxy> parent, uint32 generation, int32 session_id)
           : parent_(parent), generation_(generation), session_id_(session_id) {
       }
-      void on_query_finished() final {
-        send_closure(parent_, &SessionMultiProxy::on_query_finished, generation_, session_id_);
+      void on_query_finished(uint64 query_id) final {
+        send_closure(parent_, &SessionMultiProxy::on_query_finished, generation_, session_id_, query_id);
       }
 
      private:
@@ -164,16 +279,38 @@ void SessionMultiProxy::init() {
                                    session_count_ > 1 && is_primary_, is_cdn_, need_destroy_auth_key_ && i == 0);
     sessions_.push_back(std::move(info));
   }
+  on_session_load_changed();
 }
 
-void SessionMultiProxy::on_query_finished(uint32 generation, int session_id) {
+void SessionMultiProxy::on_query_finished(uint32 generation, int session_id, uint64 query_id) {
   if (generation != sessions_generation_) {
     return;
   }
   CHECK(static_cast<size_t>(session_id) < sessions_.size());
-  auto &query_count = sessions_[session_id].query_count;
-  CHECK(query_count > 0);
-  query_count--;
+  auto &session = sessions_[session_id];
+  auto it = session.queries.find(query_id);
+  if (it == session.queries.end()) {
+    LOG(ERROR) << "Receive unknown finished query " << query_id;
+    return;
+  }
+  auto query_info = it->second;
+  CHECK(query_info.count > 0);
+  if (--it->second.count == 0) {
+    session.queries.erase(it);
+  }
+
+  CHECK(session.query_count > 0);
+  session.query_count--;
+  session.query_bytes -= static_cast<int64>(query_info.size);
+  if (is_bulk_query(query_info.size)) {
+    CHECK(session.bulk_query_count > 0);
+    session.bulk_query_count--;
+  } else {
+    auto duration = Time::now() - query_info.sent_at;
+    session.query_duration =
+        session.query_duration == 0.0 ? duration : 0.8 * session.query_duration + 0.2 * duration;
+  }
+  on_session_load_changed();
 }
 
 }  // namespace td
@@ -11,6 +11,9 @@
 
 #include "td/actor/actor.h"
 
+#include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
+
 #include <memory>
 
 namespace td {
@@ -45,19 +48,46 @@ class SessionMultiProxy final : public Actor {
   bool is_media_ = false;
   bool is_cdn_ = false;
   bool need_destroy_auth_key_ = false;
+  string session_type_;
+  struct QueryInfo {
+    size_t size = 0;
+    double sent_at = 0.0;
+    int32 count = 0;  // number of sent copies of the query with the same identifier
+  };
   struct SessionInfo {
     ActorOwn<SessionProxy> proxy;
     int query_count{0};
+    int bulk_query_count{0};
+    int64 query_bytes{0};
+    // exponential moving average of durations of interactive queries from sending to receiving of the result,
+    // including time spent in the session's queues; 0 if unknown
+    double query_duration{0.0};
+    int64 sent_query_count{0};
+    FlatHashMap<uint64, QueryInfo> queries;
   };
   uint32 sessions_generation_{0};
   std::vector<SessionInfo> sessions_;
 
   void start_up() final;
+  void tear_down() final;
+  void timeout_expired() final;
   void init();
 
+  void on_session_load_changed();
+
+  void publish_session_loads() const;
+
   bool get_pfs_flag() const;
 
-  void on_query_finished(uint32 generation, int session_id);
+  static size_t get_query_transfer_size(const NetQuery &query);
+
+  static bool is_bulk_query(size_t size);
+
+  double get_session_score(const SessionInfo &session, bool is_bulk) const;
+
+  size_t choose_session(bool is_bulk) const;
+
+  void on_query_finished(uint32 generation, int session_id, uint64 query_id);
 };
 
 }  // namespace td
@@ -12,22 +12,25 @@
 
 namespace td {
 
-SqliteConnectionSafe::SqliteConnectionSafe(string path, DbKey key, optional<int32> cipher_version)
+SqliteConnectionSafe::SqliteConnectionSafe(string path, DbKey key, optional<int32> cipher_version, SqliteTuning tuning)
     : path_(std::move(path))
-    , lsls_connection_([path = path_, close_state_ptr = &close_state_, key = std::move(key),
-                        cipher_version = std::move(cipher_version)] {
+    , lsls_connection_([path = path_, close_state_ptr = &close_state_, commit_stats_collector = commit_stats_collector_,
+                        key = std::move(key), cipher_version = std::move(cipher_version), tuning] {
       auto r_db = SqliteDb::open_with_key(path, false, key, cipher_version.copy());
       if (r_db.is_error()) {
         LOG(FATAL) << "Can't open database in state " << close_state_ptr->load() << ": " << r_db.error().message();
       }
       auto db = r_db.move_as_ok();
+      db.apply_tuning(tuning).ensure();
       db.exec("PRAGMA journal_mode=WAL").ensure();
       db.exec("PRAGMA secure_delete=1").ensure();
+      db.set_commit_stats_collector(commit_stats_collector);
       return db;
     }) {
 }
 
 void SqliteConnectionSafe::set(SqliteDb &&db) {
+  db.set_commit_stats_collector(commit_stats_collector_);
   lsls_connection_.set(std::move(db));
 }
 
@@ -35,6 +38,10 @@ SqliteDb &SqliteConnectionSafe::get() {
   return lsls_connection_.get();
 }
 
+SqliteDb::CommitStats SqliteConnectionSafe::get_commit_stats() const {
+  return commit_stats_collector_->get_stats();
+}
+
 void SqliteConnectionSafe::close() {
   LOG(INFO) << "Close SQLite database " << tag("path", path_);
   close_state_++;
@@ -8,6 +8,7 @@
 
 #include "td/db/DbKey.h"
 #include "td/db/SqliteDb.h"
+#include "td/db/SqliteTuning.h"
 
 #include "td/actor/SchedulerLocalStorage.h"
 
@@ -15,13 +16,14 @@
 #include "td/utils/optional.h"
 
 #include <atomic>
+#include <memory>
 
 namespace td {
 
 class SqliteConnectionSafe {
  public:
   SqliteConnectionSafe() = default;
-  SqliteConnectionSafe(string path, DbKey key, optional<int32> cipher_version = {});
+  SqliteConnectionSafe(string path, DbKey key, optional<int32> cipher_version = {}, SqliteTuning tuning = {});
 
   SqliteDb &get();
   void set(SqliteDb &&db);
@@ -30,9 +32,14 @@ class SqliteConnectionSafe {
 
   void close_and_destroy();
 
+  // returns statistics of transaction commits of all connections to the database
+  SqliteDb::CommitStats get_commit_stats() const;
+
  private:
   string path_;
   std::atomic<uint32> close_state_{0};
+  std::shared_ptr<SqliteDb::CommitStatsCollector> commit_stats_collector_ =
+      std::make_shared<SqliteDb::CommitStatsCollector>();
   LazySchedulerLocalStorage<SqliteDb> lsls_connection_;
 };
 
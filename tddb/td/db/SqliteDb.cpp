@@ -14,10 +14,13 @@
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
 #include "td/utils/StringBuilder.h"
+#include "td/utils/Time.h"
 #include "td/utils/Timer.h"
 
 #include "sqlite/sqlite3.h"
 
+#include <atomic>
+
 namespace td {
 
 namespace {
@@ -67,8 +70,31 @@ string db_key_to_sqlcipher_key(const DbKey &db_key) {
   res.resize(expected_size);
   return res;
 }
+
 }  // namespace
 
+void SqliteDb::CommitStatsCollector::on_commit_finished(double commit_time) {
+  auto commit_time_us = static_cast<uint64>(commit_time * 1e6);
+  commit_count_.fetch_add(1, std::memory_order_relaxed);
+  total_commit_time_us_.fetch_add(commit_time_us, std::memory_order_relaxed);
+  if (commit_time >= SLOW_COMMIT_TIME) {
+    slow_commit_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+  auto max_time_us = max_commit_time_us_.load(std::memory_order_relaxed);
+  while (commit_time_us > max_time_us &&
+         !max_commit_time_us_.compare_exchange_weak(max_time_us, commit_time_us, std::memory_order_relaxed)) {
+  }
+}
+
+SqliteDb::CommitStats SqliteDb::CommitStatsCollector::get_stats() const {
+  CommitStats result;
+  result.commit_count = commit_count_.load(std::memory_order_relaxed);
+  result.slow_commit_count = slow_commit_count_.load(std::memory_order_relaxed);
+  result.total_commit_time = static_cast<double>(total_commit_time_us_.load(std::memory_order_relaxed)) * 1e-6;
+  result.max_commit_time = static_cast<double>(max_commit_time_us_.load(std::memory_order_relaxed)) * 1e-6;
+  return result;
+}
+
 SqliteDb::~SqliteDb() = default;
 
 Status SqliteDb::init(CSlice path, bool allow_creation) {
@@ -168,6 +194,42 @@ Result<string> SqliteDb::get_pragma_string(Slice name) {
   return std::move(res);
 }
 
+Status SqliteDb::apply_tuning(const SqliteTuning &tuning) {
+  if (tuning.page_size > 0 && !get_cipher_version()) {
+    // page size of encrypted databases is determined by SQLCipher settings and must not be changed
+    TRY_STATUS(exec(PSLICE() << "PRAGMA page_size = " << tuning.page_size));
+  }
+  TRY_STATUS(exec(PSLICE() << "PRAGMA mmap_size = " << tuning.mmap_size));
+  TRY_STATUS(exec(PSLICE() << "PRAGMA cache_size = " << tuning.cache_size));
+  TRY_STATUS(exec(PSLICE() << "PRAGMA temp_store = " << (tuning.use_memory_temp_store ? "MEMORY" : "DEFAULT")));
+  TRY_STATUS(exec(PSLICE() << "PRAGMA wal_autocheckpoint = " << tuning.wal_autocheckpoint));
+  return Status::OK();
+}
+
+Result<SqliteDb::WalCheckpointResult> SqliteDb::checkpoint_wal_passive() {
+  CHECK(!empty());
+  WalCheckpointResult result;
+  auto rc = tdsqlite3_wal_checkpoint_v2(raw_->db(), nullptr, SQLITE_CHECKPOINT_PASSIVE, &result.wal_page_count,
+                                        &result.checkpointed_page_count);
+  if (rc != SQLITE_OK) {
+    return raw_->last_error();
+  }
+  return result;
+}
+
+Result<int64> SqliteDb::get_data_version() {
+  TRY_RESULT(stmt, get_statement("PRAGMA data_version"));
+  TRY_STATUS(stmt.step());
+  if (!stmt.has_row()) {
+    return Status::Error(PSLICE() << "PRAGMA data_version failed for database \"" << raw_->path() << '"');
+  }
+  return stmt.view_int64(0);
+}
+
+int32 SqliteDb::get_total_change_count() const {
+  return tdsqlite3_total_changes(raw_->db());
+}
+
 Result<int32> SqliteDb::user_version() {
   TRY_RESULT(get_version_stmt, get_statement("PRAGMA user_version"));
   TRY_STATUS(get_version_stmt.step());
@@ -198,11 +260,21 @@ Status SqliteDb::begin_write_transaction() {
 Status SqliteDb::commit_transaction() {
   TRY_RESULT(need_commit, raw_->on_commit());
   if (need_commit) {
-    return exec("COMMIT");
+    if (commit_stats_collector_ == nullptr) {
+      return exec("COMMIT");
+    }
+    auto start_time = Time::now();
+    auto status = exec("COMMIT");
+    commit_stats_collector_->on_commit_finished(Time::now() - start_time);
+    return status;
   }
   return Status::OK();
 }
 
+bool SqliteDb::is_in_transaction() const {
+  return tdsqlite3_get_autocommit(raw_->db()) == 0;
+}
+
 Status SqliteDb::check_encryption() {
   auto status = exec("SELECT count(*) FROM sqlite_master");
   if (status.is_ok()) {
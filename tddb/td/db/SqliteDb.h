@@ -8,6 +8,7 @@
 
 #include "td/db/DbKey.h"
 #include "td/db/SqliteStatement.h"
+#include "td/db/SqliteTuning.h"
 
 #include "td/db/detail/RawSqliteDb.h"
 
@@ -16,6 +17,7 @@
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 
+#include <atomic>
 #include <memory>
 
 struct tdsqlite3;
@@ -24,6 +26,38 @@ namespace td {
 
 class SqliteDb {
  public:
+  struct WalCheckpointResult {
+    int32 wal_page_count = 0;
+    // the number of pages in the WAL, which are already written to the database file
+    int32 checkpointed_page_count = 0;
+  };
+
+  // statistics of explicit transactions only; statements executed in autocommit mode aren't accounted,
+  // even though they can also be slowed down by WAL checkpoints
+  struct CommitStats {
+    uint64 commit_count = 0;
+    // the number of commits, which took more than SLOW_COMMIT_TIME, usually because of WAL checkpoints
+    uint64 slow_commit_count = 0;
+    double total_commit_time = 0.0;
+    double max_commit_time = 0.0;
+  };
+
+  static constexpr double SLOW_COMMIT_TIME = 0.05;
+
+  // collects statistics of transaction commits of all connections to which it is attached
+  class CommitStatsCollector {
+   public:
+    void on_commit_finished(double commit_time);
+
+    CommitStats get_stats() const;
+
+   private:
+    std::atomic<uint64> commit_count_{0};
+    std::atomic<uint64> slow_commit_count_{0};
+    std::atomic<uint64> total_commit_time_us_{0};
+    std::atomic<uint64> max_commit_time_us_{0};
+  };
+
   SqliteDb() = default;
   SqliteDb(SqliteDb &&) = default;
   SqliteDb &operator=(SqliteDb &&) = default;
@@ -33,7 +67,7 @@ class SqliteDb {
 
   // dangerous
   SqliteDb clone() const {
-    return SqliteDb(raw_, enable_logging_);
+    return SqliteDb(raw_, enable_logging_, commit_stats_collector_);
   }
 
   bool empty() const {
@@ -48,10 +82,30 @@ class SqliteDb {
   Result<string> get_pragma(Slice name);
   Result<string> get_pragma_string(Slice name);
 
+  // must be called before the first change of a new database, because page size can't be changed in WAL mode
+  Status apply_tuning(const SqliteTuning &tuning) TD_WARN_UNUSED_RESULT;
+
+  // checkpoints as much of the WAL as possible without waiting for other readers and writers
+  Result<WalCheckpointResult> checkpoint_wal_passive();
+
+  // returns a value, which changes after a commit to the database through any other connection
+  Result<int64> get_data_version();
+
+  // returns the total number of rows modified through the connection
+  int32 get_total_change_count() const;
+
   Status begin_read_transaction() TD_WARN_UNUSED_RESULT;
   Status begin_write_transaction() TD_WARN_UNUSED_RESULT;
   Status commit_transaction() TD_WARN_UNUSED_RESULT;
 
+  // returns true if there is an explicitly started transaction, which isn't committed yet
+  bool is_in_transaction() const;
+
+  // commits of the connection and all its clones will be accounted in the collector
+  void set_commit_stats_collector(std::shared_ptr<CommitStatsCollector> commit_stats_collector) {
+    commit_stats_collector_ = std::move(commit_stats_collector);
+  }
+
   Result<int32> user_version();
   Status set_user_version(int32 version) TD_WARN_UNUSED_RESULT;
   void trace(bool flag);
@@ -78,11 +132,15 @@ class SqliteDb {
   optional<int32> get_cipher_version() const;
 
  private:
-  SqliteDb(std::shared_ptr<detail::RawSqliteDb> raw, bool enable_logging)
-      : raw_(std::move(raw)), enable_logging_(enable_logging) {
+  SqliteDb(std::shared_ptr<detail::RawSqliteDb> raw, bool enable_logging,
+           std::shared_ptr<CommitStatsCollector> commit_stats_collector)
+      : raw_(std::move(raw))
+      , enable_logging_(enable_logging)
+      , commit_stats_collector_(std::move(commit_stats_collector)) {
   }
   std::shared_ptr<detail::RawSqliteDb> raw_;
   bool enable_logging_ = false;
+  std::shared_ptr<CommitStatsCollector> commit_stats_collector_;
 
   Status init(CSlice path, bool allow_creation) TD_WARN_UNUSED_RESULT;
 
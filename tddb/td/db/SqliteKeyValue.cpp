@@ -40,17 +40,57 @@ Status SqliteKeyValue::init_with_connection(SqliteDb connection, string table_na
   return Status::OK();
 }
 
+SqliteKeyValue::~SqliteKeyValue() {
+  release_cache_keys();
+}
+
+void SqliteKeyValue::close() {
+  release_cache_keys();
+  *this = SqliteKeyValue();
+}
+
+// keys changed in a transaction are unpinned even if the transaction isn't committed,
+// because their values aren't cached and will be read from the database
+void SqliteKeyValue::release_cache_keys() {
+  if (cache_ == nullptr || (uncommitted_cache_keys_.empty() && uncommitted_cache_prefixes_.empty())) {
+    return;
+  }
+  cache_->on_commit(uncommitted_cache_keys_, uncommitted_cache_prefixes_);
+  uncommitted_cache_keys_.clear();
+  uncommitted_cache_prefixes_.clear();
+}
+
 Status SqliteKeyValue::drop() {
   if (empty()) {
     return Status::OK();
   }
 
   auto result = drop(db_, table_name_);
+  if (cache_ != nullptr) {
+    cache_->clear();
+  }
   close();
   return result;
 }
 
+Status SqliteKeyValue::commit_transaction() {
+  TRY_STATUS(db_.commit_transaction());
+  if (cache_ != nullptr) {
+    on_cache_commit();
+  }
+  return Status::OK();
+}
+
 void SqliteKeyValue::set(Slice key, Slice value) {
+  uint64 generation = 0;
+  if (cache_ != nullptr) {
+    on_cache_commit();
+    if (cache_->has_value(key, value, true)) {
+      return;
+    }
+    generation = cache_->get_generation();
+  }
+
   set_stmt_.bind_blob(1, key).ensure();
   set_stmt_.bind_blob(2, value).ensure();
   auto status = set_stmt_.step();
@@ -58,6 +98,10 @@ void SqliteKeyValue::set(Slice key, Slice value) {
     LOG(FATAL) << "Failed to set \"" << base64_encode(key) << "\": " << status;
   }
   set_stmt_.reset();
+
+  if (cache_ != nullptr) {
+    on_cache_write(key, value, true, generation);
+  }
 }
 
 void SqliteKeyValue::set_all(const FlatHashMap<string, string> &key_values) {
@@ -69,23 +113,55 @@ void SqliteKeyValue::set_all(const FlatHashMap<string, string> &key_values) {
 }
 
 string SqliteKeyValue::get(Slice key) {
+  bool is_present = false;
+  if (cache_ == nullptr) {
+    return get_from_database(key, is_present);
+  }
+
+  on_cache_commit();
+  string value;
+  if (cache_->get(key, value)) {
+    return value;
+  }
+  auto generation = cache_->get_generation();
+  value = get_from_database(key, is_present);
+  cache_->add(key, value, is_present, generation);
+  return value;
+}
+
+string SqliteKeyValue::get_from_database(Slice key, bool &is_present) {
   SCOPE_EXIT {
     get_stmt_.reset();
   };
   get_stmt_.bind_blob(1, key).ensure();
   get_stmt_.step().ensure();
   if (!get_stmt_.has_row()) {
+    is_present = false;
     return string();
   }
+  is_present = true;
   auto data = get_stmt_.view_blob(0).str();
   get_stmt_.step().ignore();
   return data;
 }
 
 void SqliteKeyValue::erase(Slice key) {
+  uint64 generation = 0;
+  if (cache_ != nullptr) {
+    on_cache_commit();
+    if (cache_->has_value(key, Slice(), false)) {
+      return;
+    }
+    generation = cache_->get_generation();
+  }
+
   erase_stmt_.bind_blob(1, key).ensure();
   erase_stmt_.step().ensure();
   erase_stmt_.reset();
+
+  if (cache_ != nullptr) {
+    on_cache_write(key, Slice(), false, generation);
+  }
 }
 
 void SqliteKeyValue::erase_batch(vector<string> keys) {
@@ -95,6 +171,10 @@ void SqliteKeyValue::erase_batch(vector<string> keys) {
 }
 
 void SqliteKeyValue::erase_by_prefix(Slice prefix) {
+  if (cache_ != nullptr) {
+    on_cache_commit();
+  }
+
   auto next = next_prefix(prefix);
   if (next.empty()) {
     SCOPE_EXIT {
@@ -110,6 +190,30 @@ void SqliteKeyValue::erase_by_prefix(Slice prefix) {
     erase_by_prefix_stmt_.bind_blob(2, next).ensure();
     erase_by_prefix_stmt_.step().ensure();
   }
+
+  if (cache_ != nullptr) {
+    bool is_committed = !db_.is_in_transaction();
+    cache_->on_erase_by_prefix(prefix, is_committed);
+    if (!is_committed) {
+      uncommitted_cache_prefixes_.push_back(prefix.str());
+    }
+  }
+}
+
+void SqliteKeyValue::on_cache_write(Slice key, Slice value, bool is_present, uint64 generation) {
+  bool is_committed = !db_.is_in_transaction();
+  cache_->on_write(key, value, is_present, generation, is_committed);
+  if (!is_committed) {
+    uncommitted_cache_keys_.push_back(key.str());
+  }
+}
+
+// keys changed in a transaction are unpinned after the transaction is committed either through commit_transaction
+// or directly through the database connection
+void SqliteKeyValue::on_cache_commit() {
+  if (!db_.is_in_transaction()) {
+    release_cache_keys();
+  }
 }
 
 string SqliteKeyValue::next_prefix(Slice prefix) {
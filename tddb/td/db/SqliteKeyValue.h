@@ -7,6 +7,7 @@
 #pragma once
 
 #include "td/db/SqliteDb.h"
+#include "td/db/SqliteKeyValueCache.h"
 #include "td/db/SqliteStatement.h"
 
 #include "td/utils/common.h"
@@ -15,10 +16,19 @@
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
 
+#include <memory>
+
 namespace td {
 
 class SqliteKeyValue {
  public:
+  SqliteKeyValue() = default;
+  SqliteKeyValue(const SqliteKeyValue &) = delete;
+  SqliteKeyValue &operator=(const SqliteKeyValue &) = delete;
+  SqliteKeyValue(SqliteKeyValue &&) = default;
+  SqliteKeyValue &operator=(SqliteKeyValue &&) = default;
+  ~SqliteKeyValue();
+
   static Status drop(SqliteDb &connection, Slice table_name) TD_WARN_UNUSED_RESULT {
     return connection.exec(PSLICE() << "DROP TABLE IF EXISTS " << table_name);
   }
@@ -33,10 +43,17 @@ class SqliteKeyValue {
 
   Status init_with_connection(SqliteDb connection, string table_name) TD_WARN_UNUSED_RESULT;
 
-  void close() {
-    *this = SqliteKeyValue();
+  // the cache can be shared between connections to the same table; get_by_prefix and get_by_range don't use it
+  void set_cache(std::shared_ptr<SqliteKeyValueCache> cache) {
+    cache_ = std::move(cache);
+  }
+
+  SqliteKeyValueCache *get_cache() const {
+    return cache_.get();
   }
 
+  void close();
+
   Status drop();
 
   void set(Slice key, Slice value);
@@ -57,9 +74,7 @@ class SqliteKeyValue {
     return db_.begin_write_transaction();
   }
 
-  Status commit_transaction() TD_WARN_UNUSED_RESULT {
-    return db_.commit_transaction();
-  }
+  Status commit_transaction() TD_WARN_UNUSED_RESULT;
 
   void erase_by_prefix(Slice prefix);
 
@@ -128,6 +143,18 @@ class SqliteKeyValue {
   SqliteStatement get_by_prefix_stmt_;
   SqliteStatement get_by_prefix_rare_stmt_;
 
+  std::shared_ptr<SqliteKeyValueCache> cache_;
+  vector<string> uncommitted_cache_keys_;
+  vector<string> uncommitted_cache_prefixes_;
+
+  string get_from_database(Slice key, bool &is_present);
+
+  void release_cache_keys();
+
+  void on_cache_write(Slice key, Slice value, bool is_present, uint64 generation);
+
+  void on_cache_commit();
+
   static string next_prefix(Slice prefix);
 };
 
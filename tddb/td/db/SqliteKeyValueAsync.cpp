@@ -7,11 +7,13 @@
 #include "td/db/SqliteKeyValueAsync.h"
 
 #include "td/db/SqliteKeyValue.h"
+#include "td/db/SqliteKeyValueCache.h"
 
 #include "td/actor/actor.h"
 
 #include "td/utils/common.h"
 #include "td/utils/optional.h"
+#include "td/utils/Slice.h"
 #include "td/utils/Time.h"
 
 namespace td {
@@ -36,6 +38,9 @@ class SqliteKeyValueAsync final : public SqliteKeyValueAsyncInterface {
   void get(string key, Promise<string> promise) final {
     send_closure_later(impl_, &Impl::get, std::move(key), std::move(promise));
   }
+  void get_by_prefix(string key_prefix, Promise<vector<std::pair<string, string>>> promise) final {
+    send_closure_later(impl_, &Impl::get_by_prefix, std::move(key_prefix), std::move(promise));
+  }
   void close(Promise<Unit> promise) final {
     send_closure_later(impl_, &Impl::close, std::move(promise));
   }
@@ -49,9 +54,11 @@ class SqliteKeyValueAsync final : public SqliteKeyValueAsyncInterface {
     void set(string key, string value, Promise<Unit> promise) {
       auto it = buffer_.find(key);
       if (it != buffer_.end()) {
+        update_pending_write(key, value, true);
         it->second = std::move(value);
       } else {
         CHECK(!key.empty());
+        add_pending_write(key, value, true);
         buffer_.emplace(std::move(key), std::move(value));
       }
       if (promise) {
@@ -70,9 +77,11 @@ class SqliteKeyValueAsync final : public SqliteKeyValueAsyncInterface {
     void erase(string key, Promise<Unit> promise) {
       auto it = buffer_.find(key);
       if (it != buffer_.end()) {
+        update_pending_write(key, Slice(), false);
         it->second = optional<string>();
       } else {
         CHECK(!key.empty());
+        add_pending_write(key, Slice(), false);
         buffer_.emplace(std::move(key), optional<string>());
       }
       if (promise) {
@@ -96,10 +105,21 @@ class SqliteKeyValueAsync final : public SqliteKeyValueAsyncInterface {
       promise.set_value(kv_->get(key));
     }
 
+    void get_by_prefix(const string &key_prefix, Promise<vector<std::pair<string, string>>> promise) {
+      do_flush(true /*force*/);
+      vector<std::pair<string, string>> result;
+      kv_->get_by_prefix(key_prefix, [&result](Slice key, Slice value) {
+        result.emplace_back(key.str(), value.str());
+        return true;
+      });
+      promise.set_value(std::move(result));
+    }
+
     void close(Promise<Unit> promise) {
       do_flush(true /*force*/);
       kv_safe_.reset();
       kv_ = nullptr;
+      cache_ = nullptr;
       stop();
       promise.set_value(Unit());
     }
@@ -107,6 +127,7 @@ class SqliteKeyValueAsync final : public SqliteKeyValueAsyncInterface {
    private:
     std::shared_ptr<SqliteKeyValueSafe> kv_safe_;
     SqliteKeyValue *kv_ = nullptr;
+    SqliteKeyValueCache *cache_ = nullptr;
 
     static constexpr double MAX_PENDING_QUERIES_DELAY = 0.01;
     static constexpr size_t MAX_PENDING_QUERIES_COUNT = 100;
@@ -143,16 +164,35 @@ class SqliteKeyValueAsync final : public SqliteKeyValueAsyncInterface {
         }
       }
       kv_->commit_transaction().ensure();
+      if (cache_ != nullptr) {
+        for (auto &it : buffer_) {
+          cache_->finish_pending_write(it.first);
+        }
+      }
       buffer_.clear();
       set_promises(buffer_promises_);
     }
 
+    // buffered changes are visible through the cache before they are written to the database
+    void add_pending_write(Slice key, Slice value, bool is_present) {
+      if (cache_ != nullptr) {
+        cache_->add_pending_write(key, value, is_present);
+      }
+    }
+
+    void update_pending_write(Slice key, Slice value, bool is_present) {
+      if (cache_ != nullptr) {
+        cache_->update_pending_write(key, value, is_present);
+      }
+    }
+
     void timeout_expired() final {
       do_flush(false /*force*/);
     }
 
     void start_up() final {
       kv_ = &kv_safe_->get();
+      cache_ = kv_->get_cache();
     }
   };
   ActorOwn<Impl> impl_;
@@ -13,6 +13,7 @@
 #include "td/utils/Promise.h"
 
 #include <memory>
+#include <utility>
 
 namespace td {
 
@@ -30,6 +31,9 @@ class SqliteKeyValueAsyncInterface {
 
   virtual void get(string key, Promise<string> promise) = 0;
 
+  // returns pairs (key without the prefix, value) for all keys beginning with the prefix
+  virtual void get_by_prefix(string key_prefix, Promise<vector<std::pair<string, string>>> promise) = 0;
+
   virtual void close(Promise<Unit> promise) = 0;
 };
 
@@ -0,0 +1,255 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/db/SqliteKeyValueCache.h"
+
+#include "td/utils/algorithm.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+
+#include <algorithm>
+
+namespace td {
+
+SqliteKeyValueCache::SqliteKeyValueCache(size_t max_size) : max_size_(max_size) {
+}
+
+void SqliteKeyValueCache::set_max_size(size_t max_size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_size_ = max_size;
+  evict();
+}
+
+bool SqliteKeyValueCache::get(Slice key, string &value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it == entries_.end() || !it->second.is_value_known_) {
+    stats_.miss_count++;
+    return false;
+  }
+  stats_.hit_count++;
+  auto &entry = it->second;
+  if (!entry.is_pinned()) {
+    entry.remove();
+    lru_list_.put_back(&entry);
+  }
+  value = entry.value_;
+  return true;
+}
+
+uint64 SqliteKeyValueCache::get_generation() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return generation_;
+}
+
+void SqliteKeyValueCache::add(Slice key, Slice value, bool is_present, uint64 generation) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (generation != generation_ || max_size_ == 0 || entries_.count(key) != 0 ||
+      is_erased_by_uncommitted_prefix(key)) {
+    return;
+  }
+  auto &entry = get_entry(key);
+  set_entry_value(entry, value, is_present);
+  update_entry(entry);
+}
+
+bool SqliteKeyValueCache::has_value(Slice key, Slice value, bool is_present) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return false;
+  }
+  auto &entry = it->second;
+  // the values of keys with pending writes aren't stored in the database yet
+  if (!entry.is_value_known_ || entry.pending_write_count_ > 0 || entry.is_present_ != is_present ||
+      (is_present && entry.value_ != value)) {
+    return false;
+  }
+  stats_.skipped_write_count++;
+  return true;
+}
+
+void SqliteKeyValueCache::on_write(Slice key, Slice value, bool is_present, uint64 generation, bool is_committed) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  bool is_generation_changed = generation != generation_;
+  generation_++;
+  if (is_generation_changed && is_committed) {
+    // the key could have been changed concurrently by another connection, so its value is unknown;
+    // values of pinned keys were changed after the write, so they are kept
+    if (it != entries_.end() && !it->second.is_pinned()) {
+      erase_entry(it);
+    }
+    return;
+  }
+  if (max_size_ == 0 && is_committed && it == entries_.end()) {
+    return;
+  }
+
+  auto &entry = it == entries_.end() ? get_entry(key) : it->second;
+  if (entry.pending_write_count_ == 0) {
+    if (is_committed) {
+      set_entry_value(entry, value, is_present);
+    } else {
+      // other connections must read the committed value from the database
+      forget_entry_value(entry);
+    }
+  }
+  if (!is_committed) {
+    entry.uncommitted_write_count_++;
+  }
+  update_entry(entry);
+}
+
+void SqliteKeyValueCache::on_erase_by_prefix(Slice prefix, bool is_committed) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  generation_++;
+  auto it = entries_.lower_bound(prefix);
+  while (it != entries_.end() && begins_with(it->first, prefix)) {
+    auto &entry = it->second;
+    if (entry.pending_write_count_ > 0) {
+      // the buffered value will be written after the erasure
+      ++it;
+    } else if (entry.is_pinned()) {
+      if (is_committed) {
+        set_entry_value(entry, Slice(), false);
+      } else {
+        forget_entry_value(entry);
+      }
+      ++it;
+    } else {
+      erase_entry(it++);
+    }
+  }
+  if (!is_committed) {
+    uncommitted_erased_prefixes_.push_back(prefix.str());
+  }
+}
+
+void SqliteKeyValueCache::on_commit(const vector<string> &keys, const vector<string> &prefixes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  generation_++;
+  for (auto &key : keys) {
+    auto it = entries_.find(key);
+    CHECK(it != entries_.end());
+    auto &entry = it->second;
+    CHECK(entry.uncommitted_write_count_ > 0);
+    entry.uncommitted_write_count_--;
+    if (!entry.is_pinned() && !entry.is_value_known_) {
+      // the committed value will be read from the database
+      erase_entry(it);
+    } else {
+      update_entry(entry);
+    }
+  }
+  for (auto &prefix : prefixes) {
+    auto it = std::find(uncommitted_erased_prefixes_.begin(), uncommitted_erased_prefixes_.end(), prefix);
+    CHECK(it != uncommitted_erased_prefixes_.end());
+    uncommitted_erased_prefixes_.erase(it);
+  }
+}
+
+void SqliteKeyValueCache::add_pending_write(Slice key, Slice value, bool is_present) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  generation_++;
+  auto &entry = get_entry(key);
+  set_entry_value(entry, value, is_present);
+  entry.pending_write_count_++;
+  update_entry(entry);
+}
+
+void SqliteKeyValueCache::update_pending_write(Slice key, Slice value, bool is_present) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  generation_++;
+  auto it = entries_.find(key);
+  CHECK(it != entries_.end());
+  CHECK(it->second.pending_write_count_ > 0);
+  set_entry_value(it->second, value, is_present);
+}
+
+void SqliteKeyValueCache::finish_pending_write(Slice key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  CHECK(it != entries_.end());
+  auto &entry = it->second;
+  CHECK(entry.pending_write_count_ > 0);
+  entry.pending_write_count_--;
+  update_entry(entry);
+}
+
+void SqliteKeyValueCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  generation_++;
+  auto it = entries_.begin();
+  while (it != entries_.end()) {
+    if (it->second.is_pinned()) {
+      ++it;
+    } else {
+      erase_entry(it++);
+    }
+  }
+}
+
+SqliteKeyValueCache::Stats SqliteKeyValueCache::get_stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto result = stats_;
+  result.key_count = entries_.size();
+  result.size = size_;
+  return result;
+}
+
+SqliteKeyValueCache::Entry &SqliteKeyValueCache::get_entry(Slice key) {
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    return it->second;
+  }
+  auto &entry = entries_[key.str()];
+  entry.key_ = key.str();
+  size_ += entry.get_size();
+  return entry;
+}
+
+void SqliteKeyValueCache::set_entry_value(Entry &entry, Slice value, bool is_present) {
+  size_ -= entry.get_size();
+  entry.value_ = value.str();
+  entry.is_present_ = is_present;
+  entry.is_value_known_ = true;
+  size_ += entry.get_size();
+}
+
+void SqliteKeyValueCache::forget_entry_value(Entry &entry) {
+  set_entry_value(entry, Slice(), false);
+  entry.is_value_known_ = false;
+}
+
+void SqliteKeyValueCache::update_entry(Entry &entry) {
+  entry.remove();
+  if (!entry.is_pinned()) {
+    lru_list_.put_back(&entry);
+  }
+  evict();
+}
+
+void SqliteKeyValueCache::erase_entry(std::map<string, Entry, std::less<>>::iterator it) {
+  CHECK(!it->second.is_pinned());
+  size_ -= it->second.get_size();
+  entries_.erase(it);
+}
+
+bool SqliteKeyValueCache::is_erased_by_uncommitted_prefix(Slice key) const {
+  return any_of(uncommitted_erased_prefixes_, [key](const string &prefix) { return begins_with(key, prefix); });
+}
+
+void SqliteKeyValueCache::evict() {
+  while (size_ > max_size_ && !lru_list_.empty()) {
+    auto *entry = static_cast<Entry *>(lru_list_.begin());
+    auto it = entries_.find(entry->key_);
+    CHECK(it != entries_.end());
+    erase_entry(it);
+  }
+}
+
+}  // namespace td
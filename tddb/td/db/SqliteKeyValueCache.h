@@ -0,0 +1,128 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/List.h"
+#include "td/utils/Slice.h"
+
+#include <functional>
+#include <map>
+#include <mutex>
+
+namespace td {
+
+// thread-safe cache of values from a SqliteKeyValue table, which is shared between all connections to the table
+// values of the least recently used keys are evicted to fit into the given number of bytes,
+// but values of pinned keys are never evicted:
+// - keys changed in a not yet committed transaction are pinned by SqliteKeyValue until the commit; their values
+//   aren't cached, so other connections read the committed values from the database and the changing connection
+//   reads its own changes from the database;
+// - keys with buffered changes are pinned by SqliteKeyValueAsync until the changes are written to the database,
+//   so the new values are returned by all connections before they are written
+class SqliteKeyValueCache {
+ public:
+  struct Stats {
+    uint64 hit_count = 0;
+    uint64 miss_count = 0;
+    // the number of sets and erases, which didn't change the stored value and were skipped
+    uint64 skipped_write_count = 0;
+    size_t key_count = 0;
+    size_t size = 0;
+
+    double get_hit_rate() const {
+      auto total_count = hit_count + miss_count;
+      return total_count == 0 ? 0.0 : static_cast<double>(hit_count) / static_cast<double>(total_count);
+    }
+  };
+
+  explicit SqliteKeyValueCache(size_t max_size);
+
+  void set_max_size(size_t max_size);
+
+  // returns true and the value if the key is cached; a value of an absent key is empty
+  bool get(Slice key, string &value);
+
+  // must be called before reading of the value from the database; the returned value must be passed to add
+  uint64 get_generation();
+
+  // adds the value read from the database, unless the key was changed after the reading has begun
+  void add(Slice key, Slice value, bool is_present, uint64 generation);
+
+  // returns true if the key has the value in the database, so the write can be skipped
+  bool has_value(Slice key, Slice value, bool is_present);
+
+  // must be called after the key is changed in the database; keys changed in a transaction are pinned until commit
+  // and their values are forgotten
+  void on_write(Slice key, Slice value, bool is_present, uint64 generation, bool is_committed);
+
+  // must be called after keys beginning with the prefix are erased from the database;
+  // keys beginning with the prefix aren't added until commit if they were erased in a transaction
+  void on_erase_by_prefix(Slice prefix, bool is_committed);
+
+  // must be called for the keys and prefixes changed in a transaction after the transaction is committed,
+  // or if the connection is closed and the transaction may never be committed
+  void on_commit(const vector<string> &keys, const vector<string> &prefixes);
+
+  // pins the key with a buffered change until finish_pending_write is called for it
+  void add_pending_write(Slice key, Slice value, bool is_present);
+
+  // changes the value of the key with a buffered change after another change of the key is buffered
+  void update_pending_write(Slice key, Slice value, bool is_present);
+
+  void finish_pending_write(Slice key);
+
+  void clear();
+
+  Stats get_stats();
+
+ private:
+  struct Entry final : public ListNode {
+    string key_;
+    string value_;
+    bool is_present_ = false;
+    // false if the key was changed in a not yet committed transaction
+    bool is_value_known_ = true;
+    int32 uncommitted_write_count_ = 0;
+    int32 pending_write_count_ = 0;
+
+    bool is_pinned() const {
+      return uncommitted_write_count_ > 0 || pending_write_count_ > 0;
+    }
+
+    size_t get_size() const {
+      return key_.size() + value_.size() + ENTRY_OVERHEAD;
+    }
+  };
+
+  static constexpr size_t ENTRY_OVERHEAD = 96;
+
+  std::mutex mutex_;
+  size_t max_size_ = 0;
+  size_t size_ = 0;
+  uint64 generation_ = 0;
+  ListNode lru_list_;  // unpinned entries from the least to the most recently used
+  std::map<string, Entry, std::less<>> entries_;
+  vector<string> uncommitted_erased_prefixes_;
+  Stats stats_;
+
+  Entry &get_entry(Slice key);
+
+  void set_entry_value(Entry &entry, Slice value, bool is_present);
+
+  void forget_entry_value(Entry &entry);
+
+  void update_entry(Entry &entry);
+
+  void erase_entry(std::map<string, Entry, std::less<>>::iterator it);
+
+  bool is_erased_by_uncommitted_prefix(Slice key) const;
+
+  void evict();
+};
+
+}  // namespace td
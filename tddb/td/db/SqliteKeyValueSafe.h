@@ -8,6 +8,7 @@
 
 #include "td/db/SqliteConnectionSafe.h"
 #include "td/db/SqliteKeyValue.h"
+#include "td/db/SqliteKeyValueCache.h"
 
 #include "td/actor/SchedulerLocalStorage.h"
 
@@ -19,21 +20,28 @@ namespace td {
 
 class SqliteKeyValueSafe {
  public:
-  SqliteKeyValueSafe(string name, std::shared_ptr<SqliteConnectionSafe> safe_connection)
-      : lsls_kv_([name = std::move(name), safe_connection = std::move(safe_connection)] {
+  // if cache_size is positive, then values are cached in a cache of the given size shared between all schedulers
+  SqliteKeyValueSafe(string name, std::shared_ptr<SqliteConnectionSafe> safe_connection, size_t cache_size = 0)
+      : cache_(cache_size == 0 ? nullptr : std::make_shared<SqliteKeyValueCache>(cache_size))
+      , lsls_kv_([name = std::move(name), safe_connection = std::move(safe_connection), cache = cache_] {
         SqliteKeyValue kv;
         kv.init_with_connection(safe_connection->get().clone(), name).ensure();
+        kv.set_cache(cache);
         return kv;
       }) {
   }
   SqliteKeyValue &get() {
     return lsls_kv_.get();
   }
+  SqliteKeyValueCache *get_cache() const {
+    return cache_.get();
+  }
   void close() {
     lsls_kv_.clear_values();
   }
 
  private:
+  std::shared_ptr<SqliteKeyValueCache> cache_;
   LazySchedulerLocalStorage<SqliteKeyValue> lsls_kv_;
 };
 
@@ -0,0 +1,31 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+
+namespace td {
+
+// SQLite settings, which are applied to every connection to a database; the defaults are the defaults of SQLite
+struct SqliteTuning {
+  // the maximum number of bytes of the database file, which are accessed through memory mapping; ignored by SQLCipher
+  int64 mmap_size = 0;
+
+  // the maximum number of cached database pages; the maximum size of the cache in KiB if negative
+  int32 cache_size = -2000;
+
+  // the page size of newly created unencrypted databases; 0 keeps the default page size
+  int32 page_size = 0;
+
+  // whether temporary tables and indices are stored in memory instead of files
+  bool use_memory_temp_store = false;
+
+  // the number of pages in the WAL after which a committing connection checkpoints it; 0 disables the checkpoints
+  int32 wal_autocheckpoint = 1000;
+};
+
+}  // namespace td
@@ -0,0 +1,120 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/db/SqliteWalCheckpointer.h"
+
+#include "td/db/SqliteDb.h"
+
+#include "td/actor/actor.h"
+
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/Time.h"
+
+namespace td {
+
+class SqliteWalCheckpointer final : public SqliteWalCheckpointerInterface {
+ public:
+  SqliteWalCheckpointer(std::shared_ptr<SqliteConnectionSafe> connection, double period, int32 scheduler_id) {
+    impl_ = create_actor_on_scheduler<Impl>("WalCheckpointer", scheduler_id, std::move(connection), period);
+  }
+
+  void close(Promise<Unit> promise) final {
+    send_closure_later(impl_, &Impl::close, std::move(promise));
+  }
+
+ private:
+  class Impl final : public Actor {
+   public:
+    Impl(std::shared_ptr<SqliteConnectionSafe> connection, double period)
+        : connection_(std::move(connection)), period_(period) {
+      CHECK(period_ > 0);
+    }
+
+    void close(Promise<Unit> promise) {
+      LOG(INFO) << "Did " << checkpoint_count_ << " WAL checkpoints in " << total_checkpoint_time_
+                << " seconds with maximum duration of " << max_checkpoint_time_ << " seconds and maximum WAL size of "
+                << max_wal_page_count_ << " pages; " << failed_checkpoint_count_ << " checkpoints failed";
+      connection_.reset();
+      stop();
+      promise.set_value(Unit());
+    }
+
+   private:
+    // the maximum increase of the delay between checks if nothing is committed to the database
+    static constexpr double MAX_DELAY_MULTIPLIER = 32.0;
+
+    std::shared_ptr<SqliteConnectionSafe> connection_;
+    double period_;
+    double delay_ = 0.0;
+
+    // the state of the database at the time of the last checkpoint of the whole WAL
+    int64 checkpointed_data_version_ = 0;
+    int32 checkpointed_total_change_count_ = 0;
+    bool is_wal_checkpointed_ = false;
+
+    uint64 checkpoint_count_ = 0;
+    uint64 failed_checkpoint_count_ = 0;
+    int32 max_wal_page_count_ = 0;
+    double total_checkpoint_time_ = 0.0;
+    double max_checkpoint_time_ = 0.0;
+
+    void start_up() final {
+      delay_ = period_;
+      set_timeout_in(delay_);
+    }
+
+    void timeout_expired() final {
+      auto &db = connection_->get();
+      // data version is changed by commits of other connections, including autocommit statements,
+      // and the total change count is changed by modifications through the connection itself
+      auto r_data_version = db.get_data_version();
+      auto total_change_count = db.get_total_change_count();
+      if (is_wal_checkpointed_ && r_data_version.is_ok() && r_data_version.ok() == checkpointed_data_version_ &&
+          total_change_count == checkpointed_total_change_count_) {
+        // nothing was added to the WAL since the last checkpoint, so check less often while the database is idle
+        delay_ = min(delay_ * 2, period_ * MAX_DELAY_MULTIPLIER);
+        set_timeout_in(delay_);
+        return;
+      }
+      delay_ = period_;
+      is_wal_checkpointed_ = false;
+
+      auto start_time = Time::now();
+      auto r_result = db.checkpoint_wal_passive();
+      auto checkpoint_time = Time::now() - start_time;
+      if (r_result.is_error()) {
+        // the WAL can be checkpointed concurrently by a committing connection
+        LOG(INFO) << "Failed to checkpoint WAL: " << r_result.error();
+        failed_checkpoint_count_++;
+      } else {
+        auto result = r_result.ok();
+        if (result.wal_page_count > 0) {
+          LOG(DEBUG) << "Checkpointed " << result.checkpointed_page_count << " out of " << result.wal_page_count
+                     << " WAL pages in " << checkpoint_time << " seconds";
+        }
+        checkpoint_count_++;
+        max_wal_page_count_ = max(max_wal_page_count_, result.wal_page_count);
+        total_checkpoint_time_ += checkpoint_time;
+        max_checkpoint_time_ = max(max_checkpoint_time_, checkpoint_time);
+        if (result.checkpointed_page_count == result.wal_page_count && r_data_version.is_ok()) {
+          is_wal_checkpointed_ = true;
+          checkpointed_data_version_ = r_data_version.ok();
+          checkpointed_total_change_count_ = total_change_count;
+        }
+      }
+      set_timeout_in(delay_);
+    }
+  };
+  ActorOwn<Impl> impl_;
+};
+
+unique_ptr<SqliteWalCheckpointerInterface> create_sqlite_wal_checkpointer(
+    std::shared_ptr<SqliteConnectionSafe> connection, double period, int32 scheduler_id) {
+  return td::make_unique<SqliteWalCheckpointer>(std::move(connection), period, scheduler_id);
+}
+
+}  // namespace td
@@ -0,0 +1,31 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/db/SqliteConnectionSafe.h"
+
+#include "td/utils/common.h"
+#include "td/utils/Promise.h"
+
+#include <memory>
+
+namespace td {
+
+class SqliteWalCheckpointerInterface {
+ public:
+  virtual ~SqliteWalCheckpointerInterface() = default;
+
+  virtual void close(Promise<Unit> promise) = 0;
+};
+
+// periodically does passive checkpoints of the WAL of the database using a connection on the given scheduler,
+// so connections, committing transactions, rarely need to checkpoint the WAL themselves;
+// checks are done less often while nothing is written to the database
+unique_ptr<SqliteWalCheckpointerInterface> create_sqlite_wal_checkpointer(
+    std::shared_ptr<SqliteConnectionSafe> connection, double period, int32 scheduler_id);
+
+}  // namespace td
@@ -11,6 +11,7 @@
 #include "td/net/Wget.h"
 
 #include "td/utils/common.h"
+#include "td/utils/format.h"
 #include "td/utils/JsonBuilder.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
@@ -18,26 +19,28 @@
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Time.h"
 
+#include <functional>
+
 namespace td {
 namespace detail {
 
 class GoogleDnsResolver final : public Actor {
  public:
-  GoogleDnsResolver(std::string host, bool prefer_ipv6, Promise<IPAddress> promise)
+  GoogleDnsResolver(std::string host, bool prefer_ipv6, Promise<vector<IPAddress>> promise)
       : host_(std::move(host)), prefer_ipv6_(prefer_ipv6), promise_(std::move(promise)) {
   }
 
  private:
   std::string host_;
   bool prefer_ipv6_;
-  Promise<IPAddress> promise_;
+  Promise<vector<IPAddress>> promise_;
   ActorOwn<Wget> wget_;
   double begin_time_ = 0;
 
   void start_up() final {
     auto r_address = IPAddress::get_ip_address(host_);
     if (r_address.is_ok()) {
-      promise_.set_value(r_address.move_as_ok());
+      promise_.set_value({r_address.move_as_ok()});
       return stop();
     }
 
@@ -54,29 +57,37 @@ class GoogleDnsResolver final : public Actor {
         SslCtx::VerifyPeer::Off);
   }
 
-  static Result<IPAddress> get_ip_address(Result<unique_ptr<HttpQuery>> r_http_query) {
+  static Result<vector<IPAddress>> get_ip_addresses(Result<unique_ptr<HttpQuery>> r_http_query) {
     TRY_RESULT(http_query, std::move(r_http_query));
 
-    auto get_ip_address = [](JsonValue &answer) -> Result<IPAddress> {
+    auto get_ip_addresses = [](JsonValue &answer) -> Result<vector<IPAddress>> {
       auto &array = answer.get_array();
       if (array.empty()) {
         return Status::Error("Failed to parse DNS result: Answer is an empty array");
       }
-      if (array[0].type() != JsonValue::Type::Object) {
-        return Status::Error("Failed to parse DNS result: Answer[0] is not an object");
+      vector<IPAddress> result;
+      for (auto &record : array) {
+        if (record.type() != JsonValue::Type::Object) {
+          return Status::Error("Failed to parse DNS result: Answer element is not an object");
+        }
+        TRY_RESULT(ip_str, record.get_object().get_required_string_field("data"));
+        // skip CNAME records
+        auto r_ip = IPAddress::get_ip_address(ip_str);
+        if (r_ip.is_ok()) {
+          result.push_back(r_ip.move_as_ok());
+        }
+      }
+      if (result.empty()) {
+        return Status::Error("Failed to parse DNS result: Answer has no IP addresses");
       }
-      auto &answer_0 = array[0].get_object();
-      TRY_RESULT(ip_str, answer_0.get_required_string_field("data"));
-      IPAddress ip;
-      TRY_STATUS(ip.init_host_port(ip_str, 0));
-      return ip;
+      return std::move(result);
     };
     if (!http_query->get_arg("Answer").empty()) {
       TRY_RESULT(answer, json_decode(http_query->get_arg("Answer")));
       if (answer.type() != JsonValue::Type::Array) {
         return Status::Error("Expected JSON array");
       }
-      return get_ip_address(answer);
+      return get_ip_addresses(answer);
     } else {
       TRY_RESULT(json_value, json_decode(http_query->content_));
       if (json_value.type() != JsonValue::Type::Object) {
@@ -84,16 +95,16 @@ class GoogleDnsResolver final : public Actor {
       }
       auto &object = json_value.get_object();
       TRY_RESULT(answer, object.extract_required_field("Answer", JsonValue::Type::Array));
-      return get_ip_address(answer);
+      return get_ip_addresses(answer);
     }
   }
 
   void on_result(Result<unique_ptr<HttpQuery>> r_http_query) {
     auto end_time = Time::now();
-    auto result = get_ip_address(std::move(r_http_query));
+    auto result = get_ip_addresses(std::move(r_http_query));
     VLOG(dns_resolver) << "Init IPv" << (prefer_ipv6_ ? "6" : "4") << " host = " << host_ << " in "
                        << end_time - begin_time_ << " seconds to "
-                       << (result.is_ok() ? (PSLICE() << result.ok()) : CSlice("[invalid]"));
+                       << (result.is_ok() ? (PSLICE() << format::as_array(result.ok())) : CSlice("[invalid]"));
     promise_.set_result(std::move(result));
     stop();
   }
@@ -101,26 +112,45 @@ class GoogleDnsResolver final : public Actor {
 
 class NativeDnsResolver final : public Actor {
  public:
-  NativeDnsResolver(std::string host, bool prefer_ipv6, Promise<IPAddress> promise)
+  NativeDnsResolver(std::string host, bool prefer_ipv6, Promise<vector<IPAddress>> promise)
       : host_(std::move(host)), prefer_ipv6_(prefer_ipv6), promise_(std::move(promise)) {
   }
 
  private:
   std::string host_;
   bool prefer_ipv6_;
-  Promise<IPAddress> promise_;
+  Promise<vector<IPAddress>> promise_;
 
   void start_up() final {
-    IPAddress ip;
     auto begin_time = Time::now();
-    auto status = ip.init_host_port(host_, 0, prefer_ipv6_);
+    auto r_ip_addresses = IPAddress::get_host_ip_addresses(host_, "0");
     auto end_time = Time::now();
-    VLOG(dns_resolver) << "Init host = " << host_ << " in " << end_time - begin_time << " seconds to " << ip;
-    if (status.is_error()) {
-      promise_.set_error(std::move(status));
-    } else {
-      promise_.set_value(std::move(ip));
-    }
+    VLOG(dns_resolver) << "Init host = " << host_ << " in " << end_time - begin_time << " seconds to "
+                       << (r_ip_addresses.is_ok() ? (PSLICE() << format::as_array(r_ip_addresses.ok()))
+                                                  : CSlice("[invalid]"));
+    promise_.set_result(std::move(r_ip_addresses));
+    stop();
+  }
+};
+
+class CustomDnsResolver final : public Actor {
+ public:
+  CustomDnsResolver(std::function<Result<vector<IPAddress>>(const string &host, bool prefer_ipv6)> resolver,
+                    std::string host, bool prefer_ipv6, Promise<vector<IPAddress>> promise)
+      : resolver_(std::move(resolver))
+      , host_(std::move(host))
+      , prefer_ipv6_(prefer_ipv6)
+      , promise_(std::move(promise)) {
+  }
+
+ private:
+  std::function<Result<vector<IPAddress>>(const string &host, bool prefer_ipv6)> resolver_;
+  std::string host_;
+  bool prefer_ipv6_;
+  Promise<vector<IPAddress>> promise_;
+
+  void start_up() final {
+    promise_.set_result(resolver_(host_, prefer_ipv6_));
     stop();
   }
 };
@@ -131,9 +161,20 @@ int VERBOSITY_NAME(dns_resolver) = VERBOSITY_NAME(DEBUG);
 
 GetHostByNameActor::GetHostByNameActor(Options options) : options_(std::move(options)) {
   CHECK(!options_.resolver_types.empty());
+  options_.prefetch_time = min(options_.prefetch_time, options_.ok_timeout * 0.1);
 }
 
 void GetHostByNameActor::run(string host, int port, bool prefer_ipv6, Promise<IPAddress> promise) {
+  run_all(std::move(host), port, prefer_ipv6,
+          PromiseCreator::lambda([promise = std::move(promise)](Result<vector<IPAddress>> r_ip_addresses) mutable {
+            if (r_ip_addresses.is_error()) {
+              return promise.set_error(r_ip_addresses.move_as_error());
+            }
+            promise.set_value(std::move(r_ip_addresses.ok_ref()[0]));
+          }));
+}
+
+void GetHostByNameActor::run_all(string host, int port, bool prefer_ipv6, Promise<vector<IPAddress>> promise) {
   auto r_ascii_host = idn_to_ascii(host);
   if (r_ascii_host.is_error()) {
     return promise.set_error(r_ascii_host.move_as_error());
@@ -144,29 +185,75 @@ void GetHostByNameActor::run(string host, int port, bool prefer_ipv6, Promise<IP
   }
 
   auto begin_time = Time::now();
-  auto &value = cache_[prefer_ipv6].emplace(ascii_host, Value{{}, begin_time - 1.0}).first->second;
+  auto &value = cache_[prefer_ipv6].emplace(ascii_host, Value{{}, begin_time - 1.0, 0.0}).first->second;
   if (value.expires_at > begin_time) {
-    return promise.set_result(value.get_ip_port(port));
+    stats_.hit_count++;
+    auto result = value.get_ip_ports(port);
+    if (value.ips.is_ok() && value.expires_at < begin_time + options_.prefetch_time) {
+      // the host is still used, so resolve it again before the addresses expire
+      start_query(std::move(ascii_host), std::move(host), prefer_ipv6);
+    }
+    return promise.set_result(std::move(result));
+  }
+  if (value.ips.is_ok() && value.stale_expires_at > begin_time) {
+    // return the expired addresses immediately and update them in background
+    stats_.stale_hit_count++;
+    auto result = value.get_ip_ports(port);
+    start_query(std::move(ascii_host), std::move(host), prefer_ipv6);
+    return promise.set_result(std::move(result));
+  }
+
+  stats_.blocked_count++;
+  auto &query = start_query(std::move(ascii_host), std::move(host), prefer_ipv6);
+  query.promises.emplace_back(port, std::move(promise));
+}
+
+void GetHostByNameActor::get_stats(Promise<Stats> promise) {
+  promise.set_value(Stats(stats_));
+}
+
+vector<IPAddress> GetHostByNameActor::sort_ip_addresses(vector<IPAddress> ip_addresses, bool prefer_ipv6) {
+  vector<IPAddress> preferred_ip_addresses;
+  vector<IPAddress> other_ip_addresses;
+  for (auto &ip_address : ip_addresses) {
+    if (ip_address.is_ipv6() == prefer_ipv6) {
+      preferred_ip_addresses.push_back(std::move(ip_address));
+    } else {
+      other_ip_addresses.push_back(std::move(ip_address));
+    }
   }
 
+  // interleave address families as recommended by Happy Eyeballs, so that a connection to an address of another
+  // family is tried early if addresses of the preferred family are unreachable
+  vector<IPAddress> result;
+  result.reserve(ip_addresses.size());
+  for (size_t i = 0; i < max(preferred_ip_addresses.size(), other_ip_addresses.size()); i++) {
+    if (i < preferred_ip_addresses.size()) {
+      result.push_back(std::move(preferred_ip_addresses[i]));
+    }
+    if (i < other_ip_addresses.size()) {
+      result.push_back(std::move(other_ip_addresses[i]));
+    }
+  }
+  return result;
+}
+
+GetHostByNameActor::Query &GetHostByNameActor::start_query(string ascii_host, string real_host, bool prefer_ipv6) {
   auto &query_ptr = active_queries_[prefer_ipv6][ascii_host];
   if (query_ptr == nullptr) {
     query_ptr = make_unique<Query>();
+    query_ptr->real_host = std::move(real_host);
+    query_ptr->begin_time = Time::now();
+    run_query(std::move(ascii_host), prefer_ipv6, *query_ptr);
   }
-  auto &query = *query_ptr;
-  query.promises.emplace_back(port, std::move(promise));
-  if (query.query.empty()) {
-    CHECK(query.promises.size() == 1);
-    query.real_host = std::move(host);
-    query.begin_time = Time::now();
-    run_query(std::move(ascii_host), prefer_ipv6, query);
-  }
+  return *query_ptr;
 }
 
 void GetHostByNameActor::run_query(std::string host, bool prefer_ipv6, Query &query) {
-  auto promise = PromiseCreator::lambda([actor_id = actor_id(this), host, prefer_ipv6](Result<IPAddress> res) mutable {
-    send_closure(actor_id, &GetHostByNameActor::on_query_result, std::move(host), prefer_ipv6, std::move(res));
-  });
+  auto promise =
+      PromiseCreator::lambda([actor_id = actor_id(this), host, prefer_ipv6](Result<vector<IPAddress>> res) mutable {
+        send_closure(actor_id, &GetHostByNameActor::on_query_result, std::move(host), prefer_ipv6, std::move(res));
+      });
 
   CHECK(query.query.empty());
   CHECK(query.pos < options_.resolver_types.size());
@@ -179,6 +266,11 @@ void GetHostByNameActor::run_query(std::string host, bool prefer_ipv6, Query &qu
       case ResolverType::Google:
         return ActorOwn<>(create_actor_on_scheduler<detail::GoogleDnsResolver>(
             "GoogleDnsResolver", options_.scheduler_id, std::move(host), prefer_ipv6, std::move(promise)));
+      case ResolverType::Custom:
+        CHECK(options_.custom_resolver != nullptr);
+        return ActorOwn<>(create_actor_on_scheduler<detail::CustomDnsResolver>(
+            "CustomDnsResolver", options_.scheduler_id, options_.custom_resolver, std::move(host), prefer_ipv6,
+            std::move(promise)));
       default:
         UNREACHABLE();
         return ActorOwn<>();
@@ -186,13 +278,15 @@ void GetHostByNameActor::run_query(std::string host, bool prefer_ipv6, Query &qu
   }();
 }
 
-void GetHostByNameActor::on_query_result(std::string host, bool prefer_ipv6, Result<IPAddress> result) {
+void GetHostByNameActor::on_query_result(std::string host, bool prefer_ipv6, Result<vector<IPAddress>> result) {
   auto query_it = active_queries_[prefer_ipv6].find(host);
   CHECK(query_it != active_queries_[prefer_ipv6].end());
   auto &query = *query_it->second;
-  CHECK(!query.promises.empty());
   CHECK(!query.query.empty());
 
+  if (result.is_ok() && result.ok().empty()) {
+    result = Status::Error("Failed to find IPv4/IPv6 address");
+  }
   if (result.is_error() && query.pos < options_.resolver_types.size()) {
     query.query.reset();
     return run_query(std::move(host), prefer_ipv6, query);
@@ -200,17 +294,30 @@ void GetHostByNameActor::on_query_result(std::string host, bool prefer_ipv6, Res
 
   auto end_time = Time::now();
   VLOG(dns_resolver) << "Init host = " << query.real_host << " in total of " << end_time - query.begin_time
-                     << " seconds to " << (result.is_ok() ? (PSLICE() << result.ok()) : CSlice("[invalid]"));
+                     << " seconds to "
+                     << (result.is_ok() ? (PSLICE() << format::as_array(result.ok())) : CSlice("[invalid]"));
 
   auto promises = std::move(query.promises);
+  if (promises.empty()) {
+    stats_.refresh_count++;
+  }
+  active_queries_[prefer_ipv6].erase(query_it);
+
   auto value_it = cache_[prefer_ipv6].find(host);
   CHECK(value_it != cache_[prefer_ipv6].end());
-  auto cache_timeout = result.is_ok() ? options_.ok_timeout : options_.error_timeout;
-  value_it->second = Value{std::move(result), end_time + cache_timeout};
-  active_queries_[prefer_ipv6].erase(query_it);
+  auto &value = value_it->second;
+  if (result.is_ok()) {
+    auto expires_at = end_time + options_.ok_timeout;
+    value = Value{sort_ip_addresses(result.move_as_ok(), prefer_ipv6), expires_at, expires_at + options_.stale_timeout};
+  } else if (value.ips.is_ok() && value.stale_expires_at > end_time) {
+    // keep the previous addresses, but don't try to resolve the host again too often
+    value.expires_at = min(end_time + options_.error_timeout, value.stale_expires_at);
+  } else {
+    value = Value{std::move(result), end_time + options_.error_timeout, 0.0};
+  }
 
   for (auto &promise : promises) {
-    promise.second.set_result(value_it->second.get_ip_port(promise.first));
+    promise.second.set_result(value.get_ip_ports(promise.first));
   }
 }
 
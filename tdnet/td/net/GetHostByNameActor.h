@@ -15,6 +15,7 @@
 #include "td/utils/Promise.h"
 #include "td/utils/Status.h"
 
+#include <functional>
 #include <utility>
 
 namespace td {
@@ -23,36 +24,64 @@ extern int VERBOSITY_NAME(dns_resolver);
 
 class GetHostByNameActor final : public Actor {
  public:
-  enum class ResolverType { Native, Google };
+  enum class ResolverType { Native, Google, Custom };
 
   struct Options {
     static constexpr int32 DEFAULT_CACHE_TIME = 60 * 29;       // 29 minutes
     static constexpr int32 DEFAULT_ERROR_CACHE_TIME = 60 * 5;  // 5 minutes
+    static constexpr int32 DEFAULT_PREFETCH_TIME = 60;         // 1 minute
 
     vector<ResolverType> resolver_types{ResolverType::Native};
     int32 scheduler_id{-1};
-    int32 ok_timeout{DEFAULT_CACHE_TIME};
-    int32 error_timeout{DEFAULT_ERROR_CACHE_TIME};
+    double ok_timeout{DEFAULT_CACHE_TIME};
+    double error_timeout{DEFAULT_ERROR_CACHE_TIME};
+    // expired addresses are returned during the time while they are re-resolved in background;
+    // disabled by default, because the addresses can be outdated
+    double stale_timeout{0.0};
+    // requested addresses are re-resolved in background if they expire in less than the time,
+    // but not more than 10% of ok_timeout
+    double prefetch_time{DEFAULT_PREFETCH_TIME};
+    // the resolver used by ResolverType::Custom, for example, in tests
+    std::function<Result<vector<IPAddress>>(const string &host, bool prefer_ipv6)> custom_resolver;
+  };
+
+  struct Stats {
+    uint64 hit_count = 0;
+    uint64 stale_hit_count = 0;
+    uint64 blocked_count = 0;
+    uint64 refresh_count = 0;
   };
 
   explicit GetHostByNameActor(Options options);
 
   void run(std::string host, int port, bool prefer_ipv6, Promise<IPAddress> promise);
 
+  // returns all known addresses of the host in the order, in which connections to them must be tried
+  void run_all(std::string host, int port, bool prefer_ipv6, Promise<vector<IPAddress>> promise);
+
+  void get_stats(Promise<Stats> promise);
+
+  // orders addresses of different families alternately, starting from the preferred family
+  static vector<IPAddress> sort_ip_addresses(vector<IPAddress> ip_addresses, bool prefer_ipv6);
+
  private:
-  void on_query_result(std::string host, bool prefer_ipv6, Result<IPAddress> result);
+  void on_query_result(std::string host, bool prefer_ipv6, Result<vector<IPAddress>> result);
 
   struct Value {
-    Result<IPAddress> ip;
+    Result<vector<IPAddress>> ips;
     double expires_at;
+    double stale_expires_at;
 
-    Value(Result<IPAddress> ip, double expires_at) : ip(std::move(ip)), expires_at(expires_at) {
+    Value(Result<vector<IPAddress>> ips, double expires_at, double stale_expires_at)
+        : ips(std::move(ips)), expires_at(expires_at), stale_expires_at(stale_expires_at) {
     }
 
-    Result<IPAddress> get_ip_port(int port) const {
-      auto result = ip.clone();
+    Result<vector<IPAddress>> get_ip_ports(int port) const {
+      auto result = ips.clone();
       if (result.is_ok()) {
-        result.ok_ref().set_port(port);
+        for (auto &ip : result.ok_ref()) {
+          ip.set_port(port);
+        }
       }
       return result;
     }
@@ -64,11 +93,14 @@ class GetHostByNameActor final : public Actor {
     size_t pos = 0;
     string real_host;
     double begin_time = 0.0;
-    std::vector<std::pair<int, Promise<IPAddress>>> promises;
+    std::vector<std::pair<int, Promise<vector<IPAddress>>>> promises;
   };
   FlatHashMap<string, unique_ptr<Query>> active_queries_[2];
 
   Options options_;
+  Stats stats_;
+
+  Query &start_query(string ascii_host, string real_host, bool prefer_ipv6);
 
   void run_query(std::string host, bool prefer_ipv6, Query &query);
 };
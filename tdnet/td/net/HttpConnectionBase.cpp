@@ -47,7 +47,7 @@ void HttpConnectionBase::start_up() {
   Scheduler::subscribe(fd_.get_poll_info().extract_pollable_fd(this));
   reader_.init(read_sink_.get_output(), max_post_size_, max_files_);
   if (state_ == State::Read) {
-    current_query_ = make_unique<HttpQuery>();
+    create_current_query();
   }
   live_event();
   yield();
@@ -68,12 +68,26 @@ void HttpConnectionBase::write_next(BufferSlice buffer) {
 
 void HttpConnectionBase::write_ok() {
   CHECK(state_ == State::Write);
-  current_query_ = make_unique<HttpQuery>();
+  create_current_query();
   state_ = State::Read;
   live_event();
   loop();
 }
 
+void HttpConnectionBase::reuse_query(unique_ptr<HttpQuery> query) {
+  CHECK(query != nullptr);
+  query->clear();
+  free_query_ = std::move(query);
+}
+
+void HttpConnectionBase::create_current_query() {
+  if (free_query_ != nullptr) {
+    current_query_ = std::move(free_query_);
+  } else {
+    current_query_ = make_unique<HttpQuery>();
+  }
+}
+
 void HttpConnectionBase::write_error(Status error) {
   CHECK(state_ == State::Write);
   LOG(WARNING) << "Close HTTP connection: " << error;
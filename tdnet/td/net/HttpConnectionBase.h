@@ -30,6 +30,9 @@ class HttpConnectionBase : public Actor {
   void write_ok();
   void write_error(Status error);
 
+  // returns a handled query to the connection to reuse its memory for the next query
+  void reuse_query(unique_ptr<HttpQuery> query);
+
  protected:
   enum class State { Read, Write, Close };
   HttpConnectionBase(State state, BufferedFd<SocketFd> fd, SslStream ssl_stream, size_t max_post_size, size_t max_files,
@@ -55,12 +58,15 @@ class HttpConnectionBase : public Actor {
   int32 idle_timeout_;
   HttpReader reader_;
   unique_ptr<HttpQuery> current_query_;
+  unique_ptr<HttpQuery> free_query_;
   bool close_after_write_ = false;
 
   int32 slow_scheduler_id_{-1};
 
   void live_event();
 
+  void create_current_query();
+
   void start_up() final;
   void tear_down() final;
   void timeout_expired() final;
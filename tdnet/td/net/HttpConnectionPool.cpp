@@ -0,0 +1,342 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/net/HttpConnectionPool.h"
+
+#include "td/net/SslStream.h"
+#include "td/net/Wget.h"
+
+#include "td/utils/algorithm.h"
+#include "td/utils/BufferedFd.h"
+#include "td/utils/HttpUrl.h"
+#include "td/utils/logging.h"
+#include "td/utils/port/IPAddress.h"
+#include "td/utils/port/SocketFd.h"
+#include "td/utils/SliceBuilder.h"
+#include "td/utils/Time.h"
+
+#include <limits>
+
+namespace td {
+
+HttpConnectionPool::HttpConnectionPool(Options options) : options_(std::move(options)) {
+  CHECK(options_.max_connections_per_host > 0);
+  CHECK(options_.max_pipelined_queries > 0);
+}
+
+void HttpConnectionPool::send_query(string url, vector<std::pair<string, string>> headers, string content,
+                                    string content_type, Promise<unique_ptr<HttpQuery>> promise) {
+  auto query = make_unique<Query>();
+  query->url_ = std::move(url);
+  query->headers_ = std::move(headers);
+  query->content_ = std::move(content);
+  query->content_type_ = std::move(content_type);
+  query->timeout_at_ = Time::now() + options_.query_timeout;
+  query->promise_ = std::move(promise);
+
+  auto query_id = ++query_id_;
+  queries_.emplace(query_id, std::move(query));
+  add_query(query_id);
+  update_timeout();
+}
+
+void HttpConnectionPool::add_query(uint64 query_id) {
+  auto &query = queries_[query_id];
+  CHECK(query != nullptr);
+  auto r_url = parse_url(query->url_);
+  if (r_url.is_error()) {
+    return finish_query(query_id, r_url.move_as_error());
+  }
+  auto url = r_url.move_as_ok();
+  auto r_host = idn_to_ascii(url.host_);
+  if (r_host.is_error()) {
+    return finish_query(query_id, r_host.move_as_error());
+  }
+  url.host_ = r_host.move_as_ok();
+  auto r_request = Wget::create_request(url, query->headers_, query->content_, query->content_type_);
+  if (r_request.is_error()) {
+    return finish_query(query_id, r_request.move_as_error());
+  }
+  query->request_ = r_request.move_as_ok();
+
+  bool is_https = url.protocol_ == HttpUrl::Protocol::Https;
+  query->host_key_ = PSTRING() << (is_https ? "https://" : "http://") << url.host_ << ':' << url.port_;
+  auto &host = hosts_[query->host_key_];
+  if (host == nullptr) {
+    host = make_unique<Host>();
+    host->host_ = url.host_;
+    host->port_ = url.port_;
+    host->is_https_ = is_https;
+  }
+  host->pending_query_ids_.push(query_id);
+
+  auto host_key = query->host_key_;
+  process_host(host_key);
+}
+
+void HttpConnectionPool::process_host(const string &host_key) {
+  auto host_it = hosts_.find(host_key);
+  if (host_it == hosts_.end()) {
+    return;
+  }
+  auto &host = *host_it->second;
+  while (!host.pending_query_ids_.empty()) {
+    auto query_id = host.pending_query_ids_.front();
+    if (queries_.count(query_id) == 0) {
+      // the query has already failed
+      host.pending_query_ids_.pop();
+      continue;
+    }
+
+    // choose the least loaded connection, which can accept the query
+    Connection *connection = nullptr;
+    for (auto connection_id : host.connection_ids_) {
+      auto *candidate = connections_[connection_id].get();
+      CHECK(candidate != nullptr);
+      if (candidate->is_reading_ || candidate->sent_query_ids_.size() >= options_.max_pipelined_queries) {
+        continue;
+      }
+      if (connection == nullptr || candidate->sent_query_ids_.size() < connection->sent_query_ids_.size()) {
+        connection = candidate;
+      }
+    }
+    if (connection == nullptr) {
+      if (host.connection_ids_.size() >= options_.max_connections_per_host) {
+        break;
+      }
+      auto r_connection_id = create_connection(host_key, host);
+      if (r_connection_id.is_error()) {
+        host.pending_query_ids_.pop();
+        finish_query(query_id, r_connection_id.move_as_error());
+        continue;
+      }
+      auto connection_id = r_connection_id.ok();
+      host.connection_ids_.push_back(connection_id);
+      connection = connections_[connection_id].get();
+    }
+
+    host.pending_query_ids_.pop();
+    auto &query = queries_[query_id];
+    LOG(DEBUG) << "Send query " << query_id << " to " << host_key;
+    send_closure(connection->connection_, &HttpOutboundConnection::write_next, query->request_.clone());
+    connection->sent_query_ids_.push(query_id);
+  }
+
+  // start to read responses for all sent requests
+  for (auto connection_id : host.connection_ids_) {
+    auto &connection = connections_[connection_id];
+    if (!connection->is_reading_ && !connection->sent_query_ids_.empty()) {
+      send_closure(connection->connection_, &HttpOutboundConnection::write_ok);
+      connection->is_reading_ = true;
+    }
+  }
+
+  if (host.connection_ids_.empty() && host.pending_query_ids_.empty()) {
+    LOG(DEBUG) << "Forget " << host_key;
+    hosts_.erase(host_it);
+  }
+}
+
+Result<uint64> HttpConnectionPool::create_connection(const string &host_key, const Host &host) {
+  IPAddress addr;
+  TRY_STATUS(addr.init_host_port(host.host_, host.port_, options_.prefer_ipv6));
+
+  TRY_RESULT(fd, SocketFd::open(addr));
+  if (fd.empty()) {
+    return Status::Error("Sockets are not supported");
+  }
+  SslStream ssl_stream;
+  if (host.is_https_) {
+    TRY_RESULT(ssl_ctx, SslCtx::create(CSlice() /* certificate */, options_.verify_peer));
+    TRY_RESULT_ASSIGN(ssl_stream, SslStream::create(host.host_, std::move(ssl_ctx)));
+  }
+
+  auto connection_id = ++connection_id_;
+  LOG(INFO) << "Create connection " << connection_id << " to " << host_key;
+  auto connection = make_unique<Connection>();
+  connection->host_key_ = host_key;
+  connection->connection_ = create_actor<HttpOutboundConnection>(
+      "HttpOutboundConnection", BufferedFd<SocketFd>(std::move(fd)), std::move(ssl_stream),
+      std::numeric_limits<std::size_t>::max(), 0, 0, actor_shared(this, connection_id));
+  connection->idle_since_ = Time::now();
+  connections_.emplace(connection_id, std::move(connection));
+  return connection_id;
+}
+
+void HttpConnectionPool::close_connection(uint64 connection_id, Status error) {
+  auto it = connections_.find(connection_id);
+  if (it == connections_.end()) {
+    return;
+  }
+  auto connection = std::move(it->second);
+  connections_.erase(it);
+  LOG(INFO) << "Close connection " << connection_id << " to " << connection->host_key_ << ": " << error;
+
+  auto host_key = connection->host_key_;
+  auto &host = hosts_[host_key];
+  CHECK(host != nullptr);
+  td::remove(host->connection_ids_, connection_id);
+
+  while (!connection->sent_query_ids_.empty()) {
+    auto query_id = connection->sent_query_ids_.pop();
+    auto query_it = queries_.find(query_id);
+    if (query_it == queries_.end()) {
+      continue;
+    }
+    auto &query = query_it->second;
+    if (query->content_.empty() && !query->was_resent_) {
+      // the server could close the connection without processing the request, so it is safe to resend GET requests
+      query->was_resent_ = true;
+      host->pending_query_ids_.push(query_id);
+    } else {
+      finish_query(query_id, error.clone());
+    }
+  }
+  connection.reset();  // closes the connection
+
+  process_host(host_key);
+}
+
+void HttpConnectionPool::on_query_result(uint64 query_id, Result<unique_ptr<HttpQuery>> r_http_query) {
+  if (r_http_query.is_error()) {
+    return finish_query(query_id, r_http_query.move_as_error());
+  }
+
+  auto http_query = r_http_query.move_as_ok();
+  auto code = http_query->code_;
+  if (code == 301 || code == 302 || code == 307 || code == 308) {
+    auto &query = queries_[query_id];
+    if (query->redirect_count_ < options_.max_redirect_count) {
+      query->redirect_count_++;
+      query->url_ = http_query->get_header("location").str();
+      query->was_resent_ = false;
+      LOG(DEBUG) << "Redirect query " << query_id << " to " << query->url_;
+      return add_query(query_id);
+    }
+  }
+  if (code >= 200 && code < 300) {
+    return finish_query(query_id, std::move(http_query));
+  }
+  finish_query(query_id, Status::Error(PSLICE() << "HTTP error: " << code));
+}
+
+void HttpConnectionPool::finish_query(uint64 query_id, Result<unique_ptr<HttpQuery>> r_http_query) {
+  auto it = queries_.find(query_id);
+  CHECK(it != queries_.end());
+  auto promise = std::move(it->second->promise_);
+  queries_.erase(it);
+  promise.set_result(std::move(r_http_query));
+}
+
+void HttpConnectionPool::handle(unique_ptr<HttpQuery> result) {
+  auto connection_id = get_link_token();
+  auto it = connections_.find(connection_id);
+  if (it == connections_.end()) {
+    return;
+  }
+  auto &connection = *it->second;
+  CHECK(connection.is_reading_);
+  CHECK(!connection.sent_query_ids_.empty());
+  connection.is_reading_ = false;
+  auto query_id = connection.sent_query_ids_.pop();
+  if (connection.sent_query_ids_.empty()) {
+    connection.idle_since_ = Time::now();
+  }
+  bool keep_alive = result->keep_alive_;
+  auto host_key = connection.host_key_;
+
+  if (queries_.count(query_id) != 0) {
+    on_query_result(query_id, std::move(result));
+  }
+
+  if (!keep_alive) {
+    close_connection(connection_id, Status::Error("Connection closed by server"));
+  }
+  process_host(host_key);
+  update_timeout();
+}
+
+void HttpConnectionPool::on_connection_error(Status error) {
+  close_connection(get_link_token(), std::move(error));
+  update_timeout();
+}
+
+void HttpConnectionPool::hangup_shared() {
+  close_connection(get_link_token(), Status::Error("Connection closed"));
+  update_timeout();
+}
+
+void HttpConnectionPool::loop() {
+  auto now = Time::now();
+
+  vector<uint64> expired_query_ids;
+  for (auto &it : queries_) {
+    if (it.second->timeout_at_ <= now) {
+      expired_query_ids.push_back(it.first);
+    }
+  }
+  for (auto query_id : expired_query_ids) {
+    finish_query(query_id, Status::Error("Response timeout expired"));
+  }
+
+  // responses are received in order, so connections with expired queries can't be used anymore
+  vector<uint64> closed_connection_ids;
+  for (auto &it : connections_) {
+    auto &connection = *it.second;
+    bool is_expired = false;
+    if (connection.sent_query_ids_.empty()) {
+      is_expired = connection.idle_since_ + options_.idle_timeout <= now;
+    } else {
+      for (auto query_id : connection.sent_query_ids_.as_span()) {
+        if (queries_.count(query_id) == 0) {
+          is_expired = true;
+        }
+      }
+    }
+    if (is_expired) {
+      closed_connection_ids.push_back(it.first);
+    }
+  }
+  for (auto connection_id : closed_connection_ids) {
+    close_connection(connection_id, Status::Error("Timeout expired"));
+  }
+
+  update_timeout();
+}
+
+void HttpConnectionPool::update_timeout() {
+  double next_timeout_at = 0.0;
+  auto update_next_timeout_at = [&next_timeout_at](double timeout_at) {
+    if (next_timeout_at == 0.0 || timeout_at < next_timeout_at) {
+      next_timeout_at = timeout_at;
+    }
+  };
+  for (auto &it : queries_) {
+    update_next_timeout_at(it.second->timeout_at_);
+  }
+  for (auto &it : connections_) {
+    if (it.second->sent_query_ids_.empty()) {
+      update_next_timeout_at(it.second->idle_since_ + options_.idle_timeout);
+    }
+  }
+  if (next_timeout_at == 0.0) {
+    cancel_timeout();
+  } else {
+    set_timeout_at(next_timeout_at);
+  }
+}
+
+void HttpConnectionPool::tear_down() {
+  vector<uint64> query_ids;
+  for (auto &it : queries_) {
+    query_ids.push_back(it.first);
+  }
+  for (auto query_id : query_ids) {
+    finish_query(query_id, Status::Error("Canceled"));
+  }
+}
+
+}  // namespace td
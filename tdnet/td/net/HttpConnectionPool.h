@@ -0,0 +1,112 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/net/HttpOutboundConnection.h"
+#include "td/net/HttpQuery.h"
+#include "td/net/SslCtx.h"
+
+#include "td/actor/actor.h"
+
+#include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/Promise.h"
+#include "td/utils/Status.h"
+#include "td/utils/VectorQueue.h"
+
+#include <utility>
+
+namespace td {
+
+// sends HTTP requests like Wget, but keeps connections alive and reuses them for subsequent requests to the same host
+class HttpConnectionPool final : public HttpOutboundConnection::Callback {
+ public:
+  struct Options {
+    size_t max_connections_per_host = 4;
+    // the maximum number of requests sent through a connection before their responses are received;
+    // pipelining is disabled if it is equal to 1
+    size_t max_pipelined_queries = 1;
+    // unused connections are closed after the timeout
+    double idle_timeout = 30.0;
+    // the maximum time to receive a response, including time spent in the queue and on redirects
+    double query_timeout = 10.0;
+    int32 max_redirect_count = 3;
+    bool prefer_ipv6 = false;
+    SslCtx::VerifyPeer verify_peer = SslCtx::VerifyPeer::On;
+  };
+
+  explicit HttpConnectionPool(Options options);
+
+  // sends a GET request if the content is empty and a POST request otherwise
+  void send_query(string url, vector<std::pair<string, string>> headers, string content, string content_type,
+                  Promise<unique_ptr<HttpQuery>> promise);
+
+ private:
+  struct Query {
+    string url_;
+    vector<std::pair<string, string>> headers_;
+    string content_;
+    string content_type_;
+    string host_key_;
+    BufferSlice request_;
+    int32 redirect_count_ = 0;
+    bool was_resent_ = false;
+    double timeout_at_ = 0.0;
+    Promise<unique_ptr<HttpQuery>> promise_;
+  };
+
+  struct Connection {
+    string host_key_;
+    ActorOwn<HttpOutboundConnection> connection_;
+    VectorQueue<uint64> sent_query_ids_;
+    bool is_reading_ = false;
+    double idle_since_ = 0.0;
+  };
+
+  struct Host {
+    string host_;
+    int port_ = 0;
+    bool is_https_ = false;
+    vector<uint64> connection_ids_;
+    VectorQueue<uint64> pending_query_ids_;
+  };
+
+  Options options_;
+
+  FlatHashMap<uint64, unique_ptr<Query>> queries_;
+  FlatHashMap<uint64, unique_ptr<Connection>> connections_;
+  FlatHashMap<string, unique_ptr<Host>> hosts_;
+  uint64 query_id_ = 0;
+  uint64 connection_id_ = 0;
+
+  void add_query(uint64 query_id);
+
+  void process_host(const string &host_key);
+
+  Result<uint64> create_connection(const string &host_key, const Host &host);
+
+  void close_connection(uint64 connection_id, Status error);
+
+  void on_query_result(uint64 query_id, Result<unique_ptr<HttpQuery>> r_http_query);
+
+  void finish_query(uint64 query_id, Result<unique_ptr<HttpQuery>> r_http_query);
+
+  void update_timeout();
+
+  void handle(unique_ptr<HttpQuery> result) final;
+
+  void on_connection_error(Status error) final;
+
+  void hangup_shared() final;
+
+  void loop() final;
+
+  void tear_down() final;
+};
+
+}  // namespace td
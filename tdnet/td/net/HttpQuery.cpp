@@ -33,6 +33,20 @@ vector<std::pair<string, string>> HttpQuery::get_args() const {
   return res;
 }
 
+void HttpQuery::clear() {
+  container_.clear();
+  type_ = Type::Empty;
+  code_ = 0;
+  url_path_ = MutableSlice();
+  args_.clear();
+  reason_ = MutableSlice();
+  keep_alive_ = true;
+  headers_.clear();
+  files_.clear();
+  content_ = MutableSlice();
+  peer_address_ = IPAddress();
+}
+
 int HttpQuery::get_retry_after() const {
   auto value = get_header("retry-after");
   if (value.empty()) {
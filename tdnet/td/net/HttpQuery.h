@@ -43,6 +43,9 @@ class HttpQuery {
   vector<std::pair<string, string>> get_args() const;
 
   int get_retry_after() const;
+
+  // resets the query to the initial state, but keeps allocated memory to reuse it for the next query
+  void clear();
 };
 
 StringBuilder &operator<<(StringBuilder &sb, const HttpQuery &q);
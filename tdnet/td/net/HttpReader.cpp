@@ -583,7 +583,7 @@ void HttpReader::process_header(MutableSlice header_name, MutableSlice header_va
     }
   } else if (header_name == "content-type") {
     content_type_ = header_value;
-    content_type_lowercased_ = header_value.str();
+    content_type_lowercased_.assign(header_value.data(), header_value.size());
     to_lower_inplace(content_type_lowercased_);
   } else if (header_name == "content-encoding") {
     to_lower_inplace(header_value);
@@ -760,7 +760,7 @@ Status HttpReader::parse_head(MutableSlice head) {
 
   content_length_ = -1;
   content_type_ = Slice("application/octet-stream");
-  content_type_lowercased_ = content_type_.str();
+  content_type_lowercased_.assign(content_type_.data(), content_type_.size());
   transfer_encoding_ = Slice();
   content_encoding_ = Slice();
 
@@ -0,0 +1,76 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/net/MultiTcpListener.h"
+
+#include "td/utils/logging.h"
+#include "td/utils/port/ServerSocketFd.h"
+
+namespace td {
+
+class MultiTcpListener::Worker final : public TcpListener::Callback {
+ public:
+  Worker(int port, string server_address, bool need_listen, CallbackFactory callback_factory)
+      : port_(port)
+      , server_address_(std::move(server_address))
+      , need_listen_(need_listen)
+      , callback_factory_(std::move(callback_factory)) {
+  }
+
+  void accept(SocketFd fd) final {
+    send_closure(callback_, &TcpListener::Callback::accept, std::move(fd));
+  }
+
+ private:
+  int port_;
+  string server_address_;
+  bool need_listen_;
+  CallbackFactory callback_factory_;
+
+  ActorOwn<TcpListener::Callback> callback_;
+  ActorOwn<TcpListener> listener_;
+
+  void start_up() final {
+    callback_ = callback_factory_();
+    if (need_listen_) {
+      listener_ = create_actor<TcpListener>("TcpListener", port_, actor_shared(this), server_address_);
+    }
+  }
+};
+
+MultiTcpListener::MultiTcpListener(int port, vector<int32> scheduler_ids, CallbackFactory callback_factory,
+                                   Slice server_address, bool allow_port_reuse)
+    : port_(port)
+    , scheduler_ids_(std::move(scheduler_ids))
+    , callback_factory_(std::move(callback_factory))
+    , server_address_(server_address.str())
+    , allow_port_reuse_(allow_port_reuse) {
+  CHECK(!scheduler_ids_.empty());
+}
+
+void MultiTcpListener::start_up() {
+  bool use_port_reuse = allow_port_reuse_ && ServerSocketFd::is_port_reuse_balanced() && scheduler_ids_.size() > 1;
+  LOG(INFO) << "Listen on port " << port_ << " on " << scheduler_ids_.size() << " schedulers "
+            << (use_port_reuse ? "with" : "without") << " SO_REUSEPORT";
+  for (auto scheduler_id : scheduler_ids_) {
+    workers_.push_back(create_actor_on_scheduler<Worker>("MultiTcpListenerWorker", scheduler_id, port_,
+                                                         server_address_, use_port_reuse, callback_factory_));
+  }
+  if (!use_port_reuse) {
+    listener_ = create_actor<TcpListener>("TcpListener", port_, actor_shared(this), server_address_);
+  }
+}
+
+void MultiTcpListener::accept(SocketFd fd) {
+  // the connection isn't subscribed to any poll yet, so it can be passed to another scheduler
+  send_closure(workers_[next_worker_], &Worker::accept, std::move(fd));
+  next_worker_++;
+  if (next_worker_ == workers_.size()) {
+    next_worker_ = 0;
+  }
+}
+
+}  // namespace td
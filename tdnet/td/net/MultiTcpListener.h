@@ -0,0 +1,52 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/net/TcpListener.h"
+
+#include "td/actor/actor.h"
+
+#include "td/utils/common.h"
+#include "td/utils/port/SocketFd.h"
+#include "td/utils/Slice.h"
+
+#include <functional>
+
+namespace td {
+
+// listens on the port on several schedulers and passes every accepted connection to the callback created
+// on the scheduler, which accepted the connection, so all work with the connection is done on that scheduler
+// if the OS balances connections between sockets with SO_REUSEPORT, then there is a listener on each scheduler,
+// otherwise, or if port reuse isn't allowed, connections are accepted by a single listener and distributed
+// between schedulers in round-robin order
+class MultiTcpListener final : public TcpListener::Callback {
+ public:
+  // called once on each of the schedulers
+  using CallbackFactory = std::function<ActorOwn<TcpListener::Callback>()>;
+
+  MultiTcpListener(int port, vector<int32> scheduler_ids, CallbackFactory callback_factory,
+                   Slice server_address = Slice("0.0.0.0"), bool allow_port_reuse = true);
+
+ private:
+  class Worker;
+
+  int port_;
+  vector<int32> scheduler_ids_;
+  CallbackFactory callback_factory_;
+  const string server_address_;
+  bool allow_port_reuse_;
+
+  vector<ActorOwn<Worker>> workers_;
+  ActorOwn<TcpListener> listener_;
+  size_t next_worker_ = 0;
+
+  void start_up() final;
+
+  void accept(SocketFd fd) final;
+};
+
+}  // namespace td
@@ -6,6 +6,8 @@
 //
 #include "td/net/SslCtx.h"
 
+#include "td/net/SslSessionCache.h"
+
 #include "td/utils/common.h"
 #include "td/utils/crypto.h"
 #include "td/utils/FlatHashMap.h"
@@ -180,6 +182,7 @@ Result<SslCtxPtr> do_create_ssl_ctx(CSlice cert_file, SslCtx::VerifyPeer verify_
   SSL_CTX_set_min_proto_version(ssl_ctx, TLS1_VERSION);
 #endif
   SSL_CTX_set_mode(ssl_ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER | SSL_MODE_ENABLE_PARTIAL_WRITE);
+  SslSessionCache::enable(ssl_ctx);
 
   if (cert_file.empty()) {
     auto *store = load_system_certificate_store();
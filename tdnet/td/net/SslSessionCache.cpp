@@ -0,0 +1,178 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/net/SslSessionCache.h"
+
+#if !TD_EMSCRIPTEN
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/logging.h"
+#include "td/utils/SliceBuilder.h"
+
+#include <openssl/crypto.h>
+#include <openssl/ssl.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+namespace td {
+
+namespace {
+
+constexpr size_t MAX_SESSION_COUNT = 1000;
+
+std::atomic<uint64> session_hit_count{0};
+std::atomic<uint64> session_miss_count{0};
+
+void free_session_key(void *parent, void *ptr, CRYPTO_EX_DATA *ad, int idx, long argl, void *argp) {
+  delete static_cast<string *>(ptr);
+}
+
+// the identifier of the context, which is used as a part of the session key
+int get_ssl_ctx_ex_data_index() {
+  static int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+  return index;
+}
+
+// the session key of the connection
+int get_ssl_ex_data_index() {
+  static int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, free_session_key);
+  return index;
+}
+
+class SessionStorage {
+ public:
+  static SessionStorage &instance() {
+    // never destroyed, because sessions can't be freed after OpenSSL is deinitialized
+    static auto *storage = new SessionStorage();
+    return *storage;
+  }
+
+  void add(const string &key, SSL_SESSION *session) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sessions_.find(key);
+    if (it != sessions_.end()) {
+      SSL_SESSION_free(it->second);
+      it->second = session;
+      return;
+    }
+    if (sessions_.size() >= MAX_SESSION_COUNT) {
+      // evict an arbitrary session
+      auto evicted_it = sessions_.begin();
+      SSL_SESSION_free(evicted_it->second);
+      sessions_.erase(evicted_it);
+    }
+    sessions_.emplace(key, session);
+  }
+
+  bool resume(const string &key, SSL *ssl) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sessions_.find(key);
+    if (it == sessions_.end()) {
+      return false;
+    }
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    if (!SSL_SESSION_is_resumable(it->second)) {
+      SSL_SESSION_free(it->second);
+      sessions_.erase(it);
+      return false;
+    }
+#endif
+    return SSL_set_session(ssl, it->second) == 1;
+  }
+
+  size_t size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sessions_.size();
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &it : sessions_) {
+      SSL_SESSION_free(it.second);
+    }
+    sessions_.clear();
+  }
+
+ private:
+  std::mutex mutex_;
+  FlatHashMap<string, SSL_SESSION *> sessions_;
+};
+
+int on_new_session(SSL *ssl, SSL_SESSION *session) {
+  auto *key = static_cast<const string *>(SSL_get_ex_data(ssl, get_ssl_ex_data_index()));
+  if (key == nullptr) {
+    return 0;
+  }
+  LOG(DEBUG) << "Save TLS session for " << *key;
+  SessionStorage::instance().add(*key, session);
+  return 1;  // the reference to the session is taken
+}
+
+}  // namespace
+
+void SslSessionCache::enable(void *openssl_ctx) {
+  static std::atomic<std::uintptr_t> next_ctx_id{0};
+  auto *ssl_ctx = static_cast<SSL_CTX *>(openssl_ctx);
+  auto ctx_id = ++next_ctx_id;
+  SSL_CTX_set_ex_data(ssl_ctx, get_ssl_ctx_ex_data_index(), reinterpret_cast<void *>(ctx_id));
+  SSL_CTX_set_session_cache_mode(ssl_ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+  SSL_CTX_sess_set_new_cb(ssl_ctx, on_new_session);
+}
+
+void SslSessionCache::resume_session(void *openssl_ssl, Slice host) {
+  auto *ssl = static_cast<SSL *>(openssl_ssl);
+  auto *ssl_ctx = SSL_get_SSL_CTX(ssl);
+  auto ctx_id = reinterpret_cast<std::uintptr_t>(SSL_CTX_get_ex_data(ssl_ctx, get_ssl_ctx_ex_data_index()));
+  if (ctx_id == 0) {
+    return;
+  }
+
+  string key = PSTRING() << ctx_id << ' ' << host;
+  if (SessionStorage::instance().resume(key, ssl)) {
+    LOG(DEBUG) << "Resume TLS session for " << key;
+    session_hit_count.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    session_miss_count.fetch_add(1, std::memory_order_relaxed);
+  }
+  SSL_set_ex_data(ssl, get_ssl_ex_data_index(), new string(std::move(key)));
+}
+
+SslSessionCache::Stats SslSessionCache::get_stats() {
+  Stats result;
+  result.hit_count = session_hit_count.load(std::memory_order_relaxed);
+  result.miss_count = session_miss_count.load(std::memory_order_relaxed);
+  result.session_count = SessionStorage::instance().size();
+  return result;
+}
+
+void SslSessionCache::clear() {
+  SessionStorage::instance().clear();
+}
+
+}  // namespace td
+
+#else
+
+namespace td {
+
+void SslSessionCache::enable(void *openssl_ctx) {
+}
+
+void SslSessionCache::resume_session(void *openssl_ssl, Slice host) {
+}
+
+SslSessionCache::Stats SslSessionCache::get_stats() {
+  return Stats();
+}
+
+void SslSessionCache::clear() {
+}
+
+}  // namespace td
+
+#endif
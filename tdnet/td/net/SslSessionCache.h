@@ -0,0 +1,35 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+
+namespace td {
+
+// process-wide bounded cache of client TLS sessions, which are resumed on subsequent connections to the same host
+// using TLS 1.3 session tickets or TLS 1.2 session identifiers instead of doing full handshakes
+class SslSessionCache {
+ public:
+  struct Stats {
+    uint64 hit_count = 0;
+    uint64 miss_count = 0;
+    size_t session_count = 0;
+  };
+
+  // enables storing of sessions, established using the OpenSSL context; sessions are never shared between contexts
+  static void enable(void *openssl_ctx);
+
+  // must be called for a new client OpenSSL connection before the handshake
+  static void resume_session(void *openssl_ssl, Slice host);
+
+  static Stats get_stats();
+
+  static void clear();
+};
+
+}  // namespace td
@@ -7,6 +7,8 @@
 #include "td/net/SslStream.h"
 
 #if !TD_EMSCRIPTEN
+#include "td/net/SslSessionCache.h"
+
 #include "td/utils/common.h"
 #include "td/utils/crypto.h"
 #include "td/utils/logging.h"
@@ -175,6 +177,7 @@ class SslStreamImpl {
       SSL_set_tlsext_host_name(ssl_handle.get(), MutableCSlice(host_str).begin());
     }
 #endif
+    SslSessionCache::resume_session(ssl_handle.get(), host);
     SSL_set_connect_state(ssl_handle.get());
 
     ssl_handle_ = std::move(ssl_handle);
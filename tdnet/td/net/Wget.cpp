@@ -38,23 +38,21 @@ Wget::Wget(Promise<unique_ptr<HttpQuery>> promise, string url, std::vector<std::
     , content_type_(std::move(content_type)) {
 }
 
-Status Wget::try_init() {
-  TRY_RESULT(url, parse_url(input_url_));
-  TRY_RESULT_ASSIGN(url.host_, idn_to_ascii(url.host_));
-
+Result<BufferSlice> Wget::create_request(const HttpUrl &url, const std::vector<std::pair<string, string>> &headers,
+                                         Slice content, Slice content_type) {
   HttpHeaderCreator hc;
-  if (content_.empty()) {
+  if (content.empty()) {
     hc.init_get(url.query_);
   } else {
     hc.init_post(url.query_);
-    hc.set_content_size(content_.size());
-    if (!content_type_.empty()) {
-      hc.set_content_type(content_type_);
+    hc.set_content_size(content.size());
+    if (!content_type.empty()) {
+      hc.set_content_type(content_type);
     }
   }
   bool was_host = false;
   bool was_accept_encoding = false;
-  for (auto &header : headers_) {
+  for (auto &header : headers) {
     auto header_lower = to_lower(header.first);
     if (header_lower == "host") {
       was_host = true;
@@ -70,7 +68,14 @@ Status Wget::try_init() {
   if (!was_accept_encoding) {
     hc.add_header("Accept-Encoding", "gzip, deflate");
   }
-  TRY_RESULT(header, hc.finish(content_));
+  TRY_RESULT(request, hc.finish(content));
+  return BufferSlice(request);
+}
+
+Status Wget::try_init() {
+  TRY_RESULT(url, parse_url(input_url_));
+  TRY_RESULT_ASSIGN(url.host_, idn_to_ascii(url.host_));
+  TRY_RESULT(request, create_request(url, headers_, content_, content_type_));
 
   IPAddress addr;
   TRY_STATUS(addr.init_host_port(url.host_, url.port_, prefer_ipv6_));
@@ -91,7 +96,7 @@ Status Wget::try_init() {
         0, 0, ActorOwn<HttpOutboundConnection::Callback>(actor_id(this)));
   }
 
-  send_closure(connection_, &HttpOutboundConnection::write_next, BufferSlice(header));
+  send_closure(connection_, &HttpOutboundConnection::write_next, std::move(request));
   send_closure(connection_, &HttpOutboundConnection::write_ok);
   return Status::OK();
 }
@@ -12,8 +12,11 @@
 
 #include "td/actor/actor.h"
 
+#include "td/utils/buffer.h"
 #include "td/utils/common.h"
+#include "td/utils/HttpUrl.h"
 #include "td/utils/Promise.h"
+#include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 
 #include <utility>
@@ -26,6 +29,10 @@ class Wget final : public HttpOutboundConnection::Callback {
                 int32 timeout_in = 10, int32 ttl = 3, bool prefer_ipv6 = false,
                 SslCtx::VerifyPeer verify_peer = SslCtx::VerifyPeer::On, string content = {}, string content_type = {});
 
+  // returns HTTP request to the URL with the given headers, GET if the content is empty and POST otherwise
+  static Result<BufferSlice> create_request(const HttpUrl &url, const std::vector<std::pair<string, string>> &headers,
+                                            Slice content, Slice content_type);
+
  private:
   Status try_init();
   void loop() final;
@@ -6,6 +6,7 @@
 //
 #include "td/utils/AsyncFileLog.h"
 
+#include "td/utils/misc.h"
 #include "td/utils/port/FileFd.h"
 #include "td/utils/port/path.h"
 #include "td/utils/port/sleep.h"
@@ -13,11 +14,118 @@
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Time.h"
 
+#include <chrono>
+#include <cstring>
+
 namespace td {
 
 #if !TD_THREAD_UNSUPPORTED
 
-Status AsyncFileLog::init(string path, int64 rotate_threshold, bool redirect_stderr) {
+// Multi-producer single-consumer ring of variable-sized records.
+// Every record starts at an 8-byte aligned position with a header, which becomes non-zero only after the record
+// payload is completely written, so producers reserve space with a single CAS and never wait for each other.
+class AsyncFileLog::RingBuffer {
+ public:
+  static constexpr size_t MIN_CAPACITY = 1 << 18;
+
+  explicit RingBuffer(size_t capacity) {
+    capacity_ = MIN_CAPACITY;
+    while (capacity_ < capacity) {
+      capacity_ *= 2;
+    }
+    data_.resize(capacity_);
+    headers_ = vector<std::atomic<uint32>>(capacity_ / HEADER_SIZE);
+  }
+
+  size_t get_max_record_length() const {
+    return capacity_ / 2;
+  }
+
+  // writes the data followed by the suffix as one record
+  bool try_write(Slice data, Slice suffix = Slice()) {
+    auto length = data.size() + suffix.size();
+    CHECK(length <= get_max_record_length());
+    auto record_size = get_record_size(length);
+    auto pos = write_pos_.load(std::memory_order_relaxed);
+    do {
+      if (pos + record_size - read_pos_.load(std::memory_order_acquire) > capacity_) {
+        return false;
+      }
+    } while (!write_pos_.compare_exchange_weak(pos, pos + record_size, std::memory_order_relaxed));
+
+    auto offset = static_cast<size_t>((pos + HEADER_SIZE) & (capacity_ - 1));
+    offset = copy_data(offset, data);
+    copy_data(offset, suffix);
+
+    get_header(pos).store(static_cast<uint32>(length) | COMMITTED_FLAG);
+    return true;
+  }
+
+  // calls f for each piece of committed data in order; returns whether something was read
+  template <class F>
+  bool read(F &&f) {
+    auto pos = read_pos_.load(std::memory_order_relaxed);
+    auto start_pos = pos;
+    while (true) {
+      auto &header = get_header(pos);
+      auto header_value = header.load();
+      if (header_value == 0) {
+        break;
+      }
+      auto length = static_cast<size_t>(header_value & ~COMMITTED_FLAG);
+      auto offset = static_cast<size_t>((pos + HEADER_SIZE) & (capacity_ - 1));
+      auto first_part_size = min(length, capacity_ - offset);
+      f(Slice(&data_[offset], first_part_size));
+      if (first_part_size != length) {
+        f(Slice(&data_[0], length - first_part_size));
+      }
+      header.store(0, std::memory_order_relaxed);
+      pos += get_record_size(length);
+      read_pos_.store(pos, std::memory_order_release);
+    }
+    return pos != start_pos;
+  }
+
+  bool is_empty() const {
+    return read_pos_.load(std::memory_order_acquire) == write_pos_.load(std::memory_order_acquire);
+  }
+
+  bool has_committed_data() {
+    return get_header(read_pos_.load(std::memory_order_relaxed)).load() != 0;
+  }
+
+ private:
+  static constexpr size_t HEADER_SIZE = 8;
+  static constexpr uint32 COMMITTED_FLAG = static_cast<uint32>(1) << 31;
+
+  size_t capacity_ = 0;
+  string data_;
+  vector<std::atomic<uint32>> headers_;
+  std::atomic<uint64> write_pos_{0};
+  char pad_[TD_CONCURRENCY_PAD - sizeof(std::atomic<uint64>)];
+  std::atomic<uint64> read_pos_{0};
+
+  // returns the offset after the copied data
+  size_t copy_data(size_t offset, Slice data) {
+    auto first_part_size = min(data.size(), capacity_ - offset);
+    std::memcpy(&data_[offset], data.data(), first_part_size);
+    std::memcpy(&data_[0], data.data() + first_part_size, data.size() - first_part_size);
+    return (offset + data.size()) & (capacity_ - 1);
+  }
+
+  static size_t get_record_size(size_t length) {
+    return HEADER_SIZE + ((length + HEADER_SIZE - 1) & ~(HEADER_SIZE - 1));
+  }
+
+  std::atomic<uint32> &get_header(uint64 pos) {
+    return headers_[static_cast<size_t>(pos & (capacity_ - 1)) / HEADER_SIZE];
+  }
+};
+
+AsyncFileLog::AsyncFileLog() = default;
+
+Status AsyncFileLog::init(string path, int64 rotate_threshold, bool redirect_stderr, size_t buffer_size,
+                          OverflowPolicy overflow_policy) {
   CHECK(path_.empty());
   CHECK(!path.empty());
 
@@ -34,11 +142,15 @@ Status AsyncFileLog::init(string path, int64 rotate_threshold, bool redirect_std
   }
   TRY_RESULT(size, fd.get_size());
 
+  overflow_policy_ = overflow_policy;
+  buffer_ = td::make_unique<RingBuffer>(buffer_size);
   queue_ = td::make_unique<MpscPollableQueue<Query>>();
   queue_->init();
 
   logging_thread_ = td::thread(
-      [queue = queue_.get(), fd = std::move(fd), path = path_, size, rotate_threshold, redirect_stderr]() mutable {
+      [buffer = buffer_.get(), queue = queue_.get(), is_reader_sleeping = &is_reader_sleeping_,
+       blocked_writers = &blocked_writers_, fd = std::move(fd), path = path_, size, rotate_threshold,
+       redirect_stderr]() mutable {
         auto after_rotation = [&] {
           fd.close();
           auto r_fd = FileFd::open(path, FileFd::Create | FileFd::Write | FileFd::Append);
@@ -56,7 +168,7 @@ Status AsyncFileLog::init(string path, int64 rotate_threshold, bool redirect_std
           }
           size = r_size.move_as_ok();
         };
-        auto append = [&](CSlice slice) {
+        auto append = [&](Slice slice) {
           if (size > rotate_threshold) {
             auto status = rename(path, PSLICE() << path << ".old");
             if (status.is_error()) {
@@ -80,18 +192,57 @@ Status AsyncFileLog::init(string path, int64 rotate_threshold, bool redirect_std
           }
         };
 
+        // log lines are collected into batches to reduce the number of system calls
+        constexpr size_t MAX_BATCH_SIZE = 1 << 16;
+        string batch;
+        batch.reserve(MAX_BATCH_SIZE);
+        auto flush_batch = [&] {
+          if (!batch.empty()) {
+            append(batch);
+            batch.clear();
+          }
+        };
+        auto write_buffer = [&] {
+          auto has_data = buffer->read([&](Slice data) {
+            if (batch.size() + data.size() > MAX_BATCH_SIZE) {
+              flush_batch();
+            }
+            if (data.size() >= MAX_BATCH_SIZE) {
+              append(data);
+            } else {
+              batch.append(data.begin(), data.size());
+            }
+          });
+          if (has_data && blocked_writers->count_.load() > 0) {
+            std::lock_guard<std::mutex> lock(blocked_writers->mutex_);
+            blocked_writers->condition_.notify_all();
+          }
+          return has_data;
+        };
+
         while (true) {
+          bool has_data = write_buffer();
+          flush_batch();
+
           int ready_count = queue->reader_wait_nonblock();
           if (ready_count == 0) {
+            if (has_data) {
+              continue;
+            }
+            is_reader_sleeping->store(true);
+            if (buffer->has_committed_data()) {
+              is_reader_sleeping->store(false, std::memory_order_relaxed);
+              continue;
+            }
             queue->reader_get_event_fd().wait(1000);
+            is_reader_sleeping->store(false, std::memory_order_relaxed);
             continue;
           }
           bool need_close = false;
           while (ready_count-- > 0) {
             Query query = queue->reader_get_unsafe();
             switch (query.type_) {
-              case Query::Type::Log:
-                append(query.data_);
+              case Query::Type::WakeUp:
                 break;
               case Query::Type::AfterRotation:
                 after_rotation();
@@ -106,6 +257,10 @@ Status AsyncFileLog::init(string path, int64 rotate_threshold, bool redirect_std
           queue->reader_flush();
 
           if (need_close) {
+            while (!buffer->is_empty()) {
+              write_buffer();
+            }
+            flush_batch();
             fd.close();
             break;
           }
@@ -144,16 +299,39 @@ void AsyncFileLog::after_rotation() {
 }
 
 void AsyncFileLog::do_append(int log_level, CSlice slice) {
-  Query query;
-  query.data_ = slice.str();
   if (queue_ == nullptr) {
     process_fatal_error("AsyncFileLog is not inited");
   }
-  queue_->writer_put(std::move(query));
+  Slice data = slice;
+  Slice suffix;
+  if (data.size() > buffer_->get_max_record_length()) {
+    // keep the line terminator of truncated lines
+    suffix = ends_with(data, "\n") ? Slice("\n") : Slice();
+    data.truncate(buffer_->get_max_record_length() - suffix.size());
+  }
+  if (!buffer_->try_write(data, suffix)) {
+    if (overflow_policy_ == OverflowPolicy::Drop && log_level != VERBOSITY_NAME(FATAL)) {
+      dropped_line_count_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    blocked_line_count_.fetch_add(1, std::memory_order_relaxed);
+    blocked_writers_.count_.fetch_add(1);
+    {
+      std::unique_lock<std::mutex> lock(blocked_writers_.mutex_);
+      // the timeout protects from missing a notification sent between the check for free space and the wait
+      while (!buffer_->try_write(data, suffix)) {
+        blocked_writers_.condition_.wait_for(lock, std::chrono::milliseconds(10));
+      }
+    }
+    blocked_writers_.count_.fetch_sub(1);
+  }
+  if (is_reader_sleeping_.load() && is_reader_sleeping_.exchange(false)) {
+    queue_->writer_put(Query());
+  }
   if (log_level == VERBOSITY_NAME(FATAL)) {
     // it is not thread-safe to join logging_thread_ there, so just wait for the log line to be printed
     auto end_time = Time::now() + 1.0;
-    while (!queue_->is_empty() && Time::now() < end_time) {
+    while (!buffer_->is_empty() && Time::now() < end_time) {
       usleep_for(1000);
     }
     usleep_for(5000);  // allow some time for the log line to be actually printed
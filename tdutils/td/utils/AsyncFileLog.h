@@ -13,30 +13,65 @@
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
 namespace td {
 
 #if !TD_THREAD_UNSUPPORTED
 
+// log lines are copied into a preallocated lock-free ring buffer and written to the file by a separate thread
 class AsyncFileLog final : public LogInterface {
  public:
-  AsyncFileLog() = default;
+  static constexpr size_t DEFAULT_BUFFER_SIZE = 1 << 22;
+
+  // what to do with a log line, if there is no free space in the buffer
+  enum class OverflowPolicy : int32 { Block, Drop };
+
+  AsyncFileLog();
   AsyncFileLog(const AsyncFileLog &) = delete;
   AsyncFileLog &operator=(const AsyncFileLog &) = delete;
   AsyncFileLog(AsyncFileLog &&) = delete;
   AsyncFileLog &operator=(AsyncFileLog &&) = delete;
   ~AsyncFileLog();
 
-  Status init(string path, int64 rotate_threshold, bool redirect_stderr = true);
+  Status init(string path, int64 rotate_threshold, bool redirect_stderr = true,
+              size_t buffer_size = DEFAULT_BUFFER_SIZE, OverflowPolicy overflow_policy = OverflowPolicy::Block);
+
+  // number of log lines, which were dropped because of buffer overflow
+  uint64 get_dropped_line_count() const {
+    return dropped_line_count_.load(std::memory_order_relaxed);
+  }
+
+  // number of log lines, which had to wait for free space in the buffer
+  uint64 get_blocked_line_count() const {
+    return blocked_line_count_.load(std::memory_order_relaxed);
+  }
 
  private:
   struct Query {
-    enum class Type : int32 { Log, AfterRotation, Close };
-    Type type_ = Type::Log;
-    string data_;
+    enum class Type : int32 { WakeUp, AfterRotation, Close };
+    Type type_ = Type::WakeUp;
+  };
+
+  class RingBuffer;
+
+  // writers, waiting for free space in the buffer
+  struct BlockedWriters {
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::atomic<int32> count_{0};
   };
 
   string path_;
+  OverflowPolicy overflow_policy_ = OverflowPolicy::Block;
+  unique_ptr<RingBuffer> buffer_;
   unique_ptr<MpscPollableQueue<Query>> queue_;
+  std::atomic<bool> is_reader_sleeping_{false};
+  std::atomic<uint64> dropped_line_count_{0};
+  std::atomic<uint64> blocked_line_count_{0};
+  BlockedWriters blocked_writers_;
   thread logging_thread_;
 
   vector<string> get_file_paths() final;
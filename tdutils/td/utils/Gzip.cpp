@@ -9,8 +9,11 @@
 char disable_linker_warning_about_empty_file_gzip_cpp TD_UNUSED;
 
 #if TD_HAVE_ZLIB
+#include "td/utils/port/thread_local.h"
+#include "td/utils/ScopeGuard.h"
 #include "td/utils/SliceBuilder.h"
 
+#include <array>
 #include <cstring>
 #include <limits>
 #include <utility>
@@ -154,7 +157,57 @@ Gzip::~Gzip() {
   clear();
 }
 
+// returns uncompressed size stored in the trailer of gzip-formatted data or 0 if it is unknown
+static size_t get_gzip_uncompressed_size_hint(Slice s) {
+  // the minimum gzip header is 10 bytes long and the trailer is 8 bytes long
+  if (s.size() < 18 || s.ubegin()[0] != 0x1f || s.ubegin()[1] != 0x8b) {
+    return 0;
+  }
+  auto trailer = s.uend() - 4;
+  uint32 size = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | (static_cast<uint32>(trailer[3]) << 24);
+  // deflate can't compress better than 1032:1
+  if (static_cast<uint64>(size) > static_cast<uint64>(s.size()) * 1032) {
+    return 0;
+  }
+  return size;
+}
+
+// decompresses data at once into a buffer of the known size, so there is no reallocation and no copying
+static BufferSlice gzdecode_with_size_hint(Slice s, size_t size_hint) {
+  BufferSlice result(size_hint);
+  Gzip gzip;
+  gzip.init_decode().ensure();
+  gzip.set_input(s);
+  gzip.close_input();
+  gzip.set_output(result.as_mutable_slice());
+  while (true) {
+    auto r_state = gzip.run();
+    if (r_state.is_error()) {
+      return BufferSlice();
+    }
+    if (r_state.ok() == Gzip::State::Done) {
+      break;
+    }
+    if (gzip.need_input() || gzip.need_output()) {
+      // the data is truncated, consists of several gzip members or the size hint is wrong
+      return BufferSlice();
+    }
+  }
+  if (gzip.used_output() != size_hint) {
+    return BufferSlice();
+  }
+  return result;
+}
+
 BufferSlice gzdecode(Slice s) {
+  auto size_hint = get_gzip_uncompressed_size_hint(s);
+  if (size_hint != 0) {
+    auto result = gzdecode_with_size_hint(s, size_hint);
+    if (!result.empty()) {
+      return result;
+    }
+  }
+
   Gzip gzip;
   gzip.init_decode().ensure();
   ChainBufferWriter message;
@@ -184,23 +237,112 @@ BufferSlice gzdecode(Slice s) {
   return message.extract_reader().move_as_buffer_slice();
 }
 
-BufferSlice gzencode(Slice s, double max_compression_ratio) {
-  Gzip gzip;
-  gzip.init_encode().ensure();
-  gzip.set_input(s);
-  gzip.close_input();
+// deflate stream initialization allocates and clears hundreds of kilobytes of memory,
+// which is much more expensive than compression of a short request, so the streams are reset and reused;
+// a separate stream is kept for each compression level, because deflateParams may flush pending data of a stream
+class ThreadLocalDeflateStreams {
+ public:
+  ThreadLocalDeflateStreams() {
+    for (auto &stream : streams_) {
+      std::memset(&stream.stream_, 0, sizeof(stream.stream_));
+    }
+  }
+  ThreadLocalDeflateStreams(const ThreadLocalDeflateStreams &) = delete;
+  ThreadLocalDeflateStreams &operator=(const ThreadLocalDeflateStreams &) = delete;
+  ThreadLocalDeflateStreams(ThreadLocalDeflateStreams &&) = delete;
+  ThreadLocalDeflateStreams &operator=(ThreadLocalDeflateStreams &&) = delete;
+  ~ThreadLocalDeflateStreams() {
+    for (auto &stream : streams_) {
+      if (stream.is_inited_) {
+        deflateEnd(&stream.stream_);
+      }
+    }
+  }
+
+  z_stream *init(int compression_level) {
+    if (compression_level < Z_DEFAULT_COMPRESSION || compression_level > Z_BEST_COMPRESSION) {
+      return nullptr;
+    }
+    auto &stream = streams_[compression_level - Z_DEFAULT_COMPRESSION];
+    if (!stream.is_inited_) {
+      if (deflateInit2(&stream.stream_, compression_level, Z_DEFLATED, 15, MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY) !=
+          Z_OK) {
+        return nullptr;
+      }
+      stream.is_inited_ = true;
+      return &stream.stream_;
+    }
+    if (deflateReset(&stream.stream_) != Z_OK) {
+      return nullptr;
+    }
+    return &stream.stream_;
+  }
+
+  static void release(z_stream *stream) {
+    // the buffers are freed after the call, so they must not be referenced by the stream
+    stream->next_in = nullptr;
+    stream->avail_in = 0;
+    stream->next_out = nullptr;
+    stream->avail_out = 0;
+  }
+
+ private:
+  struct Stream {
+    z_stream stream_;
+    bool is_inited_ = false;
+  };
+  std::array<Stream, Z_BEST_COMPRESSION - Z_DEFAULT_COMPRESSION + 1> streams_;
+};
+
+BufferSlice gzencode(Slice s, double max_compression_ratio, int compression_level) {
+  static TD_THREAD_LOCAL ThreadLocalDeflateStreams *deflate_streams;
+  init_thread_local<ThreadLocalDeflateStreams>(deflate_streams);
+  auto stream = deflate_streams->init(compression_level);
+  if (stream == nullptr) {
+    return BufferSlice();
+  }
+  SCOPE_EXIT {
+    ThreadLocalDeflateStreams::release(stream);
+  };
+
   auto max_size = static_cast<size_t>(static_cast<double>(s.size()) * max_compression_ratio);
   BufferWriter message{max_size};
-  gzip.set_output(message.prepare_append());
-  auto r_state = gzip.run();
-  if (r_state.is_error()) {
+  auto output = message.prepare_append();
+  CHECK(s.size() <= std::numeric_limits<uInt>::max());
+  CHECK(output.size() <= std::numeric_limits<uInt>::max());
+  stream->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(s.data()));
+  stream->avail_in = static_cast<uInt>(s.size());
+  stream->next_out = reinterpret_cast<Bytef *>(output.data());
+  stream->avail_out = static_cast<uInt>(output.size());
+  if (deflate(stream, Z_FINISH) != Z_STREAM_END) {
     return BufferSlice();
   }
-  auto state = r_state.ok();
-  if (state != Gzip::State::Done) {
+  message.confirm_append(output.size() - stream->avail_out);
+  return message.as_buffer_slice();
+}
+
+BufferSlice gzencode_gzip_format(Slice s, int compression_level) {
+  z_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  if (deflateInit2(&stream, compression_level, Z_DEFLATED, MAX_WBITS + 16, MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return BufferSlice();
+  }
+  SCOPE_EXIT {
+    deflateEnd(&stream);
+  };
+
+  CHECK(s.size() <= std::numeric_limits<uInt>::max());
+  BufferWriter message{static_cast<size_t>(deflateBound(&stream, static_cast<uLong>(s.size())))};
+  auto output = message.prepare_append();
+  CHECK(output.size() <= std::numeric_limits<uInt>::max());
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(s.data()));
+  stream.avail_in = static_cast<uInt>(s.size());
+  stream.next_out = reinterpret_cast<Bytef *>(output.data());
+  stream.avail_out = static_cast<uInt>(output.size());
+  if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
     return BufferSlice();
   }
-  message.confirm_append(gzip.flush_output());
+  message.confirm_append(output.size() - stream.avail_out);
   return message.as_buffer_slice();
 }
 
@@ -99,7 +99,11 @@ class Gzip {
 
 BufferSlice gzdecode(Slice s);
 
-BufferSlice gzencode(Slice s, double max_compression_ratio);
+// returns empty BufferSlice if the compressed data doesn't fit in s.size() * max_compression_ratio bytes
+BufferSlice gzencode(Slice s, double max_compression_ratio, int compression_level = 6);
+
+// compresses data in gzip format, which is used by the server for gzip_packed and stores the uncompressed size
+BufferSlice gzencode_gzip_format(Slice s, int compression_level = 6);
 
 }  // namespace td
 
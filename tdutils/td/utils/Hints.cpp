@@ -131,22 +131,8 @@ vector<Hints::KeyT> Hints::search_word(const string &word) const {
   return results;
 }
 
-std::pair<size_t, vector<Hints::KeyT>> Hints::search(Slice query, int32 limit, bool return_all_for_empty_query) const {
-  // LOG(ERROR) << "Search " << query;
+vector<Hints::KeyT> Hints::search_words(const vector<string> &words) const {
   vector<KeyT> results;
-
-  if (limit < 0) {
-    return {key_to_name_.size(), std::move(results)};
-  }
-
-  auto words = get_words(query);
-  if (return_all_for_empty_query && words.empty()) {
-    results.reserve(key_to_name_.size());
-    for (auto &it : key_to_name_) {
-      results.push_back(it.first);
-    }
-  }
-
   for (size_t i = 0; i < words.size(); i++) {
     vector<KeyT> keys = search_word(words[i]);
     if (i == 0) {
@@ -171,6 +157,41 @@ std::pair<size_t, vector<Hints::KeyT>> Hints::search(Slice query, int32 limit, b
     }
     results.resize(new_results_size);
   }
+  return results;
+}
+
+vector<Hints::KeyT> Hints::search_keys(Slice query) const {
+  auto words = get_words(query);
+  if (!words.empty()) {
+    return search_words(words);
+  }
+
+  vector<KeyT> results;
+  results.reserve(key_to_name_.size());
+  for (auto &it : key_to_name_) {
+    results.push_back(it.first);
+  }
+  std::sort(results.begin(), results.end());
+  return results;
+}
+
+std::pair<size_t, vector<Hints::KeyT>> Hints::search(Slice query, int32 limit, bool return_all_for_empty_query) const {
+  // LOG(ERROR) << "Search " << query;
+  vector<KeyT> results;
+
+  if (limit < 0) {
+    return {key_to_name_.size(), std::move(results)};
+  }
+
+  auto words = get_words(query);
+  if (return_all_for_empty_query && words.empty()) {
+    results.reserve(key_to_name_.size());
+    for (auto &it : key_to_name_) {
+      results.push_back(it.first);
+    }
+  } else {
+    results = search_words(words);
+  }
 
   auto total_size = results.size();
   if (total_size < static_cast<size_t>(limit)) {
@@ -34,6 +34,9 @@ class Hints {
       Slice query, int32 limit,
       bool return_all_for_empty_query = false) const;  // TODO sort by name instead of sort by rating
 
+  // returns all keys matching the query without ranking in increasing order; returns all keys for an empty query
+  vector<KeyT> search_keys(Slice query) const;
+
   bool has_key(KeyT key) const;
 
   string key_to_string(KeyT key) const;
@@ -60,6 +63,8 @@ class Hints {
 
   vector<KeyT> search_word(const string &word) const;
 
+  vector<KeyT> search_words(const vector<string> &words) const;
+
   class CompareByRating {
     const std::unordered_map<KeyT, RatingT, Hash<KeyT>> &key_to_rating_;
 
@@ -0,0 +1,115 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/bits.h"
+#include "td/utils/common.h"
+
+#include <array>
+#include <cmath>
+
+namespace td {
+
+// log-linear histogram of durations in the spirit of HdrHistogram
+// durations are stored with microsecond precision; every power of two is split into 4 buckets,
+// so returned percentiles have relative error not exceeding 12.5%
+class LatencyHistogram {
+ public:
+  // duration is in seconds
+  void add(double duration) {
+    if (!(duration > 0)) {
+      duration = 0;
+    }
+    auto value = duration >= MAX_DURATION ? MAX_VALUE : static_cast<uint64>(duration * 1e6);
+    buckets_[get_bucket(value)]++;
+    count_++;
+    sum_ += duration;
+    if (duration > max_) {
+      max_ = duration;
+    }
+  }
+
+  uint64 get_count() const {
+    return count_;
+  }
+
+  double get_average() const {
+    return count_ == 0 ? 0.0 : sum_ / static_cast<double>(count_);
+  }
+
+  double get_max() const {
+    return max_;
+  }
+
+  // percentile is in range [0, 100]
+  double get_percentile(double percentile) const {
+    if (count_ == 0) {
+      return 0.0;
+    }
+    auto rank = static_cast<uint64>(std::ceil(percentile * 0.01 * static_cast<double>(count_)));
+    if (rank == 0) {
+      rank = 1;
+    }
+    uint64 total = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+      total += buckets_[i];
+      if (total >= rank) {
+        if (i + 1 == BUCKET_COUNT) {
+          break;
+        }
+        auto result = static_cast<double>(get_bucket_middle(i)) * 1e-6;
+        return result < max_ ? result : max_;
+      }
+    }
+    return max_;
+  }
+
+  void merge(const LatencyHistogram &other) {
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+      buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    if (other.max_ > max_) {
+      max_ = other.max_;
+    }
+  }
+
+ private:
+  static constexpr int SUB_BUCKET_BITS = 2;
+  static constexpr uint64 SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+  static constexpr int MAX_VALUE_BITS = 36;
+  static constexpr uint64 MAX_VALUE = (static_cast<uint64>(1) << MAX_VALUE_BITS) - 1;
+  static constexpr double MAX_DURATION = static_cast<double>(MAX_VALUE) * 1e-6;
+  static constexpr size_t BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+  std::array<uint32, BUCKET_COUNT> buckets_{};
+  uint64 count_ = 0;
+  double sum_ = 0.0;
+  double max_ = 0.0;
+
+  static size_t get_bucket(uint64 value) {
+    if (value < 2 * SUB_BUCKET_COUNT) {
+      return static_cast<size_t>(value);
+    }
+    auto exponent = 63 - count_leading_zeroes64(value);
+    return static_cast<size_t>((exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT +
+                               ((value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1)));
+  }
+
+  static uint64 get_bucket_middle(size_t bucket) {
+    if (bucket < 2 * SUB_BUCKET_COUNT) {
+      return bucket;
+    }
+    auto exponent = static_cast<int>(bucket / SUB_BUCKET_COUNT) + SUB_BUCKET_BITS - 1;
+    auto sub_bucket = bucket % SUB_BUCKET_COUNT;
+    auto width = static_cast<uint64>(1) << (exponent - SUB_BUCKET_BITS);
+    return (SUB_BUCKET_COUNT + sub_bucket) * width + width / 2;
+  }
+};
+
+}  // namespace td
@@ -575,15 +575,22 @@ void AesIgeState::decrypt(Slice from, MutableSlice to) {
   impl_->decrypt(from, to);
 }
 
+// creation of a cipher context is much more expensive than encryption of a short packet, so the context is reused
+static AesIgeStateImpl &get_thread_local_aes_ige_state() {
+  static TD_THREAD_LOCAL AesIgeStateImpl *state;
+  init_thread_local<AesIgeStateImpl>(state);
+  return *state;
+}
+
 void aes_ige_encrypt(Slice aes_key, MutableSlice aes_iv, Slice from, MutableSlice to) {
-  AesIgeStateImpl state;
+  auto &state = get_thread_local_aes_ige_state();
   state.init(aes_key, aes_iv, true);
   state.encrypt(from, to);
   state.get_iv(aes_iv);
 }
 
 void aes_ige_decrypt(Slice aes_key, MutableSlice aes_iv, Slice from, MutableSlice to) {
-  AesIgeStateImpl state;
+  auto &state = get_thread_local_aes_ige_state();
   state.init(aes_key, aes_iv, false);
   state.decrypt(from, to);
   state.get_iv(aes_iv);
@@ -721,7 +728,7 @@ void AesCtrState::decrypt(Slice from, MutableSlice to) {
 }
 
 #if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(LIBRESSL_VERSION_NUMBER)
-static void make_digest(Slice data, MutableSlice output, const EVP_MD *evp_md) {
+static void make_digest(Slice prefix, Slice data, MutableSlice output, const EVP_MD *evp_md) {
   static TD_THREAD_LOCAL EVP_MD_CTX *ctx;
   if (unlikely(ctx == nullptr)) {
     ctx = EVP_MD_CTX_new();
@@ -733,6 +740,10 @@ static void make_digest(Slice data, MutableSlice output, const EVP_MD *evp_md) {
   }
   int res = EVP_DigestInit_ex(ctx, evp_md, nullptr);
   LOG_IF(FATAL, res != 1);
+  if (!prefix.empty()) {
+    res = EVP_DigestUpdate(ctx, prefix.ubegin(), prefix.size());
+    LOG_IF(FATAL, res != 1);
+  }
   res = EVP_DigestUpdate(ctx, data.ubegin(), data.size());
   LOG_IF(FATAL, res != 1);
   res = EVP_DigestFinal_ex(ctx, output.ubegin(), nullptr);
@@ -740,6 +751,10 @@ static void make_digest(Slice data, MutableSlice output, const EVP_MD *evp_md) {
   EVP_MD_CTX_reset(ctx);
 }
 
+static void make_digest(Slice data, MutableSlice output, const EVP_MD *evp_md) {
+  make_digest(Slice(), data, output, evp_md);
+}
+
 static void init_thread_local_evp_md(const EVP_MD *&evp_md, const char *algorithm) {
   evp_md = EVP_MD_fetch(nullptr, algorithm, nullptr);
   LOG_IF(FATAL, evp_md == nullptr);
@@ -777,6 +792,27 @@ void sha256(Slice data, MutableSlice output) {
 #endif
 }
 
+void sha256(Slice prefix, Slice data, MutableSlice output) {
+  CHECK(output.size() >= 32);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(LIBRESSL_VERSION_NUMBER)
+  static TD_THREAD_LOCAL const EVP_MD *evp_md;
+  if (unlikely(evp_md == nullptr)) {
+    init_thread_local_evp_md(evp_md, "sha256");
+  }
+  make_digest(prefix, data, output, evp_md);
+#else
+  SHA256_CTX ctx;
+  int err = SHA256_Init(&ctx);
+  LOG_IF(FATAL, err != 1);
+  err = SHA256_Update(&ctx, prefix.ubegin(), prefix.size());
+  LOG_IF(FATAL, err != 1);
+  err = SHA256_Update(&ctx, data.ubegin(), data.size());
+  LOG_IF(FATAL, err != 1);
+  err = SHA256_Final(output.ubegin(), &ctx);
+  LOG_IF(FATAL, err != 1);
+#endif
+}
+
 void sha512(Slice data, MutableSlice output) {
   CHECK(output.size() >= 64);
 #if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(LIBRESSL_VERSION_NUMBER)
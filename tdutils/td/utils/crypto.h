@@ -120,6 +120,9 @@ void sha1(Slice data, unsigned char output[20]);
 
 void sha256(Slice data, MutableSlice output);
 
+// SHA-256 of the concatenation of prefix and data
+void sha256(Slice prefix, Slice data, MutableSlice output);
+
 void sha512(Slice data, MutableSlice output);
 
 string sha1(Slice data) TD_WARN_UNUSED_RESULT;
@@ -6,17 +6,78 @@
 //
 #include "td/utils/find_boundary.h"
 
+#include "td/utils/bits.h"
+
 #include <cstring>
 
+#if defined(__SSE2__) || (TD_MSVC && (defined(_M_X64) || (defined(_M_IX86) && _M_IX86_FP >= 2)))
+#define TD_FIND_BOUNDARY_SSE2 1
+#include <emmintrin.h>
+#endif
+
 namespace td {
 
+// returns position of the first occurrence of the boundary, which is fully contained in the data,
+// or the number of positions from which the boundary can't start inside the data
+static size_t find_boundary_in_slice(Slice data, Slice boundary) {
+  CHECK(data.size() >= boundary.size());
+  const char *begin = data.data();
+  const size_t end_pos = data.size() - boundary.size() + 1;
+  size_t pos = 0;
+
+#if TD_FIND_BOUNDARY_SSE2
+  // check 16 positions at once by the first and the last characters of the boundary
+  const auto first = _mm_set1_epi8(boundary[0]);
+  const auto last = _mm_set1_epi8(boundary.back());
+  for (; pos + 16 <= end_pos; pos += 16) {
+    auto first_block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin + pos));
+    auto last_block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin + pos + boundary.size() - 1));
+    auto mask = static_cast<uint32>(
+        _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first_block, first), _mm_cmpeq_epi8(last_block, last))));
+    while (mask != 0) {
+      auto offset = static_cast<size_t>(count_trailing_zeroes32(mask));
+      if (std::memcmp(begin + pos + offset, boundary.data(), boundary.size()) == 0) {
+        return pos + offset;
+      }
+      mask &= mask - 1;
+    }
+  }
+#endif
+
+  while (pos < end_pos) {
+    const auto *ptr = static_cast<const char *>(std::memchr(begin + pos, boundary[0], end_pos - pos));
+    if (ptr == nullptr) {
+      break;
+    }
+    pos = static_cast<size_t>(ptr - begin);
+    if (std::memcmp(ptr, boundary.data(), boundary.size()) == 0) {
+      return pos;
+    }
+    pos++;
+  }
+  return end_pos;
+}
+
 bool find_boundary(ChainBufferReader range, Slice boundary, size_t &already_read) {
   range.advance(already_read);
 
   const int MAX_BOUNDARY_LENGTH = 70;
   CHECK(boundary.size() <= MAX_BOUNDARY_LENGTH + 4);
+  CHECK(!boundary.empty());
   while (!range.empty()) {
     Slice ready = range.prepare_read();
+    if (ready.size() >= boundary.size()) {
+      // fast path for the boundary, which is fully contained in the current chunk
+      auto shift = find_boundary_in_slice(ready, boundary);
+      already_read += shift;
+      if (shift + boundary.size() <= ready.size()) {
+        return true;
+      }
+      range.advance(shift);
+      continue;
+    }
+
+    // the boundary can span multiple chunks
     if (ready[0] == boundary[0]) {
       if (range.size() < boundary.size()) {
         return false;
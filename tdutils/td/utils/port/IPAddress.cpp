@@ -400,6 +400,21 @@ Status IPAddress::init_host_port(CSlice host, int port, bool prefer_ipv6) {
 
 Status IPAddress::init_host_port(CSlice host, CSlice port, bool prefer_ipv6) {
   is_valid_ = false;
+  TRY_RESULT(ip_addresses, get_host_ip_addresses(host, port));
+
+  // use the first address of the preferred family if there is one, or the first address otherwise
+  const IPAddress *best_ip_address = &ip_addresses[0];
+  for (auto &ip_address : ip_addresses) {
+    if (ip_address.is_ipv6() == prefer_ipv6) {
+      best_ip_address = &ip_address;
+      break;
+    }
+  }
+  *this = *best_ip_address;
+  return Status::OK();
+}
+
+Result<vector<IPAddress>> IPAddress::get_host_ip_addresses(CSlice host, CSlice port) {
   if (host.empty()) {
     return Status::Error("Host is empty");
   }
@@ -411,9 +426,13 @@ Status IPAddress::init_host_port(CSlice host, CSlice port, bool prefer_ipv6) {
   TRY_RESULT(ascii_host, idn_to_ascii(host));
   host = ascii_host;  // assign string to CSlice
 
+  vector<IPAddress> result;
   if (host[0] == '[' && host.back() == ']') {
     auto port_int = to_integer<int>(port);
-    return init_ipv6_port(host, port_int == 0 ? 1 : port_int);
+    IPAddress ip_address;
+    TRY_STATUS(ip_address.init_ipv6_port(host, port_int == 0 ? 1 : port_int));
+    result.push_back(std::move(ip_address));
+    return std::move(result);
   }
 
   // some getaddrinfo implementations use inet_pton instead of inet_aton and support only decimal-dotted IPv4 form,
@@ -442,27 +461,18 @@ Status IPAddress::init_host_port(CSlice host, CSlice port, bool prefer_ipv6) {
     freeaddrinfo(info);
   };
 
-  addrinfo *best_info = nullptr;
   for (auto *ptr = info; ptr != nullptr; ptr = ptr->ai_next) {
-    if (ptr->ai_family == AF_INET && (!prefer_ipv6 || best_info == nullptr)) {
-      // just use first IPv4 address if there is no IPv6 and it isn't preferred
-      best_info = ptr;
-      if (!prefer_ipv6) {
-        break;
-      }
-    }
-    if (ptr->ai_family == AF_INET6 && (prefer_ipv6 || best_info == nullptr)) {
-      // or first IPv6 address if there is no IPv4 and it isn't preferred
-      best_info = ptr;
-      if (prefer_ipv6) {
-        break;
-      }
+    if (ptr->ai_family != AF_INET && ptr->ai_family != AF_INET6) {
+      continue;
     }
+    IPAddress ip_address;
+    TRY_STATUS(ip_address.init_sockaddr(ptr->ai_addr, narrow_cast<socklen_t>(ptr->ai_addrlen)));
+    result.push_back(std::move(ip_address));
   }
-  if (best_info == nullptr) {
+  if (result.empty()) {
     return Status::Error("Failed to find IPv4/IPv6 address");
   }
-  return init_sockaddr(best_info->ai_addr, narrow_cast<socklen_t>(best_info->ai_addrlen));
+  return std::move(result);
 }
 
 Status IPAddress::init_host_port(CSlice host_port) {
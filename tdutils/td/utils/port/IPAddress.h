@@ -56,6 +56,9 @@ class IPAddress {
   static Result<IPAddress> get_ipv4_address(CSlice host);
   static Result<IPAddress> get_ipv6_address(CSlice host);
 
+  // returns all IPv4 and IPv6 addresses of the host in the order returned by the system resolver
+  static Result<vector<IPAddress>> get_host_ip_addresses(CSlice host, CSlice port);
+
   Status init_ipv6_port(CSlice ipv6, int port) TD_WARN_UNUSED_RESULT;
   Status init_ipv6_as_ipv4_port(CSlice ipv4, int port) TD_WARN_UNUSED_RESULT;
   Status init_ipv4_port(CSlice ipv4, int port) TD_WARN_UNUSED_RESULT;
@@ -307,6 +307,17 @@ Result<SocketFd> ServerSocketFd::accept() {
   return impl_->accept();
 }
 
+Result<int32> ServerSocketFd::get_port() const {
+  sockaddr_in6 addr;  // large enough for both IPv4 and IPv6 addresses
+  socklen_t len = sizeof(addr);
+  if (getsockname(get_native_fd().socket(), reinterpret_cast<sockaddr *>(&addr), &len) != 0) {
+    return OS_SOCKET_ERROR("Failed to get socket address");
+  }
+  IPAddress address;
+  TRY_STATUS(address.init_sockaddr(reinterpret_cast<sockaddr *>(&addr), len));
+  return address.get_port();
+}
+
 void ServerSocketFd::close() {
   impl_.reset();
 }
@@ -316,7 +327,7 @@ bool ServerSocketFd::empty() const {
 }
 
 Result<ServerSocketFd> ServerSocketFd::open(int32 port, CSlice addr) {
-  if (port <= 0 || port >= (1 << 16)) {
+  if (port < 0 || port >= (1 << 16)) {
     return Status::Error(PSLICE() << "Invalid server port " << port << " specified");
   }
 
@@ -369,6 +380,14 @@ Result<ServerSocketFd> ServerSocketFd::open(int32 port, CSlice addr) {
   return ServerSocketFd(std::move(impl));
 }
 
+bool ServerSocketFd::is_port_reuse_balanced() {
+#if (TD_LINUX || TD_ANDROID) && defined(SO_REUSEPORT)
+  return true;
+#else
+  return false;
+#endif
+}
+
 Result<uint32> ServerSocketFd::maximize_snd_buffer(uint32 max_size) {
   return get_native_fd().maximize_snd_buffer(max_size);
 }
@@ -36,8 +36,12 @@ class ServerSocketFd {
   Result<uint32> maximize_snd_buffer(uint32 max_size = 0);
   Result<uint32> maximize_rcv_buffer(uint32 max_size = 0);
 
+  // if port is 0, then the socket is bound to a free port, which can be received using get_port
   static Result<ServerSocketFd> open(int32 port, CSlice addr = CSlice("0.0.0.0")) TD_WARN_UNUSED_RESULT;
 
+  // returns true if incoming connections are balanced between all sockets listening on the same port
+  static bool is_port_reuse_balanced();
+
   PollableFdInfo &get_poll_info();
   const PollableFdInfo &get_poll_info() const;
 
@@ -45,6 +49,8 @@ class ServerSocketFd {
 
   Result<SocketFd> accept() TD_WARN_UNUSED_RESULT;
 
+  Result<int32> get_port() const TD_WARN_UNUSED_RESULT;
+
   void close();
   bool empty() const;
 
@@ -7,7 +7,10 @@
 #include "td/utils/tests.h"
 
 #include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/find_boundary.h"
 #include "td/utils/Random.h"
+#include "td/utils/Slice.h"
 
 TEST(Buffer, buffer_builder) {
   {
@@ -54,3 +57,36 @@ TEST(Buffer, buffer_builder) {
     ASSERT_EQ(builder.extract().as_slice(), str);
   }
 }
+
+TEST(Buffer, find_boundary) {
+  for (int t = 0; t < 1000; t++) {
+    td::string boundary = td::Random::fast_bool() ? "\r\n\r\n" : "\r\n--" + td::rand_string('a', 'c', 10);
+    td::string str;
+    auto length = td::Random::fast(0, 300);
+    for (int i = 0; i < length; i++) {
+      str += "ab\r\n-"[td::Random::fast(0, 4)];
+    }
+    if (td::Random::fast_bool()) {
+      str.insert(static_cast<size_t>(td::Random::fast(0, length)), boundary);
+    }
+    auto expected_pos = str.find(boundary);
+
+    td::ChainBufferWriter writer;
+    auto reader = writer.extract_reader();
+    size_t already_read = 0;
+    bool is_found = false;
+    for (auto &part : td::rand_split(str)) {
+      writer.append(td::BufferSlice(part));
+      reader.sync_with_writer();
+      if (!is_found) {
+        is_found = td::find_boundary(reader.clone(), boundary, already_read);
+      }
+    }
+    if (expected_pos == td::string::npos) {
+      ASSERT_TRUE(!is_found);
+    } else {
+      ASSERT_TRUE(is_found);
+      ASSERT_EQ(expected_pos, already_read);
+    }
+  }
+}
@@ -293,6 +293,17 @@ TEST(Crypto, sha256) {
   }
 }
 
+TEST(Crypto, sha256_prefix) {
+  td::string prefix = td::rand_string('a', 'z', 32);
+  for (auto &str : strings) {
+    td::string baseline(32, '\0');
+    td::sha256(prefix + str, baseline);
+    td::string result(32, '\0');
+    td::sha256(prefix, str, result);
+    ASSERT_EQ(baseline, result);
+  }
+}
+
 TEST(Crypto, md5) {
   td::vector<td::Slice> answers{
       "1B2M2Y8AsgTpgAmY7PhCfg==", "xMpCOKC5I4INzFCab3WEmw==", "vwBninYbDRkgk+uA7GMiIQ==", "dwfWrk4CfHDuoqk1wilvIQ=="};
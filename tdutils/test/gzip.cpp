@@ -45,6 +45,51 @@ TEST(Gzip, gzencode) {
   }
 }
 
+TEST(Gzip, gzencode_compression_level) {
+  auto str = td::rand_string('a', 'c', 100000);
+  auto default_encoded = td::gzencode(str, 2).as_slice().str();
+  for (int compression_level : {1, 9, 0, 6, 4, 6}) {
+    auto r = td::gzencode(str, 2, compression_level);
+    ASSERT_TRUE(!r.empty());
+    ASSERT_EQ(str, td::gzdecode(r.as_slice()));
+    if (compression_level == 6) {
+      ASSERT_EQ(default_encoded, r.as_slice().str());
+    }
+  }
+  ASSERT_TRUE(td::gzencode(td::rand_string(0, 255, 1000), 0.9).empty());
+  encode_decode(str);
+}
+
+TEST(Gzip, gzencode_alternating_compression_level) {
+  td::string strs[] = {td::rand_string('a', 'c', 100000), td::rand_string('a', 'z', 1000)};
+  int compression_levels[] = {9, 1};
+  td::string expected[2];
+  for (int i = 0; i < 2; i++) {
+    expected[i] = td::gzencode(strs[i], 2, compression_levels[i]).as_slice().str();
+  }
+  for (int j = 0; j < 10; j++) {
+    for (int i = 0; i < 2; i++) {
+      auto r = td::gzencode(strs[i], 2, compression_levels[i]);
+      ASSERT_TRUE(!r.empty());
+      ASSERT_EQ(expected[i], r.as_slice().str());
+      ASSERT_EQ(strs[i], td::gzdecode(r.as_slice()));
+    }
+  }
+}
+
+TEST(Gzip, gzdecode_gzip_format) {
+  for (auto str : {td::rand_string('a', 'z', 1), td::rand_string('a', 'z', 1000000), td::string(1000000, 'a'),
+                   td::rand_string(0, 255, 100000)}) {
+    auto gzip_data = td::gzencode_gzip_format(str).as_slice().str();
+    ASSERT_TRUE(!gzip_data.empty());
+    ASSERT_EQ(str, td::gzdecode(gzip_data));
+
+    // truncated data must not be decoded
+    gzip_data.pop_back();
+    ASSERT_TRUE(td::gzdecode(gzip_data).empty());
+  }
+}
+
 TEST(Gzip, flow) {
   auto str = td::rand_string('a', 'z', 1000000);
   auto parts = td::rand_split(str);
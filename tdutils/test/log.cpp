@@ -8,9 +8,11 @@
 #include "td/utils/benchmark.h"
 #include "td/utils/CombinedLog.h"
 #include "td/utils/FileLog.h"
+#include "td/utils/filesystem.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
 #include "td/utils/MemoryLog.h"
+#include "td/utils/misc.h"
 #include "td/utils/NullLog.h"
 #include "td/utils/port/path.h"
 #include "td/utils/port/thread.h"
@@ -184,4 +186,76 @@ TEST(Log, Bench) {
   });
 #endif
 }
+
+#if !TD_EVENTFD_UNSUPPORTED
+TEST(Log, AsyncFileLog) {
+  const int threads_n = 4;
+  const int lines_n = 10000;
+  for (auto overflow_policy : {td::AsyncFileLog::OverflowPolicy::Block, td::AsyncFileLog::OverflowPolicy::Drop}) {
+    td::string path = "tmplog_async";
+    td::unlink(path).ignore();
+    td::uint64 dropped_line_count = 0;
+    {
+      td::AsyncFileLog log;
+      log.init(path, std::numeric_limits<td::int64>::max(), false, 0, overflow_policy).ensure();
+      std::vector<td::thread> threads(threads_n);
+      for (int i = 0; i < threads_n; i++) {
+        threads[i] = td::thread([&log, i] {
+          for (int j = 0; j < lines_n; j++) {
+            log.append(VERBOSITY_NAME(ERROR), PSLICE() << "Thread " << i << " line " << j << '\n');
+          }
+        });
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+      dropped_line_count = log.get_dropped_line_count();
+    }
+    if (overflow_policy == td::AsyncFileLog::OverflowPolicy::Block) {
+      ASSERT_EQ(0u, dropped_line_count);
+    }
+
+    auto lines = td::full_split(td::read_file_str(path).move_as_ok(), '\n');
+    ASSERT_TRUE(!lines.empty());
+    ASSERT_TRUE(lines.back().empty());
+    lines.pop_back();
+    ASSERT_EQ(static_cast<size_t>(threads_n * lines_n) - dropped_line_count, lines.size());
+
+    // lines from each thread must be written in order
+    std::vector<int> next_line(threads_n, 0);
+    for (auto &line : lines) {
+      auto parts = td::full_split(line, ' ');
+      ASSERT_EQ(4u, parts.size());
+      auto thread_id = td::to_integer<int>(parts[1]);
+      auto line_id = td::to_integer<int>(parts[3]);
+      ASSERT_TRUE(line_id >= next_line[thread_id]);
+      if (overflow_policy == td::AsyncFileLog::OverflowPolicy::Block) {
+        ASSERT_EQ(next_line[thread_id], line_id);
+      }
+      next_line[thread_id] = line_id + 1;
+    }
+    td::unlink(path).ignore();
+  }
+}
+
+TEST(Log, AsyncFileLog_long_line) {
+  td::string path = "tmplog_async_long";
+  td::unlink(path).ignore();
+  {
+    td::AsyncFileLog log;
+    log.init(path, std::numeric_limits<td::int64>::max(), false, 0).ensure();
+    td::string long_line(1 << 20, 'a');
+    long_line += '\n';
+    log.append(VERBOSITY_NAME(ERROR), long_line);
+    log.append(VERBOSITY_NAME(ERROR), "short line\n");
+  }
+  auto lines = td::full_split(td::read_file_str(path).move_as_ok(), '\n');
+  ASSERT_EQ(3u, lines.size());
+  ASSERT_TRUE(lines[0].size() < static_cast<size_t>(1 << 20));
+  ASSERT_EQ(td::string(lines[0].size(), 'a'), lines[0]);
+  ASSERT_EQ("short line", lines[1]);
+  ASSERT_TRUE(lines[2].empty());
+  td::unlink(path).ignore();
+}
+#endif
 #endif
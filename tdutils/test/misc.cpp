@@ -18,7 +18,9 @@
 #include "td/utils/HashMap.h"
 #include "td/utils/HashSet.h"
 #include "td/utils/HashTableUtils.h"
+#include "td/utils/Hints.h"
 #include "td/utils/invoke.h"
+#include "td/utils/LatencyHistogram.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/port/EventFd.h"
@@ -46,6 +48,7 @@
 
 #include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <limits>
 #include <locale>
 #include <unordered_map>
@@ -1391,3 +1394,64 @@ TEST(UniqueValuePtr, Basic) {
   ASSERT_TRUE(c == d);
   ASSERT_TRUE(6 == **d);
 }
+
+TEST(Misc, LatencyHistogram) {
+  td::LatencyHistogram histogram;
+  ASSERT_EQ(0u, histogram.get_count());
+  ASSERT_EQ(0.0, histogram.get_percentile(50));
+
+  td::vector<double> durations;
+  for (int i = 0; i < 10000; i++) {
+    durations.push_back(td::Random::fast(0, 1000000) * 1e-5);
+    histogram.add(durations.back());
+  }
+  histogram.add(-1.0);
+  durations.push_back(0.0);
+  histogram.add(1e9);
+  durations.push_back(1e9);
+  std::sort(durations.begin(), durations.end());
+
+  ASSERT_EQ(durations.size(), histogram.get_count());
+  ASSERT_EQ(1e9, histogram.get_max());
+  for (double percentile : {1.0, 10.0, 50.0, 90.0, 99.0, 99.9}) {
+    auto rank = static_cast<size_t>(std::ceil(percentile * 0.01 * static_cast<double>(durations.size())));
+    auto expected = durations[rank - 1];
+    auto result = histogram.get_percentile(percentile);
+    ASSERT_TRUE(std::abs(result - expected) <= expected * 0.125 + 1e-6);
+  }
+  ASSERT_EQ(1e9, histogram.get_percentile(100));
+
+  td::LatencyHistogram other;
+  other.add(2e9);
+  histogram.merge(other);
+  ASSERT_EQ(durations.size() + 1, histogram.get_count());
+  ASSERT_EQ(2e9, histogram.get_max());
+}
+
+TEST(Misc, Hints_search_keys) {
+  td::Hints hints;
+  hints.add(5, "Cat photos");
+  hints.add(2, "cat video");
+  hints.add(9, "dog photos");
+  hints.add(7, "Catalog");
+  hints.set_rating(9, -10);
+
+  ASSERT_TRUE((hints.search_keys("cat") == td::vector<td::int64>{2, 5, 7}));
+  ASSERT_TRUE((hints.search_keys("photo") == td::vector<td::int64>{5, 9}));
+  ASSERT_TRUE((hints.search_keys("cat photo") == td::vector<td::int64>{5}));
+  ASSERT_TRUE(hints.search_keys("bird").empty());
+  ASSERT_TRUE((hints.search_keys("") == td::vector<td::int64>{2, 5, 7, 9}));
+
+  hints.remove(5);
+  ASSERT_TRUE((hints.search_keys("cat") == td::vector<td::int64>{2, 7}));
+
+  // the same keys as found by search, but without ranking and limit
+  for (int i = 0; i < 1000; i++) {
+    hints.add(td::Random::fast(1, 100), td::Slice(td::Random::fast(0, 1) ? "cat" : "dog cat"));
+  }
+  for (td::string query : {"cat", "dog", "d", "dog cat", "x", ""}) {
+    auto found = hints.search(query, 1000, true).second;
+    std::sort(found.begin(), found.end());
+    ASSERT_TRUE(found == hints.search_keys(query));
+  }
+}
@@ -14,7 +14,9 @@
 #include "td/db/SqliteConnectionSafe.h"
 #include "td/db/SqliteDb.h"
 #include "td/db/SqliteKeyValue.h"
+#include "td/db/SqliteKeyValueCache.h"
 #include "td/db/SqliteKeyValueSafe.h"
+#include "td/db/SqliteTuning.h"
 #include "td/db/TsSeqKeyValue.h"
 
 #include "td/actor/actor.h"
@@ -29,6 +31,7 @@
 #include "td/utils/port/thread.h"
 #include "td/utils/Random.h"
 #include "td/utils/Slice.h"
+#include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
 #include "td/utils/StringBuilder.h"
 #include "td/utils/tests.h"
@@ -147,6 +150,61 @@ TEST(DB, sqlite_lfs) {
   td::SqliteDb::destroy(path).ignore();
 }
 
+TEST(DB, sqlite_tuning) {
+  td::string path = "test_sqlite_db";
+  td::SqliteDb::destroy(path).ignore();
+
+  td::SqliteTuning tuning;
+  tuning.cache_size = -1024;
+  tuning.page_size = 8192;
+  tuning.use_memory_temp_store = true;
+  tuning.wal_autocheckpoint = 0;
+  auto db = td::SqliteDb::open_with_key(path, true, td::DbKey::empty()).move_as_ok();
+  db.apply_tuning(tuning).ensure();
+  db.exec("PRAGMA journal_mode=WAL").ensure();
+  auto get_pragma = [&db](td::CSlice name) {
+    auto stmt = db.get_statement(PSLICE() << "PRAGMA " << name).move_as_ok();
+    stmt.step().ensure();
+    return stmt.view_int64(0);
+  };
+  ASSERT_EQ(-1024, get_pragma("cache_size"));
+  ASSERT_EQ(8192, get_pragma("page_size"));
+  ASSERT_EQ(2, get_pragma("temp_store"));
+
+  auto commit_stats_collector = std::make_shared<td::SqliteDb::CommitStatsCollector>();
+  db.set_commit_stats_collector(commit_stats_collector);
+  auto kv = td::SqliteKeyValue();
+  kv.init_with_connection(db.clone(), "kv").ensure();
+  kv.begin_write_transaction().ensure();
+  for (int i = 0; i < 100; i++) {
+    kv.set(td::to_string(i), td::string(1000, 'a'));
+  }
+  kv.commit_transaction().ensure();
+  ASSERT_EQ(1u, commit_stats_collector->get_stats().commit_count);
+
+  // nothing is checkpointed automatically, so all pages must be checkpointed by the passive checkpoint
+  auto other_db = td::SqliteDb::open_with_key(path, false, td::DbKey::empty()).move_as_ok();
+  auto result = other_db.checkpoint_wal_passive().move_as_ok();
+  ASSERT_TRUE(result.wal_page_count > 0);
+  ASSERT_EQ(result.wal_page_count, result.checkpointed_page_count);
+  ASSERT_EQ(td::string(1000, 'a'), kv.get("99"));
+
+  // autocommit writes aren't accounted in commit statistics, but are visible through data version and change count
+  auto data_version = other_db.get_data_version().move_as_ok();
+  auto other_change_count = other_db.get_total_change_count();
+  auto change_count = db.get_total_change_count();
+  kv.set("autocommit", "a");
+  ASSERT_EQ(1u, commit_stats_collector->get_stats().commit_count);
+  ASSERT_TRUE(other_db.get_data_version().move_as_ok() != data_version);
+  ASSERT_EQ(other_change_count, other_db.get_total_change_count());
+  ASSERT_TRUE(db.get_total_change_count() > change_count);
+
+  kv.close();
+  db.close();
+  other_db.close();
+  td::SqliteDb::destroy(path).ignore();
+}
+
 TEST(DB, sqlite_encryption) {
   td::string path = "test_sqlite_db";
   td::SqliteDb::destroy(path).ignore();
@@ -459,7 +517,13 @@ TEST(DB, key_value) {
   td::CSlice path = "test_sqlite_kv";
   td::SqliteDb::destroy(path).ignore();
   auto db = td::SqliteDb::open_with_key(path, true, td::DbKey::empty()).move_as_ok();
-  sqlite_kv.impl().init_with_connection(std::move(db), "KV").ensure();
+  sqlite_kv.impl().init_with_connection(db.clone(), "KV").ensure();
+
+  // the cache is smaller than the data to test evictions
+  QueryHandler<td::SqliteKeyValue> cached_sqlite_kv;
+  cached_sqlite_kv.impl().init_with_connection(std::move(db), "CachedKV").ensure();
+  auto cache = std::make_shared<td::SqliteKeyValueCache>(3000);
+  cached_sqlite_kv.impl().set_cache(cache);
 
   int cnt = 0;
   for (auto &q : queries) {
@@ -468,23 +532,125 @@ TEST(DB, key_value) {
     DbQuery c = q;
     DbQuery d = q;
     DbQuery e = q;
+    DbQuery f = q;
     baseline.do_query(a);
     kv.do_query(b);
     ts_kv.do_query(c);
     sqlite_kv.do_query(d);
     new_kv.do_query(e);
+    cached_sqlite_kv.do_query(f);
     ASSERT_EQ(a.value, b.value);
     ASSERT_EQ(a.value, c.value);
     ASSERT_EQ(a.value, d.value);
     ASSERT_EQ(a.value, e.value);
+    ASSERT_EQ(a.value, f.value);
     if (cnt++ % 200 == 0) {
       new_kv.impl().init(new_kv_name.str()).ensure();
     }
   }
+  auto stats = cache->get_stats();
+  ASSERT_TRUE(stats.hit_count > 0);
+  ASSERT_TRUE(stats.miss_count > 0);
+  ASSERT_TRUE(stats.size <= 3000);
+
+  cached_sqlite_kv.impl().erase_by_prefix("a");
+  for (auto &key : keys) {
+    ASSERT_EQ(key[0] == 'a' ? td::string() : baseline.impl().get(key), cached_sqlite_kv.impl().get(key));
+  }
+  cached_sqlite_kv.impl().close();
   td::SqliteDb::destroy(path).ignore();
   td::Binlog::destroy(new_kv_name).ignore();
 }
 
+TEST(DB, sqlite_key_value_cache_close_in_transaction) {
+  td::CSlice path = "test_sqlite_kv";
+  td::SqliteDb::destroy(path).ignore();
+  auto db = td::SqliteDb::open_with_key(path, true, td::DbKey::empty()).move_as_ok();
+  auto cache = std::make_shared<td::SqliteKeyValueCache>(3000);
+
+  td::SqliteKeyValue kv;
+  kv.init_with_connection(db.clone(), "KV").ensure();
+  kv.set_cache(cache);
+  kv.set("a", "1");
+  kv.begin_write_transaction().ensure();
+  kv.set("a", "2");
+  kv.set("b", "3");
+  kv.close();
+
+  // the transaction can be never committed, so the changed keys must not be cached
+  td::string value;
+  ASSERT_TRUE(!cache->get("a", value));
+  ASSERT_TRUE(!cache->get("b", value));
+  ASSERT_EQ(0u, cache->get_stats().key_count);
+
+  db.commit_transaction().ensure();
+  kv.init_with_connection(db.clone(), "KV").ensure();
+  kv.set_cache(cache);
+  ASSERT_EQ("2", kv.get("a"));
+  ASSERT_EQ("3", kv.get("b"));
+  kv.close();
+  db.close();
+  td::SqliteDb::destroy(path).ignore();
+}
+
+TEST(DB, sqlite_key_value_cache_isolation) {
+  td::CSlice path = "test_sqlite_kv";
+  td::SqliteDb::destroy(path).ignore();
+  auto db = td::SqliteDb::open_with_key(path, true, td::DbKey::empty()).move_as_ok();
+  auto other_db = td::SqliteDb::open_with_key(path, true, td::DbKey::empty()).move_as_ok();
+  auto cache = std::make_shared<td::SqliteKeyValueCache>(3000);
+
+  td::SqliteKeyValue kv;
+  kv.init_with_connection(db.clone(), "KV").ensure();
+  kv.set_cache(cache);
+  td::SqliteKeyValue other_kv;
+  other_kv.init_with_connection(other_db.clone(), "KV").ensure();
+  other_kv.set_cache(cache);
+
+  kv.set("a", "1");
+  kv.set("b", "2");
+  ASSERT_EQ("1", other_kv.get("a"));
+
+  // uncommitted changes are visible only through the connection, which made them
+  kv.begin_write_transaction().ensure();
+  kv.set("a", "3");
+  kv.erase("b");
+  kv.set("c", "4");
+  ASSERT_EQ("3", kv.get("a"));
+  ASSERT_EQ("", kv.get("b"));
+  ASSERT_EQ("4", kv.get("c"));
+  ASSERT_EQ("1", other_kv.get("a"));
+  ASSERT_EQ("2", other_kv.get("b"));
+  ASSERT_EQ("", other_kv.get("c"));
+  kv.commit_transaction().ensure();
+  ASSERT_EQ("3", other_kv.get("a"));
+  ASSERT_EQ("", other_kv.get("b"));
+  ASSERT_EQ("4", other_kv.get("c"));
+
+  // keys changed by a destroyed connection must not stay pinned
+  {
+    td::SqliteKeyValue destroyed_kv;
+    destroyed_kv.init_with_connection(db.clone(), "KV").ensure();
+    destroyed_kv.set_cache(cache);
+    destroyed_kv.begin_write_transaction().ensure();
+    destroyed_kv.set("a", "5");
+    destroyed_kv.set("d", "6");
+  }
+  ASSERT_EQ("3", other_kv.get("a"));
+  db.commit_transaction().ensure();
+  cache->set_max_size(0);
+  ASSERT_EQ(0u, cache->get_stats().key_count);
+  cache->set_max_size(3000);
+  ASSERT_EQ("5", other_kv.get("a"));
+  ASSERT_EQ("6", other_kv.get("d"));
+
+  kv.close();
+  other_kv.close();
+  db.close();
+  other_db.close();
+  td::SqliteDb::destroy(path).ignore();
+}
+
 TEST(DB, key_value_set_all) {
   td::vector<td::string> keys;
   td::vector<td::string> values;
@@ -0,0 +1,76 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/DownloadManager.h"
+
+#include "td/utils/common.h"
+#include "td/utils/Random.h"
+#include "td/utils/tests.h"
+
+#include <algorithm>
+#include <set>
+
+static td::vector<td::int64> get_page(const td::vector<td::int64> &download_ids, td::int64 offset, size_t limit,
+                                      td::int64 skipped_modulo = 0) {
+  return td::DownloadManager::get_download_ids_page(
+      download_ids.begin(), std::lower_bound(download_ids.begin(), download_ids.end(), offset), limit,
+      [skipped_modulo](td::int64 download_id) { return skipped_modulo != 0 && download_id % skipped_modulo == 0; });
+}
+
+TEST(DownloadManager, get_download_ids_page) {
+  td::vector<td::int64> download_ids{2, 3, 5, 7, 11, 13, 17};
+  ASSERT_TRUE((get_page(download_ids, 100, 3) == td::vector<td::int64>{17, 13, 11}));
+  ASSERT_TRUE((get_page(download_ids, 11, 3) == td::vector<td::int64>{7, 5, 3}));
+  ASSERT_TRUE((get_page(download_ids, 12, 3) == td::vector<td::int64>{11, 7, 5}));
+  ASSERT_TRUE((get_page(download_ids, 5, 3) == td::vector<td::int64>{3, 2}));
+  ASSERT_TRUE(get_page(download_ids, 2, 3).empty());
+  ASSERT_TRUE(get_page(download_ids, 100, 0).empty());
+  ASSERT_TRUE(get_page({}, 100, 10).empty());
+
+  // skipped identifiers must not be counted towards the limit
+  ASSERT_TRUE((get_page({1, 2, 3, 4, 5, 6, 7, 8}, 100, 3, 2) == td::vector<td::int64>{7, 5, 3}));
+  ASSERT_TRUE((get_page({1, 2, 3, 4, 5, 6, 7, 8}, 5, 3, 2) == td::vector<td::int64>{3, 1}));
+  ASSERT_TRUE(get_page({2, 4, 6}, 100, 3, 2).empty());
+}
+
+TEST(DownloadManager, get_download_ids_page_random) {
+  for (int t = 0; t < 100; t++) {
+    std::set<td::int64> download_id_set;
+    auto count = td::Random::fast(0, 100);
+    for (int i = 0; i < count; i++) {
+      download_id_set.insert(td::Random::fast(1, 200));
+    }
+    td::vector<td::int64> download_ids(download_id_set.begin(), download_id_set.end());
+    auto skipped_modulo = td::Random::fast(0, 3);
+    auto is_skipped = [skipped_modulo](td::int64 download_id) {
+      return skipped_modulo != 0 && download_id % skipped_modulo == 0;
+    };
+    auto limit = static_cast<size_t>(td::Random::fast(1, 10));
+
+    // paging through all results must return every non-skipped identifier exactly once in decreasing order
+    td::vector<td::int64> all_download_ids;
+    td::int64 offset = 1000;
+    while (true) {
+      auto page = td::DownloadManager::get_download_ids_page(
+          download_id_set.begin(), download_id_set.lower_bound(offset), limit, is_skipped);
+      ASSERT_TRUE(page == get_page(download_ids, offset, limit, skipped_modulo));
+      ASSERT_TRUE(page.size() <= limit);
+      if (page.empty()) {
+        break;
+      }
+      all_download_ids.insert(all_download_ids.end(), page.begin(), page.end());
+      offset = page.back();
+    }
+
+    td::vector<td::int64> expected;
+    for (auto it = download_ids.rbegin(); it != download_ids.rend(); ++it) {
+      if (!is_skipped(*it)) {
+        expected.push_back(*it);
+      }
+    }
+    ASSERT_TRUE(all_download_ids == expected);
+  }
+}
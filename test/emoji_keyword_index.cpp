@@ -0,0 +1,113 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/EmojiKeywordIndex.h"
+
+#include "td/utils/common.h"
+#include "td/utils/misc.h"
+#include "td/utils/Random.h"
+#include "td/utils/tests.h"
+
+#include <map>
+#include <utility>
+
+static std::vector<std::pair<td::string, td::string>> naive_search(const std::map<td::string, td::string> &keywords,
+                                                                   const td::string &prefix) {
+  std::vector<std::pair<td::string, td::string>> result;
+  for (auto it = keywords.lower_bound(prefix); it != keywords.end() && td::begins_with(it->first, prefix); ++it) {
+    for (auto &emoji : td::full_split(it->second, '$')) {
+      result.emplace_back(emoji, it->first);
+    }
+  }
+  return result;
+}
+
+static td::string random_keyword() {
+  td::string result;
+  auto length = td::Random::fast(1, 4);
+  for (int i = 0; i < length; i++) {
+    result += static_cast<char>(td::Random::fast('a', 'd'));
+  }
+  return result;
+}
+
+static td::string random_emojis() {
+  td::vector<td::string> emojis;
+  auto count = td::Random::fast(0, 3);
+  for (int i = 0; i < count; i++) {
+    emojis.push_back(td::to_string(td::Random::fast(0, 9)));
+  }
+  return td::implode(emojis, '$');
+}
+
+static void check_index(const td::EmojiKeywordIndex &index, const std::map<td::string, td::string> &keywords) {
+  ASSERT_EQ(keywords.size(), index.size());
+  for (td::string prefix : {"", "a", "ab", "abc", "abcd", "b", "dd", "ddddd", "e"}) {
+    ASSERT_TRUE(naive_search(keywords, prefix) == index.search(prefix));
+  }
+  for (int i = 0; i < 100; i++) {
+    auto keyword = random_keyword();
+    auto it = keywords.find(keyword);
+    auto expected = it == keywords.end() ? td::vector<td::string>() : td::full_split(it->second, '$');
+    ASSERT_TRUE(expected == index.get_keyword_emojis(keyword));
+  }
+}
+
+TEST(EmojiKeywordIndex, simple) {
+  td::EmojiKeywordIndex index({{"cat", "A$B"}, {"car", "C"}, {"dog", ""}, {"cat", "D"}});
+  ASSERT_EQ(2u, index.size());
+  ASSERT_TRUE(index.get_keyword_emojis("dog").empty());
+  ASSERT_TRUE(index.get_keyword_emojis("ca").empty());
+  ASSERT_TRUE(td::vector<td::string>{"D"} == index.get_keyword_emojis("cat"));
+  auto result = index.search("ca");
+  ASSERT_EQ(2u, result.size());
+  ASSERT_EQ("C", result[0].first);
+  ASSERT_EQ("car", result[0].second);
+  ASSERT_EQ("D", result[1].first);
+  ASSERT_EQ("cat", result[1].second);
+
+  index.update({{"car", ""}, {"dog", "E$F"}});
+  ASSERT_EQ(2u, index.size());
+  ASSERT_TRUE(index.get_keyword_emojis("car").empty());
+  ASSERT_EQ(2u, index.search("d").size());
+}
+
+TEST(EmojiKeywordIndex, random) {
+  for (int t = 0; t < 100; t++) {
+    std::map<td::string, td::string> keywords;
+    td::vector<std::pair<td::string, td::string>> keyword_emojis;
+    auto count = td::Random::fast(0, 50);
+    for (int i = 0; i < count; i++) {
+      auto keyword = random_keyword();
+      auto emojis = random_emojis();
+      keyword_emojis.emplace_back(keyword, emojis);
+      if (emojis.empty()) {
+        keywords.erase(keyword);
+      } else {
+        keywords[keyword] = emojis;
+      }
+    }
+    td::EmojiKeywordIndex index(std::move(keyword_emojis));
+    check_index(index, keywords);
+
+    for (int u = 0; u < 5; u++) {
+      td::vector<std::pair<td::string, td::string>> changes;
+      auto change_count = td::Random::fast(0, 20);
+      for (int i = 0; i < change_count; i++) {
+        auto keyword = random_keyword();
+        auto emojis = random_emojis();
+        changes.emplace_back(keyword, emojis);
+        if (emojis.empty()) {
+          keywords.erase(keyword);
+        } else {
+          keywords[keyword] = emojis;
+        }
+      }
+      index.update(std::move(changes));
+      check_index(index, keywords);
+    }
+  }
+}
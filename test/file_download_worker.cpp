@@ -0,0 +1,462 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/files/FileBitmask.h"
+#include "td/telegram/files/FileDownloader.h"
+#include "td/telegram/files/FileDownloadWorker.h"
+#include "td/telegram/files/FileEncryptionKey.h"
+#include "td/telegram/files/FileLocation.h"
+#include "td/telegram/files/FileType.h"
+#include "td/telegram/files/ResourceManager.h"
+#include "td/telegram/net/DcId.h"
+#include "td/telegram/net/NetQuery.h"
+#include "td/telegram/net/NetQueryCreator.h"
+#include "td/telegram/telegram_api.h"
+
+#include "td/actor/actor.h"
+#include "td/actor/ConcurrentScheduler.h"
+
+#include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/crypto.h"
+#include "td/utils/filesystem.h"
+#include "td/utils/logging.h"
+#include "td/utils/OrderedEventsProcessor.h"
+#include "td/utils/port/FileFd.h"
+#include "td/utils/port/path.h"
+#include "td/utils/Promise.h"
+#include "td/utils/Random.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Span.h"
+#include "td/utils/Status.h"
+#include "td/utils/tests.h"
+#include "td/utils/tl_parsers.h"
+#include "td/utils/tl_storers.h"
+#include "td/utils/UInt.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+// writes CDN-encrypted parts received in random order through the workers in the same way as FileDownloader does
+class TestFileDownloadWorkers final : public td::Actor {
+ public:
+  TestFileDownloadWorkers(td::string path, td::vector<td::ActorId<td::FileDownloadWorker>> workers)
+      : path_(std::move(path)), workers_(std::move(workers)) {
+  }
+
+ private:
+  static constexpr size_t PART_SIZE = 16 << 10;
+  static constexpr int PART_COUNT = 37;
+  static constexpr size_t LAST_PART_SIZE = 1000;
+
+  td::string path_;
+  td::vector<td::ActorId<td::FileDownloadWorker>> workers_;
+  size_t next_worker_ = 0;
+
+  td::string content_;
+  td::string cdn_encryption_key_;
+  td::string cdn_encryption_iv_;
+
+  td::OrderedEventsProcessor<std::pair<int, td::Result<size_t>>> written_parts_;
+  td::uint64 next_written_seq_no_ = 1;
+  int pending_write_count_ = 0;
+  int pending_check_count_ = 0;
+
+  td::ActorId<td::FileDownloadWorker> get_worker() {
+    auto worker = workers_[next_worker_];
+    next_worker_ = (next_worker_ + 1) % workers_.size();
+    return worker;
+  }
+
+  static size_t get_part_size(int part_id) {
+    return part_id + 1 == PART_COUNT ? LAST_PART_SIZE : PART_SIZE;
+  }
+
+  void start_up() final {
+    content_ = td::rand_string('a', 'z', PART_SIZE * (PART_COUNT - 1) + LAST_PART_SIZE);
+    cdn_encryption_key_ = td::rand_string('a', 'z', 32);
+    cdn_encryption_iv_ = td::rand_string('a', 'z', 12) + td::string(4, '\0');
+
+    // CDN parts are encrypted with a continuous AES-CTR stream, and workers decrypt them starting from the part offset
+    td::string encrypted_content(PART_SIZE * PART_COUNT, '\0');
+    td::MutableSlice(encrypted_content).copy_from(content_);
+    td::AesCtrState ctr_state;
+    ctr_state.init(cdn_encryption_key_, cdn_encryption_iv_);
+    ctr_state.encrypt(encrypted_content, td::MutableSlice(encrypted_content));
+
+    auto fd = std::make_shared<td::FileFd>(
+        td::FileFd::open(path_, td::FileFd::Write | td::FileFd::Read | td::FileFd::Create | td::FileFd::Truncate)
+            .move_as_ok());
+
+    td::vector<int> part_ids(PART_COUNT);
+    for (int i = 0; i < PART_COUNT; i++) {
+      part_ids[i] = i;
+    }
+    td::Random::Xorshift128plus rnd(123);
+    td::rand_shuffle(td::as_mutable_span(part_ids), rnd);
+
+    for (auto part_id : part_ids) {
+      auto seq_no = next_written_seq_no_++;
+      auto offset = static_cast<td::int64>(part_id * PART_SIZE);
+      auto bytes = td::BufferSlice(td::Slice(encrypted_content).substr(part_id * PART_SIZE, PART_SIZE));
+      auto promise =
+          td::PromiseCreator::lambda([actor_id = actor_id(this), seq_no, part_id](td::Result<size_t> r_size) {
+            send_closure(actor_id, &TestFileDownloadWorkers::on_part_written, seq_no, part_id, std::move(r_size));
+          });
+      pending_write_count_++;
+      send_closure(get_worker(), &td::FileDownloadWorker::write_part, fd, offset, std::move(bytes),
+                   get_part_size(part_id), cdn_encryption_key_, cdn_encryption_iv_, std::move(promise));
+    }
+    // the file must stay open until the last worker finishes writing
+    fd = nullptr;
+  }
+
+  void on_part_written(td::uint64 seq_no, int part_id, td::Result<size_t> r_size) {
+    pending_write_count_--;
+    written_parts_.add(seq_no, std::make_pair(part_id, std::move(r_size)),
+                       [this](td::uint64 seq_no, std::pair<int, td::Result<size_t>> &&p) {
+                         // results must be processed in the order in which the parts were sent
+                         ASSERT_EQ(seq_no, next_processed_seq_no_);
+                         next_processed_seq_no_++;
+                         ASSERT_TRUE(p.second.is_ok());
+                         ASSERT_EQ(get_part_size(p.first), p.second.ok());
+                       });
+    if (pending_write_count_ == 0) {
+      ASSERT_EQ(next_written_seq_no_, next_processed_seq_no_);
+      check_content();
+    }
+  }
+
+  td::uint64 next_processed_seq_no_ = 1;
+
+  void check_content() {
+    auto r_fd = td::FileFd::open(path_, td::FileFd::Read);
+    ASSERT_TRUE(r_fd.is_ok());
+    auto fd = std::make_shared<td::FileFd>(r_fd.move_as_ok());
+    ASSERT_EQ(content_.size(), static_cast<size_t>(fd->get_size().ok()));
+
+    for (int part_id = 0; part_id < PART_COUNT; part_id++) {
+      auto offset = part_id * PART_SIZE;
+      auto size = get_part_size(part_id);
+      td::string hash(32, '\0');
+      td::sha256(td::Slice(content_).substr(offset, size), hash);
+      bool is_corrupted = part_id % 5 == 0;
+      if (is_corrupted) {
+        hash[0] = static_cast<char>(hash[0] ^ 1);
+      }
+      auto promise = td::PromiseCreator::lambda([actor_id = actor_id(this), is_corrupted](td::Result<bool> r_is_ok) {
+        send_closure(actor_id, &TestFileDownloadWorkers::on_hash_checked, !is_corrupted, std::move(r_is_ok));
+      });
+      pending_check_count_++;
+      send_closure(get_worker(), &td::FileDownloadWorker::check_hash, fd, static_cast<td::int64>(offset), size,
+                   std::move(hash), std::move(promise));
+    }
+  }
+
+  void on_hash_checked(bool expected, td::Result<bool> r_is_ok) {
+    ASSERT_TRUE(r_is_ok.is_ok());
+    ASSERT_EQ(expected, r_is_ok.ok());
+    if (--pending_check_count_ == 0) {
+      stop();
+    }
+  }
+
+  void tear_down() final {
+    td::Scheduler::instance()->finish();
+  }
+};
+
+TEST(FileDownloadWorker, out_of_order_parts) {
+  td::string path = "test_file_download_worker";
+  td::unlink(path).ignore();
+
+  int worker_count = 3;
+  td::ConcurrentScheduler sched(worker_count, 0);
+  td::vector<td::ActorOwn<td::FileDownloadWorker>> workers;
+  td::vector<td::ActorId<td::FileDownloadWorker>> worker_ids;
+  for (int i = 1; i <= worker_count; i++) {
+    workers.push_back(sched.create_actor_unsafe<td::FileDownloadWorker>(i, "FileDownloadWorker"));
+    worker_ids.push_back(workers.back().get());
+  }
+  sched.create_actor_unsafe<TestFileDownloadWorkers>(0, "TestFileDownloadWorkers", path, std::move(worker_ids))
+      .release();
+  sched.start();
+  while (sched.run_main(10)) {
+    // empty
+  }
+  for (auto &worker : workers) {
+    worker.release();
+  }
+  sched.finish();
+
+  td::unlink(path).ignore();
+}
+
+// downloads a file through FileDownloader answering its queries in batches in reverse order
+// and closes the downloader after the last but one part is received, while parts are still being written
+class TestFileDownloader final : public td::Actor {
+ public:
+  TestFileDownloader(td::string path, td::vector<td::ActorId<td::FileDownloadWorker>> workers, bool is_secret,
+                     td::NetQueryCreator &net_query_creator)
+      : path_(std::move(path))
+      , workers_(std::move(workers))
+      , is_secret_(is_secret)
+      , net_query_creator_(net_query_creator) {
+  }
+
+ private:
+  static constexpr size_t PART_SIZE = 16 << 10;
+  static constexpr int PART_COUNT = 37;
+  static constexpr size_t LAST_PART_SIZE = 1008;
+
+  class Callback final : public td::FileDownloader::Callback {
+   public:
+    Callback(td::ActorId<TestFileDownloader> actor_id, td::NetQueryCreator &net_query_creator)
+        : actor_id_(actor_id), net_query_creator_(net_query_creator) {
+    }
+    ~Callback() final {
+      send_closure(actor_id_, &TestFileDownloader::on_downloader_closed);
+    }
+
+   private:
+    td::ActorId<TestFileDownloader> actor_id_;
+    td::NetQueryCreator &net_query_creator_;
+
+    void on_start_download() final {
+    }
+    void on_partial_download(td::PartialLocalFileLocation partial_local, td::int64 ready_size, td::int64 size) final {
+      send_closure(actor_id_, &TestFileDownloader::on_partial_download, std::move(partial_local), ready_size);
+    }
+    void on_ok(td::FullLocalFileLocation full_local, td::int64 size, bool is_new) final {
+      LOG(FATAL) << "Unexpected end of download";
+    }
+    void on_error(td::Status status) final {
+      LOG(FATAL) << "Receive error " << status;
+    }
+    td::NetQueryCreator &net_query_creator() final {
+      return net_query_creator_;
+    }
+    void send_net_query(td::NetQueryPtr net_query, td::ActorShared<td::NetQueryCallback> callback) final {
+      send_closure(actor_id_, &TestFileDownloader::on_net_query, std::move(net_query), std::move(callback));
+    }
+  };
+
+  td::string path_;
+  td::vector<td::ActorId<td::FileDownloadWorker>> workers_;
+  bool is_secret_ = false;
+  td::NetQueryCreator &net_query_creator_;
+
+  td::string content_;
+  td::string encrypted_content_;
+  td::vector<td::string> part_ivs_;  // part_id -> IV after decryption of all previous parts
+
+  td::ActorOwn<td::ResourceManager> resource_manager_;
+  td::ActorOwn<td::FileDownloader> downloader_;
+
+  td::vector<std::pair<td::NetQueryPtr, td::ActorShared<td::NetQueryCallback>>> pending_queries_;
+  std::pair<td::NetQueryPtr, td::ActorShared<td::NetQueryCallback>> last_part_query_;
+  td::vector<int> answered_part_ids_;
+  size_t partial_download_count_ = 0;
+
+  static size_t get_part_size(int part_id) {
+    return part_id + 1 == PART_COUNT ? LAST_PART_SIZE : PART_SIZE;
+  }
+
+  // results of functions can't be stored, so upload.file is serialized manually
+  static td::BufferSlice create_upload_file(td::Slice bytes) {
+    auto store = [bytes](auto &storer) {
+      storer.store_binary(td::telegram_api::upload_file::ID);
+      storer.store_binary(td::telegram_api::storage_filePartial::ID);
+      storer.store_binary(static_cast<td::int32>(0));
+      storer.store_string(bytes);
+    };
+    td::TlStorerCalcLength storer_calc_length;
+    store(storer_calc_length);
+    td::BufferSlice result(storer_calc_length.get_length());
+    td::TlStorerUnsafe storer_unsafe(result.as_mutable_slice().ubegin());
+    store(storer_unsafe);
+    return result;
+  }
+
+  void start_up() final {
+    auto size = PART_SIZE * (PART_COUNT - 1) + LAST_PART_SIZE;
+    content_ = td::rand_string('a', 'z', size);
+    encrypted_content_ = content_;
+
+    td::FileEncryptionKey encryption_key;
+    td::string iv;
+    if (is_secret_) {
+      encryption_key = td::FileEncryptionKey::create();
+      iv = td::as_slice(encryption_key.mutable_iv()).str();
+      td::UInt256 encryption_iv = encryption_key.mutable_iv();
+      td::aes_ige_encrypt(encryption_key.key_slice(), td::as_mutable_slice(encryption_iv), content_,
+                          td::MutableSlice(encrypted_content_));
+
+      td::UInt256 decryption_iv = encryption_key.mutable_iv();
+      part_ivs_.push_back(iv);
+      for (int part_id = 0; part_id < PART_COUNT; part_id++) {
+        auto part = td::Slice(encrypted_content_).substr(part_id * PART_SIZE, get_part_size(part_id));
+        td::string decrypted_part(part.size(), '\0');
+        td::aes_ige_decrypt(encryption_key.key_slice(), td::as_mutable_slice(decryption_iv), part,
+                            td::MutableSlice(decrypted_part));
+        part_ivs_.push_back(td::as_slice(decryption_iv).str());
+      }
+    }
+
+    td::FileFd::open(path_, td::FileFd::Write | td::FileFd::Create | td::FileFd::Truncate).move_as_ok().close();
+    auto file_type = is_secret_ ? td::FileType::Encrypted : td::FileType::Sticker;
+    td::FullRemoteFileLocation remote(file_type, 1, 2, td::DcId::internal(2), td::string());
+    td::LocalFileLocation local(td::PartialLocalFileLocation{file_type, static_cast<td::int64>(PART_SIZE), path_, iv,
+                                                             td::string()});
+
+    // only a few parts can be downloaded simultaneously, so the parts are received in many batches
+    resource_manager_ = td::create_actor<td::ResourceManager>(
+        "ResourceManager", static_cast<td::int64>(4 * PART_SIZE), td::ResourceManager::Mode::Baseline);
+    downloader_ = td::create_actor<td::FileDownloader>(
+        "FileDownloader", remote, local, static_cast<td::int64>(size), "test", encryption_key, false, false, 0, 0,
+        workers_, td::make_unique<Callback>(actor_id(this), net_query_creator_));
+    send_closure(resource_manager_, &td::ResourceManager::register_worker,
+                 td::ActorShared<td::FileLoaderActor>(downloader_.get(), static_cast<td::uint64>(-1)),
+                 static_cast<td::int8>(1));
+  }
+
+  void on_net_query(td::NetQueryPtr net_query, td::ActorShared<td::NetQueryCallback> callback) {
+    if (pending_queries_.empty()) {
+      // answer all queries sent by the downloader at once
+      yield();
+    }
+    pending_queries_.emplace_back(std::move(net_query), std::move(callback));
+  }
+
+  void loop() final {
+    auto pending_queries = std::move(pending_queries_);
+    pending_queries_.clear();
+    for (auto it = pending_queries.rbegin(); it != pending_queries.rend(); ++it) {
+      auto &net_query = it->first;
+      ASSERT_EQ(td::telegram_api::upload_getFile::ID, net_query->tl_constructor());
+      ASSERT_TRUE(net_query->gzip_flag() == td::NetQuery::GzipFlag::Off);
+
+      // offset and limit are the last fields of the query
+      auto query = net_query->query().as_slice();
+      td::TlParser parser(query.substr(query.size() - 12));
+      auto offset = parser.fetch_long();
+      auto limit = parser.fetch_int();
+      ASSERT_TRUE(parser.get_error() == nullptr);
+      ASSERT_EQ(static_cast<td::int32>(PART_SIZE), limit);
+      ASSERT_EQ(0, static_cast<int>(offset % static_cast<td::int64>(PART_SIZE)));
+      auto part_id = static_cast<int>(offset / static_cast<td::int64>(PART_SIZE));
+      if (downloader_.empty()) {
+        // the downloader is being closed and must not receive new parts
+        net_query->set_error(td::Status::Error(500, "Test"));
+        net_query.reset();
+        continue;
+      }
+      if (part_id + 1 == PART_COUNT) {
+        // the download must not be finished
+        ASSERT_TRUE(last_part_query_.first.empty());
+        last_part_query_ = std::move(*it);
+        continue;
+      }
+
+      net_query->set_ok(create_upload_file(td::Slice(encrypted_content_).substr(offset, PART_SIZE)));
+      send_closure(std::move(it->second), &td::NetQueryCallback::on_result, std::move(net_query));
+      answered_part_ids_.push_back(part_id);
+    }
+
+    if (answered_part_ids_.size() + 1 == static_cast<size_t>(PART_COUNT)) {
+      // the downloader must wait for the parts being written before closing
+      downloader_.reset();
+    }
+  }
+
+  void on_partial_download(td::PartialLocalFileLocation partial_local, td::int64 ready_size) {
+    partial_download_count_++;
+    ASSERT_EQ(path_, partial_local.path_);
+    td::Bitmask bitmask(td::Bitmask::Decode{}, partial_local.ready_bitmask_);
+    auto ready_parts = bitmask.as_vector();
+    ASSERT_TRUE(ready_parts.size() <= answered_part_ids_.size());
+    ASSERT_EQ(static_cast<td::int64>(ready_parts.size() * PART_SIZE), ready_size);
+
+    // parts must be reported in the order in which they were received
+    td::vector<int> expected_ready_parts;
+    if (is_secret_) {
+      // secret parts are processed in order of part identifiers
+      for (size_t i = 0; i < ready_parts.size(); i++) {
+        expected_ready_parts.push_back(static_cast<int>(i));
+      }
+    } else {
+      expected_ready_parts.assign(answered_part_ids_.begin(), answered_part_ids_.begin() + ready_parts.size());
+      std::sort(expected_ready_parts.begin(), expected_ready_parts.end());
+    }
+    ASSERT_TRUE(expected_ready_parts == ready_parts);
+
+    if (is_secret_) {
+      auto ready_part_count = static_cast<size_t>(bitmask.get_ready_parts(0));
+      ASSERT_EQ(part_ivs_[ready_part_count], partial_local.iv_);
+    }
+  }
+
+  void on_downloader_closed() {
+    ASSERT_TRUE(partial_download_count_ > 0);
+    if (!last_part_query_.first.empty()) {
+      last_part_query_.first->set_error(td::Status::Error(500, "Test"));
+      last_part_query_.first.reset();
+      last_part_query_.second.reset();
+    }
+
+    // all received parts must be written before the downloader is closed
+    auto size = PART_SIZE * (PART_COUNT - 1);
+    auto r_content = td::read_file_str(path_);
+    ASSERT_TRUE(r_content.is_ok());
+    ASSERT_EQ(size, r_content.ok().size());
+    ASSERT_TRUE(td::Slice(content_).substr(0, size) == r_content.ok());
+
+    resource_manager_.reset();
+    stop();
+  }
+
+  void tear_down() final {
+    td::Scheduler::instance()->finish();
+  }
+};
+
+static void test_file_downloader(bool is_secret) {
+  td::string path = "test_file_downloader";
+  td::unlink(path).ignore();
+
+  td::NetQueryCreator net_query_creator(nullptr);
+  int worker_count = 3;
+  td::ConcurrentScheduler sched(worker_count, 0);
+  td::vector<td::ActorOwn<td::FileDownloadWorker>> workers;
+  td::vector<td::ActorId<td::FileDownloadWorker>> worker_ids;
+  for (int i = 1; i <= worker_count; i++) {
+    workers.push_back(sched.create_actor_unsafe<td::FileDownloadWorker>(i, "FileDownloadWorker"));
+    worker_ids.push_back(workers.back().get());
+  }
+  sched
+      .create_actor_unsafe<TestFileDownloader>(0, "TestFileDownloader", path, std::move(worker_ids), is_secret,
+                                               net_query_creator)
+      .release();
+  sched.start();
+  while (sched.run_main(10)) {
+    // empty
+  }
+  for (auto &worker : workers) {
+    worker.release();
+  }
+  sched.finish();
+
+  td::unlink(path).ignore();
+}
+
+TEST(FileDownloader, out_of_order_parts) {
+  test_file_downloader(false);
+}
+
+TEST(FileDownloader, secret_part_ivs) {
+  test_file_downloader(true);
+}
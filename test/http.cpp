@@ -11,9 +11,19 @@
 #endif
 
 #include "td/net/HttpChunkedByteFlow.h"
+#include "td/net/HttpConnectionPool.h"
 #include "td/net/HttpHeaderCreator.h"
+#include "td/net/HttpInboundConnection.h"
 #include "td/net/HttpQuery.h"
 #include "td/net/HttpReader.h"
+#include "td/net/MultiTcpListener.h"
+#include "td/net/SslCtx.h"
+#include "td/net/SslSessionCache.h"
+#include "td/net/TcpListener.h"
+#include "td/net/Wget.h"
+
+#include "td/actor/actor.h"
+#include "td/actor/ConcurrentScheduler.h"
 
 #include "td/utils/AesCtrByteFlow.h"
 #include "td/utils/algorithm.h"
@@ -28,10 +38,15 @@
 #include "td/utils/GzipByteFlow.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
+#include "td/utils/Promise.h"
 #include "td/utils/port/detail/PollableFd.h"
 #include "td/utils/port/FileFd.h"
+#include "td/utils/port/IPAddress.h"
 #include "td/utils/port/path.h"
 #include "td/utils/port/PollFlags.h"
+#include "td/utils/port/ServerSocketFd.h"
+#include "td/utils/port/SocketFd.h"
+#include "td/utils/port/thread.h"
 #include "td/utils/port/thread_local.h"
 #include "td/utils/Random.h"
 #include "td/utils/Slice.h"
@@ -40,10 +55,18 @@
 #include "td/utils/tests.h"
 #include "td/utils/UInt.h"
 
+#if !TD_EMSCRIPTEN
+#include <openssl/bio.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#endif
+
 #include <algorithm>
 #include <condition_variable>
 #include <limits>
 #include <mutex>
+#include <utility>
 
 static td::string make_chunked(const td::string &str) {
   auto v = td::rand_split(str);
@@ -533,6 +556,328 @@ TEST(Http, form_data) {
   ASSERT_TRUE(!q.files_[0].temp_file_name.empty());
 }
 
+namespace {
+
+// returns a port, which was free a moment ago
+int get_free_port() {
+  auto r_server_fd = td::ServerSocketFd::open(0, "127.0.0.1");
+  LOG_CHECK(r_server_fd.is_ok()) << r_server_fd.error();
+  auto r_port = r_server_fd.ok().get_port();
+  LOG_CHECK(r_port.is_ok()) << r_port.error();
+  return r_port.ok();
+}
+
+class HttpPoolTestHandler final : public td::HttpInboundConnection::Callback {
+ public:
+  void handle(td::unique_ptr<td::HttpQuery> query, td::ActorOwn<td::HttpInboundConnection> connection) final {
+    td::HttpHeaderCreator hc;
+    hc.init_ok();
+    hc.set_keep_alive();
+    hc.set_content_size(query->url_path_.size());
+    auto r_header = hc.finish(query->url_path_);
+    LOG_CHECK(r_header.is_ok()) << r_header.error();
+    // the next query on the connection is received into the memory of the handled query
+    send_closure(connection, &td::HttpInboundConnection::reuse_query, std::move(query));
+    send_closure(connection, &td::HttpInboundConnection::write_next, td::BufferSlice(r_header.ok()));
+    send_closure(connection.release(), &td::HttpInboundConnection::write_ok);
+  }
+
+  void hangup() final {
+    stop();
+  }
+};
+
+class HttpPoolTest final : public td::TcpListener::Callback {
+ public:
+  HttpPoolTest(int port, size_t max_pipelined_queries) : port_(port), max_pipelined_queries_(max_pipelined_queries) {
+  }
+
+ private:
+  static constexpr size_t MAX_CONNECTIONS = 2;
+  static constexpr int QUERY_COUNT = 20;
+
+  int port_;
+  size_t max_pipelined_queries_;
+  td::ActorOwn<td::TcpListener> listener_;
+  td::ActorOwn<td::HttpConnectionPool> pool_;
+  size_t accepted_connection_count_ = 0;
+  int received_query_count_ = 0;
+
+  void start_up() final {
+    listener_ = td::create_actor<td::TcpListener>("TcpListener", port_, actor_shared(this), "127.0.0.1");
+    yield();
+  }
+
+  void accept(td::SocketFd fd) final {
+    accepted_connection_count_++;
+    auto handler = td::create_actor<HttpPoolTestHandler>("HttpPoolTestHandler");
+    td::create_actor<td::HttpInboundConnection>("HttpInboundConnection", td::BufferedFd<td::SocketFd>(std::move(fd)),
+                                                1024, 0, 0, std::move(handler))
+        .release();
+  }
+
+  void loop() final {
+    if (!pool_.empty()) {
+      return;
+    }
+    td::HttpConnectionPool::Options options;
+    options.max_connections_per_host = MAX_CONNECTIONS;
+    options.max_pipelined_queries = max_pipelined_queries_;
+    pool_ = td::create_actor<td::HttpConnectionPool>("HttpConnectionPool", options);
+    for (int i = 0; i < QUERY_COUNT; i++) {
+      td::string path = PSTRING() << "/query" << i;
+      send_closure(pool_, &td::HttpConnectionPool::send_query, PSTRING() << "http://127.0.0.1:" << port_ << path,
+                   td::vector<std::pair<td::string, td::string>>(), td::string(), td::string(),
+                   td::PromiseCreator::lambda([actor_id = actor_id(this), path](
+                                                  td::Result<td::unique_ptr<td::HttpQuery>> r_http_query) mutable {
+                     send_closure(actor_id, &HttpPoolTest::on_query_result, std::move(path), std::move(r_http_query));
+                   }));
+    }
+  }
+
+  void on_query_result(td::string path, td::Result<td::unique_ptr<td::HttpQuery>> r_http_query) {
+    LOG_CHECK(r_http_query.is_ok()) << r_http_query.error();
+    ASSERT_EQ(path, r_http_query.ok()->content_.str());
+    if (++received_query_count_ == QUERY_COUNT) {
+      ASSERT_TRUE(accepted_connection_count_ <= MAX_CONNECTIONS);
+      pool_.reset();
+      listener_.reset();
+      td::Scheduler::instance()->finish();
+      stop();
+    }
+  }
+};
+
+}  // namespace
+
+TEST(Http, connection_pool) {
+  for (size_t max_pipelined_queries : {1, 4}) {
+    td::ConcurrentScheduler sched(0, 0);
+    sched.create_actor_unsafe<HttpPoolTest>(0, "HttpPoolTest", get_free_port(), max_pipelined_queries)
+        .release();
+    sched.start();
+    while (sched.run_main(10)) {
+      // empty
+    }
+    sched.finish();
+  }
+}
+
+namespace {
+
+class MultiTcpListenerTest final : public td::Actor {
+ public:
+  MultiTcpListenerTest(int port, td::vector<td::int32> scheduler_ids, bool allow_port_reuse)
+      : port_(port), scheduler_ids_(std::move(scheduler_ids)), allow_port_reuse_(allow_port_reuse) {
+  }
+
+  void on_accepted(td::int32 sched_id) {
+    ASSERT_TRUE(td::contains(scheduler_ids_, sched_id));
+    accepted_sched_ids_.push_back(sched_id);
+    for (auto scheduler_id : scheduler_ids_) {
+      if (!td::contains(accepted_sched_ids_, scheduler_id)) {
+        return;
+      }
+    }
+    listener_.reset();
+    client_fds_.clear();
+    td::Scheduler::instance()->finish();
+    stop();
+  }
+
+ private:
+  // the OS balances connections between listeners randomly, so there can be several connections to the same listener
+  static constexpr size_t MAX_CONNECTIONS = 1000;
+
+  class Callback final : public td::TcpListener::Callback {
+   public:
+    explicit Callback(td::ActorId<MultiTcpListenerTest> parent) : parent_(parent) {
+    }
+
+   private:
+    td::ActorId<MultiTcpListenerTest> parent_;
+
+    void accept(td::SocketFd fd) final {
+      send_closure(parent_, &MultiTcpListenerTest::on_accepted, td::Scheduler::instance()->sched_id());
+    }
+
+    void hangup() final {
+      stop();
+    }
+  };
+
+  int port_;
+  td::vector<td::int32> scheduler_ids_;
+  bool allow_port_reuse_;
+  td::ActorOwn<td::MultiTcpListener> listener_;
+  td::vector<td::SocketFd> client_fds_;
+  td::vector<td::int32> accepted_sched_ids_;
+
+  void start_up() final {
+    auto callback_factory = [parent = actor_id(this)] {
+      return td::ActorOwn<td::TcpListener::Callback>(
+          td::create_actor<Callback>("MultiTcpListenerTestCallback", parent));
+    };
+    listener_ = td::create_actor<td::MultiTcpListener>("MultiTcpListener", port_, scheduler_ids_,
+                                                       std::move(callback_factory), "127.0.0.1", allow_port_reuse_);
+    set_timeout_in(0.001);
+  }
+
+  void timeout_expired() final {
+    // listeners are started asynchronously, so connections are opened until all schedulers accept some of them
+    ASSERT_TRUE(client_fds_.size() < MAX_CONNECTIONS);
+    td::IPAddress address;
+    address.init_ipv4_port("127.0.0.1", port_).ensure();
+    auto r_socket_fd = td::SocketFd::open(address);
+    if (r_socket_fd.is_ok()) {
+      client_fds_.push_back(r_socket_fd.move_as_ok());
+    }
+    set_timeout_in(0.001);
+  }
+};
+
+}  // namespace
+
+TEST(Http, multi_tcp_listener) {
+  for (bool allow_port_reuse : {true, false}) {
+    td::ConcurrentScheduler sched(3, 0);
+    sched.create_actor_unsafe<MultiTcpListenerTest>(0, "MultiTcpListenerTest", get_free_port(),
+                                                    td::vector<td::int32>{1, 2, 3}, allow_port_reuse)
+        .release();
+    sched.start();
+    while (sched.run_main(10)) {
+      // empty
+    }
+    sched.finish();
+  }
+}
+
+#if !TD_EMSCRIPTEN
+namespace {
+
+// returns a context of a TLS server with a new self-signed certificate
+SSL_CTX *create_test_server_ssl_ctx() {
+  EVP_PKEY *pkey = nullptr;
+  auto *pkey_ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+  CHECK(pkey_ctx != nullptr);
+  CHECK(EVP_PKEY_keygen_init(pkey_ctx) == 1);
+  CHECK(EVP_PKEY_CTX_set_ec_paramgen_curve_nid(pkey_ctx, NID_X9_62_prime256v1) == 1);
+  CHECK(EVP_PKEY_keygen(pkey_ctx, &pkey) == 1);
+  EVP_PKEY_CTX_free(pkey_ctx);
+
+  auto *cert = X509_new();
+  CHECK(cert != nullptr);
+  X509_set_version(cert, 2);
+  ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+  X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+  X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+  X509_set_pubkey(cert, pkey);
+  auto *name = X509_get_subject_name(cert);
+  X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("127.0.0.1"), -1, -1, 0);
+  X509_set_issuer_name(cert, name);
+  CHECK(X509_sign(cert, pkey, EVP_sha256()) != 0);
+
+  auto *ssl_ctx = SSL_CTX_new(TLS_server_method());
+  CHECK(ssl_ctx != nullptr);
+  CHECK(SSL_CTX_use_certificate(ssl_ctx, cert) == 1);
+  CHECK(SSL_CTX_use_PrivateKey(ssl_ctx, pkey) == 1);
+  X509_free(cert);
+  EVP_PKEY_free(pkey);
+  return ssl_ctx;
+}
+
+class SslSessionTest final : public td::Actor {
+ public:
+  SslSessionTest(int port, int query_count) : port_(port), query_count_(query_count) {
+  }
+
+ private:
+  int port_;
+  int query_count_;
+
+  void loop() final {
+    if (query_count_ == 0) {
+      td::Scheduler::instance()->finish();
+      return stop();
+    }
+    query_count_--;
+
+    // queries are sent sequentially to receive the session from the previous connection
+    auto promise =
+        td::PromiseCreator::lambda([actor_id = actor_id(this)](td::Result<td::unique_ptr<td::HttpQuery>> r_query) {
+          LOG_CHECK(r_query.is_ok()) << r_query.error();
+          send_closure(actor_id, &SslSessionTest::on_query_result);
+        });
+    td::create_actor<td::Wget>("Wget", std::move(promise), PSTRING() << "https://127.0.0.1:" << port_ << '/',
+                               td::vector<std::pair<td::string, td::string>>(), 10, 0, false,
+                               td::SslCtx::VerifyPeer::Off)
+        .release();
+  }
+
+  void on_query_result() {
+    loop();
+  }
+};
+
+}  // namespace
+
+TEST(Http, ssl_session_resumption) {
+  constexpr int QUERY_COUNT = 3;
+  td::SslCtx::init_openssl();
+  auto *server_ssl_ctx = create_test_server_ssl_ctx();
+  auto *acceptor = BIO_new_accept("127.0.0.1:0");
+  CHECK(acceptor != nullptr);
+  BIO_set_bind_mode(acceptor, BIO_BIND_REUSEADDR);
+  CHECK(BIO_do_accept(acceptor) == 1);  // starts to listen on a free port
+  auto port = td::to_integer<int>(td::Slice(BIO_get_accept_port(acceptor)));
+  CHECK(port > 0);
+
+  int reused_session_count = 0;
+  td::thread server_thread([&] {
+    for (int i = 0; i < QUERY_COUNT; i++) {
+      CHECK(BIO_do_accept(acceptor) == 1);
+      auto *bio = BIO_pop(acceptor);
+      auto *ssl = SSL_new(server_ssl_ctx);
+      SSL_set_bio(ssl, bio, bio);
+      CHECK(SSL_accept(ssl) == 1);
+      if (SSL_session_reused(ssl)) {
+        reused_session_count++;
+      }
+      td::string request;
+      char buf[1024];
+      while (request.find("\r\n\r\n") == td::string::npos) {
+        auto size = SSL_read(ssl, buf, sizeof(buf));
+        CHECK(size > 0);
+        request.append(buf, size);
+      }
+      td::Slice response = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: close\r\n\r\nok";
+      CHECK(SSL_write(ssl, response.data(), static_cast<int>(response.size())) == static_cast<int>(response.size()));
+      SSL_shutdown(ssl);
+      SSL_free(ssl);
+    }
+  });
+
+  auto old_stats = td::SslSessionCache::get_stats();
+  {
+    td::ConcurrentScheduler sched(0, 0);
+    sched.create_actor_unsafe<SslSessionTest>(0, "SslSessionTest", port, QUERY_COUNT).release();
+    sched.start();
+    while (sched.run_main(10)) {
+      // empty
+    }
+    sched.finish();
+  }
+  server_thread.join();
+  BIO_free(acceptor);
+  SSL_CTX_free(server_ssl_ctx);
+
+  auto new_stats = td::SslSessionCache::get_stats();
+  ASSERT_EQ(QUERY_COUNT - 1, reused_session_count);
+  ASSERT_EQ(static_cast<td::uint64>(QUERY_COUNT - 1), new_stats.hit_count - old_stats.hit_count);
+  ASSERT_EQ(1u, new_stats.miss_count - old_stats.miss_count);
+}
+#endif
+
 #if TD_DARWIN_WATCH_OS
 struct Baton {
   std::mutex mutex;
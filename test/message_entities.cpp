@@ -2007,3 +2007,81 @@ TEST(MessageEntities, get_markdown_v3) {
   check_get_markdown_v3("```\naba\n```", {}, "aba\n", {{td::MessageEntity::Type::Pre, 0, 4}});
   check_get_markdown_v3("```\n```", {}, "\n", {{td::MessageEntity::Type::Pre, 0, 1}});
 }
+
+static td::vector<td::MessageEntity> find_entities_separately(td::Slice text) {
+  td::vector<td::MessageEntity> entities;
+  auto add_entity = [&entities, &text](td::MessageEntity::Type type, td::Slice entity) {
+    entities.emplace_back(type, td::narrow_cast<td::int32>(entity.begin() - text.begin()),
+                          td::narrow_cast<td::int32>(entity.size()));
+  };
+  for (auto &mention : td::find_mentions(text)) {
+    add_entity(td::MessageEntity::Type::Mention, mention);
+  }
+  for (auto &command : td::find_bot_commands(text)) {
+    add_entity(td::MessageEntity::Type::BotCommand, command);
+  }
+  for (auto &hashtag : td::find_hashtags(text)) {
+    add_entity(td::MessageEntity::Type::Hashtag, hashtag);
+  }
+  for (auto &cashtag : td::find_cashtags(text)) {
+    add_entity(td::MessageEntity::Type::Cashtag, cashtag);
+  }
+  for (auto &card : td::find_bank_card_numbers(text)) {
+    add_entity(td::MessageEntity::Type::BankCardNumber, card);
+  }
+  for (auto &url : td::find_tg_urls(text)) {
+    add_entity(td::MessageEntity::Type::Url, url);
+  }
+  for (auto &url : td::find_urls(text)) {
+    add_entity(url.second ? td::MessageEntity::Type::EmailAddress : td::MessageEntity::Type::Url, url.first);
+  }
+  for (auto &media_timestamp : td::find_media_timestamps(text)) {
+    entities.emplace_back(td::MessageEntity::Type::MediaTimestamp,
+                          td::narrow_cast<td::int32>(media_timestamp.first.begin() - text.begin()),
+                          td::narrow_cast<td::int32>(media_timestamp.first.size()), media_timestamp.second);
+  }
+  std::sort(entities.begin(), entities.end());
+
+  // find_entities keeps only non-intersecting entities
+  td::vector<td::MessageEntity> result;
+  td::int32 last_entity_end = 0;
+  for (auto &entity : entities) {
+    if (entity.offset >= last_entity_end) {
+      last_entity_end = entity.offset + entity.length;
+      result.push_back(std::move(entity));
+    }
+  }
+  return result;
+}
+
+static void check_find_entities(const td::string &text) {
+  auto entities = td::find_entities(text, false, false);
+  std::sort(entities.begin(), entities.end());
+  auto expected = find_entities_separately(text);
+  if (entities != expected) {
+    LOG(FATAL) << td::tag("text", text) << td::tag("got", td::format::as_array(entities))
+               << td::tag("expected", td::format::as_array(expected));
+  }
+}
+
+TEST(MessageEntities, find_entities) {
+  // bank card numbers are almost never generated randomly
+  check_find_entities("4916-3385-0608-2832 @mention #hashtag");
+  check_find_entities("pay 4556728228023269 to $USD at t.me/test");
+  // matchers start from the first trigger character, which can be close to the end of the text
+  check_find_entities("tg://a");
+  check_find_entities("text tg://a");
+  check_find_entities("at 1:23 see a.bc");
+  ASSERT_EQ(td::MessageEntity::Type::BankCardNumber,
+            td::find_entities("card 5280 9342 8317 1080", false, false)[0].type);
+
+  td::string alphabet = "ab1ZA9 .:/@#$-_\ntg";
+  for (int i = 0; i < 100000; i++) {
+    td::string text;
+    auto length = td::Random::fast(0, 60);
+    for (int j = 0; j < length; j++) {
+      text += alphabet[td::Random::fast(0, static_cast<int>(alphabet.size()) - 1)];
+    }
+    check_find_entities(text);
+  }
+}
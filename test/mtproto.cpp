@@ -5,21 +5,28 @@
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
 #include "td/telegram/ConfigManager.h"
+#include "td/telegram/net/ConnectionCreator.h"
+#include "td/telegram/net/DcId.h"
+#include "td/telegram/net/DcOptions.h"
+#include "td/telegram/net/DcOptionsSet.h"
 #include "td/telegram/net/PublicRsaKeySharedMain.h"
 #include "td/telegram/net/Session.h"
 #include "td/telegram/NotificationManager.h"
 #include "td/telegram/telegram_api.h"
 
 #include "td/mtproto/AuthData.h"
+#include "td/mtproto/AuthKey.h"
 #include "td/mtproto/DhCallback.h"
 #include "td/mtproto/DhHandshake.h"
 #include "td/mtproto/Handshake.h"
 #include "td/mtproto/HandshakeActor.h"
+#include "td/mtproto/MessageId.h"
 #include "td/mtproto/Ping.h"
 #include "td/mtproto/PingConnection.h"
 #include "td/mtproto/ProxySecret.h"
 #include "td/mtproto/RawConnection.h"
 #include "td/mtproto/RSA.h"
+#include "td/mtproto/SessionConnection.h"
 #include "td/mtproto/TlsInit.h"
 #include "td/mtproto/TransportType.h"
 
@@ -37,7 +44,9 @@
 #include "td/utils/HttpDate.h"
 #include "td/utils/logging.h"
 #include "td/utils/port/Clocks.h"
+#include "td/utils/port/detail/PollableFd.h"
 #include "td/utils/port/IPAddress.h"
+#include "td/utils/port/sleep.h"
 #include "td/utils/port/SocketFd.h"
 #include "td/utils/Promise.h"
 #include "td/utils/Random.h"
@@ -47,6 +56,7 @@
 #include "td/utils/tests.h"
 #include "td/utils/Time.h"
 
+#include <cstring>
 #include <memory>
 
 TEST(Mtproto, GetHostByNameActor) {
@@ -127,6 +137,375 @@ TEST(Mtproto, GetHostByNameActor) {
   sched.finish();
 }
 
+class GetHostByNameCacheTest final : public td::Actor {
+ public:
+  explicit GetHostByNameCacheTest(int *resolve_count) : resolve_count_(resolve_count) {
+  }
+
+ private:
+  int *resolve_count_;
+  td::ActorOwn<td::GetHostByNameActor> resolver_;
+  int step_ = 0;
+
+  void start_up() final {
+    td::GetHostByNameActor::Options options;
+    options.resolver_types = {td::GetHostByNameActor::ResolverType::Custom};
+    options.custom_resolver = [resolve_count = resolve_count_](const td::string &host, bool prefer_ipv6) {
+      (*resolve_count)++;
+      td::vector<td::IPAddress> result;
+      result.push_back(td::IPAddress::get_ipv4_address("1.1.1.1").move_as_ok());
+      result.push_back(td::IPAddress::get_ipv4_address("1.1.1.2").move_as_ok());
+      result.push_back(td::IPAddress::get_ipv6_address("2001:db8::1").move_as_ok());
+      return td::Result<td::vector<td::IPAddress>>(std::move(result));
+    };
+    options.ok_timeout = 0.2;
+    options.error_timeout = 0.0;
+    options.stale_timeout = 100.0;
+    resolver_ = td::create_actor<td::GetHostByNameActor>("GetHostByNameActor", std::move(options));
+    resolve();
+  }
+
+  void resolve() {
+    send_closure(resolver_, &td::GetHostByNameActor::run_all, "example.com", 80, false,
+                 td::PromiseCreator::lambda(
+                     [actor_id = actor_id(this)](td::Result<td::vector<td::IPAddress>> r_ip_addresses) {
+                       send_closure(actor_id, &GetHostByNameCacheTest::on_resolved, std::move(r_ip_addresses));
+                     }));
+  }
+
+  void on_resolved(td::Result<td::vector<td::IPAddress>> r_ip_addresses) {
+    ASSERT_TRUE(r_ip_addresses.is_ok());
+    auto ip_addresses = r_ip_addresses.move_as_ok();
+    ASSERT_EQ(3u, ip_addresses.size());
+    ASSERT_EQ("1.1.1.1", ip_addresses[0].get_ip_str().str());
+    ASSERT_EQ("2001:db8::1", ip_addresses[1].get_ip_str().str());
+    ASSERT_EQ("1.1.1.2", ip_addresses[2].get_ip_str().str());
+    ASSERT_EQ(80, ip_addresses[2].get_port());
+
+    step_++;
+    if (step_ == 1) {
+      // the addresses must be returned from the cache
+      resolve();
+    } else if (step_ == 2) {
+      // wait for expiration of the addresses
+      set_timeout_in(0.3);
+    } else {
+      // the expired addresses must be returned immediately; wait for their background update
+      set_timeout_in(0.1);
+    }
+  }
+
+  void timeout_expired() final {
+    if (step_ == 2) {
+      return resolve();
+    }
+    send_closure(resolver_, &td::GetHostByNameActor::get_stats,
+                 td::PromiseCreator::lambda([actor_id = actor_id(this)](td::GetHostByNameActor::Stats stats) {
+                   send_closure(actor_id, &GetHostByNameCacheTest::on_stats, stats);
+                 }));
+  }
+
+  void on_stats(td::GetHostByNameActor::Stats stats) {
+    ASSERT_EQ(2, *resolve_count_);
+    ASSERT_EQ(1u, stats.hit_count);
+    ASSERT_EQ(1u, stats.stale_hit_count);
+    ASSERT_EQ(1u, stats.blocked_count);
+    ASSERT_EQ(1u, stats.refresh_count);
+    resolver_.reset();
+    td::Scheduler::instance()->finish();
+    stop();
+  }
+};
+
+TEST(Mtproto, GetHostByNameActorCache) {
+  int resolve_count = 0;
+  td::ConcurrentScheduler sched(0, 0);
+  sched.create_actor_unsafe<GetHostByNameCacheTest>(0, "GetHostByNameCacheTest", &resolve_count).release();
+  sched.start();
+  while (sched.run_main(10)) {
+    // empty
+  }
+  sched.finish();
+}
+
+class FakeServerConnection final : public td::mtproto::RawConnection {
+ public:
+  static constexpr td::int32 TEST_QUERY_ID = 0x12345678;
+
+  struct SentPacket {
+    size_t message_count = 0;
+    size_t query_count = 0;
+    size_t size = 0;
+  };
+  td::vector<SentPacket> sent_packets;
+
+  void set_connection_token(td::mtproto::ConnectionManager::ConnectionToken connection_token) final {
+  }
+
+  bool can_send() const final {
+    return true;
+  }
+
+  td::mtproto::TransportType get_transport_type() const final {
+    return td::mtproto::TransportType();
+  }
+
+  size_t send_crypto(const td::Storer &storer, td::uint64 session_id, td::int64 salt,
+                     const td::mtproto::AuthKey &auth_key, td::uint64 quick_ack_token) final {
+    td::string packet(storer.size(), '\0');
+    CHECK(storer.store(td::MutableSlice(packet).ubegin()) == packet.size());
+
+    // parse the message, which is sent by the client, as an MTProto server would do
+    auto get_int32 = [&packet](size_t offset) {
+      CHECK(offset + 4 <= packet.size());
+      td::int32 result;
+      std::memcpy(&result, packet.data() + offset, sizeof(result));
+      return result;
+    };
+    SentPacket sent_packet;
+    sent_packet.size = packet.size();
+    if (get_int32(16) == static_cast<td::int32>(0x73f1f8dc)) {
+      sent_packet.message_count = static_cast<size_t>(get_int32(20));
+      size_t offset = 24;
+      for (size_t i = 0; i < sent_packet.message_count; i++) {
+        auto length = static_cast<size_t>(get_int32(offset + 12));
+        if (get_int32(offset + 16) == TEST_QUERY_ID) {
+          sent_packet.query_count++;
+        }
+        offset += 16 + length;
+      }
+      CHECK(offset == packet.size());
+    } else {
+      sent_packet.message_count = 1;
+      sent_packet.query_count = get_int32(16) == TEST_QUERY_ID;
+    }
+    sent_packets.push_back(sent_packet);
+    return packet.size();
+  }
+
+  void send_no_crypto(const td::Storer &storer) final {
+    UNREACHABLE();
+  }
+
+  td::PollableFdInfo &get_poll_info() final {
+    return poll_info_;
+  }
+
+  StatsCallback *stats_callback() final {
+    return nullptr;
+  }
+
+  td::Status flush(const td::mtproto::AuthKey &auth_key, Callback &callback) final {
+    return callback.before_write();
+  }
+
+  bool has_error() const final {
+    return false;
+  }
+
+  void close() final {
+  }
+
+  PublicFields &extra() final {
+    return extra_;
+  }
+
+  const PublicFields &extra() const final {
+    return extra_;
+  }
+
+ private:
+  td::PollableFdInfo poll_info_;
+  PublicFields extra_;
+};
+
+class FakeSessionCallback final : public td::mtproto::SessionConnection::Callback {
+ public:
+  size_t sent_container_query_count = 0;
+
+  void on_connected() final {
+  }
+  void on_closed(td::Status status) final {
+  }
+  void on_server_salt_updated() final {
+  }
+  void on_server_time_difference_updated(bool force) final {
+  }
+  void on_new_session_created(td::uint64 unique_id, td::mtproto::MessageId first_message_id) final {
+  }
+  void on_session_failed(td::Status status) final {
+  }
+  void on_container_sent(td::mtproto::MessageId container_message_id,
+                         td::vector<td::mtproto::MessageId> message_ids) final {
+    sent_container_query_count += message_ids.size();
+  }
+  td::Status on_pong(double ping_time, double pong_time, double current_time) final {
+    return td::Status::OK();
+  }
+  td::Status on_update(td::BufferSlice packet) final {
+    return td::Status::OK();
+  }
+  void on_message_ack(td::mtproto::MessageId message_id) final {
+  }
+  td::Status on_message_result_ok(td::mtproto::MessageId message_id, td::BufferSlice packet,
+                                  size_t original_size) final {
+    return td::Status::OK();
+  }
+  void on_message_result_error(td::mtproto::MessageId message_id, int code, td::string message) final {
+  }
+  void on_message_failed(td::mtproto::MessageId message_id, td::Status status) final {
+  }
+  void on_message_info(td::mtproto::MessageId message_id, td::int32 state, td::mtproto::MessageId answer_message_id,
+                       td::int32 answer_size, td::int32 source) final {
+  }
+  td::Status on_destroy_auth_key() final {
+    return td::Status::OK();
+  }
+};
+
+TEST(Mtproto, SessionConnectionPacking) {
+  td::mtproto::AuthData auth_data;
+  auth_data.set_use_pfs(false);
+  auth_data.set_main_auth_key(td::mtproto::AuthKey(1, td::string(256, 'a')));
+  auth_data.set_server_salt(1, td::Time::now());
+  auth_data.set_session_id(1);
+
+  auto raw_connection = td::make_unique<FakeServerConnection>();
+  auto *server = raw_connection.get();
+  td::mtproto::SessionConnection connection(td::mtproto::SessionConnection::Mode::Tcp, std::move(raw_connection),
+                                            &auth_data);
+  // queries must be sent only in full packets
+  connection.set_query_delay(1000.0);
+  FakeSessionCallback callback;
+
+  // the first packet contains only ping
+  connection.flush(&callback);
+  ASSERT_EQ(1u, server->sent_packets.size());
+  ASSERT_EQ(0u, server->sent_packets[0].query_count);
+
+  const size_t QUERY_COUNT = 100;
+  const size_t QUERY_SIZE = 1000;
+  for (size_t i = 0; i < QUERY_COUNT; i++) {
+    td::string query(QUERY_SIZE, '\0');
+    std::memcpy(&query[0], &FakeServerConnection::TEST_QUERY_ID, sizeof(td::int32));
+    connection.send_query(td::BufferSlice(query), false).ensure();
+    connection.flush(&callback);
+  }
+
+  // each message in a container has 16-byte header, so 32 queries fit in a packet
+  ASSERT_EQ(4u, server->sent_packets.size());
+  size_t sent_query_count = 0;
+  for (size_t i = 1; i < server->sent_packets.size(); i++) {
+    const auto &sent_packet = server->sent_packets[i];
+    ASSERT_EQ(32u, sent_packet.query_count);
+    ASSERT_TRUE(sent_packet.size <= (1 << 15) + 1024);
+    sent_query_count += sent_packet.query_count;
+  }
+  ASSERT_EQ(sent_query_count, callback.sent_container_query_count);
+
+  const auto &stats = connection.get_packing_stats();
+  ASSERT_EQ(4u, stats.packet_count);
+  ASSERT_EQ(96u, stats.query_count);
+  ASSERT_TRUE(stats.get_bytes_per_packet() > 3 * 32 * QUERY_SIZE / 4.0);
+
+  // the remaining queries are sent after the delay
+  connection.set_query_delay(0.0);
+  td::usleep_for(1000);
+  connection.flush(&callback);
+  ASSERT_EQ(5u, server->sent_packets.size());
+  ASSERT_EQ(QUERY_COUNT - 96, server->sent_packets.back().query_count);
+  ASSERT_EQ(QUERY_COUNT, connection.get_packing_stats().query_count);
+}
+
+TEST(Mtproto, DcOptionsSetFindConnection) {
+  auto get_ip_address = [](td::CSlice ip) {
+    td::IPAddress ip_address;
+    ip_address.init_ipv4_port(ip, 443).ensure();
+    return ip_address;
+  };
+  auto dc_id = td::DcId::internal(2);
+  td::DcOptions dc_options;
+  dc_options.dc_options.emplace_back(dc_id, get_ip_address("149.154.167.50"));
+  dc_options.dc_options.emplace_back(dc_id, get_ip_address("149.154.167.50"));
+  dc_options.dc_options.emplace_back(dc_id, get_ip_address("149.154.167.51"));
+  dc_options.dc_options.emplace_back(td::DcId::internal(3), get_ip_address("149.154.175.100"));
+  td::DcOptionsSet dc_options_set;
+  dc_options_set.add_dc_options(dc_options);
+
+  auto find_ip = [&](size_t option_index) -> td::string {
+    auto r_info = dc_options_set.find_connection(dc_id, false, false, false, false, option_index);
+    if (r_info.is_error()) {
+      return "error";
+    }
+    return r_info.ok().option->get_ip_address().get_ip_str().str();
+  };
+  ASSERT_EQ("149.154.167.50", find_ip(0));
+  ASSERT_EQ("149.154.167.51", find_ip(1));
+  ASSERT_EQ("error", find_ip(2));
+
+  // options with errors are tried last
+  auto r_info = dc_options_set.find_connection(dc_id, false, false, false, false, 0);
+  r_info.ok().stat->on_error();
+  ASSERT_EQ("149.154.167.51", find_ip(0));
+  ASSERT_EQ("149.154.167.50", find_ip(1));
+  ASSERT_EQ("error", find_ip(2));
+}
+
+TEST(Mtproto, ConnectionQueries) {
+  td::detail::ConnectionQueries queries;
+  auto create_connection = [&](size_t pending_connection_count, size_t race_count, size_t spare_connection_count) {
+    auto r_new_connection = queries.get_new_connection(pending_connection_count, race_count, spare_connection_count);
+    if (r_new_connection.is_error()) {
+      return td::string("none");
+    }
+    auto new_connection = r_new_connection.move_as_ok();
+    queries.on_connection_started(new_connection);
+    return PSTRING() << new_connection.query_id << ':' << new_connection.race_index;
+  };
+
+  // only spare connections are created without queries
+  ASSERT_EQ("0:0", create_connection(0, 2, 1));
+  ASSERT_EQ("none", create_connection(1, 2, 1));
+
+  for (int i = 0; i < 2; i++) {
+    queries.add_query(td::PromiseCreator::lambda([](td::Result<td::unique_ptr<td::mtproto::RawConnection>>) {}));
+  }
+  ASSERT_TRUE(!queries.empty());
+  ASSERT_EQ("1:0", create_connection(1, 2, 1));
+  ASSERT_EQ("1:1", create_connection(2, 2, 1));
+  ASSERT_EQ("2:0", create_connection(3, 2, 1));
+  ASSERT_EQ("2:1", create_connection(4, 2, 1));
+  ASSERT_EQ("none", create_connection(5, 2, 1));
+  ASSERT_EQ("0:0", create_connection(5, 2, 2));
+  ASSERT_EQ("none", create_connection(6, 2, 2));
+
+  // a failed racing connection is replaced with a connection with the same race index
+  td::detail::ConnectionQueries::NewConnection failed_connection;
+  failed_connection.query_id = 1;
+  failed_connection.race_index = 1;
+  queries.on_connection_finished(failed_connection);
+  ASSERT_EQ("1:1", create_connection(5, 2, 1));
+  ASSERT_EQ("none", create_connection(6, 2, 1));
+
+  // pending connections of a served query become spare connections
+  td::vector<std::pair<td::unique_ptr<td::mtproto::RawConnection>, double>> ready_connections;
+  ready_connections.emplace_back(nullptr, 0.0);
+  queries.send_ready_connections(ready_connections);
+  ASSERT_TRUE(ready_connections.empty());
+  ASSERT_EQ("none", create_connection(5, 2, 1));
+  ASSERT_EQ("none", create_connection(5, 2, 3));
+  ASSERT_EQ("0:0", create_connection(4, 2, 3));
+
+  // without racing only one connection is created for each query
+  ASSERT_EQ("none", create_connection(2, 1, 0));
+  ASSERT_EQ("0:0", create_connection(2, 1, 1));
+
+  ready_connections.emplace_back(nullptr, 0.0);
+  queries.send_ready_connections(ready_connections);
+  ASSERT_TRUE(queries.empty());
+  ASSERT_EQ("none", create_connection(1, 1, 1));
+}
+
 TEST(Time, to_unix_time) {
   ASSERT_EQ(0, td::HttpDate::to_unix_time(1970, 1, 1, 0, 0, 0).move_as_ok());
   ASSERT_EQ(60 * 60 + 60 + 1, td::HttpDate::to_unix_time(1970, 1, 1, 1, 1, 1).move_as_ok());
@@ -0,0 +1,206 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/ChainId.h"
+#include "td/telegram/net/DcId.h"
+#include "td/telegram/net/NetQuery.h"
+#include "td/telegram/net/NetQueryCoalescer.h"
+#include "td/telegram/net/NetQueryCreator.h"
+#include "td/telegram/telegram_api.h"
+#include "td/telegram/UserId.h"
+
+#include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/Status.h"
+#include "td/utils/tests.h"
+
+static td::NetQueryPtr create_get_users_query(td::NetQueryCreator &creator, td::int64 user_id) {
+  td::vector<td::telegram_api::object_ptr<td::telegram_api::InputUser>> input_users;
+  input_users.push_back(td::telegram_api::make_object<td::telegram_api::inputUser>(user_id, 1));
+  return creator.create(td::telegram_api::users_getUsers(std::move(input_users)));
+}
+
+TEST(NetQueryCoalescer, merge_duplicates) {
+  td::NetQueryCreator creator(nullptr);
+  td::NetQueryCoalescer coalescer;
+  auto dc_id = td::DcId::internal(2);
+
+  auto leader = create_get_users_query(creator, 1);
+  auto follower = create_get_users_query(creator, 1);
+  auto other_user = create_get_users_query(creator, 2);
+  auto other_dc = create_get_users_query(creator, 1);
+  ASSERT_TRUE(!coalescer.try_coalesce(leader, dc_id));
+  ASSERT_TRUE(coalescer.try_coalesce(follower, dc_id));
+  ASSERT_TRUE(follower.empty());
+  ASSERT_TRUE(!coalescer.try_coalesce(other_user, dc_id));
+  ASSERT_TRUE(!coalescer.try_coalesce(other_dc, td::DcId::internal(4)));
+  ASSERT_TRUE(coalescer.has_waiting_queries());
+
+  // a resent query must not wait for itself
+  ASSERT_TRUE(!coalescer.try_coalesce(leader, dc_id));
+
+  leader->set_ok(td::BufferSlice("answer"));
+  auto waiting_queries = coalescer.on_query_ready(leader);
+  ASSERT_EQ(1u, waiting_queries.size());
+  ASSERT_TRUE(waiting_queries[0]->is_ok());
+  ASSERT_EQ("answer", waiting_queries[0]->ok().as_slice().str());
+  ASSERT_EQ("answer", leader->ok().as_slice().str());
+  ASSERT_TRUE(!coalescer.has_waiting_queries());
+
+  // the next identical query is sent again
+  auto next = create_get_users_query(creator, 1);
+  ASSERT_TRUE(!coalescer.try_coalesce(next, dc_id));
+
+  for (auto *query : {&other_user, &other_dc, &next}) {
+    (*query)->set_error(td::Status::Error(500, "Test"));
+    ASSERT_TRUE(coalescer.on_query_ready(*query).empty());
+  }
+}
+
+TEST(NetQueryCoalescer, cancel_follower) {
+  td::NetQueryCreator creator(nullptr);
+  td::NetQueryCoalescer coalescer;
+  auto dc_id = td::DcId::internal(2);
+
+  auto leader = create_get_users_query(creator, 1);
+  auto follower = create_get_users_query(creator, 1);
+  auto canceled_follower = create_get_users_query(creator, 1);
+  auto canceled_follower_ref = canceled_follower.get_weak();
+  ASSERT_TRUE(!coalescer.try_coalesce(leader, dc_id));
+  ASSERT_TRUE(coalescer.try_coalesce(follower, dc_id));
+  ASSERT_TRUE(coalescer.try_coalesce(canceled_follower, dc_id));
+  ASSERT_TRUE(coalescer.get_canceled_queries().empty());
+
+  td::cancel_query(canceled_follower_ref);
+  auto canceled_queries = coalescer.get_canceled_queries();
+  ASSERT_EQ(1u, canceled_queries.size());
+  ASSERT_TRUE(canceled_queries[0]->is_error());
+  ASSERT_EQ(td::NetQuery::Canceled, canceled_queries[0]->error().code());
+  ASSERT_TRUE(coalescer.get_canceled_queries().empty());
+  ASSERT_TRUE(coalescer.has_waiting_queries());
+
+  // an already canceled query isn't coalesced
+  auto canceled_query = create_get_users_query(creator, 1);
+  auto canceled_query_ref = canceled_query.get_weak();
+  td::cancel_query(canceled_query_ref);
+  ASSERT_TRUE(!coalescer.try_coalesce(canceled_query, dc_id));
+  ASSERT_TRUE(canceled_query->is_error());
+
+  leader->set_ok(td::BufferSlice("answer"));
+  auto waiting_queries = coalescer.on_query_ready(leader);
+  ASSERT_EQ(1u, waiting_queries.size());
+  ASSERT_TRUE(waiting_queries[0]->is_ok());
+  ASSERT_TRUE(!coalescer.has_waiting_queries());
+}
+
+TEST(NetQueryCoalescer, cancel_leader) {
+  td::NetQueryCreator creator(nullptr);
+  td::NetQueryCoalescer coalescer;
+  auto dc_id = td::DcId::internal(2);
+
+  auto leader = create_get_users_query(creator, 1);
+  auto leader_ref = leader.get_weak();
+  auto follower = create_get_users_query(creator, 1);
+  ASSERT_TRUE(!coalescer.try_coalesce(leader, dc_id));
+  ASSERT_TRUE(coalescer.try_coalesce(follower, dc_id));
+
+  // the waiting query isn't canceled with the original query and must be sent again
+  td::cancel_query(leader_ref);
+  ASSERT_TRUE(leader->update_is_ready());
+  auto waiting_queries = coalescer.on_query_ready(leader);
+  ASSERT_EQ(1u, waiting_queries.size());
+  ASSERT_TRUE(!waiting_queries[0]->is_ready());
+  ASSERT_TRUE(!coalescer.try_coalesce(waiting_queries[0], dc_id));
+
+  auto next = create_get_users_query(creator, 1);
+  ASSERT_TRUE(coalescer.try_coalesce(next, dc_id));
+  waiting_queries[0]->set_ok(td::BufferSlice("answer"));
+  auto next_waiting_queries = coalescer.on_query_ready(waiting_queries[0]);
+  ASSERT_EQ(1u, next_waiting_queries.size());
+  ASSERT_TRUE(next_waiting_queries[0]->is_ok());
+}
+
+TEST(NetQueryCoalescer, leader_error) {
+  td::NetQueryCreator creator(nullptr);
+  td::NetQueryCoalescer coalescer;
+  auto dc_id = td::DcId::internal(2);
+
+  auto leader = create_get_users_query(creator, 1);
+  ASSERT_TRUE(!coalescer.try_coalesce(leader, dc_id));
+  for (int i = 0; i < 3; i++) {
+    auto follower = create_get_users_query(creator, 1);
+    ASSERT_TRUE(coalescer.try_coalesce(follower, dc_id));
+  }
+
+  leader->set_error(td::Status::Error(400, "USER_ID_INVALID"));
+  auto waiting_queries = coalescer.on_query_ready(leader);
+  ASSERT_EQ(3u, waiting_queries.size());
+  for (auto &query : waiting_queries) {
+    ASSERT_TRUE(query->is_error());
+    ASSERT_EQ(400, query->error().code());
+    ASSERT_EQ("USER_ID_INVALID", query->error().message().str());
+  }
+  ASSERT_TRUE(!coalescer.has_waiting_queries());
+}
+
+TEST(NetQueryCoalescer, pass_through) {
+  td::NetQueryCreator creator(nullptr);
+  td::NetQueryCoalescer coalescer;
+  auto dc_id = td::DcId::internal(2);
+
+  // only whitelisted read-only queries can be coalesced
+  td::vector<td::NetQueryPtr> queries;
+  for (int i = 0; i < 2; i++) {
+    queries.push_back(creator.create(td::telegram_api::help_getConfig()));
+    ASSERT_TRUE(!coalescer.try_coalesce(queries.back(), dc_id));
+  }
+
+  // queries in a chain must be sent in order
+  for (int i = 0; i < 2; i++) {
+    td::vector<td::telegram_api::object_ptr<td::telegram_api::InputUser>> users;
+    users.push_back(td::telegram_api::make_object<td::telegram_api::inputUser>(1, 1));
+    td::vector<td::ChainId> chain_ids{td::ChainId(td::UserId(static_cast<td::int64>(1)))};
+    queries.push_back(creator.create(td::telegram_api::users_getUsers(std::move(users)), std::move(chain_ids)));
+    ASSERT_TRUE(!coalescer.try_coalesce(queries.back(), dc_id));
+  }
+
+  // other query types are never coalesced
+  for (int i = 0; i < 2; i++) {
+    td::vector<td::telegram_api::object_ptr<td::telegram_api::InputUser>> users;
+    users.push_back(td::telegram_api::make_object<td::telegram_api::inputUser>(1, 1));
+    queries.push_back(creator.create(td::telegram_api::users_getUsers(std::move(users)), {}, td::DcId::main(),
+                                     td::NetQuery::Type::Download));
+    ASSERT_TRUE(!coalescer.try_coalesce(queries.back(), dc_id));
+  }
+  ASSERT_TRUE(!coalescer.has_waiting_queries());
+
+  for (auto &query : queries) {
+    query->set_error(td::Status::Error(500, "Test"));
+    ASSERT_TRUE(coalescer.on_query_ready(query).empty());
+  }
+}
+
+TEST(NetQueryCoalescer, clear) {
+  td::NetQueryCreator creator(nullptr);
+  td::NetQueryCoalescer coalescer;
+  auto dc_id = td::DcId::internal(2);
+
+  auto leader = create_get_users_query(creator, 1);
+  ASSERT_TRUE(!coalescer.try_coalesce(leader, dc_id));
+  for (int i = 0; i < 2; i++) {
+    auto follower = create_get_users_query(creator, 1);
+    ASSERT_TRUE(coalescer.try_coalesce(follower, dc_id));
+  }
+  auto waiting_queries = coalescer.clear();
+  ASSERT_EQ(2u, waiting_queries.size());
+  ASSERT_TRUE(!coalescer.has_waiting_queries());
+
+  leader->set_error_canceled();
+  ASSERT_TRUE(coalescer.on_query_ready(leader).empty());
+  for (auto &query : waiting_queries) {
+    query->set_error_canceled();
+  }
+}
@@ -0,0 +1,110 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/PendingNotificationUpdates.h"
+#include "td/telegram/td_api.h"
+
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/tests.h"
+
+#include <utility>
+
+static td::td_api::object_ptr<td::td_api::notification> get_notification(td::int32 notification_id) {
+  return td::td_api::make_object<td::td_api::notification>(
+      notification_id, 1, false, td::td_api::make_object<td::td_api::notificationTypeNewSecretChat>());
+}
+
+static td::td_api::object_ptr<td::td_api::Update> get_update_notification_group(
+    td::int32 group_id, td::int32 total_count, td::vector<td::int32> added_notification_ids,
+    td::vector<td::int32> removed_notification_ids) {
+  td::vector<td::td_api::object_ptr<td::td_api::notification>> added_notifications;
+  for (auto notification_id : added_notification_ids) {
+    added_notifications.push_back(get_notification(notification_id));
+  }
+  return td::td_api::make_object<td::td_api::updateNotificationGroup>(
+      group_id, td::td_api::make_object<td::td_api::notificationGroupTypeMessages>(), 1, 1, 0, total_count,
+      std::move(added_notifications), std::move(removed_notification_ids));
+}
+
+static td::td_api::updateNotificationGroup &as_update_notification_group(
+    td::td_api::object_ptr<td::td_api::Update> &update) {
+  CHECK(update != nullptr);
+  CHECK(update->get_id() == td::td_api::updateNotificationGroup::ID);
+  return static_cast<td::td_api::updateNotificationGroup &>(*update);
+}
+
+TEST(PendingNotificationUpdates, merge_during_get_difference) {
+  td::PendingNotificationUpdates pending_updates;
+
+  ASSERT_TRUE(pending_updates.add_update(1, get_update_notification_group(1, 1, {1}, {})));
+  auto updates = pending_updates.flush_updates(1, false);
+  ASSERT_EQ(1u, updates.size());
+  ASSERT_TRUE(pending_updates.empty());
+
+  pending_updates.on_get_difference_started();
+
+  // a notification is added, edited and removed in the first group
+  ASSERT_TRUE(pending_updates.add_update(1, get_update_notification_group(1, 2, {2}, {})));
+  ASSERT_TRUE(!pending_updates.add_update(1, td::td_api::make_object<td::td_api::updateNotification>(
+                                                  1, get_notification(2))));
+  ASSERT_TRUE(!pending_updates.add_update(1, get_update_notification_group(1, 1, {}, {2})));
+
+  // two notifications are added one by one in the second group
+  ASSERT_TRUE(pending_updates.add_update(2, get_update_notification_group(2, 1, {10}, {})));
+  ASSERT_TRUE(!pending_updates.add_update(2, get_update_notification_group(2, 2, {11}, {})));
+
+  ASSERT_EQ(2u, pending_updates.get_group_count());
+  ASSERT_EQ(3u, pending_updates.get_update_count(1));
+  ASSERT_EQ(2u, pending_updates.get_update_count(2));
+
+  // only the changed total count remains in the first group
+  updates = pending_updates.flush_updates(1, false);
+  ASSERT_EQ(1u, updates.size());
+  auto &first_update = as_update_notification_group(updates[0]);
+  ASSERT_EQ(1, first_update.total_count_);
+  ASSERT_TRUE(first_update.added_notifications_.empty());
+  ASSERT_TRUE(first_update.removed_notification_ids_.empty());
+
+  // additions are combined into one update in the second group
+  updates = pending_updates.flush_updates(2, false);
+  ASSERT_EQ(1u, updates.size());
+  auto &second_update = as_update_notification_group(updates[0]);
+  ASSERT_EQ(2, second_update.total_count_);
+  ASSERT_EQ(2u, second_update.added_notifications_.size());
+  ASSERT_EQ(10, second_update.added_notifications_[0]->id_);
+  ASSERT_EQ(11, second_update.added_notifications_[1]->id_);
+  ASSERT_TRUE(pending_updates.empty());
+
+  auto get_difference_stats = pending_updates.get_difference_stats();
+  ASSERT_EQ(5, get_difference_stats.added_update_count);
+  ASSERT_EQ(2, get_difference_stats.sent_update_count);
+  auto stats = pending_updates.get_stats();
+  ASSERT_EQ(6, stats.added_update_count);
+  ASSERT_EQ(3, stats.sent_update_count);
+}
+
+TEST(PendingNotificationUpdates, drop_updates) {
+  td::PendingNotificationUpdates pending_updates;
+  pending_updates.on_get_difference_started();
+
+  ASSERT_TRUE(pending_updates.add_update(1, get_update_notification_group(1, 1, {1}, {})));
+  ASSERT_TRUE(pending_updates.add_update(2, get_update_notification_group(2, 1, {2}, {})));
+  ASSERT_TRUE(pending_updates.has_updates(1));
+  ASSERT_TRUE(pending_updates.get_updates(3) == nullptr);
+  ASSERT_EQ(1u, pending_updates.get_updates(2)->size());
+
+  // dropped updates aren't sent
+  ASSERT_TRUE(pending_updates.drop_updates(1));
+  ASSERT_TRUE(!pending_updates.drop_updates(1));
+  ASSERT_TRUE(!pending_updates.has_updates(1));
+  ASSERT_TRUE(pending_updates.flush_updates(1, false).empty());
+  ASSERT_EQ(1u, pending_updates.flush_updates(2, false).size());
+
+  auto get_difference_stats = pending_updates.get_difference_stats();
+  ASSERT_EQ(2, get_difference_stats.added_update_count);
+  ASSERT_EQ(1, get_difference_stats.sent_update_count);
+}
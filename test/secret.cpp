@@ -12,6 +12,7 @@
 #include "td/telegram/secret_api.h"
 #include "td/telegram/SecretChatActor.h"
 #include "td/telegram/SecretChatDb.h"
+#include "td/telegram/SecretChatDecryptionWorker.h"
 #include "td/telegram/SecretChatId.h"
 #include "td/telegram/telegram_api.h"
 #include "td/telegram/UserId.h"
@@ -45,7 +46,9 @@
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
+#include "td/utils/StringBuilder.h"
 #include "td/utils/tests.h"
+#include "td/utils/Time.h"
 #include "td/utils/tl_helpers.h"
 #include "td/utils/tl_parsers.h"
 #include "td/utils/tl_storers.h"
@@ -90,12 +93,12 @@ class inputUser final : public InputUser {
   int64 user_id_{};
   int64 access_hash_{};
 
-  static const int32 ID = -668391402;
+  static const int32 ID = -233744186;
   inputUser() = default;
 
   explicit inputUser(TlBufferParser &p)
 #define FAIL(error) p.set_error(error)
-      : user_id_(TlFetchInt::parse(p))
+      : user_id_(TlFetchLong::parse(p))
       , access_hash_(TlFetchLong::parse(p))
 #undef FAIL
   {
@@ -275,7 +278,7 @@ class encryptedChat final {
       , key_fingerprint_(key_fingerprint) {
   }
 
-  static const int32 ID = -94974410;
+  static const int32 ID = 1643173063;
   int32 get_id() const {
     return ID;
   }
@@ -485,10 +488,12 @@ class Master;
 class FakeSecretChatContext final : public SecretChatActor::Context {
  public:
   FakeSecretChatContext(std::shared_ptr<BinlogInterface> binlog, std::shared_ptr<KeyValueSyncInterface> key_value,
-                        std::shared_ptr<bool> close_flag, ActorShared<Master> master)
+                        std::shared_ptr<bool> close_flag,
+                        vector<ActorId<SecretChatDecryptionWorker>> decryption_workers, ActorShared<Master> master)
       : binlog_(std::move(binlog))
       , key_value_(std::move(key_value))
       , close_flag_(std::move(close_flag))
+      , decryption_workers_(std::move(decryption_workers))
       , master_(std::move(master)) {
     secret_chat_db_ = std::make_shared<SecretChatDb>(key_value_, 1);
     net_query_creator_.stop_check();  // :(
@@ -505,6 +510,9 @@ class FakeSecretChatContext final : public SecretChatActor::Context {
   bool close_flag() final {
     return *close_flag_;
   }
+  vector<ActorId<SecretChatDecryptionWorker>> get_decryption_workers() final {
+    return decryption_workers_;
+  }
   BinlogInterface *binlog() final {
     return binlog_.get();
   }
@@ -561,6 +569,7 @@ class FakeSecretChatContext final : public SecretChatActor::Context {
   std::shared_ptr<BinlogInterface> binlog_;
   std::shared_ptr<KeyValueSyncInterface> key_value_;
   std::shared_ptr<bool> close_flag_;
+  vector<ActorId<SecretChatDecryptionWorker>> decryption_workers_;
   ActorShared<Master> master_;
 
   std::shared_ptr<SecretChatDb> secret_chat_db_;
@@ -569,11 +578,19 @@ NetQueryCreator FakeSecretChatContext::net_query_creator_{nullptr};
 
 class Master final : public Actor {
  public:
-  explicit Master(Status *status) : status_(status) {
+  // if bench_message_count is positive, then instead of exchanging pings, messages sent by alice are collected
+  // and the time needed for bob to receive all of them is measured
+  Master(Status *status, int32 ping_count, int32 decryption_worker_count, int32 bench_message_count = 0)
+      : status_(status)
+      , ping_count_(ping_count)
+      , decryption_worker_count_(decryption_worker_count)
+      , bench_message_count_(bench_message_count) {
   }
   class SecretChatProxy final : public Actor {
    public:
-    SecretChatProxy(string name, ActorShared<Master> parent) : name_(std::move(name)) {
+    SecretChatProxy(string name, vector<ActorId<SecretChatDecryptionWorker>> decryption_workers,
+                    ActorShared<Master> parent)
+        : name_(std::move(name)), decryption_workers_(std::move(decryption_workers)) {
       binlog_ = std::make_shared<FakeBinlog>();
       key_value_ = std::make_shared<FakeKeyValue>();
       key_value_->external_init_begin(LogEvent::HandlerType::BinlogPmcMagic);
@@ -583,7 +600,9 @@ class Master final : public Actor {
       parent_token_ = parent.token();
       actor_ = create_actor<SecretChatActor>(
           PSLICE() << "SecretChat " << name_, 123,
-          td::make_unique<FakeSecretChatContext>(binlog_, key_value_, close_flag_, std::move(parent)), true);
+          td::make_unique<FakeSecretChatContext>(binlog_, key_value_, close_flag_, decryption_workers_,
+                                                 std::move(parent)),
+          true);
       on_binlog_replay_finish();
     }
 
@@ -664,7 +683,7 @@ class Master final : public Actor {
 
       actor_ = create_actor<SecretChatActor>(
           PSLICE() << "SecretChat " << name_, 123,
-          td::make_unique<FakeSecretChatContext>(binlog_, key_value_, close_flag_,
+          td::make_unique<FakeSecretChatContext>(binlog_, key_value_, close_flag_, decryption_workers_,
                                                  ActorShared<Master>(parent_, parent_token_)),
           true);
 
@@ -709,6 +728,7 @@ class Master final : public Actor {
 
    private:
     string name_;
+    vector<ActorId<SecretChatDecryptionWorker>> decryption_workers_;
 
     ActorId<Master> parent_;
     uint64 parent_token_;
@@ -763,8 +783,15 @@ class Master final : public Actor {
   }
   void start_up() final {
     auto old_context = set_context(std::make_shared<Global>());
-    alice_ = create_actor<SecretChatProxy>("SecretChatProxy alice", "alice", actor_shared(this, 1));
-    bob_ = create_actor<SecretChatProxy>("SecretChatProxy bob", "bob", actor_shared(this, 2));
+    // each worker is created on its own scheduler, so decrypted messages can be received out of order
+    vector<ActorId<SecretChatDecryptionWorker>> decryption_workers;
+    for (int32 i = 0; i < decryption_worker_count_; i++) {
+      decryption_workers_.push_back(create_actor_on_scheduler<SecretChatDecryptionWorker>(
+          PSLICE() << "SecretChatDecryptionWorker " << i, i + 1));
+      decryption_workers.push_back(decryption_workers_.back().get());
+    }
+    alice_ = create_actor<SecretChatProxy>("SecretChatProxy alice", "alice", decryption_workers, actor_shared(this, 1));
+    bob_ = create_actor<SecretChatProxy>("SecretChatProxy bob", "bob", decryption_workers, actor_shared(this, 2));
     send_closure(alice_.get_actor_unsafe()->actor_, &SecretChatActor::create_chat, UserId(static_cast<int64>(2)), 0,
                  123, PromiseCreator::lambda([actor_id = actor_id(this)](Result<SecretChatId> res) {
                    send_closure(actor_id, &Master::on_get_secret_chat_id, std::move(res), false);
@@ -791,7 +818,7 @@ class Master final : public Actor {
   }
 
   void send_net_query(NetQueryPtr query, ActorShared<NetQueryCallback> callback, bool ordered) {
-    if (can_fail(query) && Random::fast_bool()) {
+    if (bench_message_count_ == 0 && can_fail(query) && Random::fast_bool()) {
       LOG(INFO) << "Fail query " << query;
       auto resend_promise =
           PromiseCreator::lambda([self = actor_shared(this, get_link_token()), callback_actor = callback.get(),
@@ -864,9 +891,16 @@ class Master final : public Actor {
     CHECK(real_size == answer.size());
     net_query->set_ok(std::move(answer));
     send_closure(std::move(callback), &NetQueryCallback::on_result, std::move(net_query));
+    if (bench_message_count_ > 0) {
+      // secret chats aren't restarted during the benchmark
+      for (int32 i = 0; i < bench_message_count_; i++) {
+        send_message(1, PSTRING() << "BENCH: " << i);
+      }
+      return;
+    }
     send_closure(alice_, &SecretChatProxy::start_test);
     send_closure(bob_, &SecretChatProxy::start_test);
-    send_ping(1, 5000);
+    send_ping(1, ping_count_);
     set_timeout_in(1);
   }
   void timeout_expired() final {
@@ -907,6 +941,11 @@ class Master final : public Actor {
     net_query->set_ok(std::move(answer));
     send_closure(std::move(callback), &NetQueryCallback::on_result, std::move(net_query));
 
+    if (bench_message_count_ > 0 && get_link_token() == 1 && bench_start_time_ == 0.0) {
+      bench_messages_.push_back(std::move(data));
+      return;
+    }
+
     // We can't loose updates yet :(
     auto crc = crc64(data.as_slice());
     LOG(INFO) << "Send SecretChatProxy::add_inbound_message" << tag("crc", crc);
@@ -918,6 +957,18 @@ class Master final : public Actor {
   void on_inbound_message(string message, Promise<> promise) {
     promise.set_value(Unit());
     LOG(INFO) << "Receive inbound message: " << message << " " << get_link_token();
+    if (bench_message_count_ > 0) {
+      if (get_link_token() == 2 && begins_with(message, "BENCH: ") &&
+          ++bench_received_count_ == bench_message_count_) {
+        auto elapsed_time = Time::now() - bench_start_time_;
+        LOG(ERROR) << "Bench [Receive " << bench_message_count_ << " secret chat messages with "
+                   << decryption_worker_count_ << " decryption workers]: "
+                   << StringBuilder::FixedDouble(elapsed_time * 1e9 / bench_message_count_, 3) << " ns per message";
+        Scheduler::instance()->finish();
+        *status_ = Status::OK();
+      }
+      return;
+    }
     int32 cnt;
     int x = std::sscanf(message.c_str(), "PING: %d", &cnt);
     if (x != 1) {
@@ -957,10 +1008,33 @@ class Master final : public Actor {
     }
     CHECK(it != sent_messages_.end());
     // sent_messages_.erase(it);
+    if (bench_message_count_ > 0 && ++bench_sent_count_ == bench_message_count_) {
+      start_bench();
+    }
+  }
+
+  // passes all collected messages, including service messages sent by alice, to bob at once,
+  // like it happens when a lot of updates are received after a reconnect
+  void start_bench() {
+    LOG(INFO) << "Pass " << bench_messages_.size() << " messages to bob";
+    bench_start_time_ = Time::now();
+    for (auto &data : bench_messages_) {
+      auto crc = crc64(data.as_slice());
+      send_closure(bob_, &SecretChatProxy::add_inbound_message, 2, std::move(data), crc);
+    }
+    bench_messages_.clear();
   }
 
  private:
   Status *status_;
+  int32 ping_count_;
+  int32 decryption_worker_count_;
+  int32 bench_message_count_;
+  vector<BufferSlice> bench_messages_;
+  int32 bench_sent_count_ = 0;
+  int32 bench_received_count_ = 0;
+  double bench_start_time_ = 0.0;
+  vector<ActorOwn<SecretChatDecryptionWorker>> decryption_workers_;
   ActorOwn<SecretChatProxy> alice_;
   ActorOwn<SecretChatProxy> bob_;
   struct Message {
@@ -1007,7 +1081,7 @@ TEST(Secret, go) {
   ConcurrentScheduler sched(0, 0);
 
   Status result;
-  sched.create_actor_unsafe<Master>(0, "HandshakeTestActor", &result).release();
+  sched.create_actor_unsafe<Master>(0, "HandshakeTestActor", &result, 5000, 0).release();
   sched.start();
   while (sched.run_main(10)) {
     // empty;
@@ -1020,4 +1094,40 @@ TEST(Secret, go) {
   ASSERT_TRUE(result.is_ok());
 }
 
+TEST(Secret, go_with_decryption_workers) {
+  ConcurrentScheduler sched(2, 0);
+
+  Status result;
+  sched.create_actor_unsafe<Master>(0, "HandshakeTestActor", &result, 300, 2).release();
+  sched.start();
+  while (sched.run_main(10)) {
+    // empty;
+  }
+  sched.finish();
+
+  if (result.is_error()) {
+    LOG(ERROR) << result;
+  }
+  ASSERT_TRUE(result.is_ok());
+}
+
+TEST(Secret, bench_inbound_messages) {
+  for (int32 decryption_worker_count : {0, 3}) {
+    ConcurrentScheduler sched(decryption_worker_count, 0);
+
+    Status result;
+    sched.create_actor_unsafe<Master>(0, "HandshakeTestActor", &result, 0, decryption_worker_count, 10000).release();
+    sched.start();
+    while (sched.run_main(10)) {
+      // empty;
+    }
+    sched.finish();
+
+    if (result.is_error()) {
+      LOG(ERROR) << result;
+    }
+    ASSERT_TRUE(result.is_ok());
+  }
+}
+
 }  // namespace td
@@ -0,0 +1,183 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/files/FileId.h"
+#include "td/telegram/StickerSearchIndex.h"
+#include "td/telegram/StickerSetId.h"
+
+#include "td/utils/algorithm.h"
+#include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/misc.h"
+#include "td/utils/Random.h"
+#include "td/utils/tests.h"
+
+#include <map>
+
+namespace {
+struct TestStickerSet {
+  td::vector<td::FileId> sticker_ids;
+  std::map<td::string, td::vector<td::FileId>> emoji_stickers;
+  std::map<td::string, td::vector<td::FileId>> keyword_stickers;
+};
+}  // namespace
+
+static td::StickerSetId sid(td::int64 sticker_set_id) {
+  return td::StickerSetId(sticker_set_id);
+}
+
+static void update_sticker_set(td::StickerSearchIndex &index, std::map<td::int64, TestStickerSet> &sets,
+                               td::int64 sticker_set_id, const TestStickerSet &sticker_set) {
+  td::FlatHashMap<td::string, td::vector<td::FileId>> emoji_stickers;
+  for (auto &it : sticker_set.emoji_stickers) {
+    emoji_stickers[it.first] = it.second;
+  }
+  index.update_sticker_set(sid(sticker_set_id), sticker_set.sticker_ids, emoji_stickers,
+                           sticker_set.keyword_stickers);
+  sets[sticker_set_id] = sticker_set;
+}
+
+// the same search as StickersManager::can_find_sticker_by_query did for every sticker of every set
+static std::map<td::int64, td::vector<td::FileId>> naive_find_stickers(const std::map<td::int64, TestStickerSet> &sets,
+                                                                       const td::vector<td::string> &emojis,
+                                                                       const td::string &query) {
+  std::map<td::int64, td::vector<td::FileId>> result;
+  for (auto &it : sets) {
+    const auto &sticker_set = it.second;
+    for (auto sticker_id : sticker_set.sticker_ids) {
+      bool is_found = false;
+      for (auto &emoji : emojis) {
+        auto emoji_it = sticker_set.emoji_stickers.find(emoji);
+        if (emoji_it != sticker_set.emoji_stickers.end() && td::contains(emoji_it->second, sticker_id)) {
+          is_found = true;
+        }
+      }
+      if (!query.empty()) {
+        for (auto keyword_it = sticker_set.keyword_stickers.lower_bound(query);
+             keyword_it != sticker_set.keyword_stickers.end() && td::begins_with(keyword_it->first, query);
+             ++keyword_it) {
+          if (td::contains(keyword_it->second, sticker_id)) {
+            is_found = true;
+          }
+        }
+      }
+      if (is_found) {
+        result[it.first].push_back(sticker_id);
+      }
+    }
+  }
+  return result;
+}
+
+static void check_find_stickers(const td::StickerSearchIndex &index, const std::map<td::int64, TestStickerSet> &sets,
+                                const td::vector<td::string> &emojis, const td::string &query) {
+  auto found_sticker_ids = index.find_stickers(emojis, query);
+  std::map<td::int64, td::vector<td::FileId>> result;
+  for (auto &it : found_sticker_ids) {
+    ASSERT_TRUE(!it.second.empty());
+    result[it.first.get()] = std::move(it.second);
+  }
+  auto expected = naive_find_stickers(sets, emojis, query);
+  ASSERT_EQ(expected.size(), result.size());
+  for (auto &it : expected) {
+    ASSERT_TRUE(result[it.first] == it.second);
+  }
+}
+
+TEST(StickerSearchIndex, update_and_remove) {
+  td::StickerSearchIndex index;
+  std::map<td::int64, TestStickerSet> sets;
+  td::FileId a(1, 0);
+  td::FileId b(2, 0);
+  td::FileId c(3, 0);
+
+  TestStickerSet sticker_set;
+  sticker_set.sticker_ids = {a, b, c};
+  sticker_set.emoji_stickers["x"] = {c, a};
+  sticker_set.emoji_stickers["y"] = {b};
+  sticker_set.keyword_stickers["cat"] = {b};
+  sticker_set.keyword_stickers["car"] = {c};
+  update_sticker_set(index, sets, 10, sticker_set);
+  ASSERT_TRUE(index.has_sticker_set(sid(10)));
+  ASSERT_TRUE(!index.has_sticker_set(sid(11)));
+
+  // stickers are returned in the order of the sticker set
+  auto found = index.find_stickers({"x"}, "");
+  ASSERT_EQ(1u, found.size());
+  ASSERT_TRUE((found[sid(10)] == td::vector<td::FileId>{a, c}));
+  found = index.find_stickers({"x", "y"}, "ca");
+  ASSERT_TRUE((found[sid(10)] == td::vector<td::FileId>{a, b, c}));
+  found = index.find_stickers({}, "cat");
+  ASSERT_TRUE((found[sid(10)] == td::vector<td::FileId>{b}));
+  ASSERT_TRUE(index.find_stickers({"z"}, "dog").empty());
+
+  // the same sticker set can be indexed again, for example, after it is loaded from the database;
+  // its previous postings must be replaced
+  sticker_set.sticker_ids = {c, b};
+  sticker_set.emoji_stickers.erase("x");
+  sticker_set.keyword_stickers["dog"] = {c};
+  update_sticker_set(index, sets, 10, sticker_set);
+  update_sticker_set(index, sets, 10, sticker_set);
+  ASSERT_TRUE(index.find_stickers({"x"}, "").empty());
+  found = index.find_stickers({"y"}, "d");
+  ASSERT_TRUE((found[sid(10)] == td::vector<td::FileId>{c, b}));
+  check_find_stickers(index, sets, {"x", "y"}, "ca");
+
+  // an index of a removed sticker set is reused
+  index.remove_sticker_set(sid(10));
+  sets.erase(10);
+  ASSERT_TRUE(!index.has_sticker_set(sid(10)));
+  ASSERT_TRUE(index.find_stickers({"y"}, "c").empty());
+  update_sticker_set(index, sets, 20, sticker_set);
+  check_find_stickers(index, sets, {"y"}, "c");
+  index.remove_sticker_set(sid(30));
+}
+
+TEST(StickerSearchIndex, random) {
+  td::vector<td::string> emojis{"a", "b", "c", "d", "e"};
+  td::vector<td::string> keywords{"cat", "car", "cart", "dog", "do", "d", "x"};
+  td::vector<td::string> queries{"", "c", "ca", "car", "d", "do", "dog", "x", "y"};
+
+  td::StickerSearchIndex index;
+  std::map<td::int64, TestStickerSet> sets;
+  td::int32 next_file_id = 1;
+  for (int i = 0; i < 1000; i++) {
+    auto sticker_set_id = static_cast<td::int64>(td::Random::fast(1, 10));
+    if (td::Random::fast(0, 4) == 0) {
+      index.remove_sticker_set(sid(sticker_set_id));
+      sets.erase(sticker_set_id);
+    } else {
+      TestStickerSet sticker_set;
+      auto sticker_count = td::Random::fast(0, 8);
+      for (int j = 0; j < sticker_count; j++) {
+        sticker_set.sticker_ids.emplace_back(next_file_id++, 0);
+      }
+      for (auto sticker_id : sticker_set.sticker_ids) {
+        for (auto &emoji : emojis) {
+          if (td::Random::fast(0, 3) == 0) {
+            sticker_set.emoji_stickers[emoji].push_back(sticker_id);
+          }
+        }
+        for (auto &keyword : keywords) {
+          if (td::Random::fast(0, 4) == 0) {
+            sticker_set.keyword_stickers[keyword].push_back(sticker_id);
+          }
+        }
+      }
+      update_sticker_set(index, sets, sticker_set_id, sticker_set);
+    }
+
+    for (auto &query : queries) {
+      td::vector<td::string> query_emojis;
+      for (auto &emoji : emojis) {
+        if (td::Random::fast(0, 2) == 0) {
+          query_emojis.push_back(emoji);
+        }
+      }
+      check_find_stickers(index, sets, query_emojis, query);
+    }
+  }
+}